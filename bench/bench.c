@@ -0,0 +1,758 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file bench.c
+ *   Microbenchmarks for parallel region spawn latency, barrier latency, and
+ *   data sharing round trips, with POSIX and OpenMP barrier baselines.
+ *   Linux only. Built and run by `make bench`.
+ *****************************************************************************/
+
+#include <spindle.h>
+#include <topo.h>
+
+#include <getopt.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Default number of timed samples taken for each result. One additional untimed sample warms up caches and the thread pool.
+#define kBenchDefaultSampleCount                10
+
+/// Default number of barriers or data sharing round trips performed per sample.
+#define kBenchDefaultIterationCount             10000
+
+/// Default number of parallel regions spawned per sample when measuring spawn latency.
+#define kBenchDefaultSpawnIterationCount        100
+
+/// Number of SMT policies swept by the barrier and data sharing benchmarks.
+#define kBenchSMTPolicyCount                    3
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Enumerates the operations that can be timed within a parallel region.
+typedef enum EBenchKernel
+{
+    BenchKernelBarrierLocal,                                                ///< Spindle local barrier.
+    BenchKernelBarrierGlobal,                                               ///< Spindle global barrier.
+    BenchKernelBarrierPthread,                                              ///< `pthread_barrier_t` shared by all threads in the parallel region.
+    BenchKernelDataShareLocal,                                              ///< Round trip of a 64-bit value between the first and last threads of a task.
+    BenchKernelDataShareGlobal                                              ///< Round trip of a 64-bit value between the first and last threads of the parallel region.
+} EBenchKernel;
+
+/// Enumerates the ways of spawning a parallel region whose latency is measured.
+typedef enum EBenchSpawnMethod
+{
+    BenchSpawnMethodCreate,                                                 ///< Synchronous spawn that creates OS threads, without using the calling thread.
+    BenchSpawnMethodCreateUseCurrent,                                       ///< Synchronous spawn that creates OS threads and uses the calling thread as a worker.
+    BenchSpawnMethodPool,                                                   ///< Synchronous spawn with the thread pool enabled.
+    BenchSpawnMethodAsync,                                                  ///< Asynchronous spawn immediately followed by a join.
+    BenchSpawnMethodCount                                                   ///< Number of spawn methods. Not a valid method.
+} EBenchSpawnMethod;
+
+/// Argument passed to every thread of a parallel region that times a kernel.
+typedef struct SBenchRegionArg
+{
+    EBenchKernel kernel;                                                    ///< Operation to time.
+    uint64_t iterationCount;                                                ///< Number of operations per sample.
+    uint32_t sampleCount;                                                   ///< Number of timed samples.
+    double* samples;                                                        ///< Filled by the first thread with the average nanoseconds per operation of each sample.
+    pthread_barrier_t* pthreadBarrier;                                      ///< Barrier for #BenchKernelBarrierPthread, initialized for all threads in the parallel region.
+} SBenchRegionArg;
+
+/// A single benchmark result, summarizing all samples taken for one configuration.
+typedef struct SBenchResult
+{
+    const char* benchmark;                                                  ///< Operation measured.
+    const char* variant;                                                    ///< Implementation or method used to perform the operation.
+    const char* smtPolicy;                                                  ///< SMT policy used to place threads, or "-" if placement is not controlled by Spindle.
+    uint32_t taskCount;                                                     ///< Number of Spindle tasks.
+    uint32_t threadCount;                                                   ///< Total number of threads.
+    uint64_t iterationCount;                                                ///< Number of operations per sample.
+    uint32_t sampleCount;                                                   ///< Number of timed samples.
+    double minNanoseconds;                                                  ///< Fastest sample, in nanoseconds per operation.
+    double medianNanoseconds;                                               ///< Median sample, in nanoseconds per operation.
+    double meanNanoseconds;                                                 ///< Mean of all samples, in nanoseconds per operation.
+    double maxNanoseconds;                                                  ///< Slowest sample, in nanoseconds per operation.
+} SBenchResult;
+
+
+// -------- LOCALS --------------------------------------------------------- //
+
+/// Number of timed samples taken for each result.
+static uint32_t benchSampleCount = kBenchDefaultSampleCount;
+
+/// Number of barriers or data sharing round trips per sample.
+static uint64_t benchIterationCount = kBenchDefaultIterationCount;
+
+/// Number of parallel regions spawned per sample.
+static uint64_t benchSpawnIterationCount = kBenchDefaultSpawnIterationCount;
+
+/// Largest number of threads per task to measure, or 0 for no limit beyond what each NUMA node provides.
+static uint32_t benchMaxThreadsPerTask = 0;
+
+/// Barrier waiting policy used for all Spindle parallel regions.
+static ESpindleBarrierWaitPolicy benchWaitPolicy = SpindleBarrierWaitPolicySpin;
+
+/// Number of NUMA nodes in the system. Tasks that span the whole system place one task on each.
+static uint32_t benchNUMANodeCount = 0;
+
+/// All results recorded so far, in the order in which they were measured.
+static SBenchResult* benchResults = NULL;
+
+/// Number of results recorded so far.
+static uint32_t benchResultCount = 0;
+
+/// Number of benchmarks that could not be run due to an error.
+static uint32_t benchErrorCount = 0;
+
+/// Names of the SMT policies, indexed by policy, as written to the output.
+static const char* const benchSMTPolicyNames[kBenchSMTPolicyCount] = { "disable-smt", "prefer-physical", "prefer-logical" };
+
+/// Names of the spawn methods, indexed by method, as written to the output.
+static const char* const benchSpawnMethodNames[BenchSpawnMethodCount] = { "create", "create-use-current", "pool", "async" };
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Reads a monotonic clock that is unaffected by frequency scaling.
+/// @return Current time, in nanoseconds.
+static uint64_t benchHelperGetTimeNanoseconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec;
+}
+
+// --------
+
+/// Compares two samples for sorting in ascending order.
+/// @param [in] a First sample.
+/// @param [in] b Second sample.
+/// @return Negative, zero, or positive, as required by `qsort`.
+static int benchHelperCompareSamples(const void* a, const void* b)
+{
+    const double sampleA = *(const double*)a;
+    const double sampleB = *(const double*)b;
+
+    return (sampleA > sampleB) - (sampleA < sampleB);
+}
+
+// --------
+
+/// Summarizes the specified samples and appends the summary to the list of results.
+/// Reorders the samples in the process.
+/// @param [in] benchmark Operation measured.
+/// @param [in] variant Implementation or method used to perform the operation.
+/// @param [in] smtPolicy SMT policy name, or "-" if placement is not controlled by Spindle.
+/// @param [in] taskCount Number of Spindle tasks.
+/// @param [in] threadCount Total number of threads.
+/// @param [in] iterationCount Number of operations per sample.
+/// @param [in,out] samples Nanoseconds per operation of each sample.
+static void benchHelperRecordResult(const char* benchmark, const char* variant, const char* smtPolicy, uint32_t taskCount, uint32_t threadCount, uint64_t iterationCount, double* samples)
+{
+    SBenchResult* const results = realloc(benchResults, sizeof(SBenchResult) * (benchResultCount + 1));
+    SBenchResult* result = NULL;
+    double sampleSum = 0.0;
+
+    if (NULL == results)
+    {
+        fprintf(stderr, "Out of memory recording %s %s with %u threads.\n", benchmark, variant, threadCount);
+        benchErrorCount += 1;
+        return;
+    }
+
+    qsort(samples, benchSampleCount, sizeof(double), benchHelperCompareSamples);
+
+    for (uint32_t sampleIndex = 0; sampleIndex < benchSampleCount; ++sampleIndex)
+        sampleSum += samples[sampleIndex];
+
+    benchResults = results;
+    result = &benchResults[benchResultCount];
+    benchResultCount += 1;
+
+    result->benchmark = benchmark;
+    result->variant = variant;
+    result->smtPolicy = smtPolicy;
+    result->taskCount = taskCount;
+    result->threadCount = threadCount;
+    result->iterationCount = iterationCount;
+    result->sampleCount = benchSampleCount;
+    result->minNanoseconds = samples[0];
+    result->medianNanoseconds = ((0 == (benchSampleCount & 1)) ? ((samples[(benchSampleCount / 2) - 1] + samples[benchSampleCount / 2]) / 2.0) : samples[benchSampleCount / 2]);
+    result->meanNanoseconds = sampleSum / (double)benchSampleCount;
+    result->maxNanoseconds = samples[benchSampleCount - 1];
+
+    fprintf(stderr, "%-16s  %-18s  %-15s  %3u tasks  %4u threads  %12.1f ns\n", benchmark, variant, smtPolicy, taskCount, threadCount, result->medianNanoseconds);
+}
+
+// --------
+
+/// Determines the largest number of threads per task that every NUMA node can accommodate under the specified SMT policy.
+/// @param [in] smtPolicy SMT policy.
+/// @param [in] taskCount Number of tasks, which are placed on NUMA nodes starting from the first.
+/// @return Largest number of threads per task, subject to the user-specified limit.
+static uint32_t benchHelperMaxThreadsPerTask(ESpindleSMTPolicy smtPolicy, uint32_t taskCount)
+{
+    uint32_t maxThreads = UINT32_MAX;
+
+    for (uint32_t numaNode = 0; numaNode < taskCount; ++numaNode)
+    {
+        const uint32_t nodeThreads = ((SpindleSMTPolicyDisableSMT == smtPolicy) ? topoGetNUMANodePhysicalCoreCount(numaNode) : topoGetNUMANodeLogicalCoreCount(numaNode));
+
+        if (nodeThreads < maxThreads)
+            maxThreads = nodeThreads;
+    }
+
+    if ((0 != benchMaxThreadsPerTask) && (benchMaxThreadsPerTask < maxThreads))
+        maxThreads = benchMaxThreadsPerTask;
+
+    return maxThreads;
+}
+
+// --------
+
+/// Determines the next number of threads per task to measure, sweeping powers of two and always including the largest.
+/// @param [in] threadsPerTask Number of threads per task just measured.
+/// @param [in] maxThreadsPerTask Largest number of threads per task to measure.
+/// @return Next number of threads per task, or a value greater than the largest once the sweep is complete.
+static uint32_t benchHelperNextThreadsPerTask(uint32_t threadsPerTask, uint32_t maxThreadsPerTask)
+{
+    if ((threadsPerTask < maxThreadsPerTask) && ((threadsPerTask * 2) > maxThreadsPerTask))
+        return maxThreadsPerTask;
+
+    return threadsPerTask * 2;
+}
+
+// --------
+
+/// Fills task specifications that place one task on each of the first NUMA nodes, all with the same number of threads, along with their options.
+/// @param [out] taskSpec Task specifications, as an array.
+/// @param [out] taskOptions Task options, as an array parallel to the task specifications.
+/// @param [in] taskCount Number of tasks.
+/// @param [in] threadsPerTask Number of threads in each task.
+/// @param [in] smtPolicy SMT policy for all tasks.
+/// @param [in] func Starting function for all threads.
+/// @param [in] arg Argument to pass to the starting function.
+static void benchHelperFillTaskSpecs(SSpindleTaskSpec* taskSpec, SSpindleTaskOptions* taskOptions, uint32_t taskCount, uint32_t threadsPerTask, ESpindleSMTPolicy smtPolicy, TSpindleFunc func, void* arg)
+{
+    spindleTaskOptionsInit(taskOptions, taskCount);
+
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+        taskSpec[taskIndex].func = func;
+        taskSpec[taskIndex].arg = arg;
+        taskSpec[taskIndex].numaNode = taskIndex;
+        taskSpec[taskIndex].numThreads = threadsPerTask;
+        taskSpec[taskIndex].smtPolicy = smtPolicy;
+        taskOptions[taskIndex].barrierWaitPolicy = benchWaitPolicy;
+    }
+}
+
+// --------
+
+/// Starting function for parallel regions whose latency is measured. Does nothing.
+/// @param [in] arg Unused.
+static void benchHelperEmptyRegion(void* arg)
+{
+    (void)arg;
+}
+
+// --------
+
+/// Starting function for parallel regions that time a kernel.
+/// All threads perform the kernel together, and the first thread in the parallel region times it, discarding an initial warm-up sample.
+/// @param [in] arg Pointer to a #SBenchRegionArg.
+static void benchHelperKernelRegion(void* arg)
+{
+    const SBenchRegionArg* const regionArg = (const SBenchRegionArg*)arg;
+    const bool isTimingThread = (0 == spindleGetGlobalThreadID());
+    const bool isLocalSender = (0 == spindleGetLocalThreadID());
+    const bool isLocalReplier = ((spindleGetLocalThreadCount() - 1) == spindleGetLocalThreadID());
+    const bool isGlobalSender = (0 == spindleGetGlobalThreadID());
+    const bool isGlobalReplier = ((spindleGetGlobalThreadCount() - 1) == spindleGetGlobalThreadID());
+
+    for (uint32_t sampleIndex = 0; sampleIndex <= regionArg->sampleCount; ++sampleIndex)
+    {
+        uint64_t startTime = 0;
+
+        spindleBarrierGlobal();
+
+        if (isTimingThread)
+            startTime = benchHelperGetTimeNanoseconds();
+
+        switch (regionArg->kernel)
+        {
+        case BenchKernelBarrierLocal:
+            for (uint64_t iteration = 0; iteration < regionArg->iterationCount; ++iteration)
+                spindleBarrierLocal();
+            break;
+
+        case BenchKernelBarrierGlobal:
+            for (uint64_t iteration = 0; iteration < regionArg->iterationCount; ++iteration)
+                spindleBarrierGlobal();
+            break;
+
+        case BenchKernelBarrierPthread:
+            for (uint64_t iteration = 0; iteration < regionArg->iterationCount; ++iteration)
+                pthread_barrier_wait(regionArg->pthreadBarrier);
+            break;
+
+        case BenchKernelDataShareLocal:
+            for (uint64_t iteration = 0; iteration < regionArg->iterationCount; ++iteration)
+            {
+                if (isLocalSender)
+                    spindleDataShareSendLocal(iteration);
+                else
+                    spindleDataShareReceiveLocal();
+
+                if (isLocalReplier)
+                    spindleDataShareSendLocal(iteration);
+                else
+                    spindleDataShareReceiveLocal();
+            }
+            break;
+
+        case BenchKernelDataShareGlobal:
+            for (uint64_t iteration = 0; iteration < regionArg->iterationCount; ++iteration)
+            {
+                if (isGlobalSender)
+                    spindleDataShareSendGlobal(iteration);
+                else
+                    spindleDataShareReceiveGlobal();
+
+                if (isGlobalReplier)
+                    spindleDataShareSendGlobal(iteration);
+                else
+                    spindleDataShareReceiveGlobal();
+            }
+            break;
+        }
+
+        if (isTimingThread && (0 != sampleIndex))
+            regionArg->samples[sampleIndex - 1] = (double)(benchHelperGetTimeNanoseconds() - startTime) / (double)regionArg->iterationCount;
+    }
+}
+
+// --------
+
+/// Times a kernel in a Spindle parallel region and records the result.
+/// @param [in] benchmark Operation measured, as written to the output.
+/// @param [in] variant Implementation used to perform the operation, as written to the output.
+/// @param [in] kernel Operation to time.
+/// @param [in] taskCount Number of tasks, placed one per NUMA node starting from the first.
+/// @param [in] threadsPerTask Number of threads in each task.
+/// @param [in] smtPolicy SMT policy for all tasks.
+static void benchHelperRunKernel(const char* benchmark, const char* variant, EBenchKernel kernel, uint32_t taskCount, uint32_t threadsPerTask, ESpindleSMTPolicy smtPolicy)
+{
+    SSpindleTaskSpec* const taskSpec = malloc(sizeof(SSpindleTaskSpec) * taskCount);
+    SSpindleTaskOptions* const taskOptions = malloc(sizeof(SSpindleTaskOptions) * taskCount);
+    double* const samples = malloc(sizeof(double) * benchSampleCount);
+    const uint32_t threadCount = taskCount * threadsPerTask;
+    pthread_barrier_t pthreadBarrier;
+    SBenchRegionArg regionArg;
+
+    if ((NULL == taskSpec) || (NULL == taskOptions) || (NULL == samples) || (0 != pthread_barrier_init(&pthreadBarrier, NULL, threadCount)))
+    {
+        fprintf(stderr, "Failed to prepare %s %s with %u threads.\n", benchmark, variant, threadCount);
+        benchErrorCount += 1;
+        free(taskSpec);
+        free(taskOptions);
+        free(samples);
+        return;
+    }
+
+    regionArg.kernel = kernel;
+    regionArg.iterationCount = benchIterationCount;
+    regionArg.sampleCount = benchSampleCount;
+    regionArg.samples = samples;
+    regionArg.pthreadBarrier = &pthreadBarrier;
+
+    benchHelperFillTaskSpecs(taskSpec, taskOptions, taskCount, threadsPerTask, smtPolicy, benchHelperKernelRegion, &regionArg);
+
+    if (0 != spindleThreadsSpawnWithOptions(taskSpec, taskOptions, taskCount, false))
+    {
+        fprintf(stderr, "Failed to spawn %s %s with %u threads.\n", benchmark, variant, threadCount);
+        benchErrorCount += 1;
+    }
+    else
+    {
+        benchHelperRecordResult(benchmark, variant, benchSMTPolicyNames[smtPolicy], taskCount, threadCount, benchIterationCount, samples);
+    }
+
+    pthread_barrier_destroy(&pthreadBarrier);
+    free(taskSpec);
+    free(taskOptions);
+    free(samples);
+}
+
+// --------
+
+/// Times an OpenMP barrier and records the result.
+/// Thread placement is left to the OpenMP runtime and can be controlled using the `OMP_PROC_BIND` and `OMP_PLACES` environment variables.
+/// @param [in] benchmark Operation measured, as written to the output.
+/// @param [in] threadCount Number of threads in the OpenMP team.
+static void benchHelperRunOpenMPBarrier(const char* benchmark, uint32_t threadCount)
+{
+    double* const samples = malloc(sizeof(double) * benchSampleCount);
+    bool teamComplete = true;
+
+    if (NULL == samples)
+    {
+        fprintf(stderr, "Failed to prepare %s openmp with %u threads.\n", benchmark, threadCount);
+        benchErrorCount += 1;
+        return;
+    }
+
+    #pragma omp parallel num_threads(threadCount)
+    {
+        if ((uint32_t)omp_get_num_threads() != threadCount)
+        {
+            #pragma omp master
+            teamComplete = false;
+        }
+        else
+        {
+            for (uint32_t sampleIndex = 0; sampleIndex <= benchSampleCount; ++sampleIndex)
+            {
+                uint64_t startTime = 0;
+
+                #pragma omp barrier
+
+                #pragma omp master
+                startTime = benchHelperGetTimeNanoseconds();
+
+                for (uint64_t iteration = 0; iteration < benchIterationCount; ++iteration)
+                {
+                    #pragma omp barrier
+                }
+
+                #pragma omp master
+                {
+                    if (0 != sampleIndex)
+                        samples[sampleIndex - 1] = (double)(benchHelperGetTimeNanoseconds() - startTime) / (double)benchIterationCount;
+                }
+            }
+        }
+    }
+
+    if (false == teamComplete)
+    {
+        fprintf(stderr, "OpenMP runtime did not provide %u threads for %s.\n", threadCount, benchmark);
+        benchErrorCount += 1;
+    }
+    else
+    {
+        benchHelperRecordResult(benchmark, "openmp", "-", 1, threadCount, benchIterationCount, samples);
+    }
+
+    free(samples);
+}
+
+// --------
+
+/// Measures the latency of spawning and joining an empty parallel region using the specified method, and records the result.
+/// @param [in] method Spawn method.
+/// @param [in] taskCount Number of tasks, placed one per NUMA node starting from the first.
+/// @param [in] threadsPerTask Number of threads in each task.
+static void benchHelperRunSpawn(EBenchSpawnMethod method, uint32_t taskCount, uint32_t threadsPerTask)
+{
+    const ESpindleSMTPolicy smtPolicy = SpindleSMTPolicyPreferPhysical;
+    SSpindleTaskSpec* const taskSpec = malloc(sizeof(SSpindleTaskSpec) * taskCount);
+    SSpindleTaskOptions* const taskOptions = malloc(sizeof(SSpindleTaskOptions) * taskCount);
+    double* const samples = malloc(sizeof(double) * benchSampleCount);
+    const uint32_t threadCount = taskCount * threadsPerTask;
+    uint32_t result = 0;
+
+    if ((NULL == taskSpec) || (NULL == taskOptions) || (NULL == samples) || ((BenchSpawnMethodPool == method) && (0 != spindleThreadPoolEnable())))
+    {
+        fprintf(stderr, "Failed to prepare spawn %s with %u threads.\n", benchSpawnMethodNames[method], threadCount);
+        benchErrorCount += 1;
+        free(taskSpec);
+        free(taskOptions);
+        free(samples);
+        return;
+    }
+
+    benchHelperFillTaskSpecs(taskSpec, taskOptions, taskCount, threadsPerTask, smtPolicy, benchHelperEmptyRegion, NULL);
+
+    for (uint32_t sampleIndex = 0; (sampleIndex <= benchSampleCount) && (0 == result); ++sampleIndex)
+    {
+        const uint64_t startTime = benchHelperGetTimeNanoseconds();
+
+        for (uint64_t iteration = 0; (iteration < benchSpawnIterationCount) && (0 == result); ++iteration)
+        {
+            TSpindleJoinHandle handle = NULL;
+
+            switch (method)
+            {
+            case BenchSpawnMethodCreate:
+            case BenchSpawnMethodPool:
+                result = spindleThreadsSpawnWithOptions(taskSpec, taskOptions, taskCount, false);
+                break;
+
+            case BenchSpawnMethodCreateUseCurrent:
+                result = spindleThreadsSpawnWithOptions(taskSpec, taskOptions, taskCount, true);
+                break;
+
+            case BenchSpawnMethodAsync:
+                result = spindleThreadsSpawnAsync(taskSpec, taskOptions, taskCount, &handle);
+                if (0 == result)
+                    result = spindleThreadsJoin(handle);
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (0 != sampleIndex)
+            samples[sampleIndex - 1] = (double)(benchHelperGetTimeNanoseconds() - startTime) / (double)benchSpawnIterationCount;
+    }
+
+    if (BenchSpawnMethodPool == method)
+        spindleThreadPoolDisable();
+
+    if (0 != result)
+    {
+        fprintf(stderr, "Failed to spawn %s with %u threads.\n", benchSpawnMethodNames[method], threadCount);
+        benchErrorCount += 1;
+    }
+    else
+    {
+        benchHelperRecordResult("spawn", benchSpawnMethodNames[method], benchSMTPolicyNames[smtPolicy], taskCount, threadCount, benchSpawnIterationCount, samples);
+    }
+
+    free(taskSpec);
+    free(taskOptions);
+    free(samples);
+}
+
+// --------
+
+/// Writes all recorded results to the specified file in CSV format, one row per result.
+/// @param [in] filePath Path of the file to write, or "-" for standard output.
+/// @return `true` on success, `false` otherwise.
+static bool benchHelperWriteCSV(const char* filePath)
+{
+    FILE* const outputFile = ((0 == strcmp(filePath, "-")) ? stdout : fopen(filePath, "w"));
+
+    if (NULL == outputFile)
+        return false;
+
+    fprintf(outputFile, "benchmark,variant,smt_policy,wait_policy,tasks,threads,iterations,samples,min_ns,median_ns,mean_ns,max_ns\n");
+
+    for (uint32_t resultIndex = 0; resultIndex < benchResultCount; ++resultIndex)
+    {
+        const SBenchResult* const result = &benchResults[resultIndex];
+
+        fprintf(outputFile, "%s,%s,%s,%s,%u,%u,%llu,%u,%.3f,%.3f,%.3f,%.3f\n", result->benchmark, result->variant, result->smtPolicy, ((SpindleBarrierWaitPolicySpin == benchWaitPolicy) ? "spin" : "spin-then-block"), result->taskCount, result->threadCount, (unsigned long long)result->iterationCount, result->sampleCount, result->minNanoseconds, result->medianNanoseconds, result->meanNanoseconds, result->maxNanoseconds);
+    }
+
+    if (stdout != outputFile)
+        return (0 == fclose(outputFile));
+
+    return (0 == fflush(outputFile));
+}
+
+// --------
+
+/// Writes all recorded results to the specified file in JSON format, along with a description of the system and the benchmark configuration.
+/// @param [in] filePath Path of the file to write, or "-" for standard output.
+/// @return `true` on success, `false` otherwise.
+static bool benchHelperWriteJSON(const char* filePath)
+{
+    FILE* const outputFile = ((0 == strcmp(filePath, "-")) ? stdout : fopen(filePath, "w"));
+
+    if (NULL == outputFile)
+        return false;
+
+    fprintf(outputFile, "{\n");
+    fprintf(outputFile, "  \"time\": %llu,\n", (unsigned long long)time(NULL));
+    fprintf(outputFile, "  \"system\": {\"numa_nodes\": %u, \"physical_cores\": %u, \"logical_cores\": %u, \"timestamp_frequency\": %llu, \"timestamp_invariant\": %s},\n", benchNUMANodeCount, topoGetSystemPhysicalCoreCount(), topoGetSystemLogicalCoreCount(), (unsigned long long)spindleGetTimestampFrequency(), (spindleIsTimestampInvariant() ? "true" : "false"));
+    fprintf(outputFile, "  \"config\": {\"samples\": %u, \"iterations\": %llu, \"spawn_iterations\": %llu, \"wait_policy\": \"%s\"},\n", benchSampleCount, (unsigned long long)benchIterationCount, (unsigned long long)benchSpawnIterationCount, ((SpindleBarrierWaitPolicySpin == benchWaitPolicy) ? "spin" : "spin-then-block"));
+    fprintf(outputFile, "  \"results\": [");
+
+    for (uint32_t resultIndex = 0; resultIndex < benchResultCount; ++resultIndex)
+    {
+        const SBenchResult* const result = &benchResults[resultIndex];
+
+        fprintf(outputFile, "%s\n    {\"benchmark\": \"%s\", \"variant\": \"%s\", \"smt_policy\": \"%s\", \"tasks\": %u, \"threads\": %u, \"iterations\": %llu, \"samples\": %u, \"min_ns\": %.3f, \"median_ns\": %.3f, \"mean_ns\": %.3f, \"max_ns\": %.3f}", ((0 == resultIndex) ? "" : ","), result->benchmark, result->variant, result->smtPolicy, result->taskCount, result->threadCount, (unsigned long long)result->iterationCount, result->sampleCount, result->minNanoseconds, result->medianNanoseconds, result->meanNanoseconds, result->maxNanoseconds);
+    }
+
+    fprintf(outputFile, "\n  ]\n}\n");
+
+    if (stdout != outputFile)
+        return (0 == fclose(outputFile));
+
+    return (0 == fflush(outputFile));
+}
+
+// --------
+
+/// Prints usage information.
+/// @param [in] programName Name of the program, as invoked.
+static void benchHelperPrintUsage(const char* programName)
+{
+    fprintf(stderr, "Usage: %s [options]\n", programName);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "    --csv <file>               Write results in CSV format, or to standard output if <file> is '-'.\n");
+    fprintf(stderr, "    --json <file>              Write results in JSON format, or to standard output if <file> is '-'.\n");
+    fprintf(stderr, "    --samples <n>              Timed samples per result. Default %u.\n", kBenchDefaultSampleCount);
+    fprintf(stderr, "    --iterations <n>           Barriers or data sharing round trips per sample. Default %u.\n", kBenchDefaultIterationCount);
+    fprintf(stderr, "    --spawn-iterations <n>     Parallel regions spawned per sample. Default %u.\n", kBenchDefaultSpawnIterationCount);
+    fprintf(stderr, "    --max-threads <n>          Largest number of threads per task to measure. Default is all threads on each NUMA node.\n");
+    fprintf(stderr, "    --spin-then-block          Use the spin-then-block barrier waiting policy instead of spinning.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "If neither --csv nor --json is given, CSV is written to standard output.\n");
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+int main(int argc, char* argv[])
+{
+    static const struct option options[] = {
+        { "csv",                required_argument,  NULL,   'c' },
+        { "json",               required_argument,  NULL,   'j' },
+        { "samples",            required_argument,  NULL,   's' },
+        { "iterations",         required_argument,  NULL,   'i' },
+        { "spawn-iterations",   required_argument,  NULL,   'p' },
+        { "max-threads",        required_argument,  NULL,   't' },
+        { "spin-then-block",    no_argument,        NULL,   'b' },
+        { "help",               no_argument,        NULL,   'h' },
+        { NULL,                 0,                  NULL,   0   }
+    };
+
+    const char* csvFilePath = NULL;
+    const char* jsonFilePath = NULL;
+    int option = 0;
+
+    while (-1 != (option = getopt_long(argc, argv, "", options, NULL)))
+    {
+        switch (option)
+        {
+        case 'c':
+            csvFilePath = optarg;
+            break;
+
+        case 'j':
+            jsonFilePath = optarg;
+            break;
+
+        case 's':
+            benchSampleCount = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+
+        case 'i':
+            benchIterationCount = (uint64_t)strtoull(optarg, NULL, 0);
+            break;
+
+        case 'p':
+            benchSpawnIterationCount = (uint64_t)strtoull(optarg, NULL, 0);
+            break;
+
+        case 't':
+            benchMaxThreadsPerTask = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+
+        case 'b':
+            benchWaitPolicy = SpindleBarrierWaitPolicySpinThenBlock;
+            break;
+
+        default:
+            benchHelperPrintUsage(argv[0]);
+            return ('h' == option) ? 0 : 1;
+        }
+    }
+
+    if ((optind != argc) || (0 == benchSampleCount) || (0 == benchIterationCount) || (0 == benchSpawnIterationCount))
+    {
+        benchHelperPrintUsage(argv[0]);
+        return 1;
+    }
+
+    if ((NULL == csvFilePath) && (NULL == jsonFilePath))
+        csvFilePath = "-";
+
+    benchNUMANodeCount = topoGetSystemNUMANodeCount();
+
+    // Spawn and join latency, with threads spread over all NUMA nodes.
+    for (uint32_t method = 0; method < BenchSpawnMethodCount; ++method)
+    {
+        const uint32_t maxThreadsPerTask = benchHelperMaxThreadsPerTask(SpindleSMTPolicyPreferPhysical, benchNUMANodeCount);
+
+        for (uint32_t threadsPerTask = 1; threadsPerTask <= maxThreadsPerTask; threadsPerTask = benchHelperNextThreadsPerTask(threadsPerTask, maxThreadsPerTask))
+            benchHelperRunSpawn((EBenchSpawnMethod)method, benchNUMANodeCount, threadsPerTask);
+    }
+
+    // Local operations use a single task on the first NUMA node, and global operations use one task per NUMA node.
+    for (uint32_t smtPolicy = 0; smtPolicy < kBenchSMTPolicyCount; ++smtPolicy)
+    {
+        const uint32_t maxLocalThreads = benchHelperMaxThreadsPerTask((ESpindleSMTPolicy)smtPolicy, 1);
+        const uint32_t maxGlobalThreadsPerTask = benchHelperMaxThreadsPerTask((ESpindleSMTPolicy)smtPolicy, benchNUMANodeCount);
+
+        for (uint32_t threadCount = 1; threadCount <= maxLocalThreads; threadCount = benchHelperNextThreadsPerTask(threadCount, maxLocalThreads))
+        {
+            benchHelperRunKernel("barrier-local", "spindle", BenchKernelBarrierLocal, 1, threadCount, (ESpindleSMTPolicy)smtPolicy);
+            benchHelperRunKernel("barrier-local", "pthread", BenchKernelBarrierPthread, 1, threadCount, (ESpindleSMTPolicy)smtPolicy);
+
+            if (threadCount > 1)
+                benchHelperRunKernel("datashare-local", "spindle", BenchKernelDataShareLocal, 1, threadCount, (ESpindleSMTPolicy)smtPolicy);
+        }
+
+        for (uint32_t threadsPerTask = 1; threadsPerTask <= maxGlobalThreadsPerTask; threadsPerTask = benchHelperNextThreadsPerTask(threadsPerTask, maxGlobalThreadsPerTask))
+        {
+            benchHelperRunKernel("barrier-global", "spindle", BenchKernelBarrierGlobal, benchNUMANodeCount, threadsPerTask, (ESpindleSMTPolicy)smtPolicy);
+            benchHelperRunKernel("barrier-global", "pthread", BenchKernelBarrierPthread, benchNUMANodeCount, threadsPerTask, (ESpindleSMTPolicy)smtPolicy);
+
+            if ((benchNUMANodeCount * threadsPerTask) > 1)
+                benchHelperRunKernel("datashare-global", "spindle", BenchKernelDataShareGlobal, benchNUMANodeCount, threadsPerTask, (ESpindleSMTPolicy)smtPolicy);
+        }
+    }
+
+    // OpenMP baselines, at the same total thread counts as the Spindle barriers but with placement left to the OpenMP runtime.
+    {
+        const uint32_t maxLocalThreads = benchHelperMaxThreadsPerTask(SpindleSMTPolicyPreferLogical, 1);
+        const uint32_t maxGlobalThreadsPerTask = benchHelperMaxThreadsPerTask(SpindleSMTPolicyPreferLogical, benchNUMANodeCount);
+
+        omp_set_dynamic(0);
+
+        for (uint32_t threadCount = 1; threadCount <= maxLocalThreads; threadCount = benchHelperNextThreadsPerTask(threadCount, maxLocalThreads))
+            benchHelperRunOpenMPBarrier("barrier-local", threadCount);
+
+        for (uint32_t threadsPerTask = 1; threadsPerTask <= maxGlobalThreadsPerTask; threadsPerTask = benchHelperNextThreadsPerTask(threadsPerTask, maxGlobalThreadsPerTask))
+            benchHelperRunOpenMPBarrier("barrier-global", benchNUMANodeCount * threadsPerTask);
+    }
+
+    if ((NULL != csvFilePath) && (false == benchHelperWriteCSV(csvFilePath)))
+    {
+        fprintf(stderr, "Failed to write CSV results to %s.\n", csvFilePath);
+        benchErrorCount += 1;
+    }
+
+    if ((NULL != jsonFilePath) && (false == benchHelperWriteJSON(jsonFilePath)))
+    {
+        fprintf(stderr, "Failed to write JSON results to %s.\n", jsonFilePath);
+        benchErrorCount += 1;
+    }
+
+    free(benchResults);
+    return (0 == benchErrorCount) ? 0 : 1;
+}
@@ -30,6 +30,7 @@ X-AS    = egrep -v 'END[SP]?$$' \
         | sed 's/^PUBLIC *\([^ ]*\).*/.globl \1/' \
         | sed 's/^ *\([^ ]\+\) \+\(DB\|DW\|DD\|DQ\|REAL8\) \(.*\)/\1:\n\2 \3/' \
         | sed 's/^.*DW \+\([^Hh]*\).*/.word 0x\1/' \
+        | sed 's/^.*DD \+\([^Hh]*\).*/.4byte 0x\1/' \
         | sed 's/^.*DQ \+\([^Hh]*\).*/.8byte 0x\1/' \
         | sed 's/^.*REAL8 \+\([^Hh]*\).*/.double \1/' \
         | sed 's/\(, *\)\([a-fA-F0-9]*\)[hH]/\10x\2/' \
@@ -29,6 +29,7 @@ X-AS    = egrep -v 'END[SP]?$$' \
         | sed 's/^PUBLIC *\([^ ]*\).*/global \1/' \
         | sed 's/^ *\([^ ]\+\) \+\(DB\|DW\|DD\|DQ\|REAL8\) \(.*\)/\1:\n\2 \3/' \
         | sed 's/^.*DW \+\([^Hh]*\).*/dw \1h/' \
+        | sed 's/^.*DD \+\([^Hh]*\).*/dd \1h/' \
         | sed 's/^.*DQ \+\([^Hh]*\).*/dq \1h/' \
         | sed 's/^.*REAL8 \+\([^Hh]*\).*/dq \1/' \
         | sed 's/ PTR / /' \
@@ -15,7 +15,9 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 
 // -------- CONSTANTS ------------------------------------------------------ //
@@ -24,11 +26,31 @@
 #define kSpindleTaskSpecAllAvailableThreads     0
 
 /// In the `numThreads` field of #SSpindleTaskSpec, specifies to use the same number of threads for the current task as for the previous task.
-/// When spawning threads, Spindle processes task specifications in index order (0 to `taskCount - 1`).
-/// If `taskSpec[i].numThreads` is equal to this value, then the number of threads will be set to whatever Spindle used or calculated for `taskSpec[i-1]`.
+/// If `taskSpec[i].numThreads` is equal to this value, then the number of threads will be set to that of `taskSpec[i-1]`, regardless of the order in which Spindle processes tasks.
+/// If `taskSpec[i-1]` specifies 0 threads, then the number is whatever Spindle calculated for it, which is an error if Spindle processes `taskSpec[i-1]` after `taskSpec[i]` because its NUMA node comes later.
+/// If `taskSpec[i-1]` creates several tasks, then the number is that of the last of them processed before `taskSpec[i]`.
 /// If there are insufficient threads left on the current NUMA node, then this will result in an error.
 #define kSpindleTaskSpecThreadsSameAsPrevious   UINT32_MAX
 
+/// In the `numaNode` field of #SSpindleTaskSpec, specifies to create one task per NUMA node, each otherwise identical to the task specification.
+/// The `numaNodeMask` field of #SSpindleTaskOptions can restrict this to a subset of NUMA nodes.
+#define kSpindleTaskSpecAllNUMANodes            UINT32_MAX
+
+/// In the `errorTaskID` field of #SSpindlePlan, indicates that the error does not concern any particular task specification.
+#define kSpindlePlanNoTask                      UINT32_MAX
+
+/// Identifies a thread whose logical core does not share a level 3 cache with any other, or whose topology does not describe one.
+/// See #spindleGetCacheDomainID.
+#define kSpindleCacheDomainUnknown              UINT32_MAX
+
+/// Number of buckets in each per-thread histogram of barrier wait times.
+/// Bucket `i` counts waits of at least `2^i` but fewer than `2^(i+1)` cycles, except that bucket 0 also counts waits of 0 cycles and the last bucket counts all longer waits.
+#define kSpindleBarrierStatsHistogramBucketCount    32
+
+/// Maximum number of distinct labels for which barrier statistics are recorded in a single parallel region, separately for local and global barriers.
+/// Labeled barriers beyond this limit still synchronize threads, but are not recorded.
+#define kSpindleBarrierStatsMaxLabelCount           32
+
 
 // -------- TYPE DEFINITIONS ----------------------------------------------- //
 
@@ -36,12 +58,67 @@
 /// Must return nothing and accept a single parameter.
 typedef void (* TSpindleFunc)(void* arg);
 
+/// Signature of the body of a parallel loop.
+/// Invoked once per chunk of iterations, each time with a contiguous half-open range of iterations to execute.
+typedef void (* TSpindleLoopFunc)(void* arg, int64_t begin, int64_t end);
+
+/// Wait-time statistics recorded for a single thread at all barriers that share a label.
+typedef struct SSpindleBarrierThreadStats
+{
+    uint64_t callCount;                                                     ///< Number of times the thread reached a barrier with this label.
+    uint64_t totalWaitCycles;                                               ///< Total number of cycles the thread spent waiting, measured using the `rdtsc` instruction.
+    uint64_t maxWaitCycles;                                                 ///< Largest number of cycles the thread spent waiting at any one barrier.
+    uint64_t arrivalRankSum;                                                ///< Sum of the thread's arrival positions, where 0 means first to arrive. Divide by the number of calls for the average position.
+    uint64_t lastArrivalCount;                                              ///< Number of times the thread was the last to arrive, holding up all the others.
+    uint64_t histogram[kSpindleBarrierStatsHistogramBucketCount];           ///< Number of waits in each power-of-two range of cycles. See #kSpindleBarrierStatsHistogramBucketCount.
+} SSpindleBarrierThreadStats;
+
+/// Summary of barrier wait-time statistics for a group of threads, either a task or all threads on a NUMA node.
+/// Threads that finish their work early wait longest, so the thread with the smallest total wait is the one that most delays the others.
+typedef struct SSpindleBarrierGroupStats
+{
+    uint32_t groupID;                                                       ///< Task ID or NUMA node index identifying the group.
+    uint32_t threadCount;                                                   ///< Number of threads in the group that reached a barrier with this label.
+    uint64_t totalWaitCycles;                                               ///< Total number of cycles spent waiting by all threads in the group.
+    uint64_t minThreadWaitCycles;                                           ///< Smallest total wait of any thread in the group.
+    uint64_t maxThreadWaitCycles;                                           ///< Largest total wait of any thread in the group.
+    double imbalance;                                                       ///< Difference between the largest and smallest total wait of any thread in the group, divided by the largest. 0 means perfectly balanced, and values approaching 1 mean that some threads spend almost all of their barrier time waiting for others.
+    uint32_t stragglerGlobalThreadID;                                       ///< Global thread ID of the thread in the group that most often arrived last.
+} SSpindleBarrierGroupStats;
+
+/// Barrier statistics report for a single label, delivered at the end of a parallel region.
+/// All pointers remain valid only until the report function returns.
+typedef struct SSpindleBarrierStatsReport
+{
+    const char* label;                                                      ///< Label passed to the barriers.
+    bool isGlobal;                                                          ///< `true` for global barriers, `false` for local barriers. Arrival positions are among all threads or among the threads of a task, respectively.
+    uint32_t threadCount;                                                   ///< Number of threads in the parallel region, and number of entries in the per-thread statistics array.
+    uint32_t taskCount;                                                     ///< Number of tasks in the parallel region, and number of entries in the per-task summary array.
+    uint32_t nodeCount;                                                     ///< Number of NUMA nodes spanned by the parallel region, and number of entries in the per-node summary array.
+    const SSpindleBarrierThreadStats* threadStats;                          ///< Per-thread statistics, indexed by global thread ID.
+    const SSpindleBarrierGroupStats* taskStats;                             ///< Per-task summaries, indexed by task ID.
+    const SSpindleBarrierGroupStats* nodeStats;                             ///< Per-node summaries, one for each NUMA node spanned, in increasing order of NUMA node index.
+} SSpindleBarrierStatsReport;
+
+/// Signature of a function that receives barrier statistics reports.
+/// Invoked once per label at the end of a parallel region, on the thread that spawned it or, for asynchronously-spawned regions, on the thread that joins it.
+typedef void (* TSpindleBarrierStatsFunc)(const SSpindleBarrierStatsReport* report, void* arg);
+
+/// Handle that identifies a parallel region spawned asynchronously by #spindleThreadsSpawnAsync.
+/// Valid until passed to #spindleThreadsJoin.
+typedef struct SSpindleRegion* TSpindleJoinHandle;
+
+/// Handle that identifies a hardware topology loaded by #spindleTopologyLoadSynthetic or #spindleTopologyLoadXML, for which thread placement can be planned without running on it.
+/// Valid until passed to #spindleTopologyFree.
+typedef struct SSpindleTopology* TSpindleTopology;
+
 /// Enumerates supported SMT thread assignment policies.
 /// Each policy specifies how Spindle should order its assignment of threads to cores, where each core may have multiple logical threads (by means of simultaneous multithreading, or SMT).
 /// As an example, consider a task with 7 threads to be assigned to 4 physical cores, each supporting 2 logical cores (hardware threads).
 /// Preferring physical cores would assign threads in the order P0L0, P1L0, P2L0, P3L0, P0L1, P1L1, and finally P2L1.
 /// Preferring logical cores would assign threads in the order P0L0, P0L1, P1L0, P1L1, P2L0, P2L1, and finally P3L0.
 /// The correct policy depends largely on the tasks themselves and how each thread shares data with other threads.
+/// Physical cores need not all have the same number of logical cores, as on processors that combine performance cores supporting SMT with efficiency cores that do not, in which case a physical core with fewer logical cores is simply skipped once it is full.
 /// Regardless of the SMT policy, separate tasks are always affinitized to different physical cores.
 typedef enum ESpindleSMTPolicy
 {
@@ -50,35 +127,314 @@ typedef enum ESpindleSMTPolicy
     SpindleSMTPolicyPreferLogical                                           ///< When assigning threads to cores, saturate each physical core (by assigning a thread to all logical cores) before moving onto the next one.
 } ESpindleSMTPolicy;
 
+/// Enumerates supported policies for aligning tasks to cache domains, which are groups of physical cores that share a level 3 cache.
+/// Some processors have several cache domains per NUMA node, such as the core complexes of AMD processors, and a task whose threads straddle two of them pays cross-domain latency for its barriers and shared data.
+/// Sub-NUMA clustering, by contrast, exposes each cluster as its own NUMA node, so placing tasks on separate NUMA nodes already separates them.
+typedef enum ESpindleCachePolicy
+{
+    SpindleCachePolicyIgnore,                                               ///< Assign physical cores in order without regard for cache domains. Used by default.
+    SpindleCachePolicyAlign,                                                ///< If the task would not fit within what remains of the current cache domain, skip to the start of the next one, leaving the remaining physical cores unused. Tasks larger than a cache domain therefore span as few of them as possible.
+    SpindleCachePolicyTaskPerDomain                                         ///< Replace the task with one aligned task per cache domain of its NUMA node, each with the specified number of threads, or with all threads of its cache domain if 0. Tasks are numbered consecutively in cache domain order, and the task should be the only one on its NUMA node.
+} ESpindleCachePolicy;
+
+/// Enumerates the kinds of physical cores that Spindle distinguishes on processors that combine cores of differing performance, such as the P-cores and E-cores of hybrid Intel processors.
+/// Kinds are determined using the CPU kind information that `hwloc` provides, where the most performant kind consists of performance cores and all others of efficiency cores.
+/// On processors whose physical cores are all alike, or if `hwloc` does not report CPU kinds, all physical cores are performance cores.
+typedef enum ESpindleCoreKind
+{
+    SpindleCoreKindPerformance,                                             ///< Performance core, the most performant kind in the system.
+    SpindleCoreKindEfficiency                                               ///< Efficiency core, any less performant kind.
+} ESpindleCoreKind;
+
+/// Enumerates supported policies for selecting the kinds of physical cores on which a task's threads run.
+/// Physical cores of a kind that a task does not use are skipped and left unused, and because tasks take physical cores in order, tasks on the same NUMA node should be ordered to match the order of kinds among its physical cores, which on current hybrid processors places performance cores first.
+typedef enum ESpindleCoreKindPolicy
+{
+    SpindleCoreKindPolicyAny,                                               ///< Use physical cores of any kind. Used by default.
+    SpindleCoreKindPolicyPerformance,                                       ///< Use performance cores only.
+    SpindleCoreKindPolicyEfficiency                                         ///< Use efficiency cores only.
+} ESpindleCoreKindPolicy;
+
+/// Enumerates supported policies for placing a task's threads on physical cores, which matter when a task has fewer threads than the physical cores available to it.
+/// As an example, consider a task with 4 threads on a NUMA node with 8 remaining physical cores, P0 to P7, each supporting 2 logical cores.
+/// Compact placement assigns threads to P0L0, P1L0, P2L0, and P3L0, leaving P4 to P7 for subsequent tasks. Scatter placement assigns them to P0L0, P2L0, P4L0, and P6L0, occupying all 8 physical cores.
+/// The SMT policy still determines how threads share physical cores when there are more threads than physical cores, in which case scattering spreads the extra threads evenly.
+typedef enum ESpindlePlacementPolicy
+{
+    SpindlePlacementPolicyCompact,                                          ///< Pack the task's threads onto as few physical cores as the SMT policy allows, which suits tasks whose threads communicate heavily. Used by default.
+    SpindlePlacementPolicyScatter                                           ///< Spread the task's threads evenly over all physical cores that remain on its NUMA node, or in its cache domain if one task per cache domain is requested, apart from those it reserves. This maximizes the memory bandwidth and private cache capacity available to bandwidth-bound tasks, but leaves no physical cores for subsequent tasks.
+} ESpindlePlacementPolicy;
+
+/// Enumerates supported thread barrier algorithms.
+/// Every algorithm preserves the property that a waiting thread spins on a cache line written exactly once per barrier, by the thread that releases it.
+/// The centralized algorithm has the lowest latency for small numbers of threads, whereas the others avoid having every thread contend for a single counter and therefore scale better to large numbers of threads or to skewed arrival times.
+typedef enum ESpindleBarrierAlgorithm
+{
+    SpindleBarrierAlgorithmCentralized,                                     ///< All threads decrement a single shared counter, and the last to arrive releases the others by writing a single shared flag. Used by default.
+    SpindleBarrierAlgorithmDissemination,                                   ///< Threads signal each other over a logarithmic number of rounds, each thread waiting on its own per-round flag. There is no central counter and no separate release phase.
+    SpindleBarrierAlgorithmTournament,                                      ///< Threads are statically paired over a logarithmic number of rounds, the loser of each pair signalling the winner. The overall winner releases the others by writing a single shared flag.
+    SpindleBarrierAlgorithmStaticTree                                       ///< Threads combine in a static tree of counters, each shared by at most four threads, and the thread that completes the root releases the others by writing a single shared flag.
+} ESpindleBarrierAlgorithm;
+
+/// Enumerates supported policies for how threads wait at thread barriers, selected per parallel region using the `barrierWaitPolicy` field of the options of the first task.
+/// Blocking frees cores for other work when the system is oversubscribed or tasks are unbalanced, whereas latency-critical regions can continue to spin.
+typedef enum ESpindleBarrierWaitPolicy
+{
+    SpindleBarrierWaitPolicySpin,                                           ///< Threads spin until released, which gives the lowest wake-up latency but occupies a core for the whole wait. Used by default.
+    SpindleBarrierWaitPolicySpinThenBlock                                   ///< Threads spin for a limited number of iterations, backing off exponentially, and then block in the operating system until released. The releasing thread makes a system call only if some thread actually blocked.
+} ESpindleBarrierWaitPolicy;
+
+/// Enumerates supported operations for combining values in reductions and scans.
+/// Bitwise operations on double-precision values operate on their binary representations.
+typedef enum ESpindleReduceOp
+{
+    SpindleReduceOpSum,                                                     ///< Arithmetic sum.
+    SpindleReduceOpMin,                                                     ///< Minimum value.
+    SpindleReduceOpMax,                                                     ///< Maximum value.
+    SpindleReduceOpBitAnd,                                                  ///< Bitwise AND.
+    SpindleReduceOpBitOr,                                                   ///< Bitwise OR.
+    SpindleReduceOpBitXor                                                   ///< Bitwise XOR.
+} ESpindleReduceOp;
+
+/// Enumerates supported policies for distributing the iterations of a parallel loop among threads.
+/// In all cases, a chunk size of 0 selects a sensible default, as described for each policy.
+typedef enum ESpindleLoopSchedule
+{
+    SpindleLoopScheduleStatic,                                              ///< Iterations are divided among threads ahead of time without any coordination. Chunks are assigned round-robin by thread ID, or if the chunk size is 0, each thread receives one contiguous block of nearly equal size.
+    SpindleLoopScheduleDynamic,                                             ///< Threads repeatedly claim the next chunk of iterations from a shared counter until none remain. A chunk size of 0 means 1.
+    SpindleLoopScheduleGuided                                               ///< Like dynamic, except that chunks start large and shrink as iterations are claimed, each being proportional to the number of iterations remaining. The chunk size is the minimum, and 0 means 1.
+} ESpindleLoopSchedule;
+
+/// Enumerates supported page sizes for memory allocated by Spindle.
+typedef enum ESpindlePageSize
+{
+    SpindlePageSizeDefault,                                                 ///< Default page size of the operating system.
+    SpindlePageSizeLargePreferred,                                          ///< Large pages if the operating system can provide them, otherwise default pages. On Linux, this uses transparent huge pages.
+    SpindlePageSizeLargeRequired                                            ///< Large pages, failing if the operating system cannot provide them. On Linux, this requires huge pages to have been reserved, and on Windows it requires the "Lock pages in memory" privilege.
+} ESpindlePageSize;
+
 /// Specifies a Spindle task that can be created and assigned to threads.
+/// Optional behavior is selected separately using #SSpindleTaskOptions.
 typedef struct SSpindleTaskSpec
 {
     TSpindleFunc func;                                                      ///< Starting function to call for each thread.
     void* arg;                                                              ///< Argument to pass to the starting function.
-    uint32_t numaNode;                                                      ///< Zero-based index of the NUMA node on which to create the threads.
+    uint32_t numaNode;                                                      ///< Zero-based index of the NUMA node on which to create the threads, or #kSpindleTaskSpecAllNUMANodes to create one task per NUMA node.
     uint32_t numThreads;                                                    ///< Number of threads to create, or 0 to use all remaining threads available.
     ESpindleSMTPolicy smtPolicy;                                            ///< Specifies the policy for distributing threads among cores that may each have multiple hardware threads.
 } SSpindleTaskSpec;
 
+/// Specifies optional behavior for a Spindle task, complementing its #SSpindleTaskSpec.
+/// Must be initialized using #spindleTaskOptionsInit, which selects the default for every field, before any fields are filled.
+/// New fields are only ever added at the end, and the `structSize` field tells Spindle which of them the caller knows about.
+typedef struct SSpindleTaskOptions
+{
+    uint32_t structSize;                                                    ///< Size of this structure in bytes, set by #spindleTaskOptionsInit. Identifies which fields the caller knows about, so that fields added in later versions take their defaults.
+    ESpindleBarrierAlgorithm barrierAlgorithm;                              ///< Algorithm to use for this task's local barriers. The algorithm specified for the first task is also used for global barriers.
+    size_t arenaSize;                                                       ///< Number of bytes available in the arena of each thread in this task, or 0 to use the default of 1 MiB.
+    uint32_t contextSlotCount;                                              ///< Number of 64-bit slots in the context block of each thread in this task, or 0 to use the default of 8 slots.
+    uint32_t reservedCoreCount;                                             ///< Number of additional physical cores on this task's NUMA node to set aside, without placing any of this task's threads on them, for nested parallel regions spawned by this task's threads.
+    ESpindleCachePolicy cachePolicy;                                        ///< Specifies how the task is aligned to cache domains. If one task per cache domain is requested, each of the resulting tasks sets aside its own reserved physical cores within its cache domain.
+    ESpindlePlacementPolicy placementPolicy;                                ///< Specifies whether the task's threads are packed together or spread over the physical cores available to the task. Complements the SMT policy.
+    uint64_t numaNodeMask;                                                  ///< If the `numaNode` field of the task specification is #kSpindleTaskSpecAllNUMANodes, creates tasks only on NUMA nodes whose corresponding bit is set, where bit `i` represents NUMA node `i`. A value of 0 selects all NUMA nodes. Ignored otherwise.
+    ESpindleCoreKindPolicy coreKindPolicy;                                  ///< Specifies the kinds of physical cores on which the task's threads run, on processors that combine cores of differing performance.
+    ESpindleBarrierWaitPolicy barrierWaitPolicy;                            ///< Specifies how threads wait at thread barriers in the parallel region. The policy specified for the first task applies to all tasks and to both local and global barriers.
+    uint32_t barrierSpinIterations;                                         ///< For #SpindleBarrierWaitPolicySpinThenBlock, the number of spin-wait iterations to perform before blocking, or 0 to use a default. Like the waiting policy, taken from the first task. Ignored otherwise.
+} SSpindleTaskOptions;
+
+/// Planned placement of a single thread, as produced by #spindlePlanThreads.
+/// Cores are identified both by the logical indices that `hwloc` assigns, which are contiguous and ordered by locality, and by the operating system's index, as used in affinity masks and by tools such as `taskset`.
+typedef struct SSpindleThreadPlacement
+{
+    uint32_t globalThreadID;                                                ///< Global thread ID the thread would have.
+    uint32_t localThreadID;                                                 ///< Local thread ID the thread would have within its task.
+    uint32_t taskID;                                                        ///< Task to which the thread would belong.
+    uint32_t numaNode;                                                      ///< Zero-based index of the NUMA node on which the thread would run.
+    uint32_t physicalCore;                                                  ///< Logical index of the physical core on which the thread would run.
+    uint32_t logicalCore;                                                   ///< Logical index of the logical core (hardware thread) to which the thread would be affinitized.
+    uint32_t logicalCoreOSIndex;                                            ///< Operating system's index of the logical core to which the thread would be affinitized.
+    uint32_t cacheDomain;                                                   ///< Logical index of the level 3 cache shared by the thread's logical core, or #kSpindleCacheDomainUnknown. See #spindleGetCacheDomainID.
+    ESpindleCoreKind coreKind;                                              ///< Kind of physical core on which the thread would run.
+} SSpindleThreadPlacement;
+
+/// Plan that describes where each thread of a parallel region would run, or why the parallel region could not be spawned.
+/// Filled by #spindlePlanThreads and released by #spindlePlanFree.
+typedef struct SSpindlePlan
+{
+    SSpindleThreadPlacement* threads;                                       ///< Placement of each thread, indexed by global thread ID, or `NULL` if planning failed.
+    uint32_t threadCount;                                                   ///< Total number of threads that would be spawned.
+    uint32_t taskCount;                                                     ///< Number of tasks that would be created, which exceeds the number of task specifications if any requests one task per cache domain.
+    uint32_t errorTaskID;                                                   ///< Index of the task specification that could not be satisfied, or #kSpindlePlanNoTask if planning succeeded or the error does not concern any particular task.
+    const char* errorMessage;                                               ///< Description of why planning failed, or `NULL` if it succeeded. Points to a static string.
+} SSpindlePlan;
+
 
 // -------- FUNCTIONS ------------------------------------------------------ //
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/// Checks whether execution is happening within a Spindle parallelized region.
-/// Only one such region can exist at any time.
+/// Checks whether the calling thread is executing within a Spindle parallelized region, either as one of its threads or as the thread that spawned it.
+/// Multiple such regions can exist at the same time if spawned from different OS threads, so the answer differs from one OS thread to the next.
 /// @return `true` if so, `false` otherwise.
 bool spindleIsInParallelRegion(void);
 
+/// Initializes task options so that every field selects its default, and records the size of the structure known to the caller.
+/// Must be called before filling any fields, including for options that are never changed from their defaults.
+/// Defined inline so that the recorded size is that of the version of this header against which the caller is built.
+/// @param [out] taskOptions Task options to initialize, as an array.
+/// @param [in] taskCount Number of elements in the array.
+static inline void spindleTaskOptionsInit(SSpindleTaskOptions* taskOptions, uint32_t taskCount)
+{
+    memset((void*)taskOptions, 0, sizeof(SSpindleTaskOptions) * taskCount);
+    
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+        taskOptions[taskIndex].structSize = (uint32_t)sizeof(SSpindleTaskOptions);
+}
+
 /// Spawns threads according to the provided task specification.
-/// NUMA node indices must appear in monotonically increasing order in the array, and only the last entry per NUMA node may specify 0 (automatically-determined) threads.
+/// Task specifications may appear in any order, but tasks are numbered in increasing order of NUMA node, keeping the order of the array among tasks on the same NUMA node, and only the last entry per NUMA node may specify 0 (automatically-determined) threads.
+/// A task specification whose NUMA node is #kSpindleTaskSpecAllNUMANodes is replaced by one task per selected NUMA node.
+/// The first spawn in a process also calibrates the timestamp counter, which busy-waits for about 10 milliseconds if the processor does not report the counter's frequency. See #spindleGetTimestampFrequency.
+/// Different OS threads may call this function at the same time, each creating an independent parallel region with its own barriers, data sharing buffers, and collective operations.
+/// Spindle does not track which cores other parallel regions occupy, so callers that spawn concurrently should place their tasks on different NUMA nodes to avoid sharing cores.
+/// At most 65535 tasks may be specified, and at most 256 parallel regions may exist at the same time.
+/// If called from a thread that belongs to a parallel region, spawns a nested parallel region with its own thread IDs, barriers, and data sharing scope, never using the thread pool.
+/// All tasks of a nested parallel region must be placed on the calling thread's NUMA node, and if the calling thread's task reserves cores using the `reservedCoreCount` field of its task options, only those cores are used.
+/// Otherwise, only the physical cores occupied by the calling thread's task are used, including all of their logical cores, and a nested parallel region that does not fit on them is rejected rather than overlapping other tasks.
+/// Once the nested parallel region finishes, the calling thread resumes as a member of its own parallel region with its thread information, context block, and affinity restored.
+/// Every task uses the default options. See #spindleThreadsSpawnWithOptions to select others.
 /// @param [in] taskSpec Task specifications, as an array.
 /// @param [in] taskCount Number of tasks specified.
 /// @param [in] useCurrentThread `true` if the calling thread should be used as a worker (can improve performance), `false` otherwise.
 /// @return 0 once all spawned threads have terminated, or nonzero in the event of an error.
 uint32_t spindleThreadsSpawn(SSpindleTaskSpec* taskSpec, uint32_t taskCount, bool useCurrentThread);
 
+/// Spawns threads according to the provided task specification, selecting optional behavior for each task.
+/// Behaves exactly like #spindleThreadsSpawn otherwise.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskOptions Options for each task, as an array parallel to the task specifications and initialized using #spindleTaskOptionsInit, or `NULL` to use the default options for every task.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] useCurrentThread `true` if the calling thread should be used as a worker (can improve performance), `false` otherwise.
+/// @return 0 once all spawned threads have terminated, or nonzero in the event of an error.
+uint32_t spindleThreadsSpawnWithOptions(SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, bool useCurrentThread);
+
+/// Spawns threads according to the provided task specification, returning as soon as they are created rather than waiting for them to terminate.
+/// Task specifications are subject to the same rules as for #spindleThreadsSpawn. The calling thread is never used as a worker and is free to do other work while the spawned threads run, including spawning further parallel regions.
+/// Always creates new OS threads, even if the thread pool is enabled. Must not be called from within a Spindle parallel region.
+/// @param [in] taskSpec Task specifications, as an array. Need not remain valid after this function returns.
+/// @param [in] taskOptions Options for each task, as for #spindleThreadsSpawnWithOptions, or `NULL` to use the default options for every task. Need not remain valid after this function returns.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [out] handle Filled with a handle that identifies the new parallel region, to be passed to #spindleThreadsJoin. Filled with `NULL` if the number of tasks is zero.
+/// @return 0 once all threads are created, or nonzero in the event of an error, in which case no handle is produced.
+uint32_t spindleThreadsSpawnAsync(SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, TSpindleJoinHandle* handle);
+
+/// Checks, without blocking, whether all threads of an asynchronously-spawned parallel region have returned from their starting functions.
+/// @param [in] handle Handle produced by #spindleThreadsSpawnAsync.
+/// @return `true` if so, `false` otherwise.
+bool spindleThreadsPoll(TSpindleJoinHandle handle);
+
+/// Waits for all threads of an asynchronously-spawned parallel region to return from their starting functions, blocking for no longer than the specified timeout.
+/// The handle remains valid either way, and must still be passed to #spindleThreadsJoin.
+/// @param [in] handle Handle produced by #spindleThreadsSpawnAsync.
+/// @param [in] timeoutMilliseconds Maximum amount of time to block, in milliseconds.
+/// @return `true` if the parallel region completed, `false` if the timeout elapsed first.
+bool spindleThreadsWaitTimeout(TSpindleJoinHandle handle, uint32_t timeoutMilliseconds);
+
+/// Waits for all threads of an asynchronously-spawned parallel region to terminate and then frees all resources associated with it, invalidating the handle.
+/// Must be called exactly once per handle, from any OS thread.
+/// @param [in] handle Handle produced by #spindleThreadsSpawnAsync.
+/// @return 0 once all spawned threads have terminated, or nonzero in the event of an error.
+uint32_t spindleThreadsJoin(TSpindleJoinHandle handle);
+
+/// Plans the placement of threads for the provided task specification without spawning them, exactly as #spindleThreadsSpawn would place them in a parallel region that is not nested.
+/// Task specifications are subject to the same rules and produce the same errors as for #spindleThreadsSpawn, but their functions are never called and may be `NULL`.
+/// May be called from any thread, including from within a parallel region.
+/// @param [in] topology Topology on which to plan, or `NULL` to plan on the current system.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskOptions Options for each task, as for #spindleThreadsSpawnWithOptions, or `NULL` to use the default options for every task.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [out] plan Filled with the plan, or with a description of the error. Must be released using #spindlePlanFree in either case.
+/// @return 0 if every thread could be placed, or nonzero in the event of an error.
+uint32_t spindlePlanThreads(TSpindleTopology topology, SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, SSpindlePlan* plan);
+
+/// Releases the memory held by a plan filled by #spindlePlanThreads.
+/// @param [in] plan Plan to release. Its contents are no longer valid afterwards.
+void spindlePlanFree(SSpindlePlan* plan);
+
+/// Loads a hardware topology from an `hwloc` synthetic description, such as "node:8 core:28 pu:2" for 8 NUMA nodes each with 28 physical cores of 2 logical cores.
+/// The result can only be used for planning. See the `hwloc` documentation for the full syntax of synthetic descriptions.
+/// @param [in] description Synthetic topology description.
+/// @param [out] topology Receives a handle to the loaded topology, which must be released using #spindleTopologyFree.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindleTopologyLoadSynthetic(const char* description, TSpindleTopology* topology);
+
+/// Loads a hardware topology from an XML file, such as one exported on another machine using the `lstopo` tool.
+/// The result can only be used for planning.
+/// @param [in] filePath Path of the XML file.
+/// @param [out] topology Receives a handle to the loaded topology, which must be released using #spindleTopologyFree.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindleTopologyLoadXML(const char* filePath, TSpindleTopology* topology);
+
+/// Releases a hardware topology loaded for planning.
+/// @param [in] topology Handle to the topology, or `NULL` to do nothing.
+void spindleTopologyFree(TSpindleTopology topology);
+
+/// Enables the persistent thread pool.
+/// While the pool is enabled, #spindleThreadsSpawn runs threads on persistent workers rather than creating and destroying OS threads for each parallel region.
+/// Workers are created the first time they are needed and remain affinitized and parked between parallel regions, so entering a region requires only waking them.
+/// Thread assignments are also retained, and reused whenever consecutive regions have task specifications that differ only in their functions and arguments.
+/// The pool serves one parallel region at a time. Parallel regions spawned concurrently by other OS threads while the pool is in use create their own threads instead.
+/// Has no effect if the pool is already enabled. Must not be called from within a Spindle parallel region.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindleThreadPoolEnable(void);
+
+/// Disables the persistent thread pool, terminating all of its workers and freeing any retained thread assignments.
+/// Has no effect if the pool is already disabled. Must not be called from within a Spindle parallel region, and fails if another OS thread is using the pool to run a parallel region.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindleThreadPoolDisable(void);
+
+/// Checks whether the persistent thread pool is enabled.
+/// @return `true` if so, `false` otherwise.
+bool spindleThreadPoolIsEnabled(void);
+
+/// Enables or disables barrier statistics for subsequently-spawned parallel regions.
+/// While enabled, #spindleBarrierLocalLabeled and #spindleBarrierGlobalLabeled record, per label and per thread, the time spent waiting, arrival order, and a histogram of wait times.
+/// At the end of each parallel region, the report function is invoked once per label with per-thread statistics and per-task and per-node imbalance summaries.
+/// If memory for statistics cannot be allocated, the parallel region runs without them. Unlabeled barriers are never recorded.
+/// The selection remains in effect until changed. Must not be called from within a Spindle parallel region.
+/// @param [in] reportFunc Function to receive reports, or `NULL` to disable barrier statistics.
+/// @param [in] arg Argument to pass to the report function.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindleSetBarrierStats(TSpindleBarrierStatsFunc reportFunc, void* arg);
+
+/// Enables or disables event tracing for subsequently-spawned parallel regions.
+/// While enabled, each thread records timestamped events into a ring buffer on its own NUMA node: the start and end of its task, the internal barriers that surround it, every local and global barrier, every data sharing operation, and any spans or instants marked by #spindleTraceBegin, #spindleTraceEnd, and #spindleTraceInstant.
+/// At the end of each parallel region, all recorded events are appended to the trace file in the Chrome trace event format, which can be opened by `chrome://tracing` or Perfetto. Each parallel region appears as a process and each thread as a track named by its task, NUMA node, and core.
+/// If a thread records more events than its buffer holds, the oldest are overwritten. Disabling tracing completes and closes the trace file.
+/// Tracing support is compiled in by default. It can be compiled out by building with `SPINDLE_TRACING=0`, in which case this function fails and all trace points cost nothing.
+/// The selection remains in effect until changed. Must not be called from within a Spindle parallel region or while any parallel region is running.
+/// @param [in] filePath Path of the trace file to create, or `NULL` to disable event tracing.
+/// @param [in] eventsPerThread Number of events each thread can hold before overwriting the oldest, rounded up to a power of two, or 0 to use a default.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindleSetTrace(const char* filePath, uint32_t eventsPerThread);
+
+/// Retrieves the frequency of the timestamp counter that timed barriers and event tracing read.
+/// Spindle calibrates the counter once, when the first parallel region is spawned or when first needed, using the frequency reported by the processor if available and otherwise by measuring it against the operating system's clock.
+/// Measuring the frequency busy-waits for about 10 milliseconds, a cost paid by whichever call comes first, usually the first call to #spindleThreadsSpawn.
+/// @return Frequency of the timestamp counter, in ticks per second.
+uint64_t spindleGetTimestampFrequency(void);
+
+/// Checks whether the timestamp counter is invariant, meaning it advances at a constant rate regardless of frequency scaling and power states.
+/// If not, tick counts may not correspond to elapsed time, and conversions to nanoseconds are approximate.
+/// @return `true` if the timestamp counter is invariant, `false` otherwise.
+bool spindleIsTimestampInvariant(void);
+
+/// Converts a number of timestamp counter ticks, such as the result of #spindleTimedBarrierLocal or #spindleTimedBarrierGlobal, to nanoseconds.
+/// @param [in] ticks Number of ticks.
+/// @return Equivalent number of nanoseconds.
+uint64_t spindleTimestampToNanoseconds(uint64_t ticks);
+
 /// Retrieves the current thread's local ID within its task.
 /// Undefined return value if called outside the context of a code region parallelized by this library.
 /// @return Current thread's local ID.
@@ -109,6 +465,25 @@ uint32_t spindleGetGlobalThreadCount(void);
 /// @return Total number of tasks.
 uint32_t spindleGetTaskCount(void);
 
+/// Retrieves the identifier of the cache domain in which the current thread runs, namely the logical index of the level 3 cache shared by its logical core.
+/// Threads with the same identifier share a level 3 cache, regardless of the task to which they belong.
+/// Undefined return value if called outside the context of a code region parallelized by this library.
+/// @return Current thread's cache domain identifier, or #kSpindleCacheDomainUnknown if the system does not describe a level 3 cache for its logical core.
+uint32_t spindleGetCacheDomainID(void);
+
+/// Retrieves the kind of physical core on which the current thread runs, which applications can use to scale each thread's share of the work.
+/// Undefined return value if called outside the context of a code region parallelized by this library.
+/// @return Kind of the current thread's physical core.
+ESpindleCoreKind spindleGetCoreKind(void);
+
+/// Retrieves the placement of any thread in the current parallel region, which maps global thread IDs to the cores on which the threads run.
+/// The result is identical to what #spindlePlanThreads reports for the same task specifications.
+/// Undefined behavior if called outside the context of a code region parallelized by this library.
+/// @param [in] globalThreadID Global thread ID of the thread, such as the result of #spindleGetGlobalThreadID.
+/// @param [out] placement Filled with the thread's placement.
+/// @return `true` on success, or `false` if the global thread ID is out of range.
+bool spindleGetThreadPlacement(uint32_t globalThreadID, SSpindleThreadPlacement* placement);
+
 /// Sets the value of the current thread's 64-bit per-thread variable.
 /// This variable can be used for any purpose and is valid only within the context of a code region parallelized by this library.
 /// @param [in] value Value to set.
@@ -119,6 +494,34 @@ void spindleSetLocalVariable(uint64_t value);
 /// @return Value of the current thread's per-thread variable.
 uint64_t spindleGetLocalVariable(void);
 
+/// Retrieves a pointer to the calling thread's context block, an array of 64-bit slots that can be used for any purpose.
+/// The context block is located on the calling thread's NUMA node, is aligned to a cache line boundary, and does not share cache lines with any other thread's context block.
+/// The number of slots is determined by the task specification, and all slots are initialized to 0 each time threads are spawned.
+/// @return Pointer to the first slot in the calling thread's context block.
+uint64_t* spindleGetContextBlock(void);
+
+/// Retrieves the number of slots in the calling thread's context block.
+/// @return Number of 64-bit slots.
+uint32_t spindleGetContextSlotCount(void);
+
+/// Retrieves the value of a slot in the calling thread's context block.
+/// Defined inline so that the slot access itself happens in the caller. Code that accesses many slots can instead keep the result of #spindleGetContextBlock.
+/// @param [in] index Zero-based index of the slot, which must be less than the number of slots.
+/// @return Value of the slot.
+static inline uint64_t spindleGetContextSlot(uint32_t index)
+{
+    return spindleGetContextBlock()[index];
+}
+
+/// Sets the value of a slot in the calling thread's context block.
+/// Defined inline so that the slot access itself happens in the caller. Code that accesses many slots can instead keep the result of #spindleGetContextBlock.
+/// @param [in] index Zero-based index of the slot, which must be less than the number of slots.
+/// @param [in] value New value for the slot.
+static inline void spindleSetContextSlot(uint32_t index, uint64_t value)
+{
+    spindleGetContextBlock()[index] = value;
+}
+
 /// Provides a barrier that no thread can pass until all threads in the current task have reached this point in the execution.
 /// Useful for synchronization.
 void spindleBarrierLocal(void);
@@ -129,14 +532,268 @@ void spindleBarrierGlobal(void);
 
 /// Provides a barrier that no thread can pass until all threads in the current task have reached this point in the execution.
 /// Useful for synchronization, but this version measures the time a thread spends waiting.
-/// @return Number of cycles the calling thread spent waiting, captured using the `rdtsc` instruction.
+/// @return Number of timestamp counter ticks the calling thread spent waiting, captured using the `rdtsc` or `rdtscp` instruction. See #spindleTimestampToNanoseconds.
 uint64_t spindleTimedBarrierLocal(void);
 
 /// Provides a barrier that no thread can pass until all threads have reached this point in the execution.
 /// Useful for synchronization, but this version measures the time a thread spends waiting.
-/// @return Number of cycles the calling thread spent waiting, captured using the `rdtsc` instruction.
+/// @return Number of timestamp counter ticks the calling thread spent waiting, captured using the `rdtsc` or `rdtscp` instruction. See #spindleTimestampToNanoseconds.
 uint64_t spindleTimedBarrierGlobal(void);
 
+/// Provides a barrier that no thread can pass until all threads in the current task have reached this point in the execution.
+/// Useful for synchronization, but this version measures the time a thread spends waiting, in units that are comparable across processors.
+/// @return Number of nanoseconds the calling thread spent waiting.
+uint64_t spindleTimedBarrierLocalNanoseconds(void);
+
+/// Provides a barrier that no thread can pass until all threads have reached this point in the execution.
+/// Useful for synchronization, but this version measures the time a thread spends waiting, in units that are comparable across processors.
+/// @return Number of nanoseconds the calling thread spent waiting.
+uint64_t spindleTimedBarrierGlobalNanoseconds(void);
+
+/// Provides a barrier that no thread can pass until all threads in the current task have reached this point in the execution.
+/// If barrier statistics are enabled, records the calling thread's wait under the specified label. See #spindleSetBarrierStats.
+/// All threads in the current task must pass the same label, which is compared by content and must remain valid until the end of the parallel region.
+/// @param [in] label Label that identifies the barrier call site.
+void spindleBarrierLocalLabeled(const char* label);
+
+/// Provides a barrier that no thread can pass until all threads have reached this point in the execution.
+/// If barrier statistics are enabled, records the calling thread's wait under the specified label. See #spindleSetBarrierStats.
+/// All threads must pass the same label, which is compared by content and must remain valid until the end of the parallel region.
+/// @param [in] label Label that identifies the barrier call site.
+void spindleBarrierGlobalLabeled(const char* label);
+
+/// Begins a span on the calling thread's track in the event trace, which lasts until the matching call to #spindleTraceEnd.
+/// Spans on the same thread may nest. Does nothing unless the calling thread's parallel region is being traced. See #spindleSetTrace.
+/// @param [in] name Name of the span, which must remain valid until the end of the parallel region.
+void spindleTraceBegin(const char* name);
+
+/// Ends the span most recently begun by the calling thread using #spindleTraceBegin.
+/// Does nothing unless the calling thread's parallel region is being traced.
+void spindleTraceEnd(void);
+
+/// Marks a single point in time on the calling thread's track in the event trace.
+/// Does nothing unless the calling thread's parallel region is being traced.
+/// @param [in] name Name of the event, which must remain valid until the end of the parallel region.
+void spindleTraceInstant(const char* name);
+
+/// Combines a 64-bit integer contributed by each thread in the current task and returns the result to all of them.
+/// All threads in the current task must call this function with the same operation. Acts as a local barrier.
+/// Values are combined in the order of local thread ID, irrespective of the order in which threads arrive.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] value Value contributed by the calling thread.
+/// @return Combination of the values contributed by all threads in the current task.
+int64_t spindleReduceLocalInt(ESpindleReduceOp op, int64_t value);
+
+/// Combines a 64-bit integer contributed by every thread and returns the result to all of them.
+/// All threads must call this function with the same operation. Acts as a global barrier.
+/// Values are combined in the order of global thread ID, irrespective of the order in which threads arrive.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] value Value contributed by the calling thread.
+/// @return Combination of the values contributed by all threads.
+int64_t spindleReduceGlobalInt(ESpindleReduceOp op, int64_t value);
+
+/// Combines a double-precision value contributed by each thread in the current task and returns the result to all of them.
+/// All threads in the current task must call this function with the same operation. Acts as a local barrier.
+/// Values are combined in the order of local thread ID, irrespective of the order in which threads arrive, so results are deterministic.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] value Value contributed by the calling thread.
+/// @return Combination of the values contributed by all threads in the current task.
+double spindleReduceLocalDouble(ESpindleReduceOp op, double value);
+
+/// Combines a double-precision value contributed by every thread and returns the result to all of them.
+/// All threads must call this function with the same operation. Acts as a global barrier.
+/// Values are combined in the order of global thread ID, irrespective of the order in which threads arrive, so results are deterministic.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] value Value contributed by the calling thread.
+/// @return Combination of the values contributed by all threads.
+double spindleReduceGlobalDouble(ESpindleReduceOp op, double value);
+
+/// Computes a prefix combination, in the order of local thread ID, of a 64-bit integer contributed by each thread in the current task.
+/// All threads in the current task must call this function with the same operation and the same choice of inclusive or exclusive scan. Acts as a local barrier.
+/// Useful for computing output offsets. An exclusive scan returns the identity of the operation to the thread with local ID 0.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [in] inclusive `true` to include the calling thread's own value in its result, `false` to include only the values of preceding threads.
+/// @return Combination of the values contributed by the preceding threads in the current task and, if inclusive, the calling thread.
+int64_t spindleScanLocalInt(ESpindleReduceOp op, int64_t value, bool inclusive);
+
+/// Computes a prefix combination, in the order of global thread ID, of a 64-bit integer contributed by every thread.
+/// All threads must call this function with the same operation and the same choice of inclusive or exclusive scan. Acts as a global barrier.
+/// Useful for computing output offsets. An exclusive scan returns the identity of the operation to the thread with global ID 0.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [in] inclusive `true` to include the calling thread's own value in its result, `false` to include only the values of preceding threads.
+/// @return Combination of the values contributed by the preceding threads and, if inclusive, the calling thread.
+int64_t spindleScanGlobalInt(ESpindleReduceOp op, int64_t value, bool inclusive);
+
+/// Computes a prefix combination, in the order of local thread ID, of a double-precision value contributed by each thread in the current task.
+/// All threads in the current task must call this function with the same operation and the same choice of inclusive or exclusive scan. Acts as a local barrier.
+/// An exclusive scan returns the identity of the operation to the thread with local ID 0.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [in] inclusive `true` to include the calling thread's own value in its result, `false` to include only the values of preceding threads.
+/// @return Combination of the values contributed by the preceding threads in the current task and, if inclusive, the calling thread.
+double spindleScanLocalDouble(ESpindleReduceOp op, double value, bool inclusive);
+
+/// Computes a prefix combination, in the order of global thread ID, of a double-precision value contributed by every thread.
+/// All threads must call this function with the same operation and the same choice of inclusive or exclusive scan. Acts as a global barrier.
+/// An exclusive scan returns the identity of the operation to the thread with global ID 0.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [in] inclusive `true` to include the calling thread's own value in its result, `false` to include only the values of preceding threads.
+/// @return Combination of the values contributed by the preceding threads and, if inclusive, the calling thread.
+double spindleScanGlobalDouble(ESpindleReduceOp op, double value, bool inclusive);
+
+/// Collects a 64-bit value from each thread in the current task and provides all of them to every thread in the task.
+/// All threads in the current task must call this function. Completes in a single local barrier episode.
+/// Each thread writes its value to its own cache line, so contributing threads do not false-share.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [out] values Array to fill with the values contributed by all threads in the current task, indexed by local thread ID. Must have room for one value per thread in the task.
+void spindleAllGatherLocal(uint64_t value, uint64_t* values);
+
+/// Collects a 64-bit value from every thread and provides all of them to every thread.
+/// All threads must call this function. Completes in a single global barrier episode.
+/// Each thread writes its value to its own cache line, so contributing threads do not false-share.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [out] values Array to fill with the values contributed by all threads, indexed by global thread ID. Must have room for one value per thread.
+void spindleAllGatherGlobal(uint64_t value, uint64_t* values);
+
+/// Collects a 64-bit value from each thread in the current task and provides all of them to a single root thread in the task.
+/// All threads in the current task must call this function with the same root. Completes in a single local barrier episode.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [out] values On the root thread, array to fill with the values contributed by all threads in the current task, indexed by local thread ID. Ignored on other threads, and may be `NULL`.
+/// @param [in] rootLocalThreadID Local thread ID of the root thread.
+void spindleGatherLocal(uint64_t value, uint64_t* values, uint32_t rootLocalThreadID);
+
+/// Collects a 64-bit value from every thread and provides all of them to a single root thread.
+/// All threads must call this function with the same root. Completes in a single global barrier episode.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [out] values On the root thread, array to fill with the values contributed by all threads, indexed by global thread ID. Ignored on other threads, and may be `NULL`.
+/// @param [in] rootGlobalThreadID Global thread ID of the root thread.
+void spindleGatherGlobal(uint64_t value, uint64_t* values, uint32_t rootGlobalThreadID);
+
+/// Executes a loop in parallel across all threads in the current task, using the specified loop schedule.
+/// All threads in the current task must call this function with the same parameters. Ends with an implicit local barrier.
+/// @param [in] begin First iteration of the loop.
+/// @param [in] end One past the last iteration of the loop. The loop is empty if this is not greater than the first iteration.
+/// @param [in] schedule Policy for distributing iterations among threads.
+/// @param [in] chunkSize Number of iterations per chunk, interpreted according to the schedule.
+/// @param [in] func Loop body, invoked for each chunk of iterations assigned to the calling thread.
+/// @param [in] arg Argument to pass to the loop body.
+void spindleParallelForLocal(int64_t begin, int64_t end, ESpindleLoopSchedule schedule, uint64_t chunkSize, TSpindleLoopFunc func, void* arg);
+
+/// Executes a loop in parallel across all threads, using the specified loop schedule.
+/// All threads must call this function with the same parameters. Ends with an implicit global barrier.
+/// For dynamic and guided schedules, the iterations are initially divided among NUMA nodes in proportion to the number of threads on each, and threads claim chunks from a counter located on their own node.
+/// Threads move on to claim chunks from other nodes only once their own node's share of the iterations is exhausted.
+/// @param [in] begin First iteration of the loop.
+/// @param [in] end One past the last iteration of the loop. The loop is empty if this is not greater than the first iteration.
+/// @param [in] schedule Policy for distributing iterations among threads.
+/// @param [in] chunkSize Number of iterations per chunk, interpreted according to the schedule.
+/// @param [in] func Loop body, invoked for each chunk of iterations assigned to the calling thread.
+/// @param [in] arg Argument to pass to the loop body.
+void spindleParallelForGlobal(int64_t begin, int64_t end, ESpindleLoopSchedule schedule, uint64_t chunkSize, TSpindleLoopFunc func, void* arg);
+
+/// Allocates memory on the NUMA node of the current task.
+/// Must be called from within a Spindle parallel region. Memory so allocated may outlive the region.
+/// @param [in] size Number of bytes to allocate.
+/// @param [in] pageSize Page size to use.
+/// @return Pointer to the allocated memory on success, or `NULL` on failure.
+void* spindleMemoryAllocateLocal(size_t size, ESpindlePageSize pageSize);
+
+/// Allocates memory on the NUMA node of the specified task.
+/// Must be called from within a Spindle parallel region. Memory so allocated may outlive the region.
+/// @param [in] taskID Task ID of the task whose NUMA node is to hold the memory.
+/// @param [in] size Number of bytes to allocate.
+/// @param [in] pageSize Page size to use.
+/// @return Pointer to the allocated memory on success, or `NULL` on failure, including if the task does not exist.
+void* spindleMemoryAllocateForTask(uint32_t taskID, size_t size, ESpindlePageSize pageSize);
+
+/// Allocates memory on the specified NUMA node.
+/// May be called from anywhere, including outside of a Spindle parallel region.
+/// @param [in] numaNode Zero-based index of the NUMA node, as used in task specifications.
+/// @param [in] size Number of bytes to allocate.
+/// @param [in] pageSize Page size to use.
+/// @return Pointer to the allocated memory on success, or `NULL` on failure.
+void* spindleMemoryAllocateOnNode(uint32_t numaNode, size_t size, ESpindlePageSize pageSize);
+
+/// Allocates one equally-sized partition of memory per task, each on the NUMA node on which that task will run.
+/// Intended to be called before spawning threads using the same task specifications and options, so that input data can be placed before the region starts.
+/// Task specifications that create several tasks, whether one per NUMA node or one per cache domain, receive one partition for each of those tasks, so there may be more partitions than task specifications.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskOptions Options for each task specification, as an array parallel to the task specifications, or `NULL` to use the default options for all of them. See #spindleThreadsSpawnWithOptions.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] partitionSize Number of bytes to allocate for each task.
+/// @param [in] pageSize Page size to use.
+/// @param [out] partitions Receives an array, indexed by task ID, of pointers to the partitions, which must be released using #spindleMemoryFreePartitions. Receives `NULL` on failure.
+/// @param [out] partitionCount Receives the number of partitions, which is the number of tasks that spawning threads would create. Receives 0 on failure.
+/// @return 0 on success, or nonzero in the event of an error, in which case no memory remains allocated.
+uint32_t spindleMemoryAllocatePartitions(SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, size_t partitionSize, ESpindlePageSize pageSize, void*** partitions, uint32_t* partitionCount);
+
+/// Frees memory allocated by any of the Spindle memory allocation functions.
+/// @param [in] ptr Pointer to the memory to free. Nothing happens if this is `NULL`.
+/// @param [in] size Number of bytes originally requested.
+/// @param [in] pageSize Page size originally requested.
+void spindleMemoryFree(void* ptr, size_t size, ESpindlePageSize pageSize);
+
+/// Frees partitions allocated by #spindleMemoryAllocatePartitions, along with the array that points to them.
+/// @param [in] partitions Array of pointers to the partitions. Nothing happens if this is `NULL`.
+/// @param [in] partitionCount Number of partitions, as produced by #spindleMemoryAllocatePartitions.
+/// @param [in] partitionSize Number of bytes originally requested for each task.
+/// @param [in] pageSize Page size originally requested.
+void spindleMemoryFreePartitions(void** partitions, uint32_t partitionCount, size_t partitionSize, ESpindlePageSize pageSize);
+
+/// Allocates memory from the calling thread's arena, which is located on the thread's NUMA node.
+/// Allocation only advances a per-thread offset, so it is extremely fast and never contends with other threads. Memory is not freed individually, but rather released in bulk using #spindleArenaReleaseToMark or the arena barrier functions.
+/// Each thread's arena is emptied whenever threads are spawned.
+/// @param [in] size Number of bytes to allocate.
+/// @param [in] alignment Required alignment, in bytes, which must be a power of two, or 0 for 16-byte alignment.
+/// @return Pointer to the allocated memory, or `NULL` if the arena does not have enough space remaining.
+void* spindleArenaAllocate(size_t size, size_t alignment);
+
+/// Retrieves a mark that identifies the current allocation position in the calling thread's arena.
+/// @return Mark to pass to #spindleArenaReleaseToMark.
+size_t spindleArenaGetMark(void);
+
+/// Releases all memory allocated from the calling thread's arena since the specified mark was obtained.
+/// @param [in] mark Mark obtained from #spindleArenaGetMark.
+void spindleArenaReleaseToMark(size_t mark);
+
+/// Provides a thread barrier with respect to other threads in the same task and then empties the calling thread's arena.
+/// Because all threads in the task have passed the barrier, none of them can still be using memory allocated from arenas during the preceding phase.
+void spindleArenaBarrierLocal(void);
+
+/// Provides a thread barrier with respect to all other threads and then empties the calling thread's arena.
+/// Because all threads have passed the barrier, none of them can still be using memory allocated from arenas during the preceding phase.
+void spindleArenaBarrierGlobal(void);
+
+/// Runs a work item, and all the work items it spawns, using a work-stealing scheduler across all threads in the current task.
+/// All threads in the current task must call this function with the same parameters. The thread with local thread ID 0 executes the specified work item, and the others steal spawned work items until it completes.
+/// Ends with an implicit local barrier.
+/// @param [in] func Function to call for the first work item.
+/// @param [in] arg Argument to pass to the first work item.
+void spindleWorkRunLocal(TSpindleFunc func, void* arg);
+
+/// Runs a work item, and all the work items it spawns, using a work-stealing scheduler across all threads.
+/// All threads must call this function with the same parameters. The thread with global thread ID 0 executes the specified work item, and the others steal spawned work items until it completes.
+/// Thieves try threads in order of proximity: first any other thread on the same physical core, then the rest of the same task, then other tasks on the same NUMA node, and only then threads on other NUMA nodes.
+/// Ends with an implicit global barrier.
+/// @param [in] func Function to call for the first work item.
+/// @param [in] arg Argument to pass to the first work item.
+void spindleWorkRunGlobal(TSpindleFunc func, void* arg);
+
+/// Spawns a work item that may be executed by the calling thread or stolen by any other thread participating in the current work-stealing run.
+/// Every work item implicitly waits for all the work items it spawns before it is considered complete.
+/// If called outside of a work-stealing run, or if the calling thread has too many spawned work items outstanding, the work item is executed immediately.
+/// @param [in] func Function to call for the work item.
+/// @param [in] arg Argument to pass to the work item.
+void spindleWorkSpawn(TSpindleFunc func, void* arg);
+
+/// Waits for all work items spawned so far by the calling work item to complete.
+/// While waiting, the calling thread executes other work items, so this function does not idle while work is available.
+/// Has no effect if called outside of a work-stealing run.
+void spindleWorkSync(void);
+
 /// Shares a 64-bit data item with other threads in the same Spindle task.
 /// Only one thread in the task should call this function.
 /// @param [in] data Quantity that is to be shared.
@@ -157,6 +814,33 @@ uint64_t spindleDataShareReceiveLocal(void);
 /// @return [out] Shared data item.
 uint64_t spindleDataShareReceiveGlobal(void);
 
+/// Shares the contents of a buffer of arbitrary size with other threads in the same Spindle task.
+/// Only one thread in the task should call this function. Returns once every receiver has copied the contents, after which the buffer may be reused.
+/// @param [in] buffer Buffer whose contents are to be shared.
+/// @param [in] size Size of the buffer, in bytes.
+void spindleDataShareSendBufferLocal(const void* buffer, size_t size);
+
+/// Shares the contents of a buffer of arbitrary size with all other Spindle-created threads.
+/// Only one thread should call this function. Returns once every receiver has copied the contents, after which the buffer may be reused.
+/// The contents are copied once to each other NUMA node spanned by the spawned threads, so that receivers on that node copy from node-local memory.
+/// @param [in] buffer Buffer whose contents are to be shared.
+/// @param [in] size Size of the buffer, in bytes.
+void spindleDataShareSendBufferGlobal(const void* buffer, size_t size);
+
+/// Receives the contents of a buffer shared by another thread in the same Spindle task.
+/// All threads in the same task except the sender should call this function.
+/// @param [out] buffer Buffer to fill with the shared contents.
+/// @param [in] size Size of the buffer, in bytes. If smaller than the size of the shared contents, only this many bytes are copied.
+/// @return Size of the shared contents, in bytes.
+size_t spindleDataShareReceiveBufferLocal(void* buffer, size_t size);
+
+/// Receives the contents of a buffer shared by another Spindle-created thread.
+/// All threads except the sender should call this function.
+/// @param [out] buffer Buffer to fill with the shared contents.
+/// @param [in] size Size of the buffer, in bytes. If smaller than the size of the shared contents, only this many bytes are copied.
+/// @return Size of the shared contents, in bytes.
+size_t spindleDataShareReceiveBufferGlobal(void* buffer, size_t size);
+
 
 #ifdef __cplusplus
 }
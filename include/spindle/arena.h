@@ -0,0 +1,68 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file arena.h
+ *   Interface to internal per-thread arena allocator functionality.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Default number of bytes available in each thread's arena, used if a task specification does not specify a size.
+#define kSpindleArenaDefaultSize                (1024ull * 1024ull)
+
+/// Default alignment, in bytes, of allocations made from an arena, used if an allocation does not specify an alignment.
+#define kSpindleArenaDefaultAlignment           16
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Represents the bookkeeping information for a single thread's arena.
+/// Stored at the start of the arena's own memory, which is allocated on the owning thread's NUMA node, and padded so that allocations begin on a separate cache line.
+typedef struct SSpindleArena
+{
+    size_t capacity;                                                        ///< Number of bytes available for allocation.
+    size_t offset;                                                          ///< Number of bytes, from the start of the allocatable region, that are currently allocated.
+    size_t allocatedSize;                                                   ///< Total number of bytes of memory backing the arena, including this structure.
+    uint8_t padding[128 - (3 * sizeof(size_t))];                            ///< Unused, cache-line alignment padding.
+} SSpindleArena;
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Allocates an arena for each thread on that thread's NUMA node, sized according to the task specification of the thread's task.
+/// Intended to be called during the spawning process, after threads have been assigned to cores.
+/// Does nothing if the specified parallel region already holds them.
+/// @param [in] region Parallel region.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] threadAssignments Thread assignments, as an array.
+/// @param [in] threadCount Number of threads assigned.
+/// @return `true` on success, `false` on failure.
+bool spindleAllocateArenas(SSpindleRegion* region, SSpindleTaskConfig* taskSpec, SSpindleThreadInfo* threadAssignments, uint32_t threadCount);
+
+/// Frees all previously-allocated arenas of the specified parallel region.
+/// Intended to be called after all spawned threads have terminated.
+/// @param [in] region Parallel region.
+void spindleFreeArenas(SSpindleRegion* region);
+
+/// Empties the arena belonging to the specified thread.
+/// Intended to be called by each thread as it starts, before running its starting function.
+/// @param [in] region Parallel region to which the owning thread belongs.
+/// @param [in] globalThreadID Global thread ID of the owning thread.
+void spindleInitializeThreadArena(SSpindleRegion* region, uint32_t globalThreadID);
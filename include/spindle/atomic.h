@@ -0,0 +1,97 @@
+/*****************************************************************************
+* Spindle
+*   Multi-platform topology-aware thread control library.
+*   Distributes a set of synchronized tasks over cores in the system.
+*****************************************************************************
+* Authored by Samuel Grossman
+* Department of Electrical Engineering, Stanford University
+* Copyright (c) 2016-2017
+*************************************************************************//**
+* @file atomic.h
+*   Platform-specific atomic operation macros.
+*   Not intended for external use.
+*****************************************************************************/
+
+#pragma once
+
+#ifdef SPINDLE_WINDOWS
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+
+// -------- PLATFORM-SPECIFIC MACROS --------------------------------------- //
+
+/// Atomically adds `value` to the 32-bit quantity at `ptr` and yields the resulting sum.
+/// Acts as a full memory barrier.
+/// Implementation is platform-specific.
+#ifdef SPINDLE_WINDOWS
+#define atomic_add32(ptr, value)                ((uint32_t)_InterlockedExchangeAdd((volatile long*)(ptr), (long)(value)) + (uint32_t)(value))
+#else
+#define atomic_add32(ptr, value)                __atomic_add_fetch((ptr), (value), __ATOMIC_SEQ_CST)
+#endif
+
+/// Atomically adds `value` to the 64-bit quantity at `ptr` and yields the value held before the addition.
+/// Acts as a full memory barrier.
+/// Implementation is platform-specific.
+#ifdef SPINDLE_WINDOWS
+#define atomic_fetch_add64(ptr, value)          ((uint64_t)_InterlockedExchangeAdd64((volatile long long*)(ptr), (long long)(value)))
+#else
+#define atomic_fetch_add64(ptr, value)          __atomic_fetch_add((ptr), (value), __ATOMIC_SEQ_CST)
+#endif
+
+/// Atomically replaces the 64-bit quantity at `ptr` with `desired` if it is equal to `expected`, and yields `true` if the replacement took place.
+/// Acts as a full memory barrier.
+/// Implementation is platform-specific.
+#ifdef SPINDLE_WINDOWS
+#define atomic_cas64(ptr, expected, desired)    ((uint64_t)_InterlockedCompareExchange64((volatile long long*)(ptr), (long long)(desired), (long long)(expected)) == (uint64_t)(expected))
+#else
+#define atomic_cas64(ptr, expected, desired)    __sync_bool_compare_and_swap((ptr), (expected), (desired))
+#endif
+
+/// Loads the 64-bit quantity at `ptr`, preventing the compiler from caching or eliding the load.
+#define atomic_load64(ptr)                      (*(volatile uint64_t*)(ptr))
+
+/// Issues a full memory barrier, ordering all prior loads and stores before all subsequent loads and stores.
+/// Implementation is platform-specific.
+#ifdef SPINDLE_WINDOWS
+#define atomic_fence()                          _mm_mfence()
+#else
+#define atomic_fence()                          __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+/// Loads the 32-bit quantity at `ptr` with acquire semantics, so that no subsequent memory access is performed before it.
+/// Implementation is platform-specific. On Windows, volatile accesses already have acquire and release semantics.
+#ifdef SPINDLE_WINDOWS
+#define atomic_load32_acquire(ptr)              (*(volatile uint32_t*)(ptr))
+#else
+#define atomic_load32_acquire(ptr)              __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#endif
+
+/// Loads the 64-bit quantity at `ptr` with acquire semantics, so that no subsequent memory access is performed before it.
+/// Implementation is platform-specific. On Windows, volatile accesses already have acquire and release semantics.
+#ifdef SPINDLE_WINDOWS
+#define atomic_load64_acquire(ptr)              (*(volatile uint64_t*)(ptr))
+#else
+#define atomic_load64_acquire(ptr)              __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#endif
+
+/// Stores `value` to the 32-bit quantity at `ptr` with release semantics, so that no prior memory access is performed after it.
+/// Implementation is platform-specific.
+#ifdef SPINDLE_WINDOWS
+#define atomic_store32_release(ptr, value)      do { _ReadWriteBarrier(); *(volatile uint32_t*)(ptr) = (value); } while (0)
+#else
+#define atomic_store32_release(ptr, value)      __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#endif
+
+/// Stores `value` to the 64-bit quantity at `ptr` with release semantics, so that no prior memory access is performed after it.
+/// Implementation is platform-specific. On Windows, volatile accesses already have acquire and release semantics.
+#ifdef SPINDLE_WINDOWS
+#define atomic_store64_release(ptr, value)      do { _ReadWriteBarrier(); *(volatile uint64_t*)(ptr) = (value); } while (0)
+#else
+#define atomic_store64_release(ptr, value)      __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#endif
+
+/// Hints to the processor that the calling thread is in a spin-wait loop.
+#define spin_pause()                            _mm_pause()
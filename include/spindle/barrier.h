@@ -14,56 +14,157 @@
 
 #pragma once
 
+#include "types.h"
+
+#include <stddef.h>
 #include <stdint.h>
 
 
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Default number of spin-wait iterations a thread performs at a barrier before blocking, if blocking is enabled without specifying a number.
+#define kSpindleBarrierDefaultSpinIterations    16384
+
+/// Maximum number of `pause` instructions a thread issues between consecutive checks of a barrier flag while spinning before blocking.
+/// The number starts at 1 and doubles after each check, which reduces pressure on a sibling hardware thread without delaying short waits.
+#define kSpindleBarrierMaxBackoffIterations     16
+
+
 // -------- TYPE DEFINITIONS ----------------------------------------------- //
 
 /// Represents the layout of storage space used to hold barrier-related quantities.
 /// A single 32-bit value is accompanied by padding, to align on a two-cache-line (128-byte) boundary.
+/// When the value is used as a barrier flag, the word that follows it counts the threads blocked waiting for the flag to change.
 typedef struct SSpindleBarrierData
 {
     uint32_t value;                                                         ///< Data value.
-    uint8_t padding[128 - sizeof(uint32_t)];                                ///< Unused, cache-line alignment padding.
+    uint32_t sleepCount;                                                    ///< Number of threads blocked waiting for the value to change, if used as a barrier flag.
+    uint8_t padding[128 - (2 * sizeof(uint32_t))];                          ///< Unused, cache-line alignment padding.
 } SSpindleBarrierData;
 
+/// Represents the layout of storage space used to hold the first-level barrier for a single NUMA node, as part of the hierarchical global barrier.
+/// Each instance is allocated on the NUMA node it represents, so that threads on that node combine and wait without generating cross-node traffic.
+/// The counter occupies the first cache line, alongside read-mostly bookkeeping, and the flag occupies the second cache line.
+typedef struct SSpindleNodeBarrier
+{
+    uint32_t counter;                                                       ///< Number of threads on the NUMA node that have yet to reach the barrier.
+    uint32_t threadCount;                                                   ///< Number of threads on the NUMA node, used to reset the counter.
+    uint32_t numaNode;                                                      ///< Zero-based index of the NUMA node.
+    uint32_t firstTaskID;                                                   ///< Task ID of the first task on the NUMA node, whose first thread acts on behalf of the whole NUMA node.
+    void* replica;                                                          ///< Memory local to the NUMA node that holds a copy of the most recent global bulk broadcast, or `NULL` if not yet allocated.
+    size_t replicaSize;                                                     ///< Size, in bytes, of the replica buffer.
+    uint8_t padding1[64 - (4 * sizeof(uint32_t)) - sizeof(void*) - sizeof(size_t)];    ///< Unused, cache-line alignment padding.
+    uint32_t flag;                                                          ///< Flag on which threads on the NUMA node spin while waiting for the global barrier.
+    uint32_t flagSleepCount;                                                ///< Number of threads on the NUMA node blocked waiting for the flag to change.
+    uint8_t padding2[64 - (2 * sizeof(uint32_t))];                          ///< Unused, cache-line alignment padding.
+} SSpindleNodeBarrier;
+
 
 // -------- GLOBALS -------------------------------------------------------- //
 
-/// Storage area for the counter of threads that have reached the global barrier, plus cache-line padding.
-extern SSpindleBarrierData spindleGlobalBarrierCounter;
-
-/// Storage area for the global barrier flag, on which threads spin while waiting for the global barrier, plus cache-line padding.
-extern SSpindleBarrierData spindleGlobalBarrierFlag;
+/// Nonzero if threads spinning at a barrier use monitored waits (`umonitor` and `umwait`) rather than `pause` loops.
+/// Set at runtime, based on whether or not the processor supports the WAITPKG feature.
+extern uint32_t spindleBarrierUseWaitPkg;
 
-/// Base address for all local barrier counters and flags.
-extern SSpindleBarrierData* spindleLocalBarrierBase;
+/// Nonzero if timed barriers capture their final timestamp using `rdtscp`, which waits for all earlier instructions to complete, rather than `lfence` followed by `rdtsc`.
+/// Set at runtime when the timestamp counter is calibrated, based on whether or not the processor supports the `rdtscp` instruction. See "timestamp.h".
+extern uint32_t spindleBarrierUseRdtscp;
 
 
 // -------- FUNCTIONS ------------------------------------------------------ //
 
-/// Allocates space for all local thread barriers.
+/// Allocates space for all local thread barriers of the specified parallel region.
 /// Intended to be called during the spawning process.
+/// @param [in] region Parallel region.
 /// @param [in] taskCount Number of tasks.
 /// @return Pointer to the start of the memory region on success, or `NULL` on failure.
-void* spindleAllocateLocalThreadBarriers(uint32_t taskCount);
+void* spindleAllocateLocalThreadBarriers(SSpindleRegion* region, uint32_t taskCount);
+
+/// Allocates and initializes the per-NUMA-node first-level barriers used by the hierarchical global barrier.
+/// Each first-level barrier is placed in memory local to its NUMA node.
+/// Intended to be called during the spawning process, after threads have been assigned to cores.
+/// @param [in] region Parallel region.
+/// @param [in] threadAssignments Thread assignments, as an array.
+/// @param [in] threadCount Number of threads assigned.
+/// @param [in] taskCount Number of tasks.
+/// @return Pointer to the table of first-level barriers on success, or `NULL` on failure.
+void* spindleAllocateNodeThreadBarriers(SSpindleRegion* region, SSpindleThreadInfo* threadAssignments, uint32_t threadCount, uint32_t taskCount);
+
+/// Checks whether the processor supports the WAITPKG feature, which provides the `umonitor`, `umwait`, and `tpause` instructions.
+/// @return Nonzero if so, 0 otherwise.
+uint32_t spindleBarrierDetectWaitPkg(void);
 
 /// Provides a barrier that no thread can pass until all threads have reached this point in the execution.
 /// For internal use only. This is the same as the external version, except it uses a different area of memory to help catch end-user bugs.
 /// If a user specifies tasks with different numbers of global barriers, Spindle needs a separate internal barrier to help avoid allowing the program to proceed past thread spawning.
 void spindleBarrierInternalGlobal(void);
 
-/// Frees all previously-allocated space for local thread barriers.
+/// Implements the local barrier without recording it in the event trace.
+/// Invoked by #spindleBarrierLocal, which it immediately follows, and by the tracing wrapper around it. See "trace.h".
+void spindleBarrierLocalUntraced(void);
+
+/// Implements the global barrier without recording it in the event trace.
+/// Invoked by #spindleBarrierGlobal, which it immediately follows, and by the tracing wrapper around it. See "trace.h".
+void spindleBarrierGlobalUntraced(void);
+
+/// Spins until a barrier flag changes from the specified value, without ever blocking.
+/// Uses monitored waits on the flag's cache line if #spindleBarrierUseWaitPkg is nonzero, otherwise a `pause` loop.
+/// Invoked directly by the barrier implementations.
+/// @param [in] flag Address of the barrier flag.
+/// @param [in] value Value of the flag observed before reaching the barrier.
+void spindleBarrierSpinFlag(volatile uint32_t* flag, uint32_t value);
+
+/// Waits, according to the current barrier waiting policy, for a barrier flag to change from the specified value.
+/// Spins with exponential backoff for up to the calling thread's parallel region's spin limit, then blocks in the operating system.
+/// Invoked directly by the barrier implementations, and only if that spin limit is nonzero.
+/// @param [in] flag Address of the barrier flag, which must be immediately followed by the count of threads blocked on it.
+/// @param [in] value Value of the flag observed before reaching the barrier.
+void spindleBarrierWaitFlag(volatile uint32_t* flag, uint32_t value);
+
+/// Wakes all threads blocked waiting for a barrier flag to change, if there are any.
+/// Must be called after the flag is updated. Invoked directly by the barrier implementations, and only if the calling thread's parallel region's spin limit is nonzero.
+/// @param [in] flag Address of the barrier flag, which must be immediately followed by the count of threads blocked on it.
+void spindleBarrierWakeFlag(volatile uint32_t* flag);
+
+/// Wakes all threads blocked waiting for any per-NUMA-node first-level barrier flag of the calling thread's parallel region to change, if there are any.
+/// Must be called after the flags are updated. Invoked directly by the hierarchical global barrier, and only if the parallel region's spin limit is nonzero.
+void spindleBarrierWakeNodeFlags(void);
+
+/// Arrives at the internal global barrier of the specified parallel region on behalf of threads that will never reach it, so that the threads waiting there are released once all others have arrived.
+/// Invoked from outside the parallel region when some of its threads could not be created.
+/// @param [in] region Parallel region whose threads are waiting at the internal global barrier.
+/// @param [in] missingThreadCount Number of threads that will never reach the barrier.
+void spindleBarrierInternalGlobalArriveMissing(SSpindleRegion* region, uint32_t missingThreadCount);
+
+/// Frees all previously-allocated space for local thread barriers of the specified parallel region.
+/// Intended to be called after all spawned threads have terminated.
+/// @param [in] region Parallel region.
+void spindleFreeLocalThreadBarriers(SSpindleRegion* region);
+
+/// Frees all previously-allocated space for per-NUMA-node first-level barriers of the specified parallel region.
 /// Intended to be called after all spawned threads have terminated.
-void spindleFreeLocalThreadBarriers(void);
+/// @param [in] region Parallel region.
+void spindleFreeNodeThreadBarriers(SSpindleRegion* region);
 
-/// Initializes the local thread barrier memory regions for the specified thread group.
+/// Determines the number of spin-wait iterations a thread performs at a barrier before blocking in the operating system, as captured by each parallel region.
+/// @param [in] policy Barrier waiting policy, part of the first task specification.
+/// @param [in] spinIterations Requested number of spin-wait iterations, part of the first task specification, or 0 to use the default.
+/// @return Number of spin-wait iterations, or 0 if threads spin without ever blocking.
+uint32_t spindleGetBarrierSpinLimit(ESpindleBarrierWaitPolicy policy, uint32_t spinIterations);
+
+/// Selects how threads spin at barriers, based on the capabilities of the processor.
+/// Intended to be called during the thread spawning process but before actual thread creation. Only the first call has any effect.
+void spindleInitializeBarrierSpinMethod(void);
+
+/// Initializes the local thread barrier memory regions for the specified thread group of the specified parallel region.
 /// Intended to be called during the thread spawning process but before actual thread creation.
+/// @param [in] region Parallel region.
 /// @param [in] taskID Target thread group ID.
 /// @param [in] localThreadCount Number of threads being spawned in the target thread group.
-void spindleInitializeLocalThreadBarrier(uint32_t taskID, uint32_t localThreadCount);
+void spindleInitializeLocalThreadBarrier(SSpindleRegion* region, uint32_t taskID, uint32_t localThreadCount);
 
-/// Initializes the global thread barrier memory regions.
-/// Intended to be called during the thread spawning process but before actual thread creation.
+/// Initializes the global thread barrier memory regions of the specified parallel region, including any per-NUMA-node first-level barriers.
+/// Intended to be called during the thread spawning process but before actual thread creation, and after per-NUMA-node first-level barriers are allocated.
+/// @param [in] region Parallel region.
 /// @param [in] globalThreadCount Number of threads being spawned globally.
-void spindleInitializeGlobalThreadBarrier(uint32_t globalThreadCount);
+void spindleInitializeGlobalThreadBarrier(SSpindleRegion* region, uint32_t globalThreadCount);
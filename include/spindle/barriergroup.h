@@ -0,0 +1,78 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file barriergroup.h
+ *   Interface to internal thread barrier algorithms other than the default centralized barrier.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "barrier.h"
+#include "types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Maximum number of threads that combine at each counter of a static combining tree barrier.
+#define kSpindleBarrierTreeFanIn                4
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Holds the state of a set of threads that synchronize with each other using a barrier algorithm other than the default centralized barrier.
+/// One such data structure exists per task that selects a non-default algorithm for its local barriers, plus one for the global barrier if applicable.
+/// The structure itself is read-only once initialized, except for the release flag, which is padded to occupy its own cache lines.
+typedef struct SSpindleBarrierGroup
+{
+    SSpindleBarrierData* episode;                                           ///< Per-participant count of barriers reached so far, each written only by its owner.
+    SSpindleBarrierData* flags;                                             ///< Per-participant per-round flags (dissemination and tournament) or per-tree-node counters (static tree).
+    uint32_t* treeNodeChildCount;                                           ///< Per-tree-node number of children, used to reset each counter (static tree only).
+    uint32_t* treeLevelBase;                                                ///< Per-tree-level index of the first tree node in that level (static tree only).
+    ESpindleBarrierAlgorithm algorithm;                                     ///< Barrier algorithm in use.
+    uint32_t participantCount;                                              ///< Number of threads participating in the barrier.
+    uint32_t roundCount;                                                    ///< Number of signalling rounds (dissemination and tournament) or number of tree levels (static tree).
+    uint32_t spinLimit;                                                     ///< Number of spin-wait iterations to perform before blocking, or 0 to spin without ever blocking, copied from the parallel region.
+    uint8_t padding[128 - (4 * sizeof(void*)) - (4 * sizeof(uint32_t))];    ///< Unused, cache-line alignment padding.
+    SSpindleBarrierData release;                                            ///< Flag on which threads spin while waiting to be released (tournament and static tree), holding the most recent episode released.
+} SSpindleBarrierGroup;
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Allocates and initializes barrier groups for all tasks, and for the global barrier, that select a non-default barrier algorithm.
+/// The barrier groups are placed in the local barrier group table and global barrier group of the specified parallel region.
+/// Intended to be called during the spawning process, after threads have been assigned to cores.
+/// @param [in] region Parallel region.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] threadAssignments Thread assignments, as an array.
+/// @param [in] threadCount Number of threads assigned.
+/// @return `true` on success, `false` on failure.
+bool spindleAllocateBarrierGroups(SSpindleRegion* region, SSpindleTaskConfig* taskSpec, uint32_t taskCount, SSpindleThreadInfo* threadAssignments, uint32_t threadCount);
+
+/// Implements a thread barrier using the algorithm selected for the specified barrier group.
+/// Invoked directly by the external barrier functions whenever a barrier group exists for the calling thread.
+/// @param [in] group Barrier group.
+/// @param [in] participantID Calling thread's index within the barrier group, which is its local or global thread ID.
+void spindleBarrierGroupWait(SSpindleBarrierGroup* group, uint32_t participantID);
+
+/// Frees all previously-allocated barrier groups of the specified parallel region.
+/// Intended to be called after all spawned threads have terminated.
+/// @param [in] region Parallel region.
+void spindleFreeBarrierGroups(SSpindleRegion* region);
+
+/// Initializes all previously-allocated barrier groups of the specified parallel region so that they are ready for a new set of threads.
+/// Intended to be called during the thread spawning process but before actual thread creation, after the parallel region's spin limit is set.
+/// @param [in] region Parallel region.
+void spindleInitializeBarrierGroups(SSpindleRegion* region);
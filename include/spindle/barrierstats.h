@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file barrierstats.h
+ *   Declaration of internal functions for recording barrier statistics.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "types.h"
+
+#include <stdint.h>
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Counter of arrivals at barriers with a single label, used to determine each thread's arrival position.
+/// Each counter occupies its own cache line, since all participating threads update it.
+typedef struct SSpindleBarrierStatsCounter
+{
+    uint64_t arrivals;                                                      ///< Number of threads that have arrived so far, across all barrier episodes.
+    uint8_t padding[64 - sizeof(uint64_t)];                                 ///< Unused, cache-line alignment padding.
+} SSpindleBarrierStatsCounter;
+
+/// Holds all barrier statistics recorded for a single parallel region.
+/// Labels are claimed on first use and indexed by scope, where scope 0 is local barriers and scope 1 is global barriers.
+typedef struct SSpindleBarrierStats
+{
+    TSpindleBarrierStatsFunc reportFunc;                                    ///< Function to receive reports at the end of the parallel region.
+    void* reportArg;                                                        ///< Argument to pass to the report function.
+    uint32_t threadCount;                                                   ///< Number of threads in the parallel region.
+    uint32_t taskCount;                                                     ///< Number of tasks in the parallel region.
+    const char* volatile labels[2][kSpindleBarrierStatsMaxLabelCount];      ///< Labels claimed so far, indexed by scope and label slot, with unclaimed slots holding `NULL`.
+    SSpindleBarrierStatsCounter* counters;                                  ///< Arrival counters, indexed by scope, then label slot, then task ID for local barriers or 0 for global barriers.
+    SSpindleBarrierThreadStats* threadStats;                                ///< Per-thread statistics, indexed by global thread ID, then scope, then label slot, so that each thread's records are contiguous.
+} SSpindleBarrierStats;
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Frees all barrier statistics held by the specified parallel region.
+/// Intended to be called after all spawned threads have terminated.
+/// @param [in] region Parallel region.
+void spindleFreeBarrierStats(SSpindleRegion* region);
+
+/// Prepares the specified parallel region to record barrier statistics according to the current configuration, allocating or freeing memory as needed and clearing any previously-recorded statistics.
+/// Intended to be called during the thread spawning process but before actual thread creation, after threads have been assigned to cores.
+/// If memory cannot be allocated, the parallel region runs without barrier statistics.
+/// @param [in] region Parallel region.
+void spindleInitializeBarrierStats(SSpindleRegion* region);
+
+/// Delivers a report for each label recorded by the specified parallel region to the configured report function.
+/// Intended to be called after all spawned threads have returned from their starting functions. Does nothing if barrier statistics are disabled for the parallel region.
+/// @param [in] region Parallel region.
+void spindleReportBarrierStats(SSpindleRegion* region);
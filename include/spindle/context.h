@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file context.h
+ *   Interface to internal per-thread context block functionality.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Default number of 64-bit slots in each thread's context block, used if a task specification does not specify a number.
+/// This many slots fill exactly one cache line.
+#define kSpindleContextDefaultSlotCount         8
+
+/// Alignment, in bytes, of each thread's context block, which is also the granularity at which blocks are sized.
+/// Blocks occupy whole pairs of cache lines, so that adjacent-line prefetching does not cause false sharing between threads.
+#define kSpindleContextBlockAlignment           128
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Allocates context blocks for all threads, in memory local to each task's NUMA node, sized according to each task's specification.
+/// Intended to be called during the spawning process, after threads have been assigned to cores.
+/// Does nothing if the specified parallel region already holds them.
+/// @param [in] region Parallel region.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] threadAssignments Thread assignments, as an array.
+/// @param [in] threadCount Number of threads assigned.
+/// @return `true` on success, `false` on failure.
+bool spindleAllocateContextBlocks(SSpindleRegion* region, SSpindleTaskConfig* taskSpec, uint32_t taskCount, SSpindleThreadInfo* threadAssignments, uint32_t threadCount);
+
+/// Frees all previously-allocated context blocks.
+/// Intended to be called after all spawned threads have terminated.
+void spindleFreeContextBlocks(SSpindleRegion* region);
+
+/// Sets all of the slots in the specified thread's context block to 0.
+/// Intended to be called by each thread as it starts, before running its starting function.
+/// The block itself is located on demand by way of the parallel region and global thread ID held in the register that holds thread information, so nothing is cached per OS thread.
+/// @param [in] region Parallel region to which the calling thread belongs.
+/// @param [in] globalThreadID Global thread ID of the calling thread.
+void spindleInitializeThreadContextBlock(SSpindleRegion* region, uint32_t globalThreadID);
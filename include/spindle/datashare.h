@@ -14,17 +14,37 @@
 
 #pragma once
 
+#include "barrier.h"
+#include "types.h"
+
+#include <stddef.h>
 #include <stdint.h>
 
 
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Represents the layout of storage space used to hold data to be shared between threads.
+/// A single 64-bit value, along with a description of the most recent bulk broadcast, is accompanied by padding, to align on a two-cache-line (128-byte) boundary.
+typedef struct SSpindleDataShareBuffer
+{
+    uint64_t data;                                                          ///< Shared data value.
+    const void* bulkData;                                                   ///< Sender's buffer for the current bulk broadcast.
+    size_t bulkSize;                                                        ///< Size, in bytes, of the sender's buffer for the current bulk broadcast.
+    SSpindleNodeBarrier* bulkSenderNode;                                    ///< First-level barrier of the NUMA node on which the sender of the current bulk broadcast runs.
+    uint8_t padding[128 - sizeof(uint64_t) - sizeof(void*) - sizeof(size_t) - sizeof(SSpindleNodeBarrier*)];    ///< Unused, cache-line alignment padding.
+} SSpindleDataShareBuffer;
+
+
 // -------- FUNCTIONS ------------------------------------------------------ //
 
-/// Allocates space for all data sharing buffers.
+/// Allocates space for all data sharing buffers of the specified parallel region.
 /// Intended to be called during the spawning process.
+/// @param [in] region Parallel region.
 /// @param [in] taskCount Number of tasks.
 /// @return Pointer to the start of the memory region on success, or `NULL` on failure.
-void* spindleAllocateDataShareBuffers(uint32_t taskCount);
+void* spindleAllocateDataShareBuffers(SSpindleRegion* region, uint32_t taskCount);
 
-/// Frees all previously-allocated space for data sharing buffers.
+/// Frees all previously-allocated space for data sharing buffers of the specified parallel region.
 /// Intended to be called after all spawned threads have terminated.
-void spindleFreeDataShareBuffers(void);
+/// @param [in] region Parallel region.
+void spindleFreeDataShareBuffers(SSpindleRegion* region);
@@ -33,6 +33,20 @@ void spindleSetThreadID(uint32_t localThreadID, uint32_t globalThreadID, uint32_
 /// @param [in] taskCount Number of tasks globally.
 void spindleSetThreadCounts(uint32_t localThreadCount, uint32_t globalThreadCount, uint32_t taskCount);
 
+/// Initializes the calling thread with the index of its parallel region's entry in the region table.
+/// Intended to be called internally before passing control to user-supplied code, after the thread counts are set, since the region index shares space with the task count.
+/// @param [in] regionIndex Index of the parallel region in the region table.
+void spindleSetThreadRegion(uint32_t regionIndex);
+
 /// Initializes the calling thread's per-thread local variable to 0.
 /// Intended to be called internally before passing control to user-supplied code.
 void spindleInitializeLocalVariable(void);
+
+/// Copies all of the calling thread's information, including its identifiers, counts, parallel region, and per-thread local variable, out of the register that holds it.
+/// Used to preserve a thread's information while it takes part in a nested parallel region.
+/// @param [out] buffer Receives the thread information, which occupies 32 bytes.
+void spindleSaveThreadInfo(uint64_t* buffer);
+
+/// Replaces all of the calling thread's information with information previously obtained using #spindleSaveThreadInfo.
+/// @param [in] buffer Thread information to restore, which occupies 32 bytes.
+void spindleRestoreThreadInfo(const uint64_t* buffer);
@@ -0,0 +1,58 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file loop.h
+ *   Interface to internal parallel loop scheduling functionality.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "types.h"
+
+#include <stdint.h>
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Represents the layout of storage space used to hand out chunks of one share of a parallel loop's iterations.
+/// A share is the portion of the iterations assigned to a set of threads located on the same NUMA node, and the structure is allocated in memory local to that node.
+/// The first cache line holds read-only information identifying the share, and the second holds the counter, which threads modify to claim chunks.
+typedef struct SSpindleLoopShare
+{
+    uint32_t threadBase;                                                    ///< Number of participating threads that precede this share's threads, used to locate the share within the iteration space.
+    uint32_t threadCount;                                                   ///< Number of participating threads located on this share's NUMA node.
+    uint32_t numaNode;                                                      ///< Zero-based index of the NUMA node on which this share's memory is allocated.
+    uint8_t padding1[64 - (3 * sizeof(uint32_t))];                          ///< Unused, cache-line alignment padding.
+    uint64_t next;                                                          ///< Offset, relative to the start of the share, of the first iteration not yet claimed.
+    uint8_t padding2[64 - sizeof(uint64_t)];                                ///< Unused, cache-line alignment padding.
+} SSpindleLoopShare;
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Allocates and initializes loop shares for each task and for each NUMA node spanned by the spawned threads.
+/// Intended to be called during the spawning process, after threads have been assigned to cores and after NUMA node barriers have been allocated.
+/// Does nothing if the specified parallel region already holds them.
+/// @param [in] region Parallel region.
+/// @param [in] threadAssignments Thread assignments, as an array.
+/// @param [in] threadCount Number of threads assigned.
+/// @param [in] taskCount Number of tasks.
+/// @return Pointer to the table of per-task loop shares on success, or `NULL` on failure.
+void* spindleAllocateLoopShares(SSpindleRegion* region, SSpindleThreadInfo* threadAssignments, uint32_t threadCount, uint32_t taskCount);
+
+/// Frees all previously-allocated loop shares of the specified parallel region.
+/// Intended to be called after all spawned threads have terminated.
+/// @param [in] region Parallel region.
+void spindleFreeLoopShares(SSpindleRegion* region);
+
+/// Resets all loop shares of the specified parallel region so that they are ready for a new set of threads.
+/// Intended to be called during the thread spawning process but before actual thread creation.
+/// @param [in] region Parallel region.
+void spindleInitializeLoopShares(SSpindleRegion* region);
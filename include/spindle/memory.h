@@ -0,0 +1,47 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file memory.h
+ *   Interface to internal NUMA-aware memory allocation functionality.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+
+#include <hwloc.h>
+#include <stddef.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Size, in bytes, of a large page.
+/// Allocations that request large pages are rounded up to a multiple of this size.
+#define kSpindleMemoryLargePageSize             (2ull * 1024ull * 1024ull)
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Allocates memory that is bound to the specified NUMA node, using the specified page size.
+/// This is a platform-specific operation.
+/// @param [in] topology `hwloc` system topology.
+/// @param [in] numaNodeObject `hwloc` object within the topology object that represents the NUMA node on which to place the memory.
+/// @param [in] size Number of bytes to allocate.
+/// @param [in] pageSize Page size to use.
+/// @return Pointer to the allocated memory on success, or `NULL` on failure.
+void* spindleAllocateOSMemory(hwloc_topology_t topology, hwloc_obj_t numaNodeObject, size_t size, ESpindlePageSize pageSize);
+
+/// Frees memory previously allocated using #spindleAllocateOSMemory.
+/// This is a platform-specific operation.
+/// @param [in] topology `hwloc` system topology.
+/// @param [in] ptr Pointer to the memory to free.
+/// @param [in] size Number of bytes originally requested.
+/// @param [in] pageSize Page size originally requested.
+void spindleFreeOSMemory(hwloc_topology_t topology, void* ptr, size_t size, ESpindlePageSize pageSize);
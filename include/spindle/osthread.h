@@ -34,7 +34,14 @@ void spindleAffinitizeCurrentOSThread(hwloc_topology_t topology, hwloc_obj_t aff
 /// @return OS-specific handle that identifies the newly-created thread.
 hwloc_thread_t spindleCreateOSThread(SSpindleThreadInfo* threadSpec);
 
+/// Creates a single OS thread that acts as a persistent thread pool worker.
+/// This is a platform-specific operation.
+/// @param [in] worker Pool worker control structure, passed to the worker's main loop.
+/// @return OS-specific handle that identifies the newly-created thread.
+hwloc_thread_t spindleCreatePoolOSThread(SSpindlePoolWorker* worker);
+
 /// Creates the threads specified by the thread specifications and thread count.
+/// Always creates new OS threads, regardless of whether the thread pool is enabled.
 /// Returns once all created threads have terminated or an error occurs.
 /// @param [in, out] threadSpec Array of thread assignment specifications. The threadHandle members are filled with thread identification information during this function.
 /// @param [in] threadCount Number of threads to create.
@@ -42,11 +49,35 @@ hwloc_thread_t spindleCreateOSThread(SSpindleThreadInfo* threadSpec);
 /// @return 0 once all threads terminate successfully, or nonzero in the event of an error.
 uint32_t spindleCreateThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCount, bool useCurrentThread);
 
+/// Initializes thread identification information and runs the thread routine on the calling thread, without affinitizing it.
+/// Encapsulates the portion of the thread-starting functionality that must be repeated each time a thread specification is run.
+/// @param [in] threadSpec Thread specification.
+void spindleExecuteThreadSpec(SSpindleThreadInfo* threadSpec);
+
+/// Reads the operating system's monotonic clock, which is unaffected by changes to the wall-clock time.
+/// This is a platform-specific operation.
+/// @return Current time, in nanoseconds, relative to an unspecified starting point.
+uint64_t spindleGetOSTimeNanoseconds(void);
+
+/// Creates the threads specified by the thread specifications and thread count, without waiting for them to terminate.
+/// Always creates new OS threads, regardless of whether the thread pool is enabled.
+/// If some thread cannot be created, those already created leave the parallel region without running their tasks and are joined, so the parallel region can be destroyed as soon as this function returns.
+/// @param [in, out] threadSpec Array of thread assignment specifications. The threadHandle members are filled with thread identification information during this function.
+/// @param [in] threadCount Number of threads to create.
+/// @return 0 once all threads are created successfully, or nonzero in the event of an error.
+uint32_t spindleLaunchThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCount);
+
 /// Retrieves the OS-specific handle that identifes the calling thread.
 /// This is a platform-specific operation.
 /// @return OS-specific handle identifying the calling thread.
 hwloc_thread_t spindleIdentifyCurrentOSThread(void);
 
+/// Joins the specified pool worker thread, returning only once it has terminated or an error occurs.
+/// This is a platform-specific operation.
+/// @param [in] worker Pool worker control structure. Only the threadHandle member is used.
+/// @return 0 once the worker terminates successfully, or nonzero in the event of an error.
+uint32_t spindleJoinPoolOSThread(SSpindlePoolWorker* worker);
+
 /// Joins the specified threads, returning only once they have all terminated or an error occurs.
 /// This is a platform-specific operation.
 /// @param [in] threadSpec Array of thread assignment specifications. Only the threadHandle member is used, and it must be filled for all elements.
@@ -63,3 +94,23 @@ void spindleRunThreadSpec(SSpindleThreadInfo* threadSpec);
 /// @param [in] threadSpec Thread specification.
 /// @return 0 once the user-supplied function returns.
 uint32_t spindleStartCurrentThread(SSpindleThreadInfo* threadSpec);
+
+/// Blocks the calling thread for as long as the 32-bit value at the specified address is equal to the expected value.
+/// May return spuriously, so callers should re-check the value and call again if needed.
+/// This is a platform-specific operation.
+/// @param [in] address Address of the value to monitor.
+/// @param [in] expectedValue Value that, while present at the address, causes the calling thread to remain blocked.
+void spindleWaitOnAddress(volatile uint32_t* address, uint32_t expectedValue);
+
+/// Blocks the calling thread for as long as the 32-bit value at the specified address is equal to the expected value, but no longer than the specified timeout.
+/// Unlike #spindleWaitOnAddress, does not return spuriously before the timeout elapses, so callers need only re-check the value.
+/// This is a platform-specific operation.
+/// @param [in] address Address of the value to monitor.
+/// @param [in] expectedValue Value that, while present at the address, causes the calling thread to remain blocked.
+/// @param [in] timeoutMilliseconds Maximum amount of time to remain blocked, in milliseconds.
+void spindleWaitOnAddressTimeout(volatile uint32_t* address, uint32_t expectedValue, uint32_t timeoutMilliseconds);
+
+/// Wakes all threads blocked in #spindleWaitOnAddress or #spindleWaitOnAddressTimeout on the specified address.
+/// This is a platform-specific operation.
+/// @param [in] address Address on which threads may be blocked.
+void spindleWakeAddress(volatile uint32_t* address);
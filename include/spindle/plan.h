@@ -0,0 +1,87 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file plan.h
+ *   Declaration of internal functions for assigning threads to cores.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "types.h"
+
+#include <hwloc.h>
+#include <stdint.h>
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Hardware topology loaded from a description rather than from the current system, used only for planning.
+/// Opaque to the external API, which refers to it using #TSpindleTopology.
+typedef struct SSpindleTopology
+{
+    hwloc_topology_t topology;                                              ///< Loaded topology object from `hwloc`.
+} SSpindleTopology;
+
+/// Describes why threads could not be assigned to cores.
+typedef struct SSpindlePlanError
+{
+    uint32_t taskID;                                                        ///< Index of the task specification that could not be satisfied, or #kSpindlePlanNoTask if the error does not concern any particular task.
+    const char* message;                                                    ///< Static description of the error.
+} SSpindlePlanError;
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Combines task specifications with their options, as passed to the external API, into complete task descriptions.
+/// Task options from callers built against an earlier version of the structure are accepted, and the fields they lack take their defaults.
+/// On success, allocates the array of complete task descriptions, which the caller must free.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskOptions Options for each task, as an array, or `NULL` to use the default options for every task.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [out] outTaskSpec Receives the complete task descriptions.
+/// @param [out] outError Filled with a description of the error on failure. May be `NULL`.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindlePlanResolveTaskSpecs(const SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, SSpindleTaskConfig** outTaskSpec, SSpindlePlanError* outError);
+
+/// Replaces each task specification that requests one task per NUMA node or one task per cache domain with the task specifications it represents, and orders the result by NUMA node as required by #spindlePlanThreadAssignments.
+/// Task specifications for the same NUMA node keep their relative order.
+/// If no task specification requests replication and all are already in order, nothing is allocated and the original task specifications are produced unchanged.
+/// Otherwise, the expanded task specifications and the mapping back to the originals must be released using #spindlePlanFreeExpandedTaskSpecs.
+/// @param [in] topology Topology object from `hwloc`, either that of the current system or one loaded for planning.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] allowedCpuset Set of logical cores to which assignment is restricted, or `NULL` to allow all logical cores. See #spindlePlanThreadAssignments.
+/// @param [out] outTaskSpec Receives the expanded task specifications, or the original ones.
+/// @param [out] outTaskSpecIndex Receives, for each expanded task specification, the index of the original from which it was created, or `NULL` if nothing was expanded.
+/// @param [out] outTaskCount Receives the number of expanded task specifications.
+/// @param [out] outError Filled with a description of the error on failure, identifying the original task specification. May be `NULL`.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindlePlanExpandTaskSpecs(hwloc_topology_t topology, SSpindleTaskConfig* taskSpec, uint32_t taskCount, hwloc_const_cpuset_t allowedCpuset, SSpindleTaskConfig** outTaskSpec, uint32_t** outTaskSpecIndex, uint32_t* outTaskCount, SSpindlePlanError* outError);
+
+/// Releases the memory allocated by #spindlePlanExpandTaskSpecs, if any.
+/// @param [in] taskSpec Original task specifications, as passed to #spindlePlanExpandTaskSpecs.
+/// @param [in] expandedTaskSpec Task specifications produced by #spindlePlanExpandTaskSpecs.
+/// @param [in] taskSpecIndex Mapping produced by #spindlePlanExpandTaskSpecs.
+void spindlePlanFreeExpandedTaskSpecs(SSpindleTaskConfig* taskSpec, SSpindleTaskConfig* expandedTaskSpec, uint32_t* taskSpecIndex);
+
+/// Computes the assignment of threads to cores for the specified task specifications.
+/// On success, allocates and fills an array of thread information structures, one per thread, which the caller must free.
+/// Only the fields that describe placement and identity are filled. Fields that refer to a parallel region or an OS thread are left for the caller.
+/// @param [in] topology Topology object from `hwloc`, either that of the current system or one loaded for planning.
+/// @param [in] taskSpec Task specifications, as an array, already expanded using #spindlePlanExpandTaskSpecs.
+/// @param [in] taskSpecIndex Mapping from each task specification to the original from which it was created, as produced by #spindlePlanExpandTaskSpecs, or `NULL` if each task has its own.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] allowedCpuset Set of logical cores to which assignment is restricted, consisting of whole physical cores on a single NUMA node, or `NULL` to allow all logical cores.
+/// @param [out] outThreadAssignments Receives the array of thread assignments.
+/// @param [out] outThreadCount Receives the total number of threads assigned.
+/// @param [out] outError Filled with a description of the error on failure, identifying the expanded task specification. May be `NULL`.
+/// @return 0 on success, or nonzero in the event of an error.
+uint32_t spindlePlanThreadAssignments(hwloc_topology_t topology, SSpindleTaskConfig* taskSpec, const uint32_t* taskSpecIndex, uint32_t taskCount, hwloc_const_cpuset_t allowedCpuset, SSpindleThreadInfo** outThreadAssignments, uint32_t* outThreadCount, SSpindlePlanError* outError);
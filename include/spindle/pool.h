@@ -0,0 +1,62 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file pool.h
+ *   Interface to internal persistent thread pool functionality.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "types.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Attempts to claim the thread pool for running a single parallel region.
+/// The thread pool serves one parallel region at a time, so a spawning thread that fails to claim it must create its own threads instead.
+/// @return `true` if the thread pool is enabled and was claimed, `false` otherwise.
+bool spindlePoolAcquire(void);
+
+/// Releases a previous claim on the thread pool so that another parallel region can use it.
+void spindlePoolRelease(void);
+
+/// Retains the specified parallel region, along with its thread assignment plan and all memory regions allocated for it, so that it can be reused by the next parallel region.
+/// Any previously-retained parallel region is destroyed. Intended to be called at the end of the spawning process, only while the thread pool is claimed.
+/// On failure, the parallel region is destroyed instead of being retained.
+/// @param [in] taskSpec Task specifications from which the plan was produced.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] region Parallel region, ownership of which passes to the thread pool.
+void spindlePoolRetainPlan(SSpindleTaskConfig* taskSpec, uint32_t taskCount, SSpindleRegion* region);
+
+/// Attempts to reuse the most recently retained parallel region for the specified task specifications.
+/// The retained parallel region is reused only if the task specifications would produce an identical assignment of threads to cores, in which case its starting functions and arguments are updated to match.
+/// Otherwise, the retained parallel region is destroyed. Intended to be called only while the thread pool is claimed.
+/// @param [in] taskSpec Task specifications.
+/// @param [in] taskCount Number of tasks specified.
+/// @return Reusable parallel region, or `NULL` if none is available.
+SSpindleRegion* spindlePoolReusePlan(SSpindleTaskConfig* taskSpec, uint32_t taskCount);
+
+/// Runs the threads specified by the thread specifications and thread count using persistent pool workers, creating more workers if needed.
+/// Intended to be called only while the thread pool is claimed.
+/// Returns once all threads have finished executing their thread specifications or an error occurs.
+/// @param [in, out] threadSpec Array of thread assignment specifications. The threadHandle members are filled with worker identification information during this function.
+/// @param [in] threadCount Number of threads to run.
+/// @param [in] useCurrentThread `true` to use calling thread as a worker, `false` otherwise.
+/// @return 0 once all threads finish successfully, or nonzero in the event of an error.
+uint32_t spindlePoolRunThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCount, bool useCurrentThread);
+
+/// Main loop for each persistent pool worker thread.
+/// Waits for thread specifications to be dispatched and runs them, returning only once the pool instructs the worker to terminate.
+/// @param [in] worker Pool worker control structure.
+void spindlePoolWorkerMain(SSpindlePoolWorker* worker);
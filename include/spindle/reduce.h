@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file reduce.h
+ *   Interface to internal reduction, scan, and gather functionality.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "types.h"
+
+#include <stdint.h>
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Represents the layout of storage space used to coordinate a single set of threads performing reductions, scans, and gathers.
+/// Structured like a barrier, with the counter and bookkeeping occupying the first cache line and the flag, which is accompanied by the result, occupying the second.
+typedef struct SSpindleReduceControl
+{
+    uint32_t counter;                                                       ///< Number of threads that have yet to contribute to the current reduction.
+    uint32_t threadCount;                                                   ///< Number of threads participating, used to reset the counter.
+    uint32_t slotBase;                                                      ///< Index of the first per-thread contribution slot belonging to this set of threads.
+    uint32_t spinLimit;                                                     ///< Number of spin-wait iterations to perform before blocking, or 0 to spin without ever blocking, copied from the parallel region.
+    uint8_t padding1[64 - (4 * sizeof(uint32_t))];                          ///< Unused, cache-line alignment padding.
+    uint32_t flag;                                                          ///< Flag on which threads wait for the current reduction to complete.
+    uint32_t flagSleepCount;                                                ///< Number of threads blocked waiting for the flag to change.
+    uint64_t result;                                                        ///< Result of the most recently completed reduction.
+    uint8_t padding2[64 - (2 * sizeof(uint32_t)) - sizeof(uint64_t)];       ///< Unused, cache-line alignment padding.
+} SSpindleReduceControl;
+
+/// Represents the layout of storage space used to hold a single thread's contribution to a reduction, scan, or gather, along with its scan results.
+/// Each slot is written by its owning thread on arrival and, for reductions and scans, by the last thread to arrive when combining.
+/// Gathered values are double-buffered by episode, because all threads read them after being released, by which time the owning thread may have moved on to the next collective.
+typedef struct SSpindleReduceSlot
+{
+    uint64_t value;                                                         ///< Value contributed by the owning thread.
+    uint64_t exclusiveScan;                                                 ///< Combination of the values contributed by all threads that precede the owning thread.
+    uint64_t inclusiveScan;                                                 ///< Combination of the values contributed by all threads up to and including the owning thread.
+    uint64_t gatherValue[2];                                                ///< Value contributed by the owning thread to a gather, indexed by the parity of the episode.
+    uint8_t padding[128 - (5 * sizeof(uint64_t))];                          ///< Unused, cache-line alignment padding.
+} SSpindleReduceSlot;
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Allocates and initializes space for all reduction, scan, and gather coordination regions and contribution slots.
+/// Intended to be called during the spawning process, after threads have been assigned to cores.
+/// Does nothing if the specified parallel region already holds them.
+/// @param [in] region Parallel region.
+/// @param [in] threadAssignments Thread assignments, as an array.
+/// @param [in] threadCount Number of threads assigned.
+/// @param [in] taskCount Number of tasks.
+/// @return Pointer to the start of the coordination memory region on success, or `NULL` on failure.
+void* spindleAllocateReduceBuffers(SSpindleRegion* region, SSpindleThreadInfo* threadAssignments, uint32_t threadCount, uint32_t taskCount);
+
+/// Provides a barrier among all threads in the current task, during which exactly one thread, the last to arrive, invokes the specified function before any thread is released.
+/// Useful for resetting state shared by the task's threads in preparation for the next collective operation, without needing a second barrier.
+/// @param [in] action Function to invoke.
+/// @param [in] arg Argument to pass to the function.
+void spindleCollectiveBarrierLocal(TSpindleFunc action, void* arg);
+
+/// Provides a barrier among all threads, during which exactly one thread, the last to arrive, invokes the specified function before any thread is released.
+/// Useful for resetting state shared by all threads in preparation for the next collective operation, without needing a second barrier.
+/// @param [in] action Function to invoke.
+/// @param [in] arg Argument to pass to the function.
+void spindleCollectiveBarrierGlobal(TSpindleFunc action, void* arg);
+
+/// Frees all previously-allocated space for reductions and scans held by the specified parallel region.
+/// Intended to be called after all spawned threads have terminated.
+/// @param [in] region Parallel region.
+void spindleFreeReduceBuffers(SSpindleRegion* region);
+
+/// Resets all reduction and scan coordination memory regions of the specified parallel region so that they are ready for a new set of threads.
+/// Intended to be called during the thread spawning process but before actual thread creation, after the parallel region's spin limit is set.
+/// @param [in] region Parallel region.
+void spindleInitializeReduceBuffers(SSpindleRegion* region);
@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file region.h
+ *   Interface to internal parallel region context functionality.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "arena.h"
+#include "barrier.h"
+#include "barriergroup.h"
+#include "barrierstats.h"
+#include "datashare.h"
+#include "loop.h"
+#include "reduce.h"
+#include "trace.h"
+#include "types.h"
+#include "work.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Maximum number of parallel regions that can exist at the same time, across all OS threads.
+/// Each parallel region occupies one entry in the region table while it exists, including a region retained by the thread pool for reuse.
+#define kSpindleRegionTableSize                 256
+
+/// Maximum number of tasks in a single parallel region.
+/// Each thread holds the task count and the index of its parallel region's entry in the region table together, in a single 32-bit field of its thread information.
+#define kSpindleRegionMaxTaskCount              65535
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Holds all state that belongs to a single parallel region, including its thread assignment plan, its thread barriers, and the memory regions used for data sharing and collective operations.
+/// One such data structure exists per parallel region, so parallel regions spawned by different OS threads proceed independently of one another.
+/// Threads find their parallel region by means of the region table, indexed using information held in the register that holds thread information.
+/// The first four pairs of cache lines, which hold the global barriers, and the pair of cache lines that follows, which holds bookkeeping for all barriers and the table of context blocks, are accessed directly by assembly code.
+/// Their layout must match the offsets defined in "region.inc", which is checked at compile time below.
+struct SSpindleRegion
+{
+    SSpindleBarrierData globalBarrierCounter;                               ///< Counter of threads, or NUMA nodes if hierarchical, that have yet to reach the global barrier.
+    SSpindleBarrierData globalBarrierFlag;                                  ///< Flag on which threads spin while waiting for the global barrier.
+    SSpindleBarrierData internalGlobalBarrierCounter;                       ///< Counter of threads that have yet to reach the internal global barrier.
+    SSpindleBarrierData internalGlobalBarrierFlag;                          ///< Flag on which threads spin while waiting for the internal global barrier.
+    SSpindleBarrierData* localBarrierBase;                                  ///< Base address for all local barrier counters and flags, two per task.
+    SSpindleBarrierGroup** localBarrierGroupTable;                          ///< Array of pointers to barrier groups, indexed by task ID, or `NULL` if no task selects a non-default algorithm. See "barriergroup.h".
+    SSpindleBarrierGroup* globalBarrierGroup;                               ///< Barrier group used for the global barrier, or `NULL` if the global barrier uses the default algorithm.
+    SSpindleNodeBarrier** nodeBarrierTable;                                 ///< Array of pointers to the first-level barriers, one per NUMA node spanned by the spawned threads.
+    SSpindleNodeBarrier** taskNodeBarrierTable;                             ///< Array of pointers to the first-level barriers, indexed by task ID.
+    SSpindleTraceBuffer** traceBufferTable;                                 ///< Array of pointers to per-thread trace buffers, indexed by global thread ID, or `NULL` if the parallel region is not being traced. See "trace.h".
+    uint64_t** contextThreadBlock;                                          ///< Array of pointers to each thread's context block, indexed by global thread ID. See "context.h".
+    uint32_t* contextThreadSlotCount;                                       ///< Array of the number of slots in each thread's context block, indexed by global thread ID.
+    uint32_t nodeBarrierCount;                                              ///< Number of NUMA nodes spanned by the spawned threads. If greater than 1, the global barrier operates hierarchically.
+    uint32_t barrierSpinLimit;                                              ///< Number of spin-wait iterations to perform at a barrier before blocking, or 0 to spin without ever blocking, captured when the region is spawned.
+    uint32_t index;                                                         ///< Index of this parallel region's entry in the region table.
+    uint8_t padding[128 - (8 * sizeof(void*)) - (3 * sizeof(uint32_t))];    ///< Unused, cache-line alignment padding.
+
+    SSpindleThreadInfo* threadAssignments;                                  ///< Thread assignment plan, one entry per thread.
+    uint32_t threadCount;                                                   ///< Number of threads in the thread assignment plan.
+    uint32_t taskCount;                                                     ///< Number of tasks.
+    volatile uint32_t completionFlag;                                       ///< Set to 1 once all threads have returned from their starting functions, so that an asynchronous spawner can detect completion.
+    volatile uint32_t completionWaiterIsSleeping;                           ///< Nonzero while a thread is blocked waiting for the parallel region to complete.
+    volatile uint32_t abortFlag;                                            ///< Set to 1 if some threads could not be created, so that those already waiting at the startup barrier leave without running their tasks.
+
+    SSpindleDataShareBuffer* dataShareBufferBase;                           ///< Storage area for all data sharing buffers, one per task plus one for global sharing. See "datashare.h".
+
+    uint32_t barrierGroupTaskCount;                                         ///< Number of entries in the local barrier group table.
+
+    SSpindleReduceControl* reduceControlBase;                               ///< Storage area for reduction coordination, one per task plus one for global operations. See "reduce.h".
+    SSpindleReduceSlot* reduceSlotBase;                                     ///< Storage area for per-thread contribution slots, for local operations followed by global operations.
+    uint32_t reduceControlCount;                                            ///< Number of reduction coordination regions.
+
+    SSpindleLoopShare** loopTaskShareTable;                                 ///< Array of pointers to loop shares, indexed by task ID, used for local parallel loops. See "loop.h".
+    SSpindleLoopShare** loopNodeShareTable;                                 ///< Array of pointers to loop shares, parallel to the table of first-level barriers, used for global parallel loops.
+    uint32_t* loopTaskNodeIndex;                                            ///< Array of indices into the table of per-node loop shares, indexed by task ID.
+    uint32_t loopTaskCount;                                                 ///< Number of tasks for which loop shares exist.
+    uint32_t loopNodeCount;                                                 ///< Number of NUMA nodes for which loop shares exist.
+
+    SSpindleWorkDeque** workDequeTable;                                     ///< Array of pointers to per-thread work-stealing state, indexed by global thread ID. See "work.h".
+    SSpindleBarrierData* workDoneBase;                                      ///< Storage area for flags that indicate completion of the root work item of a run, one per task plus one for global runs.
+    uint32_t workThreadCount;                                               ///< Number of threads for which work-stealing state exists.
+    uint32_t workTaskCount;                                                 ///< Number of tasks for which work-stealing state exists.
+
+    SSpindleArena** arenaTable;                                             ///< Array of pointers to per-thread arenas, indexed by global thread ID. See "arena.h".
+    uint32_t arenaCount;                                                    ///< Number of threads for which arenas exist.
+
+    void** contextTaskMemory;                                               ///< Array of pointers to the memory holding each task's context blocks, indexed by task ID. See "context.h".
+    size_t* contextTaskMemorySize;                                          ///< Array of sizes, in bytes, of the memory holding each task's context blocks.
+    uint32_t contextTaskCount;                                              ///< Number of tasks for which context blocks exist.
+
+    SSpindleBarrierStats* barrierStats;                                     ///< Barrier statistics recorded by labeled barriers, or `NULL` if barrier statistics are disabled. See "barrierstats.h".
+
+    uint32_t traceBufferCount;                                              ///< Number of threads for which trace buffers exist.
+    uint32_t traceEventCapacity;                                            ///< Number of events each trace buffer can hold.
+};
+
+// Offsets used by assembly code, which must match those defined in "region.inc".
+_Static_assert(offsetof(SSpindleRegion, globalBarrierCounter) == 0, "Update kSpindleRegionGlobalBarrierCounter in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, globalBarrierFlag) == 128, "Update kSpindleRegionGlobalBarrierFlag in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, internalGlobalBarrierCounter) == 256, "Update kSpindleRegionInternalGlobalBarrierCounter in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, internalGlobalBarrierFlag) == 384, "Update kSpindleRegionInternalGlobalBarrierFlag in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, localBarrierBase) == 512, "Update kSpindleRegionLocalBarrierBase in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, localBarrierGroupTable) == 520, "Update kSpindleRegionLocalBarrierGroupTable in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, globalBarrierGroup) == 528, "Update kSpindleRegionGlobalBarrierGroup in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, nodeBarrierTable) == 536, "Update kSpindleRegionNodeBarrierTable in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, taskNodeBarrierTable) == 544, "Update kSpindleRegionTaskNodeBarrierTable in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, traceBufferTable) == 552, "Update kSpindleRegionTraceBufferTable in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, contextThreadBlock) == 560, "Update kSpindleRegionContextThreadBlock in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, contextThreadSlotCount) == 568, "Update kSpindleRegionContextThreadSlotCount in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, nodeBarrierCount) == 576, "Update kSpindleRegionNodeBarrierCount in region.inc.");
+_Static_assert(offsetof(SSpindleRegion, barrierSpinLimit) == 580, "Update kSpindleRegionBarrierSpinLimit in region.inc.");
+
+
+// -------- GLOBALS -------------------------------------------------------- //
+
+/// Array of pointers to all parallel regions that currently exist, indexed by region index.
+/// Unused entries are `NULL`.
+extern SSpindleRegion* spindleRegionTable[kSpindleRegionTableSize];
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Allocates a new, empty parallel region and claims an entry for it in the region table.
+/// Safe to call concurrently from multiple OS threads.
+/// @return Pointer to the new parallel region, or `NULL` if memory could not be allocated or the region table is full.
+SSpindleRegion* spindleCreateRegion(void);
+
+/// Frees a parallel region, along with its thread assignment plan and all memory regions allocated for it, and releases its entry in the region table.
+/// Intended to be called after all threads in the parallel region have terminated, or to clean up after a failure during the spawning process.
+/// @param [in] region Parallel region to destroy.
+void spindleDestroyRegion(SSpindleRegion* region);
+
+/// Retrieves the parallel region to which the calling thread belongs.
+/// Implemented in assembly, using the region index held in the register that holds thread information.
+/// Only valid when called from a thread spawned by Spindle.
+/// @return Pointer to the calling thread's parallel region.
+SSpindleRegion* spindleGetCurrentRegion(void);
+
+/// Reports that all threads in the parallel region have returned from their starting functions, waking any thread blocked waiting for completion.
+/// Intended to be called by exactly one thread of the parallel region, after the final internal barrier.
+/// @param [in] region Parallel region that has completed.
+void spindleSignalRegionCompletion(SSpindleRegion* region);
+
+/// Waits for the threads in the parallel region to return from their starting functions, blocking for no longer than the specified timeout.
+/// @param [in] region Parallel region for which to wait.
+/// @param [in] timeoutMilliseconds Maximum amount of time to block, in milliseconds, or 0 to check without blocking.
+/// @return `true` if the parallel region has completed, `false` if the timeout elapsed first.
+bool spindleWaitForRegionCompletion(SSpindleRegion* region, uint32_t timeoutMilliseconds);
+
+/// Specifies whether the calling OS thread is executing within a Spindle parallel region, either as one of its threads or as the thread that spawned it and is waiting for it to finish.
+/// @param [in] value `true` upon entering a parallel region, `false` upon leaving it.
+void spindleSetInParallelRegion(bool value);
@@ -0,0 +1,26 @@
+/*****************************************************************************
+* Spindle
+*   Multi-platform topology-aware thread control library.
+*   Distributes a set of synchronized tasks over cores in the system.
+*****************************************************************************
+* Authored by Samuel Grossman
+* Department of Electrical Engineering, Stanford University
+* Copyright (c) 2016-2017
+*************************************************************************//**
+* @file threadlocal.h
+*   Platform-specific thread-local storage macros.
+*   Not intended for external use.
+*****************************************************************************/
+
+#pragma once
+
+
+// -------- PLATFORM-SPECIFIC MACROS --------------------------------------- //
+
+/// Declares a variable that has a separate instance for each OS thread.
+/// Implementation is platform-specific.
+#ifdef SPINDLE_WINDOWS
+#define spindle_thread_local                    __declspec(thread)
+#else
+#define spindle_thread_local                    _Thread_local
+#endif
@@ -0,0 +1,39 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file timestamp.h
+ *   Declaration of internal functions for calibrating the timestamp counter.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Length of time, in nanoseconds, over which the timestamp counter is compared with the operating system's clock if the processor does not report its frequency.
+#define kSpindleTimestampCalibrationNanoseconds 10000000ull
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Calibrates the timestamp counter, if it has not already been calibrated.
+/// Checks whether the counter is invariant and whether the processor supports the `rdtscp` instruction, and determines the counter's frequency, either as reported by the processor or by measuring it against the operating system's clock.
+/// Invoked during the spawning process and by any function that needs the calibration. Measuring the frequency takes about #kSpindleTimestampCalibrationNanoseconds, but only happens once.
+/// Safe to call from multiple threads at the same time: exactly one calibrates, and the others wait until the results are available.
+void spindleInitializeTimestampCounter(void);
+
+/// Executes the `cpuid` instruction.
+/// Implemented in assembly.
+/// @param [in] leaf Leaf to query, placed in `eax`.
+/// @param [in] subleaf Subleaf to query, placed in `ecx`.
+/// @param [out] registers Filled with the resulting values of `eax`, `ebx`, `ecx`, and `edx`, in that order.
+void spindleTimestampQueryCPUID(uint32_t leaf, uint32_t subleaf, uint32_t* registers);
@@ -0,0 +1,126 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file trace.h
+ *   Declaration of internal functions and macros for event tracing.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "threadlocal.h"
+#include "types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Default number of events each thread's trace buffer can hold before the oldest events are overwritten.
+#define kSpindleTraceDefaultEventCapacity       65536
+
+/// Phase of an event that begins a span, using the same character as the Chrome trace event format.
+#define kSpindleTracePhaseBegin                 'B'
+
+/// Phase of an event that ends the most recently begun span on the same thread.
+#define kSpindleTracePhaseEnd                   'E'
+
+/// Phase of an event that marks a single point in time.
+#define kSpindleTracePhaseInstant               'i'
+
+/// Category of events recorded internally by Spindle.
+#define kSpindleTraceCategorySpindle            0
+
+/// Category of events recorded by the application.
+#define kSpindleTraceCategoryUser               1
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// A single recorded event.
+typedef struct SSpindleTraceEvent
+{
+    uint64_t timestamp;                                                     ///< Time at which the event occurred, captured using the `rdtsc` instruction.
+    const char* name;                                                       ///< Name of the event, or `NULL` for events that end a span.
+    uint32_t phase;                                                         ///< Phase of the event, one of the `kSpindleTracePhase` constants.
+    uint32_t category;                                                      ///< Category of the event, one of the `kSpindleTraceCategory` constants.
+} SSpindleTraceEvent;
+
+/// Ring buffer of events recorded by a single thread.
+/// Only the owning thread writes to it, and it is only read once the owning thread has left the parallel region, so no synchronization is needed.
+/// Each buffer is allocated on the owning thread's NUMA node, with the events immediately following this header.
+typedef struct SSpindleTraceBuffer
+{
+    uint64_t writeCount;                                                    ///< Number of events recorded so far. Only the most recent events, up to the capacity, are retained.
+    uint64_t capacityMask;                                                  ///< One less than the number of events the buffer can hold, which is a power of two.
+    size_t allocatedSize;                                                   ///< Number of bytes allocated for the buffer, including this header.
+    uint8_t padding[64 - (2 * sizeof(uint64_t)) - sizeof(size_t)];          ///< Unused, cache-line alignment padding.
+    SSpindleTraceEvent events[];                                            ///< Recorded events, indexed by write count modulo capacity.
+} SSpindleTraceBuffer;
+
+
+// -------- GLOBALS -------------------------------------------------------- //
+
+/// Trace buffer of the calling thread, or `NULL` if the calling thread is not in a parallel region that is being traced.
+/// Checking this pointer is the only cost of a trace point while tracing is disabled.
+extern spindle_thread_local SSpindleTraceBuffer* spindleTraceThreadBuffer;
+
+
+// -------- MACROS --------------------------------------------------------- //
+
+/// Records an internal event of the specified phase and name on the calling thread, if the calling thread is being traced.
+/// Expands to nothing if tracing support is not compiled in.
+#ifdef SPINDLE_ENABLE_TRACING
+#define spindleTraceRecord(phase, name)         do { if (NULL != spindleTraceThreadBuffer) spindleTraceRecordEvent(spindleTraceThreadBuffer, (phase), kSpindleTraceCategorySpindle, (name)); } while (0)
+#else
+#define spindleTraceRecord(phase, name)         do { } while (0)
+#endif
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Frees all trace buffers held by the specified parallel region.
+/// Intended to be called after all spawned threads have terminated.
+/// @param [in] region Parallel region.
+void spindleFreeTraceBuffers(SSpindleRegion* region);
+
+/// Prepares the specified parallel region to record events according to the current configuration, allocating or freeing trace buffers as needed and discarding any previously-recorded events.
+/// Intended to be called during the thread spawning process but before actual thread creation, after threads have been assigned to cores.
+/// If memory cannot be allocated, the parallel region runs without tracing.
+/// @param [in] region Parallel region.
+void spindleInitializeTraceBuffers(SSpindleRegion* region);
+
+/// Selects the calling thread's trace buffer within its parallel region, so that subsequent trace points record into it.
+/// Must be called with `NULL` when the calling thread leaves the parallel region. Does nothing if tracing support is not compiled in.
+/// @param [in] region Parallel region to which the calling thread belongs, or `NULL` to stop recording events on the calling thread.
+/// @param [in] globalThreadID Calling thread's global thread ID within the parallel region.
+void spindleSelectThreadTraceBuffer(SSpindleRegion* region, uint32_t globalThreadID);
+
+/// Appends an event to the specified trace buffer, overwriting the oldest event if the buffer is full.
+/// Trace points should use #spindleTraceRecord instead of calling this function directly.
+/// @param [in] buffer Trace buffer, which must belong to the calling thread.
+/// @param [in] phase Phase of the event, one of the `kSpindleTracePhase` constants.
+/// @param [in] category Category of the event, one of the `kSpindleTraceCategory` constants.
+/// @param [in] name Name of the event, which must remain valid until the end of the parallel region.
+void spindleTraceRecordEvent(SSpindleTraceBuffer* buffer, uint32_t phase, uint32_t category, const char* name);
+
+/// Appends all events recorded by the specified parallel region to the trace file, along with metadata that names each thread's track by task, NUMA node, and core.
+/// Intended to be called after all spawned threads have left the parallel region. Does nothing if tracing is disabled for the parallel region.
+/// @param [in] region Parallel region.
+void spindleWriteTrace(SSpindleRegion* region);
+
+/// Wraps the local barrier with a pair of events that record the time spent in it.
+/// Invoked directly by #spindleBarrierLocal if the calling thread's parallel region is being traced.
+void spindleTraceBarrierLocal(void);
+
+/// Wraps the global barrier with a pair of events that record the time spent in it.
+/// Invoked directly by #spindleBarrierGlobal if the calling thread's parallel region is being traced.
+void spindleTraceBarrierGlobal(void);
@@ -22,6 +22,32 @@
 
 // -------- TYPE DEFINITIONS ----------------------------------------------- //
 
+/// Internal data structure that holds all state belonging to a single parallel region.
+/// Defined in "region.h".
+typedef struct SSpindleRegion SSpindleRegion;
+
+/// Internal data structure that fully describes a task, combining its task specification with its options.
+/// Created from the arrays passed to the external API by #spindlePlanResolveTaskSpecs, so that internal code can refer to every field of a task in one place.
+/// See #SSpindleTaskSpec and #SSpindleTaskOptions for the meaning of each field.
+typedef struct SSpindleTaskConfig
+{
+    TSpindleFunc func;                                                      ///< Starting function to call for each thread.
+    void* arg;                                                              ///< Argument to pass to the starting function.
+    uint32_t numaNode;                                                      ///< Zero-based index of the NUMA node on which to create the threads, or #kSpindleTaskSpecAllNUMANodes.
+    uint32_t numThreads;                                                    ///< Number of threads to create, or one of the special values described for #SSpindleTaskSpec.
+    ESpindleSMTPolicy smtPolicy;                                            ///< Policy for distributing threads among cores that may each have multiple hardware threads.
+    ESpindleBarrierAlgorithm barrierAlgorithm;                              ///< Algorithm to use for this task's local barriers, and for global barriers if this is the first task.
+    size_t arenaSize;                                                       ///< Number of bytes available in the arena of each thread in this task, or 0 for the default.
+    uint32_t contextSlotCount;                                              ///< Number of 64-bit slots in the context block of each thread in this task, or 0 for the default.
+    uint32_t reservedCoreCount;                                             ///< Number of additional physical cores to set aside for nested parallel regions.
+    ESpindleCachePolicy cachePolicy;                                        ///< Policy for aligning the task to cache domains.
+    ESpindlePlacementPolicy placementPolicy;                                ///< Policy for packing or spreading the task's threads over its physical cores.
+    uint64_t numaNodeMask;                                                  ///< NUMA nodes on which to create tasks if the NUMA node is #kSpindleTaskSpecAllNUMANodes, or 0 for all of them.
+    ESpindleCoreKindPolicy coreKindPolicy;                                  ///< Kinds of physical cores on which the task's threads run.
+    ESpindleBarrierWaitPolicy barrierWaitPolicy;                            ///< How threads wait at thread barriers, if this is the first task.
+    uint32_t barrierSpinIterations;                                         ///< Number of spin-wait iterations before blocking, if this is the first task, or 0 for the default.
+} SSpindleTaskConfig;
+
 /// Internal data structure, used to provide each spawned thread with control and identification information.
 /// One such data structure exists per thread created during the spawning process.
 /// Each instance uniquely identifies and supplies sufficient information for each thread.
@@ -37,9 +63,30 @@ typedef struct SSpindleThreadInfo
     uint32_t localThreadID;                                                 ///< Local thread ID.
     uint32_t globalThreadID;                                                ///< Global thread ID.
     uint32_t taskID;                                                        ///< Task ID.
+    uint32_t numaNode;                                                      ///< Zero-based index of the NUMA node on which the present thread runs.
     uint32_t localThreadCount;                                              ///< Number of threads in the current task.
     uint32_t globalThreadCount;                                             ///< Total number of threads spawned.
     uint32_t taskCount;                                                     ///< Total number of tasks created.
+    uint32_t reservedStartPhysCore;                                         ///< Logical index of the first physical core reserved by the current task for nested parallel regions, valid only if any are reserved.
+    uint32_t reservedCoreCount;                                             ///< Number of physical cores, contiguous by logical index, reserved by the current task for nested parallel regions.
+    uint32_t taskSpecIndex;                                                 ///< Index of the task specification from which the current task was created, which differs from the task ID if any specification requests one task per cache domain.
+    uint32_t cacheDomain;                                                   ///< Logical index of the level 3 cache shared by the present thread's logical core, or #kSpindleCacheDomainUnknown.
+    ESpindleCoreKind coreKind;                                              ///< Kind of physical core on which the present thread runs.
+
+    SSpindleRegion* region;                                                 ///< Parallel region to which the present thread belongs.
 
     hwloc_thread_t threadHandle;                                            ///< Thread handle, used to identify and wait for threads once they are created.
 } SSpindleThreadInfo;
+
+/// Internal data structure, used to control a persistent worker thread that belongs to the thread pool.
+/// One such data structure exists per pool worker, each allocated separately and padded so that workers do not share cache lines.
+/// The controlling thread dispatches a region to a worker by filling in the thread specification and then incrementing the dispatch counter.
+typedef struct SSpindlePoolWorker
+{
+    volatile uint32_t dispatchCount;                                        ///< Number of times work has been dispatched to this worker. Workers wait for this to change.
+    volatile uint32_t isSleeping;                                           ///< Nonzero if the worker is, or is about to be, blocked in the operating system waiting for work.
+    SSpindleThreadInfo* volatile threadSpec;                                ///< Thread specification to execute next, or `NULL` to instruct the worker to terminate.
+    hwloc_obj_t affinityObject;                                             ///< Object from `hwloc` that identifies the PU to which the worker is currently affinitized, if any.
+    hwloc_thread_t threadHandle;                                            ///< Thread handle, used to wait for the worker to terminate when the pool is destroyed.
+    uint8_t padding[128 - (2 * sizeof(uint32_t)) - (2 * sizeof(void*)) - sizeof(hwloc_thread_t)];  ///< Unused, cache-line alignment padding.
+} SSpindlePoolWorker;
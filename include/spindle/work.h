@@ -0,0 +1,90 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file work.h
+ *   Interface to internal work-stealing scheduler functionality.
+ *   Not intended for external use.
+ *****************************************************************************/
+
+#pragma once
+
+#include "../spindle.h"
+#include "types.h"
+
+#include <stdint.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Maximum number of work items that can be queued in a single thread's deque.
+/// A thread that spawns a work item while its deque is full executes the item immediately instead.
+#define kSpindleWorkDequeCapacity               1024
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Represents the completion state of a running work item, or of the root of a work-stealing run.
+/// Lives on the stack of the thread executing the work item, and is referenced by every child work item it spawns.
+typedef struct SSpindleWorkFrame
+{
+    uint64_t pending;                                                       ///< Number of spawned child work items that have yet to complete.
+} SSpindleWorkFrame;
+
+/// Represents a work item that has been spawned but not yet executed.
+typedef struct SSpindleWorkItem
+{
+    TSpindleFunc func;                                                      ///< Function to call.
+    void* arg;                                                              ///< Argument to pass to the function.
+    SSpindleWorkFrame* parent;                                              ///< Frame of the work item that spawned this one, to be notified on completion.
+} SSpindleWorkItem;
+
+/// Represents the layout of storage space used to hold a single thread's work-stealing state, including its deque of spawned work items.
+/// The deque follows the Chase-Lev design: the owning thread pushes and pops at the bottom without atomic read-modify-write operations in the common case, and thieves take from the top.
+/// Each instance is allocated by the owning thread, the first time it uses the work-stealing scheduler, in memory local to its NUMA node.
+/// The top index, which thieves modify, occupies its own cache line, and the bottom index and owner bookkeeping occupy the next.
+/// The owning thread's victim lists immediately follow the work items, local list first.
+typedef struct SSpindleWorkDeque
+{
+    uint64_t top;                                                           ///< Index of the oldest work item in the deque, incremented by any thread that takes it.
+    uint8_t padding1[64 - sizeof(uint64_t)];                                ///< Unused, cache-line alignment padding.
+    uint64_t bottom;                                                        ///< Index one past the newest work item in the deque, modified only by the owning thread.
+    SSpindleWorkFrame* currentFrame;                                        ///< Frame of the work item the owning thread is currently executing, or `NULL` if none.
+    struct SSpindleWorkDeque** dequeTable;                                  ///< Table of the work-stealing state of all threads in the parallel region, indexed by global thread ID, used to locate steal victims.
+    uint32_t* victims;                                                      ///< Global thread IDs of the threads from which to steal during the current run, which is either the local or the global victim list.
+    uint32_t* localVictims;                                                 ///< Global thread IDs of the other threads in the owning thread's task, in order of preference.
+    uint32_t* globalVictims;                                                ///< Global thread IDs of all other threads, in order of preference.
+    uint32_t victimCount;                                                   ///< Number of threads from which to steal during the current run.
+    uint32_t localVictimCount;                                              ///< Number of entries in the local victim list.
+    uint32_t globalVictimCount;                                             ///< Number of entries in the global victim list.
+    uint8_t padding2[64 - sizeof(uint64_t) - (5 * sizeof(void*)) - (3 * sizeof(uint32_t))];  ///< Unused, cache-line alignment padding.
+    SSpindleWorkItem items[kSpindleWorkDequeCapacity];                      ///< Circular buffer of work items, indexed by the top and bottom indices modulo the capacity.
+} SSpindleWorkDeque;
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+
+/// Allocates and initializes the table of per-thread work-stealing state and the completion flags of work-stealing runs.
+/// The work-stealing state itself, including each thread's order of preference for steal victims, is allocated by each thread the first time it uses the work-stealing scheduler.
+/// Intended to be called during the spawning process, after threads have been assigned to cores.
+/// Does nothing if the specified parallel region already holds them.
+/// @param [in] region Parallel region.
+/// @param [in] threadCount Number of threads assigned.
+/// @param [in] taskCount Number of tasks.
+/// @return Pointer to the table of per-thread work-stealing state on success, or `NULL` on failure.
+void* spindleAllocateWorkDeques(SSpindleRegion* region, uint32_t threadCount, uint32_t taskCount);
+
+/// Frees all previously-allocated work-stealing state of the specified parallel region.
+/// Intended to be called after all spawned threads have terminated.
+/// @param [in] region Parallel region.
+void spindleFreeWorkDeques(SSpindleRegion* region);
+
+/// Resets all work-stealing state of the specified parallel region so that it is ready for a new set of threads.
+/// Intended to be called during the thread spawning process but before actual thread creation.
+/// @param [in] region Parallel region.
+void spindleInitializeWorkDeques(SSpindleRegion* region);
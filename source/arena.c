@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file arena.c
+ *   Implementation of per-thread arena allocators.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "arena.h"
+#include "memory.h"
+#include "region.h"
+#include "types.h"
+
+#include <hwloc.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <topo.h>
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Retrieves the arena that belongs to the calling thread.
+/// @return Pointer to the calling thread's arena.
+static inline SSpindleArena* spindleHelperArenaGetCurrent(void)
+{
+    return spindleGetCurrentRegion()->arenaTable[spindleGetGlobalThreadID()];
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "arena.h" for documentation.
+
+bool spindleAllocateArenas(SSpindleRegion* region, SSpindleTaskConfig* taskSpec, SSpindleThreadInfo* threadAssignments, uint32_t threadCount)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+    if (NULL != region->arenaTable)
+        return true;
+
+    if (NULL == topology)
+        return false;
+
+    region->arenaTable = (SSpindleArena**)malloc(sizeof(SSpindleArena*) * threadCount);
+    if (NULL == region->arenaTable)
+        return false;
+
+    memset((void*)region->arenaTable, 0, sizeof(SSpindleArena*) * threadCount);
+    region->arenaCount = threadCount;
+
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        const size_t capacity = (0 == taskSpec[threadAssignments[threadIndex].taskID].arenaSize) ? kSpindleArenaDefaultSize : taskSpec[threadAssignments[threadIndex].taskID].arenaSize;
+        hwloc_obj_t numaNodeObject = topoGetNUMANodeObjectAtIndex(threadAssignments[threadIndex].numaNode);
+        SSpindleArena* arena = NULL;
+
+        if (NULL == numaNodeObject)
+        {
+            spindleFreeArenas(region);
+            return false;
+        }
+
+        // Binding places the memory on the owning thread's NUMA node regardless of which thread touches it first.
+        arena = (SSpindleArena*)spindleAllocateOSMemory(topology, numaNodeObject, sizeof(SSpindleArena) + capacity, SpindlePageSizeDefault);
+        if (NULL == arena)
+        {
+            spindleFreeArenas(region);
+            return false;
+        }
+
+        arena->capacity = capacity;
+        arena->offset = 0;
+        arena->allocatedSize = sizeof(SSpindleArena) + capacity;
+
+        region->arenaTable[threadAssignments[threadIndex].globalThreadID] = arena;
+    }
+
+    return true;
+}
+
+// --------
+
+void spindleFreeArenas(SSpindleRegion* region)
+{
+    if (NULL != region->arenaTable)
+    {
+        hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+        for (uint32_t threadIndex = 0; threadIndex < region->arenaCount; ++threadIndex)
+        {
+            if (NULL != region->arenaTable[threadIndex])
+                spindleFreeOSMemory(topology, (void*)region->arenaTable[threadIndex], region->arenaTable[threadIndex]->allocatedSize, SpindlePageSizeDefault);
+        }
+
+        free((void*)region->arenaTable);
+
+        region->arenaTable = NULL;
+        region->arenaCount = 0;
+    }
+}
+
+// --------
+
+void spindleInitializeThreadArena(SSpindleRegion* region, uint32_t globalThreadID)
+{
+    region->arenaTable[globalThreadID]->offset = 0;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+void* spindleArenaAllocate(size_t size, size_t alignment)
+{
+    SSpindleArena* const arena = spindleHelperArenaGetCurrent();
+    uint8_t* const base = (uint8_t*)arena + sizeof(SSpindleArena);
+    uintptr_t start;
+
+    if (0 == alignment)
+        alignment = kSpindleArenaDefaultAlignment;
+
+    // Aligning the address itself, rather than the offset, supports any power-of-two alignment.
+    start = ((uintptr_t)(base + arena->offset) + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+
+    if ((size > arena->capacity) || ((start - (uintptr_t)base) > (arena->capacity - size)))
+        return NULL;
+
+    arena->offset = (size_t)(start - (uintptr_t)base) + size;
+    return (void*)start;
+}
+
+// --------
+
+void spindleArenaBarrierLocal(void)
+{
+    spindleBarrierLocal();
+    spindleHelperArenaGetCurrent()->offset = 0;
+}
+
+// --------
+
+void spindleArenaBarrierGlobal(void)
+{
+    spindleBarrierGlobal();
+    spindleHelperArenaGetCurrent()->offset = 0;
+}
+
+// --------
+
+size_t spindleArenaGetMark(void)
+{
+    return spindleHelperArenaGetCurrent()->offset;
+}
+
+// --------
+
+void spindleArenaReleaseToMark(size_t mark)
+{
+    SSpindleArena* const arena = spindleHelperArenaGetCurrent();
+
+    if (mark < arena->offset)
+        arena->offset = mark;
+}
@@ -12,57 +12,30 @@
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 
 INCLUDE helpers.inc
+INCLUDE region.inc
 INCLUDE registers.inc
 
 
+EXTRN spindleRegionTable:QWORD
+EXTRN spindleBarrierGroupWait:PROC
+EXTRN spindleBarrierWaitFlag:PROC
+EXTRN spindleBarrierWakeFlag:PROC
+EXTRN spindleBarrierWakeNodeFlags:PROC
+EXTRN spindleTraceBarrierGlobal:PROC
+EXTRN spindleTraceBarrierLocal:PROC
+
+
 DATA                                        SEGMENT ALIGN(64)
 
 
 ; --------- GLOBALS -----------------------------------------------------------
 ; See "barrier.h" for documentation.
 
-PUBLIC spindleGlobalBarrierCounter
-spindleGlobalBarrierCounter                 DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-
-PUBLIC spindleGlobalBarrierFlag
-spindleGlobalBarrierFlag                    DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-
-PUBLIC spindleInternalGlobalBarrierCounter
-spindleInternalGlobalBarrierCounter         DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-
-PUBLIC spindleInternalGlobalBarrierFlag
-spindleInternalGlobalBarrierFlag            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-                                            DQ          0000000000000000h
-
-PUBLIC spindleLocalBarrierBase
-spindleLocalBarrierBase                     DQ          0000000000000000h
+PUBLIC spindleBarrierUseWaitPkg
+spindleBarrierUseWaitPkg                    DD          00000000h
+
+PUBLIC spindleBarrierUseRdtscp
+spindleBarrierUseRdtscp                     DD          00000000h
 
 
 DATA                                        ENDS
@@ -75,10 +48,11 @@ _TEXT                                       SEGMENT
 
 ; Implements a thread barrier.
 ; Invoked by the various routines that expose thread barriers to the library user.
-; Register parameters: ecx (number of threads for which to wait), r8 (memory address of barrier counter), r9 (memory address of barrier flag)
-; Macro parameters: label to use for the internal loop, label to use for completion
-; Internally uses and overwrites eax and edx.
-spindleBarrier                              MACRO labelLoop, labelDone
+; If threads are allowed to block, or the processor supports monitored waits, waiting and waking are handed off to functions that return directly to the caller, so this macro must be followed by a return.
+; Register parameters: ecx (number of threads for which to wait), r8 (memory address of barrier counter), r9 (memory address of barrier flag), r10 (memory address of the current thread's parallel region)
+; Macro parameters: label to use for the internal loop, label to use for spinning, label to use for blocking waits, label to use for waking blocked threads, label to use for completion
+; Internally uses and overwrites eax and edx, and may overwrite any volatile register if threads are allowed to block.
+spindleBarrier                              MACRO labelLoop, labelSpin, labelBlock, labelWake, labelDone
     ; Read in the current value of the thread barrier flag.
     mov                     edx,                    DWORD PTR [r9]
 
@@ -89,13 +63,33 @@ spindleBarrier                              MACRO labelLoop, labelDone
     ; If all other threads have been here, clean up and signal them to wake up.
     mov                     DWORD PTR [r8],         ecx
     add                     DWORD PTR [r9],         1
+    cmp                     DWORD PTR [r10+kSpindleRegionBarrierSpinLimit], 0
+    jne                     labelWake
     jmp                     labelDone
 
-    ; Wait here for the signal.
+    ; If threads are allowed to block, wake any that did.
+  labelWake:
+    mov                     r_param1,               r9
+    jmp                     spindleBarrierWakeFlag
+
+    ; Wait here for the signal, either by spinning or, if threads are allowed to block or the processor supports monitored waits, by handing off.
   labelLoop:
+    mov                     eax,                    DWORD PTR [r10+kSpindleRegionBarrierSpinLimit]
+    or                      eax,                    DWORD PTR [spindleBarrierUseWaitPkg]
+    jne                     labelBlock
+    
+  labelSpin:
     pause
     cmp                     edx,                    DWORD PTR [r9]
-    je                      labelLoop
+    je                      labelSpin
+    jmp                     labelDone
+    
+  labelBlock:
+    mov                     e_param2,               edx
+    mov                     r_param1,               r9
+    cmp                     DWORD PTR [r10+kSpindleRegionBarrierSpinLimit], 0
+    jne                     spindleBarrierWaitFlag
+    jmp                     spindleBarrierSpinFlag
     
   labelDone:
 ENDM
@@ -105,53 +99,171 @@ ENDM
 ; See "barrier.h" and "spindle.h" for documentation.
 
 spindleBarrierLocal                         PROC PUBLIC
+IFDEF SPINDLE_ENABLE_TRACING
+    ; Hand off to the tracing wrapper if the current thread's parallel region is being traced. The wrapper returns directly to the caller.
+    ; The wrapper records the barrier around a call to the untraced implementation, which otherwise immediately follows.
+    spindleAsmHelperGetRegion                       r10, r10d, r11
+    cmp                     QWORD PTR [r10+kSpindleRegionTraceBufferTable], 0
+    jne                     spindleTraceBarrierLocal
+ENDIF
+spindleBarrierLocal                         ENDP
+
+spindleBarrierLocalUntraced                 PROC PUBLIC
+    ; Obtain the current thread's parallel region, which holds all of its barriers.
+    spindleAsmHelperGetRegion                       r10, r10d, r11
+    
+    ; If any task uses a non-default barrier algorithm, check whether the current thread's task is one of them.
+    cmp                     QWORD PTR [r10+kSpindleRegionLocalBarrierGroupTable],           0
+    jne                     spindleBarrierLocal_CheckGroup
+    
+  spindleBarrierLocal_Centralized:
     ; Calculate the memory address within the local barrier memory region for the current thread's barrier counter and flag.
-    ; This is based on the thread's task ID.
+    ; This is based on the thread's task ID. Each task's counter and flag each occupy two cache lines.
     spindleAsmHelperGetTaskID                       r8d
-    shl                     r8,                     7
-    add                     r8,                     QWORD PTR [spindleLocalBarrierBase]
+    shl                     r8,                     8
+    add                     r8,                     QWORD PTR [r10+kSpindleRegionLocalBarrierBase]
     mov                     r9,                     r8
-    add                     r9,                     64
+    add                     r9,                     128
     
     ; Number of threads for which to wait is equal to the number of threads that exist locally in the current task.
     spindleAsmHelperGetLocalThreadCount             ecx
     
     ; Invoke the barrier itself.
-    spindleBarrier          spindleBarrierLocal_Loop,                       spindleBarrierLocal_Done
+    spindleBarrier          spindleBarrierLocal_Loop, spindleBarrierLocal_Spin, spindleBarrierLocal_Block, spindleBarrierLocal_Wake, spindleBarrierLocal_Done
 
 	; All threads in the present task have passed the barrier.
     ret
-spindleBarrierLocal                         ENDP
+
+  spindleBarrierLocal_CheckGroup:
+    ; Obtain the current thread's task's barrier group, if it has one, based on the thread's task ID.
+    spindleAsmHelperGetTaskID                       r8d
+    mov                     rax,                    QWORD PTR [r10+kSpindleRegionLocalBarrierGroupTable]
+    mov                     r8,                     QWORD PTR [rax+8*r8]
+    test                    r8,                     r8
+    je                      spindleBarrierLocal_Centralized
+    
+    ; Hand off to the selected algorithm, which returns directly to the caller.
+    ; Within a task, each thread is identified by its local thread ID.
+    mov                     r_param1,               r8
+    spindleAsmHelperGetLocalThreadID                e_param2
+    jmp                     spindleBarrierGroupWait
+spindleBarrierLocalUntraced                 ENDP
 
 ; ---------
 
 spindleBarrierGlobal                        PROC PUBLIC
+IFDEF SPINDLE_ENABLE_TRACING
+    ; Hand off to the tracing wrapper if the current thread's parallel region is being traced. The wrapper returns directly to the caller.
+    ; The wrapper records the barrier around a call to the untraced implementation, which otherwise immediately follows.
+    spindleAsmHelperGetRegion                       r10, r10d, r11
+    cmp                     QWORD PTR [r10+kSpindleRegionTraceBufferTable], 0
+    jne                     spindleTraceBarrierGlobal
+ENDIF
+spindleBarrierGlobal                        ENDP
+
+spindleBarrierGlobalUntraced                PROC PUBLIC
+    ; Obtain the current thread's parallel region, which holds all of its barriers.
+    spindleAsmHelperGetRegion                       r10, r10d, r11
+    
+    ; If the global barrier uses a non-default algorithm, hand off to it, identifying each thread by its global thread ID.
+    ; The selected algorithm returns directly to the caller.
+    mov                     r_param1,               QWORD PTR [r10+kSpindleRegionGlobalBarrierGroup]
+    test                    r_param1,               r_param1
+    je                      spindleBarrierGlobal_Centralized
+    spindleAsmHelperGetGlobalThreadID               e_param2
+    jmp                     spindleBarrierGroupWait
+    
+  spindleBarrierGlobal_Centralized:
+    ; If the spawned threads span multiple NUMA nodes, synchronize hierarchically to avoid having all threads contend for the same cache line.
+    cmp                     DWORD PTR [r10+kSpindleRegionNodeBarrierCount], 1
+    ja                      spindleBarrierGlobal_Hierarchical
+    
     ; Obtain the addresses of counter and flag.
-    lea                     r8,                     QWORD PTR [spindleGlobalBarrierCounter]
-    lea                     r9,                     QWORD PTR [spindleGlobalBarrierFlag]
+    lea                     r8,                     QWORD PTR [r10+kSpindleRegionGlobalBarrierCounter]
+    lea                     r9,                     QWORD PTR [r10+kSpindleRegionGlobalBarrierFlag]
     
     ; Number of threads for which to wait is equal to the number of threads that exist globally.
     spindleAsmHelperGetGlobalThreadCount            ecx
     
     ; Invoke the barrier itself.
-    spindleBarrier          spindleBarrierGlobal_Loop,                      spindleBarrierGlobal_Done
+    spindleBarrier          spindleBarrierGlobal_Loop, spindleBarrierGlobal_Spin, spindleBarrierGlobal_Block, spindleBarrierGlobal_Wake, spindleBarrierGlobal_Done
 
 	; All threads globally have passed the barrier.
     ret
-spindleBarrierGlobal                        ENDP
+
+  spindleBarrierGlobal_Hierarchical:
+    ; Obtain the address of the first-level barrier for the current thread's NUMA node, based on the thread's task ID.
+    spindleAsmHelperGetTaskID                       r8d
+    mov                     rax,                    QWORD PTR [r10+kSpindleRegionTaskNodeBarrierTable]
+    mov                     r8,                     QWORD PTR [rax+8*r8]
+    
+    ; Read in the current value of the NUMA node's flag.
+    ; Threads spin only on their own NUMA node's flag, which is located in memory local to that NUMA node.
+    mov                     edx,                    DWORD PTR [r8+64]
+    
+    ; First level: combine with other threads on the same NUMA node and start waiting if needed.
+    lock sub                DWORD PTR [r8],         1
+    jne                     spindleBarrierGlobal_HierarchicalLoop
+    
+    ; The last thread to arrive on each NUMA node resets its node's counter and represents its node at the second level.
+    mov                     ecx,                    DWORD PTR [r8+4]
+    mov                     DWORD PTR [r8],         ecx
+    
+    ; Second level: combine with representatives of the other NUMA nodes and start waiting if needed.
+    lock sub                DWORD PTR [r10+kSpindleRegionGlobalBarrierCounter],             1
+    jne                     spindleBarrierGlobal_HierarchicalLoop
+    
+    ; If all NUMA nodes have been here, reset the second-level counter and signal every NUMA node's threads to wake up.
+    mov                     ecx,                    DWORD PTR [r10+kSpindleRegionNodeBarrierCount]
+    mov                     DWORD PTR [r10+kSpindleRegionGlobalBarrierCounter],             ecx
+    mov                     rax,                    QWORD PTR [r10+kSpindleRegionNodeBarrierTable]
+    
+  spindleBarrierGlobal_HierarchicalRelease:
+    mov                     r9,                     QWORD PTR [rax+8*rcx-8]
+    add                     DWORD PTR [r9+64],      1
+    sub                     ecx,                    1
+    jne                     spindleBarrierGlobal_HierarchicalRelease
+    
+    ; If threads are allowed to block, wake any that did, on all NUMA nodes.
+    cmp                     DWORD PTR [r10+kSpindleRegionBarrierSpinLimit], 0
+    jne                     spindleBarrierWakeNodeFlags
+    ret
+    
+    ; Wait here for the signal on the current thread's NUMA node, either by spinning or, if threads are allowed to block or the processor supports monitored waits, by handing off.
+  spindleBarrierGlobal_HierarchicalLoop:
+    mov                     eax,                    DWORD PTR [r10+kSpindleRegionBarrierSpinLimit]
+    or                      eax,                    DWORD PTR [spindleBarrierUseWaitPkg]
+    jne                     spindleBarrierGlobal_HierarchicalBlock
+    
+  spindleBarrierGlobal_HierarchicalSpin:
+    pause
+    cmp                     edx,                    DWORD PTR [r8+64]
+    je                      spindleBarrierGlobal_HierarchicalSpin
+    
+	; All threads globally have passed the barrier.
+    ret
+    
+  spindleBarrierGlobal_HierarchicalBlock:
+    mov                     e_param2,               edx
+    lea                     r_param1,               QWORD PTR [r8+64]
+    cmp                     DWORD PTR [r10+kSpindleRegionBarrierSpinLimit], 0
+    jne                     spindleBarrierWaitFlag
+    jmp                     spindleBarrierSpinFlag
+spindleBarrierGlobalUntraced                ENDP
 
 ; ---------
 
 spindleBarrierInternalGlobal                PROC PUBLIC
-    ; Obtain the addresses of counter and flag.
-    lea                     r8,                     QWORD PTR [spindleInternalGlobalBarrierCounter]
-    lea                     r9,                     QWORD PTR [spindleInternalGlobalBarrierFlag]
+    ; Obtain the addresses of counter and flag, which are part of the current thread's parallel region.
+    spindleAsmHelperGetRegion                       r10, r10d, r11
+    lea                     r8,                     QWORD PTR [r10+kSpindleRegionInternalGlobalBarrierCounter]
+    lea                     r9,                     QWORD PTR [r10+kSpindleRegionInternalGlobalBarrierFlag]
     
     ; Number of threads for which to wait is equal to the number of threads that exist globally.
     spindleAsmHelperGetGlobalThreadCount            ecx
     
     ; Invoke the barrier itself.
-    spindleBarrier          spindleBarrierInternalGlobal_Loop,              spindleBarrierInternalGlobal_Done
+    spindleBarrier          spindleBarrierInternalGlobal_Loop, spindleBarrierInternalGlobal_Spin, spindleBarrierInternalGlobal_Block, spindleBarrierInternalGlobal_Wake, spindleBarrierInternalGlobal_Done
     
 	; All threads globally have passed the barrier.
     ret
@@ -159,48 +271,107 @@ spindleBarrierInternalGlobal                ENDP
 
 ; ---------
 
-spindleInitializeLocalThreadBarrier         PROC PUBLIC
-    ; Each local barrier counter/flag combination is 128 bytes in size, or two cache lines.
-    ; Once the address is determined, place the number of threads in the local group into the counter and initialize the flag to 0.
-    shl                     r_param1,               7
-    add                     r_param1,               QWORD PTR [spindleLocalBarrierBase]
-    mov                     DWORD PTR [r_param1+0],                         e_param2
-    mov                     DWORD PTR [r_param1+64],                        0
+spindleBarrierDetectWaitPkg                 PROC PUBLIC
+    ; The WAITPKG feature flag is bit 5 of ecx, as reported by CPUID leaf 7 subleaf 0.
+    ; CPUID overwrites rbx, which must be preserved.
+    push                    rbx
+    
+    ; Verify that leaf 7 exists before querying it.
+    xor                     eax,                    eax
+    cpuid
+    cmp                     eax,                    7
+    jb                      spindleBarrierDetectWaitPkg_Unsupported
+    
+    mov                     eax,                    7
+    xor                     ecx,                    ecx
+    cpuid
+    mov                     eax,                    ecx
+    shr                     eax,                    5
+    and                     eax,                    1
+    pop                     rbx
     ret
-spindleInitializeLocalThreadBarrier         ENDP
+    
+  spindleBarrierDetectWaitPkg_Unsupported:
+    xor                     eax,                    eax
+    pop                     rbx
+    ret
+spindleBarrierDetectWaitPkg                 ENDP
 
 ; ---------
 
-spindleInitializeGlobalThreadBarrier        PROC PUBLIC
-    ; Place the total number of threads into the counter and initialize the flag to 0.
-    mov                     DWORD PTR [spindleGlobalBarrierCounter],        e_param1
-    mov                     DWORD PTR [spindleGlobalBarrierFlag],           0
+spindleBarrierSpinFlag                      PROC PUBLIC
+    ; Move the parameters out of the way, since both the timestamp counter and the monitored wait instruction use eax and edx.
+    mov                     r8,                     r_param1
+    mov                     r9d,                    e_param2
+    
+    cmp                     DWORD PTR [spindleBarrierUseWaitPkg],           0
+    je                      spindleBarrierSpinFlag_Pause
+    
+    ; Monitored waits use the lighter-weight, faster-waking C0.1 state, which is selected by bit 0 of the control register.
+    mov                     r10d,                   1
     
-    mov                     DWORD PTR [spindleInternalGlobalBarrierCounter],                        e_param1
-    mov                     DWORD PTR [spindleInternalGlobalBarrierFlag],                           0
+  spindleBarrierSpinFlag_Monitor:
+    ; Arm the monitor on the flag's cache line, then check the flag, so that a write between the two is not missed.
+    umonitor                r8
+    cmp                     r9d,                    DWORD PTR [r8]
+    jne                     spindleBarrierSpinFlag_Done
+    
+    ; Wait until the cache line is written or a deadline passes, whichever comes first.
+    ; The deadline, 100000 cycles in the future, only bounds the wait in case the operating system does not.
+    rdtsc
+    add                     eax,                    100000
+    adc                     edx,                    0
+    umwait                  r10d
+    
+    cmp                     r9d,                    DWORD PTR [r8]
+    je                      spindleBarrierSpinFlag_Monitor
+    ret
+    
+  spindleBarrierSpinFlag_Pause:
+    pause
+    cmp                     r9d,                    DWORD PTR [r8]
+    je                      spindleBarrierSpinFlag_Pause
+    
+  spindleBarrierSpinFlag_Done:
     ret
-spindleInitializeGlobalThreadBarrier        ENDP
+spindleBarrierSpinFlag                      ENDP
 
 ; ---------
 
 spindleTimedBarrierLocal                    PROC PUBLIC
+    ; Reserve stack space, keeping the stack aligned and leaving room for the callee's register parameters as required on some platforms.
+    ; The initial timestamp is kept on the stack, because the barrier may be implemented by a function that does not preserve volatile registers.
+    sub                     rsp,                    40
+    
     ; Capture the initial timestamp.
+    ; The fences keep the barrier from starting before earlier instructions complete or before the timestamp is read.
     lfence
     rdtsc
+    lfence
     shl                     rdx,                    32
     or                      rax,                    rdx
-    mov                     r8,                     rax
+    mov                     QWORD PTR [rsp+32],     rax
     
     ; Perform the barrier.
     call                    spindleBarrierLocal
     
     ; Capture the final timestamp and calculate the time taken.
+    ; Where available, rdtscp waits for the barrier to complete before reading the timestamp, which is more precise than a separate fence.
+    cmp                     DWORD PTR [spindleBarrierUseRdtscp],            0
+    je                      spindleTimedBarrierLocal_Rdtsc
+    rdtscp
+    jmp                     spindleTimedBarrierLocal_Captured
+    
+  spindleTimedBarrierLocal_Rdtsc:
     lfence
     rdtsc
+    
+  spindleTimedBarrierLocal_Captured:
     shl                     rdx,                    32
     or                      rax,                    rdx
-    sub                     rax,                    r8
+    sub                     rax,                    QWORD PTR [rsp+32]
     
+    add                     rsp,                    40
     mov                     r_retval,               rax
     ret
 spindleTimedBarrierLocal                    ENDP
@@ -208,23 +379,39 @@ spindleTimedBarrierLocal                    ENDP
 ; ---------
 
 spindleTimedBarrierGlobal                   PROC PUBLIC
+    ; Reserve stack space, keeping the stack aligned and leaving room for the callee's register parameters as required on some platforms.
+    ; The initial timestamp is kept on the stack, because the barrier may be implemented by a function that does not preserve volatile registers.
+    sub                     rsp,                    40
+    
     ; Capture the initial timestamp.
+    ; The fences keep the barrier from starting before earlier instructions complete or before the timestamp is read.
     lfence
     rdtsc
+    lfence
     shl                     rdx,                    32
     or                      rax,                    rdx
-    mov                     r8,                     rax
+    mov                     QWORD PTR [rsp+32],     rax
     
     ; Perform the barrier.
     call                    spindleBarrierGlobal
     
     ; Capture the final timestamp and calculate the time taken.
+    ; Where available, rdtscp waits for the barrier to complete before reading the timestamp, which is more precise than a separate fence.
+    cmp                     DWORD PTR [spindleBarrierUseRdtscp],            0
+    je                      spindleTimedBarrierGlobal_Rdtsc
+    rdtscp
+    jmp                     spindleTimedBarrierGlobal_Captured
+    
+  spindleTimedBarrierGlobal_Rdtsc:
     lfence
     rdtsc
+    
+  spindleTimedBarrierGlobal_Captured:
     shl                     rdx,                    32
     or                      rax,                    rdx
-    sub                     rax,                    r8
+    sub                     rax,                    QWORD PTR [rsp+32]
     
+    add                     rsp,                    40
     mov                     r_retval,               rax
     ret
 spindleTimedBarrierGlobal                   ENDP
@@ -11,35 +11,297 @@
  *   Implementation of internal thread barrier functionality.
  *****************************************************************************/
 
+#include "../spindle.h"
 #include "align.h"
+#include "atomic.h"
 #include "barrier.h"
+#include "osthread.h"
+#include "region.h"
+#include "types.h"
 
+#include <hwloc.h>
 #include <malloc.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <topo.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Selection state indicating that no thread has started checking the processor for the capabilities that affect how threads spin at barriers.
+#define kSpindleBarrierSpinMethodStateUnselected    0ull
+
+/// Selection state indicating that one thread is checking the processor and others must wait for it.
+#define kSpindleBarrierSpinMethodStateSelecting     1ull
+
+/// Selection state indicating that the spin method has been selected.
+#define kSpindleBarrierSpinMethodStateSelected      2ull
+
+
+// -------- LOCALS --------------------------------------------------------- //
+
+/// Selection state of the barrier spin method, which allows exactly one thread to select it and publishes the result to all others.
+/// Different OS threads may spawn parallel regions at the same time, so this is claimed atomically and read with acquire semantics.
+static uint64_t barrierSpinMethodState = kSpindleBarrierSpinMethodStateUnselected;
 
 
 // -------- FUNCTIONS ------------------------------------------------------ //
-// See "barrier.h" for documentation.
+// See "barrier.h" and "spindle.h" for documentation.
 
-void* spindleAllocateLocalThreadBarriers(uint32_t taskCount)
+void* spindleAllocateLocalThreadBarriers(SSpindleRegion* region, uint32_t taskCount)
 {
-    if (NULL == spindleLocalBarrierBase)
+    if (NULL == region->localBarrierBase)
     {
         // Create a single memory region of size 2x the number of tasks, so that each task gets a counter and a flag.
-        spindleLocalBarrierBase = (SSpindleBarrierData*)aligned_malloc(sizeof(SSpindleBarrierData) * taskCount * 2, sizeof(SSpindleBarrierData));
+        region->localBarrierBase = (SSpindleBarrierData*)aligned_malloc(sizeof(SSpindleBarrierData) * taskCount * 2, sizeof(SSpindleBarrierData));
     }
     
-    return spindleLocalBarrierBase;
+    return region->localBarrierBase;
+}
+
+// --------
+
+void* spindleAllocateNodeThreadBarriers(SSpindleRegion* region, SSpindleThreadInfo* threadAssignments, uint32_t threadCount, uint32_t taskCount)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+    if (NULL != region->nodeBarrierTable)
+        return region->nodeBarrierTable;
+
+    if (NULL == topology)
+        return NULL;
+
+    // There cannot be more NUMA nodes spanned than there are tasks.
+    region->nodeBarrierTable = (SSpindleNodeBarrier**)malloc(sizeof(SSpindleNodeBarrier*) * taskCount);
+    if (NULL == region->nodeBarrierTable)
+        return NULL;
+
+    region->taskNodeBarrierTable = (SSpindleNodeBarrier**)malloc(sizeof(SSpindleNodeBarrier*) * taskCount);
+    if (NULL == region->taskNodeBarrierTable)
+    {
+        free((void*)region->nodeBarrierTable);
+        region->nodeBarrierTable = NULL;
+        return NULL;
+    }
+
+    region->nodeBarrierCount = 0;
+
+    // The first thread of each task identifies the NUMA node and number of threads for the whole task.
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        SSpindleNodeBarrier* nodeBarrier = NULL;
+
+        if (0 != threadAssignments[threadIndex].localThreadID)
+            continue;
+
+        // Find the first-level barrier for the task's NUMA node, if one already exists.
+        for (uint32_t nodeIndex = 0; nodeIndex < region->nodeBarrierCount; ++nodeIndex)
+        {
+            if (threadAssignments[threadIndex].numaNode == region->nodeBarrierTable[nodeIndex]->numaNode)
+            {
+                nodeBarrier = region->nodeBarrierTable[nodeIndex];
+                break;
+            }
+        }
+
+        // Otherwise, create one in memory local to that NUMA node.
+        if (NULL == nodeBarrier)
+        {
+            hwloc_obj_t numaNodeObject = topoGetNUMANodeObjectAtIndex(threadAssignments[threadIndex].numaNode);
+            if (NULL == numaNodeObject)
+            {
+                spindleFreeNodeThreadBarriers(region);
+                return NULL;
+            }
+
+            nodeBarrier = (SSpindleNodeBarrier*)hwloc_alloc_membind(topology, sizeof(SSpindleNodeBarrier), numaNodeObject->cpuset, HWLOC_MEMBIND_BIND, 0);
+            if (NULL == nodeBarrier)
+            {
+                spindleFreeNodeThreadBarriers(region);
+                return NULL;
+            }
+
+            memset((void*)nodeBarrier, 0, sizeof(SSpindleNodeBarrier));
+            nodeBarrier->numaNode = threadAssignments[threadIndex].numaNode;
+            nodeBarrier->firstTaskID = threadAssignments[threadIndex].taskID;
+
+            region->nodeBarrierTable[region->nodeBarrierCount] = nodeBarrier;
+            region->nodeBarrierCount += 1;
+        }
+
+        nodeBarrier->threadCount += threadAssignments[threadIndex].localThreadCount;
+        nodeBarrier->counter = nodeBarrier->threadCount;
+        region->taskNodeBarrierTable[threadAssignments[threadIndex].taskID] = nodeBarrier;
+    }
+
+    return region->nodeBarrierTable;
 }
 
 // --------
 
-void spindleFreeLocalThreadBarriers(void)
+void spindleBarrierWaitFlag(volatile uint32_t* flag, uint32_t value)
 {
-    if (NULL != spindleLocalBarrierBase)
+    volatile uint32_t* const sleepCount = flag + 1;
+    const uint32_t spinLimit = spindleGetCurrentRegion()->barrierSpinLimit;
+    uint32_t backoffIterations = 1;
+
+    // Spin first, backing off exponentially, since most barrier waits are short.
+    for (uint32_t spinIterations = 0; spinIterations < spinLimit; spinIterations += backoffIterations)
+    {
+        for (uint32_t i = 0; i < backoffIterations; ++i)
+            spin_pause();
+
+        if (value != *flag)
+            return;
+
+        if (backoffIterations < kSpindleBarrierMaxBackoffIterations)
+            backoffIterations <<= 1;
+    }
+
+    // Announcing the intent to block is a full memory barrier, so either the releasing thread sees a nonzero count or the check below sees the release.
+    atomic_add32(sleepCount, 1);
+
+    while (value == *flag)
+        spindleWaitOnAddress(flag, value);
+
+    atomic_add32(sleepCount, -1);
+}
+
+// --------
+
+void spindleBarrierWakeFlag(volatile uint32_t* flag)
+{
+    // The fence orders the preceding flag update before the check of the number of blocked threads.
+    atomic_fence();
+
+    if (0 != flag[1])
+        spindleWakeAddress(flag);
+}
+
+// --------
+
+void spindleBarrierWakeNodeFlags(void)
+{
+    SSpindleRegion* const region = spindleGetCurrentRegion();
+
+    atomic_fence();
+
+    for (uint32_t nodeIndex = 0; nodeIndex < region->nodeBarrierCount; ++nodeIndex)
+    {
+        if (0 != region->nodeBarrierTable[nodeIndex]->flagSleepCount)
+            spindleWakeAddress(&region->nodeBarrierTable[nodeIndex]->flag);
+    }
+}
+
+// --------
+
+void spindleBarrierInternalGlobalArriveMissing(SSpindleRegion* region, uint32_t missingThreadCount)
+{
+    // Mirrors the centralized barrier, with a single decrement standing in for all of the missing threads.
+    if (0 != atomic_add32(&region->internalGlobalBarrierCounter.value, 0 - missingThreadCount))
+        return;
+
+    region->internalGlobalBarrierCounter.value = region->threadCount;
+    atomic_add32(&region->internalGlobalBarrierFlag.value, 1);
+    spindleBarrierWakeFlag(&region->internalGlobalBarrierFlag.value);
+}
+
+// --------
+
+void spindleFreeLocalThreadBarriers(SSpindleRegion* region)
+{
+    if (NULL != region->localBarrierBase)
+    {
+        aligned_free((void*)region->localBarrierBase);
+        region->localBarrierBase = NULL;
+    }
+}
+
+// --------
+
+void spindleFreeNodeThreadBarriers(SSpindleRegion* region)
+{
+    if (NULL != region->nodeBarrierTable)
+    {
+        hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+        for (uint32_t nodeIndex = 0; nodeIndex < region->nodeBarrierCount; ++nodeIndex)
+        {
+            if (NULL != region->nodeBarrierTable[nodeIndex]->replica)
+                hwloc_free(topology, region->nodeBarrierTable[nodeIndex]->replica, region->nodeBarrierTable[nodeIndex]->replicaSize);
+
+            hwloc_free(topology, (void*)region->nodeBarrierTable[nodeIndex], sizeof(SSpindleNodeBarrier));
+        }
+
+        free((void*)region->nodeBarrierTable);
+        free((void*)region->taskNodeBarrierTable);
+
+        region->nodeBarrierTable = NULL;
+        region->taskNodeBarrierTable = NULL;
+        region->nodeBarrierCount = 0;
+    }
+}
+
+// --------
+
+uint32_t spindleGetBarrierSpinLimit(ESpindleBarrierWaitPolicy policy, uint32_t spinIterations)
+{
+    if (SpindleBarrierWaitPolicySpinThenBlock != policy)
+        return 0;
+
+    return (0 == spinIterations ? kSpindleBarrierDefaultSpinIterations : spinIterations);
+}
+
+// --------
+
+void spindleInitializeBarrierSpinMethod(void)
+{
+    if (kSpindleBarrierSpinMethodStateSelected == atomic_load64_acquire(&barrierSpinMethodState))
+        return;
+
+    // Exactly one thread checks the processor. Any other waits for the result, which takes only a few instructions.
+    if (!atomic_cas64(&barrierSpinMethodState, kSpindleBarrierSpinMethodStateUnselected, kSpindleBarrierSpinMethodStateSelecting))
+    {
+        while (kSpindleBarrierSpinMethodStateSelected != atomic_load64_acquire(&barrierSpinMethodState))
+            spin_pause();
+
+        return;
+    }
+
+    spindleBarrierUseWaitPkg = spindleBarrierDetectWaitPkg();
+    atomic_store64_release(&barrierSpinMethodState, kSpindleBarrierSpinMethodStateSelected);
+}
+
+// --------
+
+void spindleInitializeLocalThreadBarrier(SSpindleRegion* region, uint32_t taskID, uint32_t localThreadCount)
+{
+    // Each task's counter is immediately followed by its flag.
+    SSpindleBarrierData* const localBarrier = &region->localBarrierBase[taskID * 2];
+
+    localBarrier[0].value = localThreadCount;
+    localBarrier[1].value = 0;
+    localBarrier[1].sleepCount = 0;
+}
+
+// --------
+
+void spindleInitializeGlobalThreadBarrier(SSpindleRegion* region, uint32_t globalThreadCount)
+{
+    region->internalGlobalBarrierCounter.value = globalThreadCount;
+    region->internalGlobalBarrierFlag.value = 0;
+    region->internalGlobalBarrierFlag.sleepCount = 0;
+
+    // The external barrier's counter holds either the total number of threads or, if it operates hierarchically, the number of NUMA nodes.
+    region->globalBarrierCounter.value = (region->nodeBarrierCount > 1 ? region->nodeBarrierCount : globalThreadCount);
+    region->globalBarrierFlag.value = 0;
+    region->globalBarrierFlag.sleepCount = 0;
+
+    for (uint32_t nodeIndex = 0; nodeIndex < region->nodeBarrierCount; ++nodeIndex)
     {
-        aligned_free((void*)spindleLocalBarrierBase);
-        spindleLocalBarrierBase = NULL;
+        region->nodeBarrierTable[nodeIndex]->counter = region->nodeBarrierTable[nodeIndex]->threadCount;
+        region->nodeBarrierTable[nodeIndex]->flag = 0;
+        region->nodeBarrierTable[nodeIndex]->flagSleepCount = 0;
     }
 }
@@ -0,0 +1,373 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file barriergroup.c
+ *   Implementation of internal thread barrier algorithms other than the default centralized barrier.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "align.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "barriergroup.h"
+#include "region.h"
+#include "types.h"
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Frees a single barrier group and all of its associated memory.
+/// @param [in] group Barrier group to free, which may be `NULL`.
+static void spindleHelperDestroyBarrierGroup(SSpindleBarrierGroup* group)
+{
+    if (NULL == group)
+        return;
+
+    if (NULL != group->episode)
+        aligned_free((void*)group->episode);
+
+    if (NULL != group->flags)
+        aligned_free((void*)group->flags);
+
+    if (NULL != group->treeNodeChildCount)
+        free((void*)group->treeNodeChildCount);
+
+    if (NULL != group->treeLevelBase)
+        free((void*)group->treeLevelBase);
+
+    aligned_free((void*)group);
+}
+
+// --------
+
+/// Resets a single barrier group so that it is ready for a new set of threads.
+/// @param [in] group Barrier group to reset, which may be `NULL`.
+/// @param [in] spinLimit Spin limit of the parallel region to which the barrier group belongs.
+static void spindleHelperResetBarrierGroup(SSpindleBarrierGroup* group, uint32_t spinLimit)
+{
+    if (NULL == group)
+        return;
+
+    group->spinLimit = spinLimit;
+
+    group->release.value = 0;
+    group->release.sleepCount = 0;
+
+    for (uint32_t participant = 0; participant < group->participantCount; ++participant)
+        group->episode[participant].value = 0;
+
+    switch (group->algorithm)
+    {
+    case SpindleBarrierAlgorithmDissemination:
+    case SpindleBarrierAlgorithmTournament:
+        for (uint32_t flag = 0; flag < group->participantCount * group->roundCount; ++flag)
+        {
+            group->flags[flag].value = 0;
+            group->flags[flag].sleepCount = 0;
+        }
+        break;
+
+    case SpindleBarrierAlgorithmStaticTree:
+        for (uint32_t level = 0; level < group->roundCount; ++level)
+        {
+            const uint32_t levelEnd = ((level + 1) < group->roundCount ? group->treeLevelBase[level + 1] : group->treeLevelBase[level] + 1);
+
+            for (uint32_t node = group->treeLevelBase[level]; node < levelEnd; ++node)
+                group->flags[node].value = group->treeNodeChildCount[node];
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+// --------
+
+/// Allocates and initializes a single barrier group.
+/// @param [in] algorithm Barrier algorithm to use, other than the default centralized algorithm.
+/// @param [in] participantCount Number of threads participating in the barrier.
+/// @return Pointer to the new barrier group on success, or `NULL` on failure.
+static SSpindleBarrierGroup* spindleHelperCreateBarrierGroup(ESpindleBarrierAlgorithm algorithm, uint32_t participantCount)
+{
+    SSpindleBarrierGroup* group = (SSpindleBarrierGroup*)aligned_malloc(sizeof(SSpindleBarrierGroup), sizeof(SSpindleBarrierData));
+    uint32_t flagCount = 0;
+
+    if (NULL == group)
+        return NULL;
+
+    memset((void*)group, 0, sizeof(SSpindleBarrierGroup));
+    group->algorithm = algorithm;
+    group->participantCount = participantCount;
+
+    switch (algorithm)
+    {
+    case SpindleBarrierAlgorithmDissemination:
+    case SpindleBarrierAlgorithmTournament:
+        // Both algorithms proceed over ceil(log2(participantCount)) rounds, and each participant has one flag per round.
+        while ((1u << group->roundCount) < participantCount)
+            group->roundCount += 1;
+
+        flagCount = participantCount * group->roundCount;
+        break;
+
+    case SpindleBarrierAlgorithmStaticTree:
+        // Count the tree levels and nodes, from the leaves (to which participants attach directly) up to the single root.
+        for (uint32_t levelWidth = participantCount; (0 == group->roundCount) || (levelWidth > 1); group->roundCount += 1)
+        {
+            levelWidth = (levelWidth + kSpindleBarrierTreeFanIn - 1) / kSpindleBarrierTreeFanIn;
+            flagCount += levelWidth;
+        }
+
+        group->treeNodeChildCount = (uint32_t*)malloc(sizeof(uint32_t) * flagCount);
+        group->treeLevelBase = (uint32_t*)malloc(sizeof(uint32_t) * group->roundCount);
+        if ((NULL == group->treeNodeChildCount) || (NULL == group->treeLevelBase))
+        {
+            spindleHelperDestroyBarrierGroup(group);
+            return NULL;
+        }
+
+        // Each node combines up to kSpindleBarrierTreeFanIn children, which are participants at the first level and nodes at subsequent levels.
+        for (uint32_t level = 0, levelBase = 0, childCount = participantCount; level < group->roundCount; ++level)
+        {
+            const uint32_t levelWidth = (childCount + kSpindleBarrierTreeFanIn - 1) / kSpindleBarrierTreeFanIn;
+
+            group->treeLevelBase[level] = levelBase;
+
+            for (uint32_t node = 0; node < levelWidth; ++node)
+            {
+                const uint32_t remainingChildCount = childCount - (node * kSpindleBarrierTreeFanIn);
+                group->treeNodeChildCount[levelBase + node] = (remainingChildCount < kSpindleBarrierTreeFanIn ? remainingChildCount : kSpindleBarrierTreeFanIn);
+            }
+
+            levelBase += levelWidth;
+            childCount = levelWidth;
+        }
+        break;
+
+    default:
+        spindleHelperDestroyBarrierGroup(group);
+        return NULL;
+    }
+
+    group->episode = (SSpindleBarrierData*)aligned_malloc(sizeof(SSpindleBarrierData) * participantCount, sizeof(SSpindleBarrierData));
+    if (NULL == group->episode)
+    {
+        spindleHelperDestroyBarrierGroup(group);
+        return NULL;
+    }
+
+    if (0 != flagCount)
+    {
+        group->flags = (SSpindleBarrierData*)aligned_malloc(sizeof(SSpindleBarrierData) * flagCount, sizeof(SSpindleBarrierData));
+        if (NULL == group->flags)
+        {
+            spindleHelperDestroyBarrierGroup(group);
+            return NULL;
+        }
+    }
+
+    spindleHelperResetBarrierGroup(group, 0);
+    return group;
+}
+
+// --------
+
+/// Sets the specified flag to indicate that the specified episode has been reached, waking any threads blocked waiting for it.
+/// @param [in] flag Address of the flag to set.
+/// @param [in] episode Episode that has been reached.
+/// @param [in] spinLimit Spin limit of the barrier group, 0 if no threads ever block.
+static inline void spindleHelperSignalEpisode(volatile uint32_t* flag, uint32_t episode, uint32_t spinLimit)
+{
+    *flag = episode;
+
+    if (0 != spinLimit)
+        spindleBarrierWakeFlag(flag);
+}
+
+// --------
+
+/// Waits until the specified flag indicates that the specified episode has been reached, according to the current barrier waiting policy.
+/// Episodes increase monotonically, so the comparison is performed in a way that tolerates wrap-around.
+/// @param [in] flag Address of the flag on which to wait.
+/// @param [in] episode Episode for which to wait.
+/// @param [in] spinLimit Spin limit of the barrier group, 0 to spin without ever blocking.
+static inline void spindleHelperWaitForEpisode(volatile uint32_t* flag, uint32_t episode, uint32_t spinLimit)
+{
+    uint32_t flagValue;
+
+    while ((int32_t)((flagValue = *flag) - episode) < 0)
+    {
+        if (0 != spinLimit)
+            spindleBarrierWaitFlag(flag, flagValue);
+        else
+            spindleBarrierSpinFlag(flag, flagValue);
+    }
+}
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "barriergroup.h" for documentation.
+
+bool spindleAllocateBarrierGroups(SSpindleRegion* region, SSpindleTaskConfig* taskSpec, uint32_t taskCount, SSpindleThreadInfo* threadAssignments, uint32_t threadCount)
+{
+    bool anyLocalBarrierGroups = false;
+
+    // The global barrier uses the algorithm specified for the first task and includes all threads.
+    if (SpindleBarrierAlgorithmCentralized != taskSpec[0].barrierAlgorithm)
+    {
+        region->globalBarrierGroup = spindleHelperCreateBarrierGroup(taskSpec[0].barrierAlgorithm, threadCount);
+        if (NULL == region->globalBarrierGroup)
+            return false;
+    }
+
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+        if (SpindleBarrierAlgorithmCentralized != taskSpec[taskIndex].barrierAlgorithm)
+        {
+            anyLocalBarrierGroups = true;
+            break;
+        }
+    }
+
+    if (!anyLocalBarrierGroups)
+        return true;
+
+    region->localBarrierGroupTable = (SSpindleBarrierGroup**)malloc(sizeof(SSpindleBarrierGroup*) * taskCount);
+    if (NULL == region->localBarrierGroupTable)
+    {
+        spindleFreeBarrierGroups(region);
+        return false;
+    }
+
+    memset((void*)region->localBarrierGroupTable, 0, sizeof(SSpindleBarrierGroup*) * taskCount);
+    region->barrierGroupTaskCount = taskCount;
+
+    // The first thread of each task identifies the number of threads for the whole task.
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        const uint32_t taskID = threadAssignments[threadIndex].taskID;
+
+        if ((0 != threadAssignments[threadIndex].localThreadID) || (SpindleBarrierAlgorithmCentralized == taskSpec[taskID].barrierAlgorithm))
+            continue;
+
+        region->localBarrierGroupTable[taskID] = spindleHelperCreateBarrierGroup(taskSpec[taskID].barrierAlgorithm, threadAssignments[threadIndex].localThreadCount);
+        if (NULL == region->localBarrierGroupTable[taskID])
+        {
+            spindleFreeBarrierGroups(region);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// --------
+
+void spindleBarrierGroupWait(SSpindleBarrierGroup* group, uint32_t participantID)
+{
+    volatile uint32_t* const episodeValue = &group->episode[participantID].value;
+    const uint32_t episode = *episodeValue + 1;
+    const uint32_t roundCount = group->roundCount;
+    const uint32_t spinLimit = group->spinLimit;
+
+    *episodeValue = episode;
+
+    switch (group->algorithm)
+    {
+    case SpindleBarrierAlgorithmDissemination:
+        // In each round, signal the participant a power of two ahead and wait to be signalled by the participant the same distance behind.
+        for (uint32_t round = 0; round < roundCount; ++round)
+        {
+            const uint32_t partnerID = (participantID + (1u << round)) % group->participantCount;
+
+            spindleHelperSignalEpisode(&group->flags[(partnerID * roundCount) + round].value, episode, spinLimit);
+            spindleHelperWaitForEpisode(&group->flags[(participantID * roundCount) + round].value, episode, spinLimit);
+        }
+        return;
+
+    case SpindleBarrierAlgorithmTournament:
+        // In each round, the loser of each pair signals the winner and then waits for the overall winner to release everyone.
+        for (uint32_t round = 0; round < roundCount; ++round)
+        {
+            const uint32_t roundBit = (1u << round);
+
+            if (0 != (participantID & roundBit))
+            {
+                spindleHelperSignalEpisode(&group->flags[((participantID - roundBit) * roundCount) + round].value, episode, spinLimit);
+                spindleHelperWaitForEpisode(&group->release.value, episode, spinLimit);
+                return;
+            }
+
+            if ((participantID + roundBit) < group->participantCount)
+                spindleHelperWaitForEpisode(&group->flags[(participantID * roundCount) + round].value, episode, spinLimit);
+        }
+        break;
+
+    case SpindleBarrierAlgorithmStaticTree:
+        // Combine at each level of the tree, ascending only if this participant is the last to arrive at its node.
+        for (uint32_t level = 0, childIndex = participantID; level < roundCount; ++level)
+        {
+            const uint32_t node = group->treeLevelBase[level] + (childIndex / kSpindleBarrierTreeFanIn);
+
+            if (0 != atomic_add32(&group->flags[node].value, -1))
+            {
+                spindleHelperWaitForEpisode(&group->release.value, episode, spinLimit);
+                return;
+            }
+
+            // Nobody else can touch this node until the release is written, so it is safe to reset it now.
+            *((volatile uint32_t*)&group->flags[node].value) = group->treeNodeChildCount[node];
+            childIndex /= kSpindleBarrierTreeFanIn;
+        }
+        break;
+
+    default:
+        return;
+    }
+
+    // The overall winner, or the participant that completed the root, releases everyone else.
+    spindleHelperSignalEpisode(&group->release.value, episode, spinLimit);
+}
+
+// --------
+
+void spindleFreeBarrierGroups(SSpindleRegion* region)
+{
+    if (NULL != region->localBarrierGroupTable)
+    {
+        for (uint32_t taskIndex = 0; taskIndex < region->barrierGroupTaskCount; ++taskIndex)
+            spindleHelperDestroyBarrierGroup(region->localBarrierGroupTable[taskIndex]);
+
+        free((void*)region->localBarrierGroupTable);
+        region->localBarrierGroupTable = NULL;
+        region->barrierGroupTaskCount = 0;
+    }
+
+    if (NULL != region->globalBarrierGroup)
+    {
+        spindleHelperDestroyBarrierGroup(region->globalBarrierGroup);
+        region->globalBarrierGroup = NULL;
+    }
+}
+
+// --------
+
+void spindleInitializeBarrierGroups(SSpindleRegion* region)
+{
+    spindleHelperResetBarrierGroup(region->globalBarrierGroup, region->barrierSpinLimit);
+
+    for (uint32_t taskIndex = 0; taskIndex < region->barrierGroupTaskCount; ++taskIndex)
+        spindleHelperResetBarrierGroup(region->localBarrierGroupTable[taskIndex], region->barrierSpinLimit);
+}
@@ -0,0 +1,337 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file barrierstats.c
+ *   Implementation of barrier wait-time statistics and imbalance reporting.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "align.h"
+#include "atomic.h"
+#include "barrierstats.h"
+#include "region.h"
+#include "types.h"
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// -------- LOCALS --------------------------------------------------------- //
+
+/// Function to receive barrier statistics reports for subsequently-spawned parallel regions, or `NULL` if barrier statistics are disabled.
+static TSpindleBarrierStatsFunc barrierStatsReportFunc = NULL;
+
+/// Argument to pass to the function that receives barrier statistics reports.
+static void* barrierStatsReportArg = NULL;
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Finds the slot that holds the specified label within the specified scope, claiming an unused slot if the label has not yet been seen.
+/// Safe to call concurrently from all threads in the parallel region.
+/// @param [in] stats Barrier statistics of the parallel region.
+/// @param [in] scope 0 for local barriers, 1 for global barriers.
+/// @param [in] label Label to find.
+/// @return Index of the label's slot, or #kSpindleBarrierStatsMaxLabelCount if all slots hold other labels.
+static uint32_t spindleHelperBarrierStatsFindLabel(SSpindleBarrierStats* stats, uint32_t scope, const char* label)
+{
+    for (uint32_t labelIndex = 0; labelIndex < kSpindleBarrierStatsMaxLabelCount; ++labelIndex)
+    {
+        const char* slotLabel = stats->labels[scope][labelIndex];
+
+        // Claim an unused slot, but if another thread claims it first, fall through and compare against its label instead.
+        if (NULL == slotLabel)
+        {
+            if (atomic_cas64((uint64_t*)&stats->labels[scope][labelIndex], (uint64_t)0, (uint64_t)(uintptr_t)label))
+                return labelIndex;
+
+            slotLabel = stats->labels[scope][labelIndex];
+        }
+
+        if ((slotLabel == label) || (0 == strcmp(slotLabel, label)))
+            return labelIndex;
+    }
+
+    return kSpindleBarrierStatsMaxLabelCount;
+}
+
+/// Performs a barrier and, if barrier statistics are enabled for the calling thread's parallel region, records the calling thread's wait under the specified label.
+/// @param [in] scope 0 for local barriers, 1 for global barriers.
+/// @param [in] label Label that identifies the barrier call site.
+static void spindleHelperBarrierLabeled(uint32_t scope, const char* label)
+{
+    SSpindleBarrierStats* const stats = spindleGetCurrentRegion()->barrierStats;
+    SSpindleBarrierThreadStats* threadStats = NULL;
+    uint32_t labelIndex = 0;
+    uint32_t arrivalRank = 0;
+    uint32_t participantCount = 0;
+    uint64_t waitCycles = 0;
+    uint32_t histogramBucket = 0;
+
+    if (NULL != stats)
+        labelIndex = spindleHelperBarrierStatsFindLabel(stats, scope, label);
+
+    if ((NULL == stats) || (kSpindleBarrierStatsMaxLabelCount == labelIndex))
+    {
+        if (0 == scope)
+            spindleBarrierLocal();
+        else
+            spindleBarrierGlobal();
+
+        return;
+    }
+
+    // Determine the arrival position from the number of threads that arrived earlier, counting across all episodes.
+    if (0 == scope)
+    {
+        participantCount = spindleGetLocalThreadCount();
+        arrivalRank = (uint32_t)(atomic_fetch_add64(&stats->counters[(labelIndex * stats->taskCount) + spindleGetTaskID()].arrivals, 1) % participantCount);
+        waitCycles = spindleTimedBarrierLocal();
+    }
+    else
+    {
+        participantCount = spindleGetGlobalThreadCount();
+        arrivalRank = (uint32_t)(atomic_fetch_add64(&stats->counters[(kSpindleBarrierStatsMaxLabelCount * stats->taskCount) + labelIndex].arrivals, 1) % participantCount);
+        waitCycles = spindleTimedBarrierGlobal();
+    }
+
+    // Only the calling thread writes its own records, so no synchronization is needed to update them.
+    threadStats = &stats->threadStats[(((size_t)spindleGetGlobalThreadID() * 2) + scope) * kSpindleBarrierStatsMaxLabelCount + labelIndex];
+
+    threadStats->callCount += 1;
+    threadStats->totalWaitCycles += waitCycles;
+    threadStats->arrivalRankSum += arrivalRank;
+
+    if (waitCycles > threadStats->maxWaitCycles)
+        threadStats->maxWaitCycles = waitCycles;
+
+    if ((participantCount - 1) == arrivalRank)
+        threadStats->lastArrivalCount += 1;
+
+    while (((waitCycles >> 1) > 0) && (histogramBucket < (kSpindleBarrierStatsHistogramBucketCount - 1)))
+    {
+        waitCycles >>= 1;
+        histogramBucket += 1;
+    }
+
+    threadStats->histogram[histogramBucket] += 1;
+}
+
+/// Summarizes the per-thread statistics of a contiguous range of threads, identified by global thread ID.
+/// @param [in] threadStats Per-thread statistics for a single label, indexed by global thread ID.
+/// @param [in] firstThread Global thread ID of the first thread in the group.
+/// @param [in] endThread Global thread ID one past the last thread in the group.
+/// @param [in] groupID Task ID or NUMA node index that identifies the group.
+/// @param [out] groupStats Filled with the summary.
+static void spindleHelperBarrierStatsSummarize(const SSpindleBarrierThreadStats* threadStats, uint32_t firstThread, uint32_t endThread, uint32_t groupID, SSpindleBarrierGroupStats* groupStats)
+{
+    uint64_t mostLastArrivals = 0;
+
+    memset((void*)groupStats, 0, sizeof(SSpindleBarrierGroupStats));
+    groupStats->groupID = groupID;
+    groupStats->minThreadWaitCycles = UINT64_MAX;
+    groupStats->stragglerGlobalThreadID = firstThread;
+
+    for (uint32_t threadIndex = firstThread; threadIndex < endThread; ++threadIndex)
+    {
+        if (0 == threadStats[threadIndex].callCount)
+            continue;
+
+        groupStats->threadCount += 1;
+        groupStats->totalWaitCycles += threadStats[threadIndex].totalWaitCycles;
+
+        if (threadStats[threadIndex].totalWaitCycles < groupStats->minThreadWaitCycles)
+            groupStats->minThreadWaitCycles = threadStats[threadIndex].totalWaitCycles;
+
+        if (threadStats[threadIndex].totalWaitCycles > groupStats->maxThreadWaitCycles)
+            groupStats->maxThreadWaitCycles = threadStats[threadIndex].totalWaitCycles;
+
+        if (threadStats[threadIndex].lastArrivalCount > mostLastArrivals)
+        {
+            mostLastArrivals = threadStats[threadIndex].lastArrivalCount;
+            groupStats->stragglerGlobalThreadID = threadIndex;
+        }
+    }
+
+    if (0 == groupStats->threadCount)
+        groupStats->minThreadWaitCycles = 0;
+
+    if (0 != groupStats->maxThreadWaitCycles)
+        groupStats->imbalance = (double)(groupStats->maxThreadWaitCycles - groupStats->minThreadWaitCycles) / (double)groupStats->maxThreadWaitCycles;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "barrierstats.h" for documentation.
+
+void spindleFreeBarrierStats(SSpindleRegion* region)
+{
+    if (NULL != region->barrierStats)
+    {
+        aligned_free((void*)region->barrierStats->threadStats);
+        aligned_free((void*)region->barrierStats->counters);
+        free((void*)region->barrierStats);
+        region->barrierStats = NULL;
+    }
+}
+
+// --------
+
+void spindleInitializeBarrierStats(SSpindleRegion* region)
+{
+    SSpindleBarrierStats* stats = region->barrierStats;
+    const size_t counterCount = (size_t)kSpindleBarrierStatsMaxLabelCount * (region->taskCount + 1);
+    const size_t threadStatsCount = (size_t)region->threadCount * 2 * kSpindleBarrierStatsMaxLabelCount;
+
+    if (NULL == barrierStatsReportFunc)
+    {
+        spindleFreeBarrierStats(region);
+        return;
+    }
+
+    if (NULL == stats)
+    {
+        stats = (SSpindleBarrierStats*)malloc(sizeof(SSpindleBarrierStats));
+        if (NULL == stats)
+            return;
+
+        stats->counters = (SSpindleBarrierStatsCounter*)aligned_malloc(sizeof(SSpindleBarrierStatsCounter) * counterCount, sizeof(SSpindleBarrierStatsCounter));
+        stats->threadStats = (SSpindleBarrierThreadStats*)aligned_malloc(sizeof(SSpindleBarrierThreadStats) * threadStatsCount, sizeof(SSpindleBarrierStatsCounter));
+
+        if ((NULL == stats->counters) || (NULL == stats->threadStats))
+        {
+            aligned_free((void*)stats->threadStats);
+            aligned_free((void*)stats->counters);
+            free((void*)stats);
+            return;
+        }
+
+        region->barrierStats = stats;
+    }
+
+    // Local barriers use one counter per task for each label, and global barriers use one counter per label, which follow all the local counters.
+    stats->reportFunc = barrierStatsReportFunc;
+    stats->reportArg = barrierStatsReportArg;
+    stats->threadCount = region->threadCount;
+    stats->taskCount = region->taskCount;
+
+    memset((void*)stats->labels, 0, sizeof(stats->labels));
+    memset((void*)stats->counters, 0, sizeof(SSpindleBarrierStatsCounter) * counterCount);
+    memset((void*)stats->threadStats, 0, sizeof(SSpindleBarrierThreadStats) * threadStatsCount);
+}
+
+// --------
+
+void spindleReportBarrierStats(SSpindleRegion* region)
+{
+    SSpindleBarrierStats* const stats = region->barrierStats;
+    SSpindleBarrierThreadStats* labelThreadStats = NULL;
+    SSpindleBarrierGroupStats* taskStats = NULL;
+    SSpindleBarrierGroupStats* nodeStats = NULL;
+    uint32_t nodeCount = 0;
+
+    if (NULL == stats)
+        return;
+
+    // Tasks are placed in increasing order of NUMA node, so each NUMA node's threads are contiguous by global thread ID.
+    for (uint32_t threadIndex = 0; threadIndex < stats->threadCount; ++threadIndex)
+    {
+        if ((0 == threadIndex) || (region->threadAssignments[threadIndex].numaNode != region->threadAssignments[threadIndex - 1].numaNode))
+            nodeCount += 1;
+    }
+
+    labelThreadStats = (SSpindleBarrierThreadStats*)malloc(sizeof(SSpindleBarrierThreadStats) * stats->threadCount);
+    taskStats = (SSpindleBarrierGroupStats*)malloc(sizeof(SSpindleBarrierGroupStats) * stats->taskCount);
+    nodeStats = (SSpindleBarrierGroupStats*)malloc(sizeof(SSpindleBarrierGroupStats) * nodeCount);
+
+    if ((NULL != labelThreadStats) && (NULL != taskStats) && (NULL != nodeStats))
+    {
+        for (uint32_t scope = 0; scope < 2; ++scope)
+        {
+            for (uint32_t labelIndex = 0; (labelIndex < kSpindleBarrierStatsMaxLabelCount) && (NULL != stats->labels[scope][labelIndex]); ++labelIndex)
+            {
+                SSpindleBarrierStatsReport report;
+                uint32_t groupStart = 0;
+                uint32_t nodeIndex = 0;
+
+                // Gather the label's records from each thread's storage into an array indexed by global thread ID.
+                for (uint32_t threadIndex = 0; threadIndex < stats->threadCount; ++threadIndex)
+                    labelThreadStats[threadIndex] = stats->threadStats[(((size_t)threadIndex * 2) + scope) * kSpindleBarrierStatsMaxLabelCount + labelIndex];
+
+                // Summarize each task and each NUMA node, both of which are contiguous ranges of threads.
+                for (uint32_t threadIndex = 1; threadIndex <= stats->threadCount; ++threadIndex)
+                {
+                    if ((stats->threadCount == threadIndex) || (region->threadAssignments[threadIndex].taskID != region->threadAssignments[groupStart].taskID))
+                    {
+                        spindleHelperBarrierStatsSummarize(labelThreadStats, groupStart, threadIndex, region->threadAssignments[groupStart].taskID, &taskStats[region->threadAssignments[groupStart].taskID]);
+                        groupStart = threadIndex;
+                    }
+                }
+
+                groupStart = 0;
+
+                for (uint32_t threadIndex = 1; threadIndex <= stats->threadCount; ++threadIndex)
+                {
+                    if ((stats->threadCount == threadIndex) || (region->threadAssignments[threadIndex].numaNode != region->threadAssignments[groupStart].numaNode))
+                    {
+                        spindleHelperBarrierStatsSummarize(labelThreadStats, groupStart, threadIndex, region->threadAssignments[groupStart].numaNode, &nodeStats[nodeIndex]);
+                        groupStart = threadIndex;
+                        nodeIndex += 1;
+                    }
+                }
+
+                report.label = stats->labels[scope][labelIndex];
+                report.isGlobal = (0 != scope);
+                report.threadCount = stats->threadCount;
+                report.taskCount = stats->taskCount;
+                report.nodeCount = nodeCount;
+                report.threadStats = labelThreadStats;
+                report.taskStats = taskStats;
+                report.nodeStats = nodeStats;
+
+                stats->reportFunc(&report, stats->reportArg);
+            }
+        }
+    }
+
+    free((void*)labelThreadStats);
+    free((void*)taskStats);
+    free((void*)nodeStats);
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+uint32_t spindleSetBarrierStats(TSpindleBarrierStatsFunc reportFunc, void* arg)
+{
+    if (false != spindleIsInParallelRegion())
+        return __LINE__;
+
+    barrierStatsReportFunc = reportFunc;
+    barrierStatsReportArg = arg;
+    return 0;
+}
+
+// --------
+
+void spindleBarrierLocalLabeled(const char* label)
+{
+    spindleHelperBarrierLabeled(0, label);
+}
+
+// --------
+
+void spindleBarrierGlobalLabeled(const char* label)
+{
+    spindleHelperBarrierLabeled(1, label);
+}
@@ -0,0 +1,149 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file context.c
+ *   Implementation of per-thread context blocks.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "context.h"
+#include "memory.h"
+#include "region.h"
+#include "types.h"
+
+#include <hwloc.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <topo.h>
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Computes the number of bytes each thread's context block occupies for the specified number of slots.
+/// @param [in] slotCount Number of 64-bit slots.
+/// @return Size of the context block, in bytes, rounded up to the context block alignment.
+static inline size_t spindleHelperContextBlockSize(uint32_t slotCount)
+{
+    return (((size_t)slotCount * sizeof(uint64_t)) + (kSpindleContextBlockAlignment - 1)) & ~(size_t)(kSpindleContextBlockAlignment - 1);
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "context.h" for documentation.
+
+bool spindleAllocateContextBlocks(SSpindleRegion* region, SSpindleTaskConfig* taskSpec, uint32_t taskCount, SSpindleThreadInfo* threadAssignments, uint32_t threadCount)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+    if (NULL != region->contextTaskMemory)
+        return true;
+
+    if (NULL == topology)
+        return false;
+
+    region->contextTaskMemory = (void**)malloc(sizeof(void*) * taskCount);
+    region->contextTaskMemorySize = (size_t*)malloc(sizeof(size_t) * taskCount);
+    region->contextThreadBlock = (uint64_t**)malloc(sizeof(uint64_t*) * threadCount);
+    region->contextThreadSlotCount = (uint32_t*)malloc(sizeof(uint32_t) * threadCount);
+
+    if ((NULL == region->contextTaskMemory) || (NULL == region->contextTaskMemorySize) || (NULL == region->contextThreadBlock) || (NULL == region->contextThreadSlotCount))
+    {
+        free((void*)region->contextTaskMemory);
+        free((void*)region->contextTaskMemorySize);
+        free((void*)region->contextThreadBlock);
+        free((void*)region->contextThreadSlotCount);
+
+        region->contextTaskMemory = NULL;
+        region->contextTaskMemorySize = NULL;
+        region->contextThreadBlock = NULL;
+        region->contextThreadSlotCount = NULL;
+        return false;
+    }
+
+    memset((void*)region->contextTaskMemory, 0, sizeof(void*) * taskCount);
+    region->contextTaskCount = taskCount;
+
+    // The first thread of each task identifies the NUMA node and number of threads for the whole task.
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        const uint32_t taskID = threadAssignments[threadIndex].taskID;
+        const uint32_t slotCount = (0 == taskSpec[taskID].contextSlotCount) ? kSpindleContextDefaultSlotCount : taskSpec[taskID].contextSlotCount;
+        hwloc_obj_t numaNodeObject = NULL;
+
+        if (0 != threadAssignments[threadIndex].localThreadID)
+            continue;
+
+        numaNodeObject = topoGetNUMANodeObjectAtIndex(threadAssignments[threadIndex].numaNode);
+        if (NULL == numaNodeObject)
+        {
+            spindleFreeContextBlocks(region);
+            return false;
+        }
+
+        // Extra space allows the first block to be aligned even if the underlying allocation is not.
+        region->contextTaskMemorySize[taskID] = (spindleHelperContextBlockSize(slotCount) * threadAssignments[threadIndex].localThreadCount) + kSpindleContextBlockAlignment;
+        region->contextTaskMemory[taskID] = spindleAllocateOSMemory(topology, numaNodeObject, region->contextTaskMemorySize[taskID], SpindlePageSizeDefault);
+
+        if (NULL == region->contextTaskMemory[taskID])
+        {
+            spindleFreeContextBlocks(region);
+            return false;
+        }
+    }
+
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        const uint32_t taskID = threadAssignments[threadIndex].taskID;
+        const uint32_t slotCount = (0 == taskSpec[taskID].contextSlotCount) ? kSpindleContextDefaultSlotCount : taskSpec[taskID].contextSlotCount;
+
+        const uintptr_t firstBlock = ((uintptr_t)region->contextTaskMemory[taskID] + (kSpindleContextBlockAlignment - 1)) & ~(uintptr_t)(kSpindleContextBlockAlignment - 1);
+
+        region->contextThreadBlock[threadAssignments[threadIndex].globalThreadID] = (uint64_t*)(firstBlock + (spindleHelperContextBlockSize(slotCount) * threadAssignments[threadIndex].localThreadID));
+        region->contextThreadSlotCount[threadAssignments[threadIndex].globalThreadID] = slotCount;
+    }
+
+    return true;
+}
+
+// --------
+
+void spindleFreeContextBlocks(SSpindleRegion* region)
+{
+    if (NULL != region->contextTaskMemory)
+    {
+        hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+        for (uint32_t taskIndex = 0; taskIndex < region->contextTaskCount; ++taskIndex)
+        {
+            if (NULL != region->contextTaskMemory[taskIndex])
+                spindleFreeOSMemory(topology, region->contextTaskMemory[taskIndex], region->contextTaskMemorySize[taskIndex], SpindlePageSizeDefault);
+        }
+
+        free((void*)region->contextTaskMemory);
+        free((void*)region->contextTaskMemorySize);
+        free((void*)region->contextThreadBlock);
+        free((void*)region->contextThreadSlotCount);
+
+        region->contextTaskMemory = NULL;
+        region->contextTaskMemorySize = NULL;
+        region->contextThreadBlock = NULL;
+        region->contextThreadSlotCount = NULL;
+        region->contextTaskCount = 0;
+    }
+}
+
+// --------
+
+void spindleInitializeThreadContextBlock(SSpindleRegion* region, uint32_t globalThreadID)
+{
+    memset((void*)region->contextThreadBlock[globalThreadID], 0, sizeof(uint64_t) * region->contextThreadSlotCount[globalThreadID]);
+}
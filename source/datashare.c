@@ -13,53 +13,91 @@
 
 #include "../spindle.h"
 #include "align.h"
+#include "barrier.h"
 #include "datashare.h"
+#include "region.h"
+#include "trace.h"
 
+#include <hwloc.h>
 #include <malloc.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <topo.h>
 
 
-// -------- TYPE DEFINITIONS ----------------------------------------------- //
+// -------- HELPERS -------------------------------------------------------- //
 
-/// Represents the layout of storage space used to hold data to be shared between threads.
-/// A single 64-bit value is accompanied by padding, to align on a two-cache-line (128-byte) boundary.
-typedef struct SSpindleDataShareBuffer
+/// Makes the current global bulk broadcast available in memory local to the calling thread's NUMA node and retrieves its location.
+/// Exactly one thread per NUMA node, other than the sender's NUMA node, copies the sender's buffer into a replica on its NUMA node.
+/// All other threads on that NUMA node wait for the copy by means of a global barrier, so this function must be called by all threads.
+/// @param [in] region Calling thread's parallel region.
+/// @return Location of the data that the calling thread should read.
+static const void* spindleHelperDataShareReplicateGlobal(SSpindleRegion* region)
 {
-    uint64_t data;                                                          ///< Shared data value.
-    uint8_t padding[128 - sizeof(uint64_t)];                                ///< Unused, cache-line alignment padding.
-} SSpindleDataShareBuffer;
+    SSpindleDataShareBuffer* const shareBuffer = &region->dataShareBufferBase[spindleGetTaskCount()];
+    const uint32_t taskID = spindleGetTaskID();
+    SSpindleNodeBarrier* const nodeBarrier = (NULL == region->taskNodeBarrierTable ? NULL : region->taskNodeBarrierTable[taskID]);
+    const void* result = shareBuffer->bulkData;
 
+    // Only threads on a NUMA node other than the sender's benefit from a replica.
+    if ((NULL != nodeBarrier) && (region->nodeBarrierCount > 1) && (nodeBarrier != shareBuffer->bulkSenderNode))
+    {
+        if ((taskID == nodeBarrier->firstTaskID) && (0 == spindleGetLocalThreadID()))
+        {
+            if (nodeBarrier->replicaSize < shareBuffer->bulkSize)
+            {
+                hwloc_topology_t topology = topoGetSystemTopologyObject();
+                hwloc_obj_t numaNodeObject = topoGetNUMANodeObjectAtIndex(nodeBarrier->numaNode);
+
+                if (NULL != nodeBarrier->replica)
+                    hwloc_free(topology, nodeBarrier->replica, nodeBarrier->replicaSize);
 
-// -------- LOCALS --------------------------------------------------------- //
+                nodeBarrier->replica = (NULL == numaNodeObject ? NULL : hwloc_alloc_membind(topology, shareBuffer->bulkSize, numaNodeObject->cpuset, HWLOC_MEMBIND_BIND, 0));
+                nodeBarrier->replicaSize = (NULL == nodeBarrier->replica ? 0 : shareBuffer->bulkSize);
+            }
 
-/// Storage area for all data sharing buffers.
-/// The last position is to be used for the global data sharing buffer, others are for local sharing within each task.
-static SSpindleDataShareBuffer* spindleDataShareBufferBase;
+            if (NULL != nodeBarrier->replica)
+                memcpy(nodeBarrier->replica, shareBuffer->bulkData, shareBuffer->bulkSize);
+        }
+
+        // Wait for the copy to complete. If the replica could not be allocated, fall back to the sender's buffer.
+        spindleBarrierGlobal();
+
+        if (NULL != nodeBarrier->replica)
+            result = nodeBarrier->replica;
+    }
+    else
+    {
+        spindleBarrierGlobal();
+    }
+
+    return result;
+}
 
 
 // -------- FUNCTIONS ------------------------------------------------------ //
 // See "datashare.h" for documentation.
 
-void* spindleAllocateDataShareBuffers(uint32_t taskCount)
+void* spindleAllocateDataShareBuffers(SSpindleRegion* region, uint32_t taskCount)
 {
-    if (NULL == spindleDataShareBufferBase)
+    if (NULL == region->dataShareBufferBase)
     {
         // Create a single memory region with one data sharing buffer per task, plus one for the global data sharing buffer.
-        spindleDataShareBufferBase = (SSpindleDataShareBuffer*)aligned_malloc(sizeof(SSpindleDataShareBuffer) * (1 + taskCount), sizeof(SSpindleDataShareBuffer));
+        region->dataShareBufferBase = (SSpindleDataShareBuffer*)aligned_malloc(sizeof(SSpindleDataShareBuffer) * (1 + taskCount), sizeof(SSpindleDataShareBuffer));
     }
 
-    return spindleDataShareBufferBase;
+    return region->dataShareBufferBase;
 }
 
 // --------
 
-void spindleFreeDataShareBuffers(void)
+void spindleFreeDataShareBuffers(SSpindleRegion* region)
 {
-    if (NULL != spindleDataShareBufferBase)
+    if (NULL != region->dataShareBufferBase)
     {
-        aligned_free((void*)spindleDataShareBufferBase);
-        spindleDataShareBufferBase = NULL;
+        aligned_free((void*)region->dataShareBufferBase);
+        region->dataShareBufferBase = NULL;
     }
 }
 
@@ -69,30 +107,115 @@ void spindleFreeDataShareBuffers(void)
 
 void spindleDataShareSendLocal(uint64_t data)
 {
-    spindleDataShareBufferBase[spindleGetTaskID()].data = data;
+    spindleTraceRecord(kSpindleTracePhaseBegin, "spindleDataShareSendLocal");
+    spindleGetCurrentRegion()->dataShareBufferBase[spindleGetTaskID()].data = data;
     spindleBarrierLocal();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
 }
 
 // --------
 
 void spindleDataShareSendGlobal(uint64_t data)
 {
-    spindleDataShareBufferBase[spindleGetTaskCount()].data = data;
+    spindleTraceRecord(kSpindleTracePhaseBegin, "spindleDataShareSendGlobal");
+    spindleGetCurrentRegion()->dataShareBufferBase[spindleGetTaskCount()].data = data;
     spindleBarrierGlobal();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
 }
 
 // --------
 
 uint64_t spindleDataShareReceiveLocal(void)
 {
+    spindleTraceRecord(kSpindleTracePhaseBegin, "spindleDataShareReceiveLocal");
     spindleBarrierLocal();
-    return spindleDataShareBufferBase[spindleGetTaskID()].data;
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+    return spindleGetCurrentRegion()->dataShareBufferBase[spindleGetTaskID()].data;
 }
 
 // --------
 
 uint64_t spindleDataShareReceiveGlobal(void)
 {
+    spindleTraceRecord(kSpindleTracePhaseBegin, "spindleDataShareReceiveGlobal");
+    spindleBarrierGlobal();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+    return spindleGetCurrentRegion()->dataShareBufferBase[spindleGetTaskCount()].data;
+}
+
+// --------
+
+void spindleDataShareSendBufferLocal(const void* buffer, size_t size)
+{
+    SSpindleDataShareBuffer* const shareBuffer = &spindleGetCurrentRegion()->dataShareBufferBase[spindleGetTaskID()];
+
+    spindleTraceRecord(kSpindleTracePhaseBegin, "spindleDataShareSendBufferLocal");
+
+    shareBuffer->bulkData = buffer;
+    shareBuffer->bulkSize = size;
+
+    // All threads in a task run on the same NUMA node, so receivers copy directly from the sender's buffer.
+    // The second barrier keeps the sender's buffer valid until every receiver has finished copying it.
+    spindleBarrierLocal();
+    spindleBarrierLocal();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+}
+
+// --------
+
+void spindleDataShareSendBufferGlobal(const void* buffer, size_t size)
+{
+    SSpindleRegion* const region = spindleGetCurrentRegion();
+    SSpindleDataShareBuffer* const shareBuffer = &region->dataShareBufferBase[spindleGetTaskCount()];
+
+    spindleTraceRecord(kSpindleTracePhaseBegin, "spindleDataShareSendBufferGlobal");
+
+    shareBuffer->bulkData = buffer;
+    shareBuffer->bulkSize = size;
+    shareBuffer->bulkSenderNode = (NULL == region->taskNodeBarrierTable ? NULL : region->taskNodeBarrierTable[spindleGetTaskID()]);
+
+    // The sender's buffer must remain valid until every NUMA node's replica has been made and every receiver has finished copying.
+    spindleBarrierGlobal();
+    spindleHelperDataShareReplicateGlobal(region);
+    spindleBarrierGlobal();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+}
+
+// --------
+
+size_t spindleDataShareReceiveBufferLocal(void* buffer, size_t size)
+{
+    SSpindleDataShareBuffer* const shareBuffer = &spindleGetCurrentRegion()->dataShareBufferBase[spindleGetTaskID()];
+    size_t bulkSize;
+
+    spindleTraceRecord(kSpindleTracePhaseBegin, "spindleDataShareReceiveBufferLocal");
+    spindleBarrierLocal();
+
+    bulkSize = shareBuffer->bulkSize;
+    memcpy(buffer, shareBuffer->bulkData, (size < bulkSize ? size : bulkSize));
+
+    spindleBarrierLocal();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+    return bulkSize;
+}
+
+// --------
+
+size_t spindleDataShareReceiveBufferGlobal(void* buffer, size_t size)
+{
+    SSpindleRegion* const region = spindleGetCurrentRegion();
+    SSpindleDataShareBuffer* const shareBuffer = &region->dataShareBufferBase[spindleGetTaskCount()];
+    const void* bulkData;
+    size_t bulkSize;
+
+    spindleTraceRecord(kSpindleTracePhaseBegin, "spindleDataShareReceiveBufferGlobal");
+    spindleBarrierGlobal();
+
+    bulkData = spindleHelperDataShareReplicateGlobal(region);
+    bulkSize = shareBuffer->bulkSize;
+    memcpy(buffer, bulkData, (size < bulkSize ? size : bulkSize));
+
     spindleBarrierGlobal();
-    return spindleDataShareBufferBase[spindleGetTaskCount()].data;
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+    return bulkSize;
 }
@@ -40,12 +40,35 @@ spindleSetThreadCounts                      ENDP
 
 ; ---------
 
+spindleSetThreadRegion                      PROC PUBLIC
+    vextractf128            xmm0,                   ymm_threadinfo,         1
+    vpinsrw                 xmm0,                   xmm0,                   e_param1,               3           ; Index of the parallel region in the region table
+    vinsertf128             ymm_threadinfo,         ymm_threadinfo,         xmm0,                   1
+    ret
+spindleSetThreadRegion                      ENDP
+
+; ---------
+
 spindleInitializeLocalVariable              PROC PUBLIC
     xor                     rax,                    rax
     spindleAsmHelperSetLocalVariable                rax
     ret
 spindleInitializeLocalVariable              ENDP
 
+; ---------
+
+spindleSaveThreadInfo                       PROC PUBLIC
+    vmovdqu                 YMMWORD PTR [r_param1], ymm_threadinfo
+    ret
+spindleSaveThreadInfo                       ENDP
+
+; ---------
+
+spindleRestoreThreadInfo                    PROC PUBLIC
+    vmovdqu                 ymm_threadinfo,         YMMWORD PTR [r_param1]
+    ret
+spindleRestoreThreadInfo                    ENDP
+
 
 _TEXT                                       ENDS
 
@@ -0,0 +1,396 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file loop.c
+ *   Implementation of parallel loop scheduling across threads.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "loop.h"
+#include "reduce.h"
+#include "region.h"
+#include "types.h"
+
+#include <hwloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <topo.h>
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Allocates a single loop share in memory local to the specified NUMA node.
+/// @param [in] topology System topology object from `hwloc`.
+/// @param [in] numaNode Zero-based index of the NUMA node.
+/// @return Pointer to the newly-allocated and zeroed loop share, or `NULL` on failure.
+static SSpindleLoopShare* spindleHelperLoopAllocateShare(hwloc_topology_t topology, uint32_t numaNode)
+{
+    hwloc_obj_t numaNodeObject = topoGetNUMANodeObjectAtIndex(numaNode);
+    SSpindleLoopShare* share = NULL;
+
+    if (NULL == numaNodeObject)
+        return NULL;
+
+    share = (SSpindleLoopShare*)hwloc_alloc_membind(topology, sizeof(SSpindleLoopShare), numaNodeObject->cpuset, HWLOC_MEMBIND_BIND, 0);
+    if (NULL == share)
+        return NULL;
+
+    memset((void*)share, 0, sizeof(SSpindleLoopShare));
+    share->numaNode = numaNode;
+
+    return share;
+}
+
+// --------
+
+/// Computes the offset of the first iteration of a contiguous block, when iterations are divided into nearly-equal blocks among a set of threads.
+/// The first `iterationCount % threadCount` threads each receive one more iteration than the rest.
+/// @param [in] iterationCount Total number of iterations.
+/// @param [in] threadCount Total number of threads.
+/// @param [in] threadIndex Index of the thread whose block is desired. Passing the number of threads yields the total number of iterations.
+/// @return Offset of the first iteration in the block, relative to the start of the loop.
+static inline uint64_t spindleHelperLoopBlockOffset(uint64_t iterationCount, uint32_t threadCount, uint32_t threadIndex)
+{
+    const uint64_t quotient = iterationCount / threadCount;
+    const uint64_t remainder = iterationCount % threadCount;
+
+    return (quotient * threadIndex) + ((threadIndex < remainder) ? threadIndex : remainder);
+}
+
+// --------
+
+/// Executes the chunks of a loop assigned to the calling thread by a static schedule.
+/// @param [in] begin First iteration of the loop.
+/// @param [in] iterationCount Number of iterations in the loop, which must be nonzero.
+/// @param [in] threadIndex Calling thread's index among the participating threads.
+/// @param [in] threadCount Number of participating threads.
+/// @param [in] chunkSize Number of iterations per chunk, or 0 to assign one contiguous block per thread.
+/// @param [in] func Loop body.
+/// @param [in] arg Argument to pass to the loop body.
+static void spindleHelperLoopStatic(int64_t begin, uint64_t iterationCount, uint32_t threadIndex, uint32_t threadCount, uint64_t chunkSize, TSpindleLoopFunc func, void* arg)
+{
+    uint64_t start;
+
+    if (0 == chunkSize)
+    {
+        const uint64_t blockStart = spindleHelperLoopBlockOffset(iterationCount, threadCount, threadIndex);
+        const uint64_t blockEnd = spindleHelperLoopBlockOffset(iterationCount, threadCount, threadIndex + 1);
+
+        if (blockStart < blockEnd)
+            func(arg, (int64_t)((uint64_t)begin + blockStart), (int64_t)((uint64_t)begin + blockEnd));
+
+        return;
+    }
+
+    // Chunks are assigned round-robin, so the calling thread's first chunk is the one whose index matches its own.
+    // All arithmetic is arranged so that it cannot overflow, even for loops that span nearly the entire 64-bit range.
+    if (threadIndex > ((iterationCount - 1) / chunkSize))
+        return;
+
+    start = (uint64_t)threadIndex * chunkSize;
+
+    while (true)
+    {
+        const uint64_t remaining = iterationCount - start;
+        const uint64_t count = (remaining < chunkSize) ? remaining : chunkSize;
+
+        func(arg, (int64_t)((uint64_t)begin + start), (int64_t)((uint64_t)begin + (start + count)));
+
+        if (((remaining - 1) / chunkSize) < threadCount)
+            break;
+
+        start += (uint64_t)threadCount * chunkSize;
+    }
+}
+
+// --------
+
+/// Claims and executes chunks of a single loop share according to a dynamic schedule, until the share is exhausted.
+/// @param [in] share Loop share from which to claim chunks.
+/// @param [in] shareBegin First iteration of the share.
+/// @param [in] shareSize Number of iterations in the share.
+/// @param [in] chunkSize Number of iterations per chunk, which must be nonzero.
+/// @param [in] func Loop body.
+/// @param [in] arg Argument to pass to the loop body.
+static void spindleHelperLoopClaimDynamic(SSpindleLoopShare* share, int64_t shareBegin, uint64_t shareSize, uint64_t chunkSize, TSpindleLoopFunc func, void* arg)
+{
+    // Checking before claiming keeps threads that visit an exhausted share from writing to its cache line.
+    while (atomic_load64(&share->next) < shareSize)
+    {
+        const uint64_t start = atomic_fetch_add64(&share->next, chunkSize);
+        uint64_t count;
+
+        if (start >= shareSize)
+            break;
+
+        count = shareSize - start;
+        if (count > chunkSize)
+            count = chunkSize;
+
+        func(arg, (int64_t)((uint64_t)shareBegin + start), (int64_t)((uint64_t)shareBegin + (start + count)));
+    }
+}
+
+// --------
+
+/// Claims and executes chunks of a single loop share according to a guided schedule, until the share is exhausted.
+/// @param [in] share Loop share from which to claim chunks.
+/// @param [in] shareBegin First iteration of the share.
+/// @param [in] shareSize Number of iterations in the share.
+/// @param [in] chunkSize Minimum number of iterations per chunk, which must be nonzero.
+/// @param [in] func Loop body.
+/// @param [in] arg Argument to pass to the loop body.
+static void spindleHelperLoopClaimGuided(SSpindleLoopShare* share, int64_t shareBegin, uint64_t shareSize, uint64_t chunkSize, TSpindleLoopFunc func, void* arg)
+{
+    while (true)
+    {
+        const uint64_t start = atomic_load64(&share->next);
+        uint64_t count;
+
+        if (start >= shareSize)
+            break;
+
+        // Each chunk is an equal division of the remaining iterations among the share's threads, but never smaller than the minimum.
+        count = (shareSize - start) / share->threadCount;
+        if (count < chunkSize)
+            count = chunkSize;
+        if (count > (shareSize - start))
+            count = shareSize - start;
+
+        if (atomic_cas64(&share->next, start, start + count))
+            func(arg, (int64_t)((uint64_t)shareBegin + start), (int64_t)((uint64_t)shareBegin + (start + count)));
+    }
+}
+
+// --------
+
+/// Executes the chunks of a loop claimed by the calling thread, across any number of loop shares.
+/// The iterations are divided among the shares in proportion to their thread counts, and the calling thread first exhausts its own share before moving on to the others in order.
+/// @param [in] shares Loop shares, as an array.
+/// @param [in] shareCount Number of loop shares.
+/// @param [in] homeShareIndex Index of the loop share local to the calling thread.
+/// @param [in] threadIndex Calling thread's index among the participating threads.
+/// @param [in] threadCount Number of participating threads.
+/// @param [in] begin First iteration of the loop.
+/// @param [in] end One past the last iteration of the loop.
+/// @param [in] schedule Loop schedule.
+/// @param [in] chunkSize Number of iterations per chunk, interpreted according to the schedule.
+/// @param [in] func Loop body.
+/// @param [in] arg Argument to pass to the loop body.
+static void spindleHelperLoopExecute(SSpindleLoopShare** shares, uint32_t shareCount, uint32_t homeShareIndex, uint32_t threadIndex, uint32_t threadCount, int64_t begin, int64_t end, ESpindleLoopSchedule schedule, uint64_t chunkSize, TSpindleLoopFunc func, void* arg)
+{
+    uint64_t iterationCount;
+
+    if (end <= begin)
+        return;
+
+    iterationCount = (uint64_t)end - (uint64_t)begin;
+
+    if (SpindleLoopScheduleStatic == schedule)
+    {
+        spindleHelperLoopStatic(begin, iterationCount, threadIndex, threadCount, chunkSize, func, arg);
+        return;
+    }
+
+    // Limiting the chunk size to the loop size keeps the shared counters from overflowing.
+    if (0 == chunkSize)
+        chunkSize = 1;
+    else if (chunkSize > iterationCount)
+        chunkSize = iterationCount;
+
+    for (uint32_t i = 0; i < shareCount; ++i)
+    {
+        SSpindleLoopShare* const share = shares[(homeShareIndex + i) % shareCount];
+        const uint64_t shareStart = spindleHelperLoopBlockOffset(iterationCount, threadCount, share->threadBase);
+        const uint64_t shareEnd = spindleHelperLoopBlockOffset(iterationCount, threadCount, share->threadBase + share->threadCount);
+
+        if (SpindleLoopScheduleGuided == schedule)
+            spindleHelperLoopClaimGuided(share, (int64_t)((uint64_t)begin + shareStart), shareEnd - shareStart, chunkSize, func, arg);
+        else
+            spindleHelperLoopClaimDynamic(share, (int64_t)((uint64_t)begin + shareStart), shareEnd - shareStart, chunkSize, func, arg);
+    }
+}
+
+// --------
+
+/// Resets the counters of all per-node loop shares.
+/// Invoked by the last thread to reach the barrier at the end of a global parallel loop.
+/// @param [in] arg Parallel region whose per-node loop shares are to be reset.
+static void spindleHelperLoopResetNodeShares(void* arg)
+{
+    SSpindleRegion* const region = (SSpindleRegion*)arg;
+
+    for (uint32_t nodeIndex = 0; nodeIndex < region->loopNodeCount; ++nodeIndex)
+        region->loopNodeShareTable[nodeIndex]->next = 0;
+}
+
+// --------
+
+/// Resets the counter of a single loop share.
+/// Invoked by the last thread to reach the barrier at the end of a local parallel loop.
+/// @param [in] arg Loop share to reset.
+static void spindleHelperLoopResetShare(void* arg)
+{
+    ((SSpindleLoopShare*)arg)->next = 0;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "loop.h" for documentation.
+
+void* spindleAllocateLoopShares(SSpindleRegion* region, SSpindleThreadInfo* threadAssignments, uint32_t threadCount, uint32_t taskCount)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+    uint32_t nextThreadBase = 0;
+
+    if (NULL != region->loopTaskShareTable)
+        return region->loopTaskShareTable;
+
+    if ((NULL == topology) || (NULL == region->nodeBarrierTable))
+        return NULL;
+
+    region->loopTaskShareTable = (SSpindleLoopShare**)malloc(sizeof(SSpindleLoopShare*) * taskCount);
+    region->loopNodeShareTable = (SSpindleLoopShare**)malloc(sizeof(SSpindleLoopShare*) * region->nodeBarrierCount);
+    region->loopTaskNodeIndex = (uint32_t*)malloc(sizeof(uint32_t) * taskCount);
+
+    if ((NULL == region->loopTaskShareTable) || (NULL == region->loopNodeShareTable) || (NULL == region->loopTaskNodeIndex))
+    {
+        free((void*)region->loopTaskShareTable);
+        free((void*)region->loopNodeShareTable);
+        free((void*)region->loopTaskNodeIndex);
+
+        region->loopTaskShareTable = NULL;
+        region->loopNodeShareTable = NULL;
+        region->loopTaskNodeIndex = NULL;
+        return NULL;
+    }
+
+    memset((void*)region->loopTaskShareTable, 0, sizeof(SSpindleLoopShare*) * taskCount);
+    memset((void*)region->loopNodeShareTable, 0, sizeof(SSpindleLoopShare*) * region->nodeBarrierCount);
+    region->loopTaskCount = taskCount;
+    region->loopNodeCount = region->nodeBarrierCount;
+
+    // Each NUMA node receives a share of global loops proportional to the number of threads it holds.
+    for (uint32_t nodeIndex = 0; nodeIndex < region->loopNodeCount; ++nodeIndex)
+    {
+        SSpindleLoopShare* share = spindleHelperLoopAllocateShare(topology, region->nodeBarrierTable[nodeIndex]->numaNode);
+        if (NULL == share)
+        {
+            spindleFreeLoopShares(region);
+            return NULL;
+        }
+
+        share->threadBase = nextThreadBase;
+        share->threadCount = region->nodeBarrierTable[nodeIndex]->threadCount;
+        nextThreadBase += share->threadCount;
+
+        region->loopNodeShareTable[nodeIndex] = share;
+    }
+
+    // The first thread of each task identifies the NUMA node and number of threads for the whole task.
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        const uint32_t taskID = threadAssignments[threadIndex].taskID;
+        SSpindleLoopShare* share = NULL;
+
+        if (0 != threadAssignments[threadIndex].localThreadID)
+            continue;
+
+        share = spindleHelperLoopAllocateShare(topology, threadAssignments[threadIndex].numaNode);
+        if (NULL == share)
+        {
+            spindleFreeLoopShares(region);
+            return NULL;
+        }
+
+        share->threadBase = 0;
+        share->threadCount = threadAssignments[threadIndex].localThreadCount;
+        region->loopTaskShareTable[taskID] = share;
+
+        for (uint32_t nodeIndex = 0; nodeIndex < region->loopNodeCount; ++nodeIndex)
+        {
+            if (region->taskNodeBarrierTable[taskID] == region->nodeBarrierTable[nodeIndex])
+            {
+                region->loopTaskNodeIndex[taskID] = nodeIndex;
+                break;
+            }
+        }
+    }
+
+    return region->loopTaskShareTable;
+}
+
+// --------
+
+void spindleFreeLoopShares(SSpindleRegion* region)
+{
+    if (NULL != region->loopTaskShareTable)
+    {
+        hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+        for (uint32_t taskIndex = 0; taskIndex < region->loopTaskCount; ++taskIndex)
+        {
+            if (NULL != region->loopTaskShareTable[taskIndex])
+                hwloc_free(topology, (void*)region->loopTaskShareTable[taskIndex], sizeof(SSpindleLoopShare));
+        }
+
+        for (uint32_t nodeIndex = 0; nodeIndex < region->loopNodeCount; ++nodeIndex)
+        {
+            if (NULL != region->loopNodeShareTable[nodeIndex])
+                hwloc_free(topology, (void*)region->loopNodeShareTable[nodeIndex], sizeof(SSpindleLoopShare));
+        }
+
+        free((void*)region->loopTaskShareTable);
+        free((void*)region->loopNodeShareTable);
+        free((void*)region->loopTaskNodeIndex);
+
+        region->loopTaskShareTable = NULL;
+        region->loopNodeShareTable = NULL;
+        region->loopTaskNodeIndex = NULL;
+        region->loopTaskCount = 0;
+        region->loopNodeCount = 0;
+    }
+}
+
+// --------
+
+void spindleInitializeLoopShares(SSpindleRegion* region)
+{
+    for (uint32_t taskIndex = 0; taskIndex < region->loopTaskCount; ++taskIndex)
+        region->loopTaskShareTable[taskIndex]->next = 0;
+
+    for (uint32_t nodeIndex = 0; nodeIndex < region->loopNodeCount; ++nodeIndex)
+        region->loopNodeShareTable[nodeIndex]->next = 0;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+void spindleParallelForLocal(int64_t begin, int64_t end, ESpindleLoopSchedule schedule, uint64_t chunkSize, TSpindleLoopFunc func, void* arg)
+{
+    SSpindleRegion* const region = spindleGetCurrentRegion();
+    const uint32_t taskID = spindleGetTaskID();
+
+    spindleHelperLoopExecute(&region->loopTaskShareTable[taskID], 1, 0, spindleGetLocalThreadID(), spindleGetLocalThreadCount(), begin, end, schedule, chunkSize, func, arg);
+    spindleCollectiveBarrierLocal(&spindleHelperLoopResetShare, (void*)region->loopTaskShareTable[taskID]);
+}
+
+// --------
+
+void spindleParallelForGlobal(int64_t begin, int64_t end, ESpindleLoopSchedule schedule, uint64_t chunkSize, TSpindleLoopFunc func, void* arg)
+{
+    SSpindleRegion* const region = spindleGetCurrentRegion();
+
+    spindleHelperLoopExecute(region->loopNodeShareTable, region->loopNodeCount, region->loopTaskNodeIndex[spindleGetTaskID()], spindleGetGlobalThreadID(), spindleGetGlobalThreadCount(), begin, end, schedule, chunkSize, func, arg);
+    spindleCollectiveBarrierGlobal(&spindleHelperLoopResetNodeShares, (void*)region);
+}
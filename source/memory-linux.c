@@ -0,0 +1,105 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file memory-linux.c
+ *   Implementation of functions for allocating NUMA-aware memory.
+ *   This file contains Linux-specific functions.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "memory.h"
+
+#include <hwloc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+
+// -------- INTERNAL FUNCTIONS --------------------------------------------- //
+
+/// Rounds the specified size up to a whole number of large pages.
+/// @param [in] size Size, in bytes.
+/// @return Rounded size, in bytes.
+static inline size_t spindleInternalLargePageRoundUp(size_t size)
+{
+    return (size + (kSpindleMemoryLargePageSize - 1)) & ~(size_t)(kSpindleMemoryLargePageSize - 1);
+}
+
+/// Maps anonymous memory that is aligned to a large page boundary and advises the kernel to back it with transparent huge pages.
+/// @param [in] mappedSize Size, in bytes, which must be a multiple of the large page size.
+/// @return Pointer to the mapped memory on success, or `NULL` on failure.
+static void* spindleInternalMapTransparentLargePages(size_t mappedSize)
+{
+    const size_t paddedSize = mappedSize + kSpindleMemoryLargePageSize;
+    uint8_t* base = (uint8_t*)mmap(NULL, paddedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    uint8_t* aligned;
+
+    if (MAP_FAILED == (void*)base)
+        return NULL;
+
+    // Trim the excess on either side so that what remains starts on a large page boundary.
+    aligned = (uint8_t*)(((uintptr_t)base + (kSpindleMemoryLargePageSize - 1)) & ~(uintptr_t)(kSpindleMemoryLargePageSize - 1));
+
+    if (aligned > base)
+        munmap((void*)base, (size_t)(aligned - base));
+
+    if ((base + paddedSize) > (aligned + mappedSize))
+        munmap((void*)(aligned + mappedSize), (size_t)((base + paddedSize) - (aligned + mappedSize)));
+
+    madvise((void*)aligned, mappedSize, MADV_HUGEPAGE);
+    return (void*)aligned;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "memory.h" for documentation.
+
+void* spindleAllocateOSMemory(hwloc_topology_t topology, hwloc_obj_t numaNodeObject, size_t size, ESpindlePageSize pageSize)
+{
+    size_t mappedSize = spindleInternalLargePageRoundUp(size);
+    void* mapped = NULL;
+
+    switch (pageSize)
+    {
+    case SpindlePageSizeLargePreferred:
+        mapped = spindleInternalMapTransparentLargePages(mappedSize);
+        break;
+
+    case SpindlePageSizeLargeRequired:
+        mapped = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (MAP_FAILED == mapped)
+            mapped = NULL;
+        break;
+
+    default:
+        return hwloc_alloc_membind(topology, size, numaNodeObject->cpuset, HWLOC_MEMBIND_BIND, 0);
+    }
+
+    if (NULL == mapped)
+        return NULL;
+
+    // Binding before first touch ensures that the pages are never placed anywhere else.
+    if (0 != hwloc_set_area_membind(topology, mapped, mappedSize, numaNodeObject->cpuset, HWLOC_MEMBIND_BIND, 0))
+    {
+        munmap(mapped, mappedSize);
+        return NULL;
+    }
+
+    return mapped;
+}
+
+// --------
+
+void spindleFreeOSMemory(hwloc_topology_t topology, void* ptr, size_t size, ESpindlePageSize pageSize)
+{
+    if (SpindlePageSizeDefault == pageSize)
+        hwloc_free(topology, ptr, size);
+    else
+        munmap(ptr, spindleInternalLargePageRoundUp(size));
+}
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file memory-windows.c
+ *   Implementation of functions for allocating NUMA-aware memory.
+ *   This file contains Windows-specific functions.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "memory.h"
+
+#include <hwloc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <windows.h>
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "memory.h" for documentation.
+
+void* spindleAllocateOSMemory(hwloc_topology_t topology, hwloc_obj_t numaNodeObject, size_t size, ESpindlePageSize pageSize)
+{
+    if (SpindlePageSizeDefault != pageSize)
+    {
+        const SIZE_T largePageMinimum = GetLargePageMinimum();
+
+        // Large pages require the "Lock pages in memory" privilege, so they are not always available.
+        if (0 != largePageMinimum)
+        {
+            const SIZE_T roundedSize = (size + (largePageMinimum - 1)) & ~(largePageMinimum - 1);
+            void* mapped = VirtualAllocExNuma(GetCurrentProcess(), NULL, roundedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, (DWORD)numaNodeObject->os_index);
+
+            if (NULL != mapped)
+                return mapped;
+        }
+
+        if (SpindlePageSizeLargeRequired == pageSize)
+            return NULL;
+    }
+
+    return hwloc_alloc_membind(topology, size, numaNodeObject->cpuset, HWLOC_MEMBIND_BIND, 0);
+}
+
+// --------
+
+void spindleFreeOSMemory(hwloc_topology_t topology, void* ptr, size_t size, ESpindlePageSize pageSize)
+{
+    // Both large page allocations and those made by hwloc on Windows are released the same way, so a request for large pages that fell back to default pages is also handled correctly.
+    if (SpindlePageSizeDefault == pageSize)
+        hwloc_free(topology, ptr, size);
+    else
+        VirtualFree(ptr, 0, MEM_RELEASE);
+}
@@ -0,0 +1,155 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file memory.c
+ *   Implementation of NUMA-aware memory allocation tied to task placement.
+ *   This file contains platform-independent functions.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "barrier.h"
+#include "memory.h"
+#include "plan.h"
+#include "region.h"
+#include "types.h"
+
+#include <hwloc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <topo.h>
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+void* spindleMemoryAllocateOnNode(uint32_t numaNode, size_t size, ESpindlePageSize pageSize)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+    hwloc_obj_t numaNodeObject = NULL;
+
+    if ((NULL == topology) || (0 == size) || (pageSize > SpindlePageSizeLargeRequired))
+        return NULL;
+
+    numaNodeObject = topoGetNUMANodeObjectAtIndex(numaNode);
+    if (NULL == numaNodeObject)
+        return NULL;
+
+    return spindleAllocateOSMemory(topology, numaNodeObject, size, pageSize);
+}
+
+// --------
+
+void* spindleMemoryAllocateForTask(uint32_t taskID, size_t size, ESpindlePageSize pageSize)
+{
+    SSpindleRegion* region = NULL;
+
+    // Each task's NUMA node is recorded alongside the first-level global barrier for that node, which exists only while a region does.
+    if (!spindleIsInParallelRegion() || (taskID >= spindleGetTaskCount()))
+        return NULL;
+
+    region = spindleGetCurrentRegion();
+    if (NULL == region->taskNodeBarrierTable)
+        return NULL;
+
+    return spindleMemoryAllocateOnNode(region->taskNodeBarrierTable[taskID]->numaNode, size, pageSize);
+}
+
+// --------
+
+void* spindleMemoryAllocateLocal(size_t size, ESpindlePageSize pageSize)
+{
+    return spindleMemoryAllocateForTask(spindleGetTaskID(), size, pageSize);
+}
+
+// --------
+
+uint32_t spindleMemoryAllocatePartitions(SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, size_t partitionSize, ESpindlePageSize pageSize, void*** partitions, uint32_t* partitionCount)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+    SSpindleTaskConfig* resolvedTaskSpec = NULL;
+    SSpindleTaskConfig* expandedTaskSpec = NULL;
+    uint32_t* taskSpecIndex = NULL;
+    uint32_t expandedTaskCount = 0;
+    void** taskPartitions = NULL;
+
+    if ((NULL == partitions) || (NULL == partitionCount))
+        return __LINE__;
+
+    *partitions = NULL;
+    *partitionCount = 0;
+
+    if ((NULL == topology) || (0 == taskCount))
+        return __LINE__;
+
+    // Expand the task specifications exactly as spawning threads would, so that there is one partition per task, in order of task ID.
+    if (0 != spindlePlanResolveTaskSpecs(taskSpec, taskOptions, taskCount, &resolvedTaskSpec, NULL))
+        return __LINE__;
+
+    if (0 != spindlePlanExpandTaskSpecs(topology, resolvedTaskSpec, taskCount, NULL, &expandedTaskSpec, &taskSpecIndex, &expandedTaskCount, NULL))
+    {
+        free((void*)resolvedTaskSpec);
+        return __LINE__;
+    }
+
+    taskPartitions = (void**)malloc(sizeof(void*) * expandedTaskCount);
+    if (NULL == taskPartitions)
+    {
+        spindlePlanFreeExpandedTaskSpecs(resolvedTaskSpec, expandedTaskSpec, taskSpecIndex);
+        free((void*)resolvedTaskSpec);
+        return __LINE__;
+    }
+
+    memset((void*)taskPartitions, 0, sizeof(void*) * expandedTaskCount);
+
+    for (uint32_t taskIndex = 0; taskIndex < expandedTaskCount; ++taskIndex)
+    {
+        taskPartitions[taskIndex] = spindleMemoryAllocateOnNode(expandedTaskSpec[taskIndex].numaNode, partitionSize, pageSize);
+        if (NULL == taskPartitions[taskIndex])
+        {
+            spindleMemoryFreePartitions(taskPartitions, expandedTaskCount, partitionSize, pageSize);
+            spindlePlanFreeExpandedTaskSpecs(resolvedTaskSpec, expandedTaskSpec, taskSpecIndex);
+            free((void*)resolvedTaskSpec);
+            return __LINE__;
+        }
+    }
+
+    spindlePlanFreeExpandedTaskSpecs(resolvedTaskSpec, expandedTaskSpec, taskSpecIndex);
+    free((void*)resolvedTaskSpec);
+
+    *partitions = taskPartitions;
+    *partitionCount = expandedTaskCount;
+    return 0;
+}
+
+// --------
+
+void spindleMemoryFree(void* ptr, size_t size, ESpindlePageSize pageSize)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+    if ((NULL == ptr) || (NULL == topology))
+        return;
+
+    spindleFreeOSMemory(topology, ptr, size, pageSize);
+}
+
+// --------
+
+void spindleMemoryFreePartitions(void** partitions, uint32_t partitionCount, size_t partitionSize, ESpindlePageSize pageSize)
+{
+    if (NULL == partitions)
+        return;
+
+    for (uint32_t taskIndex = 0; taskIndex < partitionCount; ++taskIndex)
+        spindleMemoryFree(partitions[taskIndex], partitionSize, pageSize);
+
+    free((void*)partitions);
+}
@@ -13,11 +13,16 @@
  *****************************************************************************/
 
 #include "osthread.h"
+#include "pool.h"
 #include "types.h"
 
 #include <hwloc.h>
+#include <linux/futex.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
 
 
 // -------- INTERNAL FUNCTIONS --------------------------------------------- //
@@ -32,6 +37,16 @@ static void* spindleInternalThreadStartFuncLinux(void* arg)
     return NULL;
 }
 
+/// Internal thread start function for Linux thread pool workers.
+/// Passes control to the platform-independent worker loop, which returns only when the pool is being destroyed.
+/// @param [arg] Pool worker control structure, cast as a typeless pointer.
+/// @return `NULL` upon termination of the worker.
+static void* spindleInternalPoolThreadStartFuncLinux(void* arg)
+{
+    spindlePoolWorkerMain((SSpindlePoolWorker*)arg);
+    return NULL;
+}
+
 
 // -------- FUNCTIONS ------------------------------------------------------ //
 // See "osthread.h" for documentation.
@@ -48,6 +63,28 @@ hwloc_thread_t spindleCreateOSThread(SSpindleThreadInfo* threadSpec)
 
 // --------
 
+hwloc_thread_t spindleCreatePoolOSThread(SSpindlePoolWorker* worker)
+{
+    pthread_t threadHandle;
+    
+    if (0 != pthread_create(&threadHandle, NULL, &spindleInternalPoolThreadStartFuncLinux, (void*)worker))
+        return (hwloc_thread_t)NULL;
+    
+    return threadHandle;
+}
+
+// --------
+
+uint64_t spindleGetOSTimeNanoseconds(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec;
+}
+
+// --------
+
 hwloc_thread_t spindleIdentifyCurrentOSThread(void)
 {
     return (hwloc_thread_t)pthread_self();
@@ -55,6 +92,16 @@ hwloc_thread_t spindleIdentifyCurrentOSThread(void)
 
 // --------
 
+uint32_t spindleJoinPoolOSThread(SSpindlePoolWorker* worker)
+{
+    if (0 != pthread_join((pthread_t)worker->threadHandle, NULL))
+        return __LINE__;
+    
+    return 0;
+}
+
+// --------
+
 uint32_t spindleJoinThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCount)
 {
     for (uint32_t i = 0; i < threadCount; ++i)
@@ -73,3 +120,54 @@ uint32_t spindleStartCurrentThread(SSpindleThreadInfo* threadSpec)
     spindleInternalThreadStartFuncLinux((void*)threadSpec);
     return 0;
 }
+
+// --------
+
+void spindleWaitOnAddress(volatile uint32_t* address, uint32_t expectedValue)
+{
+    syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expectedValue, NULL, NULL, 0);
+}
+
+// --------
+
+void spindleWaitOnAddressTimeout(volatile uint32_t* address, uint32_t expectedValue, uint32_t timeoutMilliseconds)
+{
+    struct timespec deadline;
+    
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += (time_t)(timeoutMilliseconds / 1000);
+    deadline.tv_nsec += (long)(timeoutMilliseconds % 1000) * 1000000l;
+    if (deadline.tv_nsec >= 1000000000l)
+    {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000l;
+    }
+    
+    // The futex timeout is relative, so recompute it after each spurious wakeup.
+    while (expectedValue == *address)
+    {
+        struct timespec now;
+        struct timespec remaining;
+        
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+        remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if (remaining.tv_nsec < 0)
+        {
+            remaining.tv_sec -= 1;
+            remaining.tv_nsec += 1000000000l;
+        }
+        
+        if (remaining.tv_sec < 0)
+            break;
+        
+        syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expectedValue, &remaining, NULL, 0);
+    }
+}
+
+// --------
+
+void spindleWakeAddress(volatile uint32_t* address)
+{
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+}
@@ -13,6 +13,7 @@
  *****************************************************************************/
 
 #include "osthread.h"
+#include "pool.h"
 #include "types.h"
 
 #include <hwloc.h>
@@ -20,6 +21,8 @@
 #include <stdint.h>
 #include <windows.h>
 
+#pragma comment(lib, "Synchronization.lib")
+
 
 // -------- INTERNAL FUNCTIONS --------------------------------------------- //
 
@@ -33,6 +36,16 @@ static DWORD WINAPI spindleInternalThreadStartFuncWindows(LPVOID arg)
     return 0;
 }
 
+/// Internal thread start function for Windows thread pool workers.
+/// Passes control to the platform-independent worker loop, which returns only when the pool is being destroyed.
+/// @param [arg] Pool worker control structure, cast as a typeless pointer.
+/// @return 0 upon termination of the worker.
+static DWORD WINAPI spindleInternalPoolThreadStartFuncWindows(LPVOID arg)
+{
+    spindlePoolWorkerMain((SSpindlePoolWorker*)arg);
+    return 0;
+}
+
 
 // -------- FUNCTIONS ------------------------------------------------------ //
 // See "osthread.h" for documentation.
@@ -44,6 +57,27 @@ hwloc_thread_t spindleCreateOSThread(SSpindleThreadInfo* threadSpec)
 
 // --------
 
+hwloc_thread_t spindleCreatePoolOSThread(SSpindlePoolWorker* worker)
+{
+    return CreateThread(NULL, 0, &spindleInternalPoolThreadStartFuncWindows, (LPVOID)worker, 0, NULL);
+}
+
+// --------
+
+uint64_t spindleGetOSTimeNanoseconds(void)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    
+    // Split the conversion to avoid overflowing the intermediate product.
+    return ((uint64_t)(now.QuadPart / frequency.QuadPart) * 1000000000ull) + (((uint64_t)(now.QuadPart % frequency.QuadPart) * 1000000000ull) / (uint64_t)frequency.QuadPart);
+}
+
+// --------
+
 hwloc_thread_t spindleIdentifyCurrentOSThread(void)
 {
     return (hwloc_thread_t)GetCurrentThread();
@@ -51,6 +85,16 @@ hwloc_thread_t spindleIdentifyCurrentOSThread(void)
 
 // --------
 
+uint32_t spindleJoinPoolOSThread(SSpindlePoolWorker* worker)
+{
+    DWORD waitResult = WaitForSingleObject(worker->threadHandle, INFINITE);
+    
+    CloseHandle(worker->threadHandle);
+    return (uint32_t)waitResult;
+}
+
+// --------
+
 uint32_t spindleJoinThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCount)
 {
     DWORD waitResult = 0;
@@ -74,3 +118,34 @@ uint32_t spindleStartCurrentThread(SSpindleThreadInfo* threadSpec)
     spindleInternalThreadStartFuncWindows((LPVOID)threadSpec);
     return 0;
 }
+
+// --------
+
+void spindleWaitOnAddress(volatile uint32_t* address, uint32_t expectedValue)
+{
+    WaitOnAddress((volatile VOID*)address, (PVOID)&expectedValue, sizeof(expectedValue), INFINITE);
+}
+
+// --------
+
+void spindleWaitOnAddressTimeout(volatile uint32_t* address, uint32_t expectedValue, uint32_t timeoutMilliseconds)
+{
+    const ULONGLONG deadline = GetTickCount64() + (ULONGLONG)timeoutMilliseconds;
+    
+    // The wait timeout is relative, so recompute it after each spurious wakeup.
+    while (expectedValue == *address)
+    {
+        const ULONGLONG now = GetTickCount64();
+        if (now >= deadline)
+            break;
+        
+        WaitOnAddress((volatile VOID*)address, (PVOID)&expectedValue, sizeof(expectedValue), (DWORD)(deadline - now));
+    }
+}
+
+// --------
+
+void spindleWakeAddress(volatile uint32_t* address)
+{
+    WakeByAddressAll((PVOID)address);
+}
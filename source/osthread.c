@@ -12,9 +12,14 @@
  *   This file contains platform-independent functions.
  *****************************************************************************/
 
+#include "arena.h"
+#include "atomic.h"
 #include "barrier.h"
+#include "context.h"
 #include "init.h"
 #include "osthread.h"
+#include "region.h"
+#include "trace.h"
 #include "types.h"
 
 #include <hwloc.h>
@@ -22,6 +27,23 @@
 #include <stdint.h>
 
 
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Abandons a parallel region after some of its threads could not be created, so that it can safely be destroyed.
+/// Threads that were created are released from the startup barrier without running their tasks, and waited for until they terminate.
+/// @param [in] region Parallel region to abandon.
+/// @param [in] threadSpec Array of thread assignment specifications for the threads that were created.
+/// @param [in] threadCount Number of threads that were created.
+static void spindleHelperAbandonRegion(SSpindleRegion* region, SSpindleThreadInfo* threadSpec, uint32_t threadCount)
+{
+    atomic_store32_release(&region->abortFlag, 1);
+    spindleBarrierInternalGlobalArriveMissing(region, region->threadCount - threadCount);
+
+    if (0 != threadCount)
+        spindleJoinThreads(threadSpec, threadCount);
+}
+
+
 // -------- FUNCTIONS ------------------------------------------------------ //
 // See "osthread.h" for documentation.
 
@@ -36,26 +58,35 @@ uint32_t spindleCreateThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCou
 {
     if (useCurrentThread)
     {
+        uint32_t startResult = 0;
+
         for (uint32_t i = 1; i < threadCount; ++i)
         {
             threadSpec[i].threadHandle = spindleCreateOSThread(&threadSpec[i]);
 
             if ((hwloc_thread_t)NULL == threadSpec[i].threadHandle)
+            {
+                spindleHelperAbandonRegion(threadSpec[0].region, &threadSpec[1], i - 1);
                 return __LINE__;
+            }
         }
 
         threadSpec[0].threadHandle = spindleIdentifyCurrentOSThread();
-        return spindleStartCurrentThread(&threadSpec[0]);
+        startResult = spindleStartCurrentThread(&threadSpec[0]);
+        if (0 != startResult)
+            return startResult;
+
+        // Other threads may still be leaving the last barrier, which reads memory that belongs to the parallel region, so wait for them before it can be freed.
+        if (threadCount > 1)
+            return spindleJoinThreads(&threadSpec[1], threadCount - 1);
+
+        return 0;
     }
     else
     {
-        for (uint32_t i = 0; i < threadCount; ++i)
-        {
-            threadSpec[i].threadHandle = spindleCreateOSThread(&threadSpec[i]);
-
-            if ((hwloc_thread_t)NULL == threadSpec[i].threadHandle)
-                return __LINE__;
-        }
+        const uint32_t launchResult = spindleLaunchThreads(threadSpec, threadCount);
+        if (0 != launchResult)
+            return launchResult;
 
         return spindleJoinThreads(threadSpec, threadCount);
     }
@@ -63,18 +94,76 @@ uint32_t spindleCreateThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCou
 
 // --------
 
-void spindleRunThreadSpec(SSpindleThreadInfo* threadSpec)
+void spindleExecuteThreadSpec(SSpindleThreadInfo* threadSpec)
 {
-    // Affinitize the thread as required by the thread specification.
-    spindleAffinitizeCurrentOSThread(threadSpec->topology, threadSpec->affinityObject);
-
     // Initialize thread identification information.
     spindleSetThreadID(threadSpec->localThreadID, threadSpec->globalThreadID, threadSpec->taskID);
     spindleSetThreadCounts(threadSpec->localThreadCount, threadSpec->globalThreadCount, threadSpec->taskCount);
+    spindleSetThreadRegion(threadSpec->region->index);
     spindleInitializeLocalVariable();
+    spindleInitializeThreadArena(threadSpec->region, threadSpec->globalThreadID);
+    spindleInitializeThreadContextBlock(threadSpec->region, threadSpec->globalThreadID);
+    spindleSelectThreadTraceBuffer(threadSpec->region, threadSpec->globalThreadID);
+    spindleSetInParallelRegion(true);
 
     // Wait for all threads, then call the real thread starting function.
+    spindleTraceRecord(kSpindleTracePhaseBegin, "Region");
+    spindleTraceRecord(kSpindleTracePhaseBegin, "Startup barrier");
     spindleBarrierInternalGlobal();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+
+    // If some threads could not be created, the parallel region is abandoned, so leave without running the task.
+    if (0 != atomic_load32_acquire(&threadSpec->region->abortFlag))
+    {
+        spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+        spindleSelectThreadTraceBuffer(NULL, 0);
+        spindleSetInParallelRegion(false);
+        return;
+    }
+
+    spindleTraceRecord(kSpindleTracePhaseBegin, "Task");
     threadSpec->func(threadSpec->arg);
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+
+    spindleTraceRecord(kSpindleTracePhaseBegin, "Teardown barrier");
     spindleBarrierInternalGlobal();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+
+    spindleSelectThreadTraceBuffer(NULL, 0);
+
+    // All threads have finished, so one of them reports completion to any thread waiting for the parallel region.
+    if (0 == threadSpec->globalThreadID)
+        spindleSignalRegionCompletion(threadSpec->region);
+
+    spindleSetInParallelRegion(false);
+}
+
+// --------
+
+uint32_t spindleLaunchThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCount)
+{
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        threadSpec[i].threadHandle = spindleCreateOSThread(&threadSpec[i]);
+
+        if ((hwloc_thread_t)NULL == threadSpec[i].threadHandle)
+        {
+            spindleHelperAbandonRegion(threadSpec[0].region, threadSpec, i);
+            return __LINE__;
+        }
+    }
+
+    return 0;
+}
+
+// --------
+
+void spindleRunThreadSpec(SSpindleThreadInfo* threadSpec)
+{
+    // Affinitize the thread as required by the thread specification.
+    spindleAffinitizeCurrentOSThread(threadSpec->topology, threadSpec->affinityObject);
+
+    // Initialize thread information and run.
+    spindleExecuteThreadSpec(threadSpec);
 }
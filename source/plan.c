@@ -0,0 +1,1334 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file plan.c
+ *   Implementation of thread-to-core assignment, both for spawning threads
+ *   and for planning placement without spawning, optionally on a topology
+ *   other than that of the current system.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "plan.h"
+#include "region.h"
+#include "types.h"
+
+#include <hwloc.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <topo.h>
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Records the reason for a failure to assign threads to cores, if the caller asked for it.
+/// @param [out] error Error description to fill, or `NULL`.
+/// @param [in] taskID Index of the offending task specification, or #kSpindlePlanNoTask.
+/// @param [in] message Static description of the error.
+static void spindlePlanHelperSetError(SSpindlePlanError* error, uint32_t taskID, const char* message)
+{
+    if (NULL != error)
+    {
+        error->taskID = taskID;
+        error->message = message;
+    }
+}
+
+// --------
+
+/// Determines the number of NUMA nodes in the specified topology.
+/// The current system's topology is queried using Topo, so that NUMA node indices always match those used elsewhere. Other topologies without any NUMA nodes are treated as having a single one.
+/// @param [in] topology Topology object from `hwloc`.
+/// @return Number of NUMA nodes.
+static uint32_t spindlePlanHelperGetNUMANodeCount(hwloc_topology_t topology)
+{
+    int numNumaNodes = 0;
+
+    if (topoGetSystemTopologyObject() == topology)
+        return topoGetSystemNUMANodeCount();
+
+    numNumaNodes = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NUMANODE);
+    return (numNumaNodes > 0 ? (uint32_t)numNumaNodes : 1);
+}
+
+// --------
+
+/// Retrieves the object that represents the specified NUMA node in the specified topology.
+/// See #spindlePlanHelperGetNUMANodeCount for how NUMA nodes are identified.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] numaNode Zero-based index of the NUMA node.
+/// @return Object whose cpuset covers the NUMA node's logical cores, or `NULL` if no such NUMA node exists.
+static hwloc_obj_t spindlePlanHelperGetNUMANodeObject(hwloc_topology_t topology, uint32_t numaNode)
+{
+    if (topoGetSystemTopologyObject() == topology)
+        return topoGetNUMANodeObjectAtIndex(numaNode);
+
+    if (0 >= hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NUMANODE))
+        return (0 == numaNode ? hwloc_get_root_obj(topology) : NULL);
+
+    return hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, numaNode);
+}
+
+// --------
+
+/// Retrieves the cache domain that contains the specified object, identified by the level 3 cache above it.
+/// @param [in] object Object from `hwloc`, typically a physical or logical core.
+/// @return Object that represents the level 3 cache, or `NULL` if the topology does not describe one above the specified object.
+static hwloc_obj_t spindlePlanHelperGetCacheDomainObject(hwloc_obj_t object)
+{
+    for (hwloc_obj_t ancestorObject = object->parent; NULL != ancestorObject; ancestorObject = ancestorObject->parent)
+    {
+#if HWLOC_API_VERSION >= 0x00020000
+        if (HWLOC_OBJ_L3CACHE == ancestorObject->type)
+#else
+        if (HWLOC_OBJ_CACHE == ancestorObject->type && 3 == ancestorObject->attr->cache.depth)
+#endif
+            return ancestorObject;
+    }
+
+    return NULL;
+}
+
+// --------
+
+/// Determines the number of threads that a task can place on the specified physical core.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] physicalCoreObject Physical core.
+/// @param [in] smtPolicy SMT policy, part of the task specification.
+/// @return Number of threads.
+static uint32_t spindlePlanHelperGetThreadsPerCore(hwloc_topology_t topology, hwloc_obj_t physicalCoreObject, ESpindleSMTPolicy smtPolicy)
+{
+    if (SpindleSMTPolicyDisableSMT == smtPolicy)
+        return 1;
+
+    return hwloc_get_nbobjs_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU);
+}
+
+// --------
+
+/// Determines the kind of the specified physical core, using the CPU kinds that `hwloc` reports.
+/// The most performant kind consists of performance cores and all others of efficiency cores. All physical cores are performance cores if fewer than two kinds are reported.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] physicalCoreObject Physical core.
+/// @return Kind of the physical core.
+static ESpindleCoreKind spindlePlanHelperGetCoreKind(hwloc_topology_t topology, hwloc_obj_t physicalCoreObject)
+{
+#if HWLOC_API_VERSION >= 0x00020400
+    // Kinds are ordered from least to most performant.
+    const int numCoreKinds = hwloc_cpukinds_get_nr(topology, 0);
+
+    if (numCoreKinds > 1)
+    {
+        const int coreKindIndex = hwloc_cpukinds_get_by_cpuset(topology, physicalCoreObject->cpuset, 0);
+
+        if ((coreKindIndex >= 0) && (coreKindIndex < numCoreKinds - 1))
+            return SpindleCoreKindEfficiency;
+    }
+#endif
+
+    return SpindleCoreKindPerformance;
+}
+
+// --------
+
+/// Determines whether a task may use the specified physical core, based on its kind.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] physicalCoreObject Physical core.
+/// @param [in] coreKindPolicy Core kind policy, part of the task specification.
+/// @return `true` if so, `false` otherwise.
+static bool spindlePlanHelperIsCoreKindSelected(hwloc_topology_t topology, hwloc_obj_t physicalCoreObject, ESpindleCoreKindPolicy coreKindPolicy)
+{
+    switch (coreKindPolicy)
+    {
+    case SpindleCoreKindPolicyPerformance:
+        return (SpindleCoreKindPerformance == spindlePlanHelperGetCoreKind(topology, physicalCoreObject));
+
+    case SpindleCoreKindPolicyEfficiency:
+        return (SpindleCoreKindEfficiency == spindlePlanHelperGetCoreKind(topology, physicalCoreObject));
+
+    default:
+        return true;
+    }
+}
+
+// --------
+
+/// Moves the next physical core to assign past any physical cores of a kind that a task does not use, leaving them unused.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] nodeCpuset Set of logical cores available on the current NUMA node.
+/// @param [in] coreKindPolicy Core kind policy, part of the task specification.
+/// @param [in, out] physicalCoreObject Next physical core to assign, updated if any are skipped, and `NULL` if none remain.
+/// @param [in, out] coresLeft Number of physical cores left on the current NUMA node, reduced by the number skipped.
+/// @param [in, out] threadsLeft Number of logical cores left on the current NUMA node, reduced by the number skipped.
+static void spindlePlanHelperSkipExcludedCores(hwloc_topology_t topology, hwloc_const_cpuset_t nodeCpuset, ESpindleCoreKindPolicy coreKindPolicy, hwloc_obj_t* physicalCoreObject, uint32_t* coresLeft, uint32_t* threadsLeft)
+{
+    while ((NULL != *physicalCoreObject) && (false == spindlePlanHelperIsCoreKindSelected(topology, *physicalCoreObject, coreKindPolicy)))
+    {
+        *coresLeft -= 1;
+        *threadsLeft -= hwloc_get_nbobjs_inside_cpuset_by_type(topology, (*physicalCoreObject)->cpuset, HWLOC_OBJ_PU);
+        *physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, *physicalCoreObject);
+    }
+}
+
+// --------
+
+/// Moves the next physical core to assign to the start of the next cache domain if a task would not fit in what remains of the current one, or unconditionally if the task was created as one of one task per cache domain.
+/// Nothing happens if the next physical core already starts a cache domain, if the topology does not describe cache domains, or if no cache domain follows the current one.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] nodeCpuset Set of logical cores available on the current NUMA node.
+/// @param [in] numThreadsRequested Number of threads the task requires.
+/// @param [in] smtPolicy SMT policy, part of the task specification.
+/// @param [in] cachePolicy Cache policy, part of the task specification.
+/// @param [in, out] physicalCoreObject Next physical core to assign, updated if any are skipped.
+/// @param [in, out] coresLeft Number of physical cores left on the current NUMA node, reduced by the number skipped.
+/// @param [in, out] threadsLeft Number of logical cores left on the current NUMA node, reduced by the number skipped.
+static void spindlePlanHelperAlignToCacheDomain(hwloc_topology_t topology, hwloc_const_cpuset_t nodeCpuset, uint32_t numThreadsRequested, ESpindleSMTPolicy smtPolicy, ESpindleCachePolicy cachePolicy, hwloc_obj_t* physicalCoreObject, uint32_t* coresLeft, uint32_t* threadsLeft)
+{
+    hwloc_obj_t cacheDomainObject = NULL;
+    hwloc_obj_t previousCoreObject = NULL;
+    hwloc_obj_t nextDomainCoreObject = *physicalCoreObject;
+    uint32_t threadsLeftInDomain = 0;
+
+    // If no physical cores remain, there is nothing to align, and the caller reports the error.
+    if (NULL == *physicalCoreObject)
+        return;
+
+    cacheDomainObject = spindlePlanHelperGetCacheDomainObject(*physicalCoreObject);
+    previousCoreObject = (*physicalCoreObject)->prev_cousin;
+
+    if (NULL == cacheDomainObject)
+        return;
+
+    // A task that starts at the first available physical core of a cache domain is already aligned.
+    if ((NULL == previousCoreObject) || (!hwloc_bitmap_isincluded(previousCoreObject->cpuset, nodeCpuset)) || (cacheDomainObject != spindlePlanHelperGetCacheDomainObject(previousCoreObject)))
+        return;
+
+    // Find how many threads fit in the rest of the cache domain, along with the first physical core of the next one.
+    while ((NULL != nextDomainCoreObject) && (cacheDomainObject == spindlePlanHelperGetCacheDomainObject(nextDomainCoreObject)))
+    {
+        threadsLeftInDomain += spindlePlanHelperGetThreadsPerCore(topology, nextDomainCoreObject, smtPolicy);
+        nextDomainCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, nextDomainCoreObject);
+    }
+
+    if (((SpindleCachePolicyAlign == cachePolicy) && (threadsLeftInDomain >= numThreadsRequested)) || (NULL == nextDomainCoreObject))
+        return;
+
+    // Skip the rest of the cache domain, leaving its physical cores unused.
+    while (*physicalCoreObject != nextDomainCoreObject)
+    {
+        *coresLeft -= 1;
+        *threadsLeft -= hwloc_get_nbobjs_inside_cpuset_by_type(topology, (*physicalCoreObject)->cpuset, HWLOC_OBJ_PU);
+        *physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, *physicalCoreObject);
+    }
+}
+
+// --------
+
+/// Determines whether a task specification places a task on the specified NUMA node, either directly or by requesting one task per NUMA node.
+/// A task specification whose NUMA node does not exist is treated as placing its task just past the last NUMA node, so that assignment can report the error.
+/// @param [in] taskSpec Task specification.
+/// @param [in] numaNode Zero-based index of the NUMA node, or the number of NUMA nodes to check for a NUMA node that does not exist.
+/// @param [in] numNumaNodes Number of NUMA nodes in the topology.
+/// @return `true` if so, `false` otherwise.
+static bool spindlePlanHelperIsNUMANodeSelected(const SSpindleTaskConfig* taskSpec, uint32_t numaNode, uint32_t numNumaNodes)
+{
+    if (kSpindleTaskSpecAllNUMANodes != taskSpec->numaNode)
+        return (numaNode == (taskSpec->numaNode < numNumaNodes ? taskSpec->numaNode : numNumaNodes));
+
+    if (numaNode >= numNumaNodes)
+        return false;
+
+    if (0 == taskSpec->numaNodeMask)
+        return true;
+
+    return ((numaNode < 64) && (0 != (taskSpec->numaNodeMask & ((uint64_t)1 << numaNode))));
+}
+
+// --------
+
+/// Determines the number of physical cores that a task can occupy if it takes as many as possible, as tasks do if they use all available threads or scatter their threads.
+/// These are all the physical cores of a kind the task uses that remain on the NUMA node, or in the cache domain for a task created as one of one task per cache domain, apart from those the task reserves.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] nodeCpuset Set of logical cores available on the current NUMA node.
+/// @param [in] physicalCoreObject Next physical core to assign, or `NULL` if none remain.
+/// @param [in] taskSpec Task specification.
+/// @return Number of physical cores, which is 0 if none remain beyond those the task reserves.
+static uint32_t spindlePlanHelperGetAvailableCoreCount(hwloc_topology_t topology, hwloc_const_cpuset_t nodeCpuset, hwloc_obj_t physicalCoreObject, const SSpindleTaskConfig* taskSpec)
+{
+    const hwloc_obj_t cacheDomainObject = ((NULL != physicalCoreObject) && (SpindleCachePolicyTaskPerDomain == taskSpec->cachePolicy) ? spindlePlanHelperGetCacheDomainObject(physicalCoreObject) : NULL);
+    uint32_t coreCount = 0;
+
+    while ((NULL != physicalCoreObject) && ((NULL == cacheDomainObject) || (cacheDomainObject == spindlePlanHelperGetCacheDomainObject(physicalCoreObject))))
+    {
+        if (spindlePlanHelperIsCoreKindSelected(topology, physicalCoreObject, taskSpec->coreKindPolicy))
+            coreCount += 1;
+
+        physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, physicalCoreObject);
+    }
+
+    return (coreCount > taskSpec->reservedCoreCount ? coreCount - taskSpec->reservedCoreCount : 0);
+}
+
+// --------
+
+/// Resolves a request for the same number of threads as the previous task specification, in the order the caller specified them.
+/// Follows any chain of such requests back to the task specification that starts it. If that one specifies its number of threads, the result is that number.
+/// Otherwise the number is only known once the previous task has been planned, so the request is produced unchanged and assignment resolves it.
+/// @param [in] taskSpec Task specifications, as an array in the caller's order.
+/// @param [in] taskIndex Index of the task specification whose number of threads is to be resolved.
+/// @return Number of threads for the task specification.
+static uint32_t spindlePlanHelperResolveSameAsPrevious(const SSpindleTaskConfig* taskSpec, uint32_t taskIndex)
+{
+    uint32_t previousTaskIndex = taskIndex;
+
+    if (kSpindleTaskSpecThreadsSameAsPrevious != taskSpec[taskIndex].numThreads)
+        return taskSpec[taskIndex].numThreads;
+
+    while ((0 != previousTaskIndex) && (kSpindleTaskSpecThreadsSameAsPrevious == taskSpec[previousTaskIndex].numThreads))
+        previousTaskIndex -= 1;
+
+    if (kSpindleTaskSpecAllAvailableThreads == taskSpec[previousTaskIndex].numThreads)
+        return kSpindleTaskSpecThreadsSameAsPrevious;
+
+    return taskSpec[previousTaskIndex].numThreads;
+}
+
+// --------
+
+/// Fills the task specifications that replace one that requests one task per cache domain, or counts them without filling any.
+/// Cache domains without any physical cores of a kind the task uses are left out. If that leaves none, the task specification is produced unchanged so that assignment can report the error.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] nodeCpuset Set of logical cores available on the task's NUMA node.
+/// @param [in] taskSpec Task specification to replace.
+/// @param [out] outTaskSpec Array to receive one task specification per cache domain, or `NULL` to count them only.
+/// @param [out] outDomainCount Receives the number of cache domains, which is 1 if the topology does not describe any.
+/// @return `true` on success, or `false` if some cache domain has no physical cores the task can use beyond those it reserves.
+static bool spindlePlanHelperExpandTaskSpec(hwloc_topology_t topology, hwloc_const_cpuset_t nodeCpuset, const SSpindleTaskConfig* taskSpec, SSpindleTaskConfig* outTaskSpec, uint32_t* outDomainCount)
+{
+    hwloc_obj_t physicalCoreObject = hwloc_get_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, 0);
+    uint32_t domainCount = 0;
+
+    while (NULL != physicalCoreObject)
+    {
+        const hwloc_obj_t cacheDomainObject = spindlePlanHelperGetCacheDomainObject(physicalCoreObject);
+        hwloc_obj_t domainCoreObject = physicalCoreObject;
+        uint32_t coresInDomain = 0;
+        uint32_t threadsInDomain = 0;
+
+        // Count the usable physical cores of the present cache domain, moving to the first physical core of the next one.
+        while ((NULL != physicalCoreObject) && (cacheDomainObject == spindlePlanHelperGetCacheDomainObject(physicalCoreObject)))
+        {
+            if (spindlePlanHelperIsCoreKindSelected(topology, physicalCoreObject, taskSpec->coreKindPolicy))
+                coresInDomain += 1;
+
+            physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, physicalCoreObject);
+        }
+
+        if (0 == coresInDomain)
+            continue;
+
+        if (coresInDomain <= taskSpec->reservedCoreCount)
+            return false;
+
+        if (NULL != outTaskSpec)
+        {
+            // Count the threads that fit on the cache domain's usable physical cores, other than those the task reserves.
+            for (uint32_t coreIndex = 0; coreIndex < coresInDomain - taskSpec->reservedCoreCount; ++coreIndex)
+            {
+                while (false == spindlePlanHelperIsCoreKindSelected(topology, domainCoreObject, taskSpec->coreKindPolicy))
+                    domainCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, domainCoreObject);
+
+                threadsInDomain += spindlePlanHelperGetThreadsPerCore(topology, domainCoreObject, taskSpec->smtPolicy);
+                domainCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, domainCoreObject);
+            }
+
+            outTaskSpec[domainCount] = *taskSpec;
+
+            if (kSpindleTaskSpecAllAvailableThreads == taskSpec->numThreads)
+                outTaskSpec[domainCount].numThreads = threadsInDomain;
+        }
+
+        domainCount += 1;
+    }
+
+    if (0 == domainCount)
+    {
+        if (NULL != outTaskSpec)
+            outTaskSpec[0] = *taskSpec;
+
+        domainCount = 1;
+    }
+
+    *outDomainCount = domainCount;
+    return true;
+}
+
+// --------
+
+/// Assigns a logical core to each thread of a task, given the physical cores assigned to the task.
+/// Physical cores may have differing numbers of logical cores, as on processors that mix physical core kinds.
+/// Threads of a scattered task are spread evenly over its physical cores, threads that prefer physical cores occupy one logical core per physical core before doubling up, and all others fill each physical core in turn.
+/// @param [in] topology Topology object from `hwloc`.
+/// @param [in] physicalCoreObjects Physical cores assigned to the task, in order.
+/// @param [in] physicalCoreCount Number of physical cores assigned to the task.
+/// @param [in] threadCount Number of threads in the task.
+/// @param [in] smtPolicy SMT policy, part of the task specification.
+/// @param [in] placementPolicy Placement policy, part of the task specification.
+/// @param [in] coreThreadCount Scratch space with one element per physical core assigned to the task.
+/// @param [out] outThreadAssignments Array of thread information structures, one per thread in the task, whose affinity objects are filled.
+/// @return `true` on success, or `false` if some thread could not be assigned a logical core.
+static bool spindlePlanHelperAssignLogicalCores(hwloc_topology_t topology, const hwloc_obj_t* physicalCoreObjects, uint32_t physicalCoreCount, uint32_t threadCount, ESpindleSMTPolicy smtPolicy, ESpindlePlacementPolicy placementPolicy, uint32_t* coreThreadCount, SSpindleThreadInfo* outThreadAssignments)
+{
+    uint32_t threadsLeft = threadCount;
+    uint32_t maxThreadsPerCore = 0;
+    uint32_t threadIndex = 0;
+
+    if (0 == physicalCoreCount)
+        return (0 == threadCount);
+
+    // Decide how many threads each physical core runs.
+    for (uint32_t coreIndex = 0; coreIndex < physicalCoreCount; ++coreIndex)
+    {
+        const uint32_t threadsPerCore = spindlePlanHelperGetThreadsPerCore(topology, physicalCoreObjects[coreIndex], smtPolicy);
+
+        if (threadsPerCore > maxThreadsPerCore)
+            maxThreadsPerCore = threadsPerCore;
+
+        if ((SpindlePlacementPolicyScatter == placementPolicy) && ((SpindleSMTPolicyPreferPhysical != smtPolicy) || (threadCount <= physicalCoreCount)))
+        {
+            // Physical core i runs threads ceil(i * threads / cores) through ceil((i + 1) * threads / cores) - 1, so consecutive threads share a physical core only if there are more threads than physical cores.
+            const uint32_t firstThread = (uint32_t)((((uint64_t)coreIndex * (uint64_t)threadCount) + (uint64_t)physicalCoreCount - 1) / (uint64_t)physicalCoreCount);
+            const uint32_t lastThread = (uint32_t)((((uint64_t)(coreIndex + 1) * (uint64_t)threadCount) + (uint64_t)physicalCoreCount - 1) / (uint64_t)physicalCoreCount);
+
+            coreThreadCount[coreIndex] = (lastThread - firstThread < threadsPerCore ? lastThread - firstThread : threadsPerCore);
+        }
+        else if (SpindleSMTPolicyPreferLogical == smtPolicy)
+        {
+            coreThreadCount[coreIndex] = (threadsLeft < threadsPerCore ? threadsLeft : threadsPerCore);
+        }
+        else
+        {
+            coreThreadCount[coreIndex] = 0;
+        }
+
+        threadsLeft -= coreThreadCount[coreIndex];
+    }
+
+    // Place any remaining threads one logical core deep at a time, so that physical cores with fewer logical cores fill up first.
+    for (uint32_t level = 0; (level < maxThreadsPerCore) && (threadsLeft > 0); ++level)
+    {
+        for (uint32_t coreIndex = 0; (coreIndex < physicalCoreCount) && (threadsLeft > 0); ++coreIndex)
+        {
+            if ((level == coreThreadCount[coreIndex]) && (level < spindlePlanHelperGetThreadsPerCore(topology, physicalCoreObjects[coreIndex], smtPolicy)))
+            {
+                coreThreadCount[coreIndex] += 1;
+                threadsLeft -= 1;
+            }
+        }
+    }
+
+    if (0 != threadsLeft)
+        return false;
+
+    // Number the threads, either across physical cores one logical core deep at a time or one physical core at a time.
+    if (SpindleSMTPolicyPreferPhysical == smtPolicy)
+    {
+        for (uint32_t level = 0; level < maxThreadsPerCore; ++level)
+        {
+            for (uint32_t coreIndex = 0; coreIndex < physicalCoreCount; ++coreIndex)
+            {
+                if (level < coreThreadCount[coreIndex])
+                    outThreadAssignments[threadIndex++].affinityObject = hwloc_get_obj_inside_cpuset_by_type(topology, physicalCoreObjects[coreIndex]->cpuset, HWLOC_OBJ_PU, level);
+            }
+        }
+    }
+    else
+    {
+        for (uint32_t coreIndex = 0; coreIndex < physicalCoreCount; ++coreIndex)
+        {
+            for (uint32_t level = 0; level < coreThreadCount[coreIndex]; ++level)
+                outThreadAssignments[threadIndex++].affinityObject = hwloc_get_obj_inside_cpuset_by_type(topology, physicalCoreObjects[coreIndex]->cpuset, HWLOC_OBJ_PU, level);
+        }
+    }
+
+    for (threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        if (NULL == outThreadAssignments[threadIndex].affinityObject)
+            return false;
+    }
+
+    return true;
+}
+
+// --------
+
+/// Describes the placement of a thread using indices that are meaningful outside of Spindle.
+/// @param [in] threadInfo Thread information produced by #spindlePlanThreadAssignments.
+/// @param [out] placement Filled with the thread's placement.
+static void spindlePlanHelperDescribePlacement(const SSpindleThreadInfo* threadInfo, SSpindleThreadPlacement* placement)
+{
+    const hwloc_obj_t logicalCoreObject = threadInfo->affinityObject;
+    const hwloc_obj_t physicalCoreObject = hwloc_get_ancestor_obj_by_type(threadInfo->topology, HWLOC_OBJ_CORE, logicalCoreObject);
+
+    placement->globalThreadID = threadInfo->globalThreadID;
+    placement->localThreadID = threadInfo->localThreadID;
+    placement->taskID = threadInfo->taskID;
+    placement->numaNode = threadInfo->numaNode;
+    placement->physicalCore = (NULL == physicalCoreObject ? UINT32_MAX : physicalCoreObject->logical_index);
+    placement->logicalCore = logicalCoreObject->logical_index;
+    placement->logicalCoreOSIndex = logicalCoreObject->os_index;
+    placement->cacheDomain = threadInfo->cacheDomain;
+    placement->coreKind = threadInfo->coreKind;
+}
+
+// --------
+
+/// Loads a topology for planning, after the caller has configured its source.
+/// @param [in] topology Initialized but not yet loaded topology object from `hwloc`, which is destroyed on failure.
+/// @param [out] outTopology Receives the handle to the loaded topology.
+/// @return 0 on success, or nonzero in the event of an error.
+static uint32_t spindlePlanHelperLoadTopology(hwloc_topology_t topology, TSpindleTopology* outTopology)
+{
+    SSpindleTopology* planningTopology = NULL;
+
+    if (0 != hwloc_topology_load(topology))
+    {
+        hwloc_topology_destroy(topology);
+        return __LINE__;
+    }
+
+    planningTopology = (SSpindleTopology*)malloc(sizeof(SSpindleTopology));
+    if (NULL == planningTopology)
+    {
+        hwloc_topology_destroy(topology);
+        return __LINE__;
+    }
+
+    planningTopology->topology = topology;
+    *outTopology = planningTopology;
+    return 0;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "plan.h" for documentation.
+
+uint32_t spindlePlanResolveTaskSpecs(const SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, SSpindleTaskConfig** outTaskSpec, SSpindlePlanError* outError)
+{
+    SSpindleTaskConfig* resolvedTaskSpec = NULL;
+    size_t optionsSize = sizeof(SSpindleTaskOptions);
+
+    // Task options are laid out using the caller's size of the structure, which is smaller than the present one if the caller was built against an earlier version.
+    if (NULL != taskOptions)
+    {
+        optionsSize = taskOptions[0].structSize;
+        if ((optionsSize < sizeof(uint32_t)) || (optionsSize > sizeof(SSpindleTaskOptions)))
+        {
+            spindlePlanHelperSetError(outError, 0, "Task options must be initialized using spindleTaskOptionsInit.");
+            return __LINE__;
+        }
+    }
+
+    resolvedTaskSpec = (SSpindleTaskConfig*)malloc(sizeof(SSpindleTaskConfig) * taskCount);
+    if (NULL == resolvedTaskSpec)
+    {
+        spindlePlanHelperSetError(outError, kSpindlePlanNoTask, "Out of memory.");
+        return __LINE__;
+    }
+
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+        SSpindleTaskOptions options;
+
+        // Fields that the caller does not know about keep their defaults.
+        spindleTaskOptionsInit(&options, 1);
+
+        if (NULL != taskOptions)
+        {
+            const SSpindleTaskOptions* const callerOptions = (const SSpindleTaskOptions*)((const uint8_t*)taskOptions + (optionsSize * taskIndex));
+
+            if (callerOptions->structSize != optionsSize)
+            {
+                free((void*)resolvedTaskSpec);
+                spindlePlanHelperSetError(outError, taskIndex, "Task options must be initialized using spindleTaskOptionsInit.");
+                return __LINE__;
+            }
+
+            memcpy((void*)&options, (const void*)callerOptions, optionsSize);
+        }
+
+        resolvedTaskSpec[taskIndex].func = taskSpec[taskIndex].func;
+        resolvedTaskSpec[taskIndex].arg = taskSpec[taskIndex].arg;
+        resolvedTaskSpec[taskIndex].numaNode = taskSpec[taskIndex].numaNode;
+        resolvedTaskSpec[taskIndex].numThreads = taskSpec[taskIndex].numThreads;
+        resolvedTaskSpec[taskIndex].smtPolicy = taskSpec[taskIndex].smtPolicy;
+        resolvedTaskSpec[taskIndex].barrierAlgorithm = options.barrierAlgorithm;
+        resolvedTaskSpec[taskIndex].arenaSize = options.arenaSize;
+        resolvedTaskSpec[taskIndex].contextSlotCount = options.contextSlotCount;
+        resolvedTaskSpec[taskIndex].reservedCoreCount = options.reservedCoreCount;
+        resolvedTaskSpec[taskIndex].cachePolicy = options.cachePolicy;
+        resolvedTaskSpec[taskIndex].placementPolicy = options.placementPolicy;
+        resolvedTaskSpec[taskIndex].numaNodeMask = options.numaNodeMask;
+        resolvedTaskSpec[taskIndex].coreKindPolicy = options.coreKindPolicy;
+        resolvedTaskSpec[taskIndex].barrierWaitPolicy = options.barrierWaitPolicy;
+        resolvedTaskSpec[taskIndex].barrierSpinIterations = options.barrierSpinIterations;
+    }
+
+    *outTaskSpec = resolvedTaskSpec;
+    return 0;
+}
+
+// --------
+
+uint32_t spindlePlanExpandTaskSpecs(hwloc_topology_t topology, SSpindleTaskConfig* taskSpec, uint32_t taskCount, hwloc_const_cpuset_t allowedCpuset, SSpindleTaskConfig** outTaskSpec, uint32_t** outTaskSpecIndex, uint32_t* outTaskCount, SSpindlePlanError* outError)
+{
+    SSpindleTaskConfig* expandedTaskSpec = NULL;
+    uint32_t* taskSpecIndex = NULL;
+    uint32_t* nodeTaskOffset = NULL;
+    uint32_t expandedTaskCount = 0;
+    const uint32_t numNumaNodes = spindlePlanHelperGetNUMANodeCount(topology);
+    bool expansionNeeded = false;
+
+    // Tasks are grouped by NUMA node, with one extra group at the end for task specifications whose NUMA node does not exist.
+    nodeTaskOffset = (uint32_t*)malloc(sizeof(uint32_t) * (numNumaNodes + 1));
+    if (NULL == nodeTaskOffset)
+    {
+        spindlePlanHelperSetError(outError, kSpindlePlanNoTask, "Out of memory.");
+        return __LINE__;
+    }
+
+    memset((void*)nodeTaskOffset, 0, sizeof(uint32_t) * (numNumaNodes + 1));
+
+    // Count the tasks that result on each NUMA node, leaving any errors other than those specific to expansion for assignment to report.
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+        uint32_t selectedNodeCount = 0;
+
+        if (taskSpec[taskIndex].cachePolicy > SpindleCachePolicyTaskPerDomain)
+        {
+            free((void*)nodeTaskOffset);
+            spindlePlanHelperSetError(outError, taskIndex, "The cache policy is invalid.");
+            return __LINE__;
+        }
+
+        if ((0 == taskIndex) && (kSpindleTaskSpecThreadsSameAsPrevious == taskSpec[taskIndex].numThreads))
+        {
+            free((void*)nodeTaskOffset);
+            spindlePlanHelperSetError(outError, taskIndex, "The first task cannot use the same number of threads as the previous task.");
+            return __LINE__;
+        }
+
+        for (uint32_t numaNode = 0; numaNode <= numNumaNodes; ++numaNode)
+        {
+            uint32_t domainCount = 1;
+
+            if (false == spindlePlanHelperIsNUMANodeSelected(&taskSpec[taskIndex], numaNode, numNumaNodes))
+                continue;
+
+            if ((SpindleCachePolicyTaskPerDomain == taskSpec[taskIndex].cachePolicy) && (numaNode < numNumaNodes))
+            {
+                const hwloc_obj_t numaNodeObject = spindlePlanHelperGetNUMANodeObject(topology, numaNode);
+
+                if ((NULL != numaNodeObject) && (false == spindlePlanHelperExpandTaskSpec(topology, (NULL == allowedCpuset ? numaNodeObject->cpuset : allowedCpuset), &taskSpec[taskIndex], NULL, &domainCount)))
+                {
+                    free((void*)nodeTaskOffset);
+                    spindlePlanHelperSetError(outError, taskIndex, "A cache domain has no physical cores beyond those the task reserves.");
+                    return __LINE__;
+                }
+            }
+
+            nodeTaskOffset[numaNode] += domainCount;
+            selectedNodeCount += 1;
+        }
+
+        if (0 == selectedNodeCount)
+        {
+            free((void*)nodeTaskOffset);
+            spindlePlanHelperSetError(outError, taskIndex, "The NUMA node mask selects no NUMA nodes in the topology.");
+            return __LINE__;
+        }
+
+        // Task specifications are used unchanged only if none is replicated and they are already in order of NUMA node.
+        if ((kSpindleTaskSpecAllNUMANodes == taskSpec[taskIndex].numaNode) || (SpindleCachePolicyTaskPerDomain == taskSpec[taskIndex].cachePolicy) || ((0 != taskIndex) && (taskSpec[taskIndex].numaNode < taskSpec[taskIndex - 1].numaNode)))
+            expansionNeeded = true;
+    }
+
+    if (false == expansionNeeded)
+    {
+        free((void*)nodeTaskOffset);
+
+        *outTaskSpec = taskSpec;
+        *outTaskSpecIndex = NULL;
+        *outTaskCount = taskCount;
+        return 0;
+    }
+
+    // Convert the number of tasks on each NUMA node to the position of its first task.
+    for (uint32_t numaNode = 0; numaNode <= numNumaNodes; ++numaNode)
+    {
+        const uint32_t nodeTaskCount = nodeTaskOffset[numaNode];
+
+        nodeTaskOffset[numaNode] = expandedTaskCount;
+        expandedTaskCount += nodeTaskCount;
+    }
+
+    expandedTaskSpec = (SSpindleTaskConfig*)malloc(sizeof(SSpindleTaskConfig) * expandedTaskCount);
+    taskSpecIndex = (uint32_t*)malloc(sizeof(uint32_t) * expandedTaskCount);
+    if ((NULL == expandedTaskSpec) || (NULL == taskSpecIndex))
+    {
+        free((void*)nodeTaskOffset);
+        spindlePlanFreeExpandedTaskSpecs(taskSpec, expandedTaskSpec, taskSpecIndex);
+        spindlePlanHelperSetError(outError, kSpindlePlanNoTask, "Out of memory.");
+        return __LINE__;
+    }
+
+    // Fill the task specifications in order of NUMA node, keeping the original order within each NUMA node and recording the original from which each was created.
+    // Requests for the same number of threads as the previous task specification refer to the caller's order, so they are resolved before reordering wherever possible.
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+        SSpindleTaskConfig currentTaskSpec = taskSpec[taskIndex];
+
+        currentTaskSpec.numThreads = spindlePlanHelperResolveSameAsPrevious(taskSpec, taskIndex);
+
+        for (uint32_t numaNode = 0; numaNode <= numNumaNodes; ++numaNode)
+        {
+            const uint32_t firstExpandedTaskIndex = nodeTaskOffset[numaNode];
+            hwloc_obj_t numaNodeObject = NULL;
+            uint32_t domainCount = 1;
+
+            if (false == spindlePlanHelperIsNUMANodeSelected(&currentTaskSpec, numaNode, numNumaNodes))
+                continue;
+
+            if ((SpindleCachePolicyTaskPerDomain == currentTaskSpec.cachePolicy) && (numaNode < numNumaNodes))
+                numaNodeObject = spindlePlanHelperGetNUMANodeObject(topology, numaNode);
+
+            if (NULL != numaNodeObject)
+                spindlePlanHelperExpandTaskSpec(topology, (NULL == allowedCpuset ? numaNodeObject->cpuset : allowedCpuset), &currentTaskSpec, &expandedTaskSpec[firstExpandedTaskIndex], &domainCount);
+            else
+                expandedTaskSpec[firstExpandedTaskIndex] = currentTaskSpec;
+
+            for (uint32_t domainIndex = 0; domainIndex < domainCount; ++domainIndex)
+            {
+                if (kSpindleTaskSpecAllNUMANodes == currentTaskSpec.numaNode)
+                    expandedTaskSpec[firstExpandedTaskIndex + domainIndex].numaNode = numaNode;
+
+                taskSpecIndex[firstExpandedTaskIndex + domainIndex] = taskIndex;
+            }
+
+            nodeTaskOffset[numaNode] += domainCount;
+        }
+    }
+
+    free((void*)nodeTaskOffset);
+
+    *outTaskSpec = expandedTaskSpec;
+    *outTaskSpecIndex = taskSpecIndex;
+    *outTaskCount = expandedTaskCount;
+    return 0;
+}
+
+// --------
+
+void spindlePlanFreeExpandedTaskSpecs(SSpindleTaskConfig* taskSpec, SSpindleTaskConfig* expandedTaskSpec, uint32_t* taskSpecIndex)
+{
+    if ((NULL != expandedTaskSpec) && (taskSpec != expandedTaskSpec))
+        free((void*)expandedTaskSpec);
+
+    if (NULL != taskSpecIndex)
+        free((void*)taskSpecIndex);
+}
+
+// --------
+
+uint32_t spindlePlanThreadAssignments(hwloc_topology_t topology, SSpindleTaskConfig* taskSpec, const uint32_t* taskSpecIndex, uint32_t taskCount, hwloc_const_cpuset_t allowedCpuset, SSpindleThreadInfo** outThreadAssignments, uint32_t* outThreadCount, SSpindlePlanError* outError)
+{
+    SSpindleThreadInfo* threadAssignments = NULL;
+    uint32_t nextThreadAssignmentIndex = 0;
+
+    hwloc_obj_t numaNodeObject = NULL;
+    hwloc_obj_t physicalCoreObject = NULL;
+    hwloc_obj_t cacheDomainObject = NULL;
+    hwloc_const_cpuset_t nodeCpuset = NULL;
+
+    void* taskAssignmentBuffer;
+    hwloc_obj_t* taskPhysCoreObjects;
+    uint32_t* taskFirstPhysCore;
+    uint32_t* taskPhysCoreCount;
+    uint32_t* taskNumThreads;
+    uint32_t* taskReservedStartPhysCore;
+    uint32_t* coreThreadCount;
+
+    uint32_t currentNumaNode = 0;
+    uint32_t threadsLeftOnCurrentNumaNode = 0;
+    uint32_t coresLeftOnCurrentNumaNode = 0;
+    uint32_t numThreadsRequested = 0;
+    uint32_t numNumaNodes = 0;
+    uint32_t totalNumThreads = 0;
+    uint32_t numPhysCores = 0;
+    uint32_t nextPhysCoreIndex = 0;
+
+    // Figure out the highest possible NUMA node index, for error-checking purposes.
+    numNumaNodes = spindlePlanHelperGetNUMANodeCount(topology);
+    if (1 > numNumaNodes)
+    {
+        spindlePlanHelperSetError(outError, kSpindlePlanNoTask, "The topology contains no NUMA nodes.");
+        return __LINE__;
+    }
+
+    // Initialize data structures to assign from the first NUMA node in the system.
+    numaNodeObject = spindlePlanHelperGetNUMANodeObject(topology, currentNumaNode);
+    if (NULL == numaNodeObject)
+    {
+        spindlePlanHelperSetError(outError, kSpindlePlanNoTask, "The first NUMA node could not be found in the topology.");
+        return __LINE__;
+    }
+
+    nodeCpuset = (NULL == allowedCpuset ? numaNodeObject->cpuset : allowedCpuset);
+    threadsLeftOnCurrentNumaNode = hwloc_get_nbobjs_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_PU);
+    coresLeftOnCurrentNumaNode = hwloc_get_nbobjs_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE);
+
+    physicalCoreObject = hwloc_get_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, 0);
+    if (NULL == physicalCoreObject)
+    {
+        spindlePlanHelperSetError(outError, kSpindlePlanNoTask, "The first NUMA node contains no available physical cores.");
+        return __LINE__;
+    }
+
+    // Allocate memory for assignment arrays.
+    // Physical cores assigned to tasks are listed in one array with one element per physical core in the topology, since no physical core is assigned to more than one task.
+    // Four arrays hold one element per task, and the last is scratch space with one element per physical core in the topology.
+    numPhysCores = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_CORE);
+    taskAssignmentBuffer = malloc((sizeof(hwloc_obj_t) * numPhysCores) + (sizeof(uint32_t) * ((taskCount * 4) + numPhysCores)));
+    if (NULL == taskAssignmentBuffer)
+    {
+        spindlePlanHelperSetError(outError, kSpindlePlanNoTask, "Out of memory.");
+        return __LINE__;
+    }
+
+    taskPhysCoreObjects = (hwloc_obj_t*)taskAssignmentBuffer;
+    taskFirstPhysCore = (uint32_t*)&taskPhysCoreObjects[numPhysCores];
+    taskPhysCoreCount = &taskFirstPhysCore[taskCount];
+    taskNumThreads = &taskFirstPhysCore[taskCount * 2];
+    taskReservedStartPhysCore = &taskFirstPhysCore[taskCount * 3];
+    coreThreadCount = &taskFirstPhysCore[taskCount * 4];
+
+    // Assign ranges of physical cores to tasks, based on the task specifications.
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+        // Verify the task specification's NUMA node.
+        if (taskSpec[taskIndex].numaNode >= numNumaNodes)
+        {
+            free((void*)taskAssignmentBuffer);
+            spindlePlanHelperSetError(outError, taskIndex, "The NUMA node index exceeds the number of NUMA nodes in the topology.");
+            return __LINE__;
+        }
+
+        // Verify the task specification's SMT policy, barrier algorithm, barrier wait policy, cache policy, placement policy, and core kind policy.
+        if (taskSpec[taskIndex].smtPolicy > SpindleSMTPolicyPreferLogical)
+        {
+            free((void*)taskAssignmentBuffer);
+            spindlePlanHelperSetError(outError, taskIndex, "The SMT policy is invalid.");
+            return __LINE__;
+        }
+
+        if (taskSpec[taskIndex].barrierAlgorithm > SpindleBarrierAlgorithmStaticTree)
+        {
+            free((void*)taskAssignmentBuffer);
+            spindlePlanHelperSetError(outError, taskIndex, "The barrier algorithm is invalid.");
+            return __LINE__;
+        }
+
+        if (taskSpec[taskIndex].barrierWaitPolicy > SpindleBarrierWaitPolicySpinThenBlock)
+        {
+            free((void*)taskAssignmentBuffer);
+            spindlePlanHelperSetError(outError, taskIndex, "The barrier wait policy is invalid.");
+            return __LINE__;
+        }
+
+        if (taskSpec[taskIndex].cachePolicy > SpindleCachePolicyTaskPerDomain)
+        {
+            free((void*)taskAssignmentBuffer);
+            spindlePlanHelperSetError(outError, taskIndex, "The cache policy is invalid.");
+            return __LINE__;
+        }
+
+        if (taskSpec[taskIndex].placementPolicy > SpindlePlacementPolicyScatter)
+        {
+            free((void*)taskAssignmentBuffer);
+            spindlePlanHelperSetError(outError, taskIndex, "The placement policy is invalid.");
+            return __LINE__;
+        }
+
+        if (taskSpec[taskIndex].coreKindPolicy > SpindleCoreKindPolicyEfficiency)
+        {
+            free((void*)taskAssignmentBuffer);
+            spindlePlanHelperSetError(outError, taskIndex, "The core kind policy is invalid.");
+            return __LINE__;
+        }
+
+        // Reinitialize to a different NUMA node if the specified NUMA node is different.
+        if (taskSpec[taskIndex].numaNode != currentNumaNode)
+        {
+            currentNumaNode = taskSpec[taskIndex].numaNode;
+
+            numaNodeObject = spindlePlanHelperGetNUMANodeObject(topology, currentNumaNode);
+            if (NULL == numaNodeObject)
+            {
+                free((void*)taskAssignmentBuffer);
+                spindlePlanHelperSetError(outError, taskIndex, "The NUMA node could not be found in the topology.");
+                return __LINE__;
+            }
+
+            nodeCpuset = (NULL == allowedCpuset ? numaNodeObject->cpuset : allowedCpuset);
+            threadsLeftOnCurrentNumaNode = hwloc_get_nbobjs_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_PU);
+            coresLeftOnCurrentNumaNode = hwloc_get_nbobjs_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE);
+
+            physicalCoreObject = hwloc_get_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, 0);
+            if (NULL == physicalCoreObject)
+            {
+                free((void*)taskAssignmentBuffer);
+                spindlePlanHelperSetError(outError, taskIndex, "The NUMA node contains no available physical cores.");
+                return __LINE__;
+            }
+        }
+
+        // Figure out the requested number of threads, based on any special constants passed.
+        switch (taskSpec[taskIndex].numThreads)
+        {
+        case kSpindleTaskSpecThreadsSameAsPrevious:
+            // Use the same number of threads as was ultimately used for the previous task in the caller's order.
+            if (NULL == taskSpecIndex)
+            {
+                if (0 == taskIndex)
+                {
+                    // Cannot assign same as previous number of threads if the current task is the first one specified.
+                    free((void*)taskAssignmentBuffer);
+                    spindlePlanHelperSetError(outError, taskIndex, "The first task cannot use the same number of threads as the previous task.");
+                    return __LINE__;
+                }
+
+                // Tasks are planned in the caller's order, so the previous task is the one just planned.
+                numThreadsRequested = taskNumThreads[taskIndex - 1];
+            }
+            else
+            {
+                // Tasks were reordered, so find the most recently planned task created from the previous task specification.
+                uint32_t previousTaskIndex = taskIndex;
+
+                while ((0 != previousTaskIndex) && (taskSpecIndex[previousTaskIndex - 1] + 1 != taskSpecIndex[taskIndex]))
+                    previousTaskIndex -= 1;
+
+                if (0 == previousTaskIndex)
+                {
+                    free((void*)taskAssignmentBuffer);
+                    spindlePlanHelperSetError(outError, taskIndex, "The previous task's number of threads is not yet known because it is planned on a later NUMA node.");
+                    return __LINE__;
+                }
+
+                numThreadsRequested = taskNumThreads[previousTaskIndex - 1];
+            }
+            break;
+
+        default:
+            // Use whatever number of threads as was specified directly in the input.
+            numThreadsRequested = taskSpec[taskIndex].numThreads;
+            break;
+        }
+
+        // Assign the physical cores for the current task, starting from the next available one.
+        taskFirstPhysCore[taskIndex] = nextPhysCoreIndex;
+
+        // Find the physical cores for the current task, based on the number of threads specified.
+        if (kSpindleTaskSpecAllAvailableThreads == numThreadsRequested)
+        {
+            // Verify that at least one core of a kind the task uses remains available on the current NUMA node, beyond any that the task reserves.
+            const uint32_t numCoresToConsume = spindlePlanHelperGetAvailableCoreCount(topology, nodeCpuset, physicalCoreObject, &taskSpec[taskIndex]);
+            if (0 == numCoresToConsume)
+            {
+                free((void*)taskAssignmentBuffer);
+                spindlePlanHelperSetError(outError, taskIndex, "No physical cores remain on the NUMA node beyond those the task reserves.");
+                return __LINE__;
+            }
+
+            // Initialize the counter for the number of threads assigned to the present task.
+            taskNumThreads[taskIndex] = 0;
+
+            // Consume all the remaining physical cores of a kind the task uses on the present node, except for those the task reserves.
+            for (uint32_t coreIndex = 0; coreIndex < numCoresToConsume; ++coreIndex)
+            {
+                uint32_t numThreadsConsumed = 0;
+
+                spindlePlanHelperSkipExcludedCores(topology, nodeCpuset, taskSpec[taskIndex].coreKindPolicy, &physicalCoreObject, &coresLeftOnCurrentNumaNode, &threadsLeftOnCurrentNumaNode);
+
+                // Calculate the number of threads consumed by the present physical core.
+                numThreadsConsumed = hwloc_get_nbobjs_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU);
+
+                // Add the present physical core to those assigned.
+                taskPhysCoreObjects[nextPhysCoreIndex++] = physicalCoreObject;
+
+                // Update the number of threads assigned to the present task.
+                taskNumThreads[taskIndex] += spindlePlanHelperGetThreadsPerCore(topology, physicalCoreObject, taskSpec[taskIndex].smtPolicy);
+
+                // Deduct from the number of available cores and threads on the present NUMA node.
+                coresLeftOnCurrentNumaNode -= 1;
+                threadsLeftOnCurrentNumaNode -= numThreadsConsumed;
+
+                // Move to the next physical core.
+                physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, physicalCoreObject);
+            }
+        }
+        else
+        {
+            uint32_t numThreadsAssignedForTask = 0;
+            uint32_t numCoresAssignedForTask = 0;
+            uint32_t numCoresToScatterOver = 0;
+
+            // Skip any physical cores of a kind the task does not use before deciding where it starts.
+            spindlePlanHelperSkipExcludedCores(topology, nodeCpuset, taskSpec[taskIndex].coreKindPolicy, &physicalCoreObject, &coresLeftOnCurrentNumaNode, &threadsLeftOnCurrentNumaNode);
+
+            // Start the task at the next cache domain if requested and if it would otherwise straddle two of them needlessly or share one with another task created for a different cache domain.
+            if (SpindleCachePolicyIgnore != taskSpec[taskIndex].cachePolicy)
+                spindlePlanHelperAlignToCacheDomain(topology, nodeCpuset, numThreadsRequested, taskSpec[taskIndex].smtPolicy, taskSpec[taskIndex].cachePolicy, &physicalCoreObject, &coresLeftOnCurrentNumaNode, &threadsLeftOnCurrentNumaNode);
+
+            // Verify a sufficient number of cores and threads left on the current NUMA node.
+            if (threadsLeftOnCurrentNumaNode < numThreadsRequested || (SpindleSMTPolicyDisableSMT == taskSpec[taskIndex].smtPolicy && coresLeftOnCurrentNumaNode < numThreadsRequested))
+            {
+                free((void*)taskAssignmentBuffer);
+                spindlePlanHelperSetError(outError, taskIndex, ((SpindleSMTPolicyDisableSMT == taskSpec[taskIndex].smtPolicy) ? "Not enough physical cores remain on the NUMA node for the requested number of threads." : "Not enough logical cores remain on the NUMA node for the requested number of threads."));
+                return __LINE__;
+            }
+
+            // Scattered tasks occupy every remaining physical core they can, so that their threads can be spread out.
+            if (SpindlePlacementPolicyScatter == taskSpec[taskIndex].placementPolicy)
+            {
+                numCoresToScatterOver = spindlePlanHelperGetAvailableCoreCount(topology, nodeCpuset, physicalCoreObject, &taskSpec[taskIndex]);
+                if (0 == numCoresToScatterOver)
+                {
+                    free((void*)taskAssignmentBuffer);
+                    spindlePlanHelperSetError(outError, taskIndex, "No physical cores remain over which to scatter threads beyond those the task reserves.");
+                    return __LINE__;
+                }
+            }
+
+            // Specify the number of threads for the current task.
+            taskNumThreads[taskIndex] = numThreadsRequested;
+
+            // Assign one physical core at a time to the present task,
+            while ((numThreadsAssignedForTask < numThreadsRequested) || (numCoresAssignedForTask < numCoresToScatterOver))
+            {
+                uint32_t numThreadsConsumed = 0;
+
+                // Physical cores of a kind the task does not use are left unused.
+                spindlePlanHelperSkipExcludedCores(topology, nodeCpuset, taskSpec[taskIndex].coreKindPolicy, &physicalCoreObject, &coresLeftOnCurrentNumaNode, &threadsLeftOnCurrentNumaNode);
+
+                // Check for errors: there needs to be a valid physical core object at this point.
+                if (NULL == physicalCoreObject)
+                {
+                    free((void*)taskAssignmentBuffer);
+                    spindlePlanHelperSetError(outError, taskIndex, ((SpindleCoreKindPolicyAny == taskSpec[taskIndex].coreKindPolicy) ? "The NUMA node ran out of physical cores for the requested number of threads." : "The NUMA node ran out of physical cores of the requested kind for the requested number of threads."));
+                    return __LINE__;
+                }
+
+                // Calculate the number of threads consumed by the present physical core.
+                numThreadsConsumed = hwloc_get_nbobjs_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU);
+
+                // Add the present physical core to those assigned.
+                taskPhysCoreObjects[nextPhysCoreIndex++] = physicalCoreObject;
+
+                // Add to the total number of threads assigned to the present task.
+                numThreadsAssignedForTask += spindlePlanHelperGetThreadsPerCore(topology, physicalCoreObject, taskSpec[taskIndex].smtPolicy);
+
+                // Deduct from the number of available cores and threads on the present NUMA node.
+                numCoresAssignedForTask += 1;
+                coresLeftOnCurrentNumaNode -= 1;
+                threadsLeftOnCurrentNumaNode -= numThreadsConsumed;
+
+                // Move to the next physical core.
+                physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, physicalCoreObject);
+            }
+
+            // A scattered task must fit within the physical cores over which it scatters, leaving those it reserves untouched.
+            if ((0 != numCoresToScatterOver) && (numCoresAssignedForTask > numCoresToScatterOver))
+            {
+                free((void*)taskAssignmentBuffer);
+                spindlePlanHelperSetError(outError, taskIndex, "Not enough cores remain to scatter the requested number of threads without using those the task reserves.");
+                return __LINE__;
+            }
+        }
+
+        taskPhysCoreCount[taskIndex] = nextPhysCoreIndex - taskFirstPhysCore[taskIndex];
+        taskReservedStartPhysCore[taskIndex] = (NULL == physicalCoreObject ? 0 : physicalCoreObject->logical_index);
+
+        // Set aside the physical cores that the task reserves for nested parallel regions, immediately following its own physical cores.
+        for (uint32_t reservedCoreIndex = 0; reservedCoreIndex < taskSpec[taskIndex].reservedCoreCount; ++reservedCoreIndex)
+        {
+            if (NULL == physicalCoreObject)
+            {
+                free((void*)taskAssignmentBuffer);
+                spindlePlanHelperSetError(outError, taskIndex, "Not enough physical cores remain on the NUMA node for those the task reserves.");
+                return __LINE__;
+            }
+
+            coresLeftOnCurrentNumaNode -= 1;
+            threadsLeftOnCurrentNumaNode -= hwloc_get_nbobjs_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU);
+
+            physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, nodeCpuset, HWLOC_OBJ_CORE, physicalCoreObject);
+        }
+
+        // Update the total number of threads created globally.
+        totalNumThreads += taskNumThreads[taskIndex];
+    }
+
+    // Allocate memory for thread assignments.
+    threadAssignments = (SSpindleThreadInfo*)malloc(sizeof(SSpindleThreadInfo) * totalNumThreads);
+    if (NULL == threadAssignments)
+    {
+        free((void*)taskAssignmentBuffer);
+        spindlePlanHelperSetError(outError, kSpindlePlanNoTask, "Out of memory.");
+        return __LINE__;
+    }
+
+    memset((void*)threadAssignments, 0, sizeof(SSpindleThreadInfo) * totalNumThreads);
+
+    // Create thread information for each task.
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+        // Physical cores with differing numbers of logical cores can leave a thread without a logical core to run on.
+        if (false == spindlePlanHelperAssignLogicalCores(topology, &taskPhysCoreObjects[taskFirstPhysCore[taskIndex]], taskPhysCoreCount[taskIndex], taskNumThreads[taskIndex], taskSpec[taskIndex].smtPolicy, taskSpec[taskIndex].placementPolicy, coreThreadCount, &threadAssignments[nextThreadAssignmentIndex]))
+        {
+            free((void*)threadAssignments);
+            free((void*)taskAssignmentBuffer);
+            spindlePlanHelperSetError(outError, taskIndex, "A thread could not be assigned a logical core.");
+            return __LINE__;
+        }
+
+        for (uint32_t threadIndex = 0; threadIndex < taskNumThreads[taskIndex]; ++threadIndex)
+        {
+            threadAssignments[nextThreadAssignmentIndex].func = taskSpec[taskIndex].func;
+            threadAssignments[nextThreadAssignmentIndex].arg = taskSpec[taskIndex].arg;
+            threadAssignments[nextThreadAssignmentIndex].topology = topology;
+            threadAssignments[nextThreadAssignmentIndex].localThreadID = threadIndex;
+            threadAssignments[nextThreadAssignmentIndex].globalThreadID = nextThreadAssignmentIndex;
+            threadAssignments[nextThreadAssignmentIndex].taskID = taskIndex;
+            threadAssignments[nextThreadAssignmentIndex].numaNode = taskSpec[taskIndex].numaNode;
+            threadAssignments[nextThreadAssignmentIndex].localThreadCount = taskNumThreads[taskIndex];
+            threadAssignments[nextThreadAssignmentIndex].globalThreadCount = totalNumThreads;
+            threadAssignments[nextThreadAssignmentIndex].taskCount = taskCount;
+            threadAssignments[nextThreadAssignmentIndex].reservedStartPhysCore = taskReservedStartPhysCore[taskIndex];
+            threadAssignments[nextThreadAssignmentIndex].reservedCoreCount = taskSpec[taskIndex].reservedCoreCount;
+            threadAssignments[nextThreadAssignmentIndex].taskSpecIndex = (NULL == taskSpecIndex ? taskIndex : taskSpecIndex[taskIndex]);
+
+            cacheDomainObject = spindlePlanHelperGetCacheDomainObject(threadAssignments[nextThreadAssignmentIndex].affinityObject);
+            threadAssignments[nextThreadAssignmentIndex].cacheDomain = (NULL == cacheDomainObject ? kSpindleCacheDomainUnknown : cacheDomainObject->logical_index);
+            threadAssignments[nextThreadAssignmentIndex].coreKind = spindlePlanHelperGetCoreKind(topology, hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_CORE, threadAssignments[nextThreadAssignmentIndex].affinityObject));
+
+            nextThreadAssignmentIndex += 1;
+        }
+    }
+
+    // Free buffers no longer needed.
+    free((void*)taskAssignmentBuffer);
+
+    *outThreadAssignments = threadAssignments;
+    *outThreadCount = totalNumThreads;
+    return 0;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+uint32_t spindleTopologyLoadSynthetic(const char* description, TSpindleTopology* topology)
+{
+    hwloc_topology_t syntheticTopology;
+
+    if ((NULL == description) || (NULL == topology))
+        return __LINE__;
+
+    if (0 != hwloc_topology_init(&syntheticTopology))
+        return __LINE__;
+
+    if (0 != hwloc_topology_set_synthetic(syntheticTopology, description))
+    {
+        hwloc_topology_destroy(syntheticTopology);
+        return __LINE__;
+    }
+
+    return spindlePlanHelperLoadTopology(syntheticTopology, topology);
+}
+
+// --------
+
+uint32_t spindleTopologyLoadXML(const char* filePath, TSpindleTopology* topology)
+{
+    hwloc_topology_t xmlTopology;
+
+    if ((NULL == filePath) || (NULL == topology))
+        return __LINE__;
+
+    if (0 != hwloc_topology_init(&xmlTopology))
+        return __LINE__;
+
+    if (0 != hwloc_topology_set_xml(xmlTopology, filePath))
+    {
+        hwloc_topology_destroy(xmlTopology);
+        return __LINE__;
+    }
+
+    return spindlePlanHelperLoadTopology(xmlTopology, topology);
+}
+
+// --------
+
+void spindleTopologyFree(TSpindleTopology topology)
+{
+    if (NULL == topology)
+        return;
+
+    hwloc_topology_destroy(topology->topology);
+    free((void*)topology);
+}
+
+// --------
+
+uint32_t spindlePlanThreads(TSpindleTopology topology, SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, SSpindlePlan* plan)
+{
+    hwloc_topology_t planningTopology = NULL;
+    SSpindleThreadInfo* threadAssignments = NULL;
+    SSpindleTaskConfig* resolvedTaskSpec = NULL;
+    SSpindleTaskConfig* expandedTaskSpec = NULL;
+    uint32_t* taskSpecIndex = NULL;
+    uint32_t expandedTaskCount = 0;
+    uint32_t threadCount = 0;
+    uint32_t planResult = 0;
+    SSpindlePlanError planError;
+
+    if (NULL == plan)
+        return __LINE__;
+
+    memset((void*)plan, 0, sizeof(*plan));
+    plan->taskCount = taskCount;
+    plan->errorTaskID = kSpindlePlanNoTask;
+
+    // Like spawning, an empty plan is trivially a success.
+    if (0 == taskCount)
+        return 0;
+
+    if (taskCount > kSpindleRegionMaxTaskCount)
+    {
+        plan->errorMessage = "Too many tasks are specified.";
+        return __LINE__;
+    }
+
+    planningTopology = (NULL == topology ? topoGetSystemTopologyObject() : topology->topology);
+    if (NULL == planningTopology)
+    {
+        plan->errorMessage = "The system topology could not be obtained.";
+        return __LINE__;
+    }
+
+    planResult = spindlePlanResolveTaskSpecs(taskSpec, taskOptions, taskCount, &resolvedTaskSpec, &planError);
+    if (0 != planResult)
+    {
+        plan->errorTaskID = planError.taskID;
+        plan->errorMessage = planError.message;
+        return planResult;
+    }
+
+    planResult = spindlePlanExpandTaskSpecs(planningTopology, resolvedTaskSpec, taskCount, NULL, &expandedTaskSpec, &taskSpecIndex, &expandedTaskCount, &planError);
+    if (0 != planResult)
+    {
+        free((void*)resolvedTaskSpec);
+        plan->errorTaskID = planError.taskID;
+        plan->errorMessage = planError.message;
+        return planResult;
+    }
+
+    plan->taskCount = expandedTaskCount;
+
+    if (expandedTaskCount > kSpindleRegionMaxTaskCount)
+    {
+        spindlePlanFreeExpandedTaskSpecs(resolvedTaskSpec, expandedTaskSpec, taskSpecIndex);
+        free((void*)resolvedTaskSpec);
+        plan->errorMessage = "Too many tasks result from creating one per cache domain.";
+        return __LINE__;
+    }
+
+    planResult = spindlePlanThreadAssignments(planningTopology, expandedTaskSpec, taskSpecIndex, expandedTaskCount, NULL, &threadAssignments, &threadCount, &planError);
+    if (0 != planResult)
+    {
+        // Errors identify the original task specification, not the one created from it.
+        plan->errorTaskID = ((NULL == taskSpecIndex || kSpindlePlanNoTask == planError.taskID) ? planError.taskID : taskSpecIndex[planError.taskID]);
+        plan->errorMessage = planError.message;
+        spindlePlanFreeExpandedTaskSpecs(resolvedTaskSpec, expandedTaskSpec, taskSpecIndex);
+        free((void*)resolvedTaskSpec);
+        return planResult;
+    }
+
+    spindlePlanFreeExpandedTaskSpecs(resolvedTaskSpec, expandedTaskSpec, taskSpecIndex);
+    free((void*)resolvedTaskSpec);
+
+    plan->threads = (SSpindleThreadPlacement*)malloc(sizeof(SSpindleThreadPlacement) * threadCount);
+    if (NULL == plan->threads)
+    {
+        free((void*)threadAssignments);
+        plan->errorMessage = "Out of memory.";
+        return __LINE__;
+    }
+
+    // Describe each thread's placement using indices that are meaningful outside of Spindle.
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+        spindlePlanHelperDescribePlacement(&threadAssignments[threadIndex], &plan->threads[threadIndex]);
+
+    plan->threadCount = threadCount;
+    free((void*)threadAssignments);
+    return 0;
+}
+
+// --------
+
+void spindlePlanFree(SSpindlePlan* plan)
+{
+    if (NULL == plan)
+        return;
+
+    if (NULL != plan->threads)
+        free((void*)plan->threads);
+
+    plan->threads = NULL;
+    plan->threadCount = 0;
+}
+
+// --------
+
+uint32_t spindleGetCacheDomainID(void)
+{
+    return spindleGetCurrentRegion()->threadAssignments[spindleGetGlobalThreadID()].cacheDomain;
+}
+
+// --------
+
+ESpindleCoreKind spindleGetCoreKind(void)
+{
+    return spindleGetCurrentRegion()->threadAssignments[spindleGetGlobalThreadID()].coreKind;
+}
+
+// --------
+
+bool spindleGetThreadPlacement(uint32_t globalThreadID, SSpindleThreadPlacement* placement)
+{
+    SSpindleRegion* const region = spindleGetCurrentRegion();
+
+    if ((NULL == placement) || (globalThreadID >= region->threadCount))
+        return false;
+
+    spindlePlanHelperDescribePlacement(&region->threadAssignments[globalThreadID], placement);
+    return true;
+}
@@ -0,0 +1,416 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file pool.c
+ *   Implementation of internal persistent thread pool functionality.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "align.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "osthread.h"
+#include "pool.h"
+#include "region.h"
+#include "types.h"
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// -------- LOCALS --------------------------------------------------------- //
+
+/// Nonzero if the persistent thread pool is enabled.
+/// Read by any spawning thread and written by whichever thread enables or disables the pool, so accessed only using acquire loads and release stores.
+static uint32_t poolEnabled = 0;
+
+/// Nonzero while the persistent thread pool is serving a parallel region.
+/// The pool serves only one parallel region at a time, so this is claimed atomically by whichever spawning thread gets there first.
+static uint64_t poolBusy = 0;
+
+/// Array of pointers to the control structures of all pool workers that currently exist.
+static SSpindlePoolWorker** poolWorkers = NULL;
+
+/// Number of pool workers that currently exist.
+static uint32_t poolWorkerCount = 0;
+
+/// Number of pool workers still executing their thread specifications in the current parallel region.
+static volatile uint32_t poolActiveWorkerCount = 0;
+
+/// Nonzero if the controlling thread is, or is about to be, blocked waiting for pool workers to finish.
+static volatile uint32_t poolControllerIsSleeping = 0;
+
+/// Copy of the task specifications that produced the retained thread assignment plan.
+static SSpindleTaskConfig* poolPlanTaskSpec = NULL;
+
+/// Number of tasks in the retained thread assignment plan.
+static uint32_t poolPlanTaskCount = 0;
+
+/// Retained parallel region, which holds the thread assignment plan along with all memory regions allocated for it.
+static SSpindleRegion* poolPlanRegion = NULL;
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Hands a thread specification to a pool worker and wakes it if it is blocked.
+/// @param [in] worker Pool worker control structure.
+/// @param [in] threadSpec Thread specification for the worker to run, or `NULL` to instruct it to terminate.
+static void spindlePoolHelperDispatch(SSpindlePoolWorker* worker, SSpindleThreadInfo* threadSpec)
+{
+    worker->threadSpec = threadSpec;
+    atomic_add32(&worker->dispatchCount, 1);
+
+    if (0 != worker->isSleeping)
+        spindleWakeAddress(&worker->dispatchCount);
+}
+
+/// Creates additional pool workers until the pool contains at least the specified number of workers.
+/// @param [in] workerCount Required number of pool workers.
+/// @return 0 on success, or nonzero in the event of an error.
+static uint32_t spindlePoolHelperGrow(uint32_t workerCount)
+{
+    SSpindlePoolWorker** newPoolWorkers = (SSpindlePoolWorker**)realloc((void*)poolWorkers, sizeof(SSpindlePoolWorker*) * workerCount);
+    if (NULL == newPoolWorkers)
+        return __LINE__;
+
+    poolWorkers = newPoolWorkers;
+
+    while (poolWorkerCount < workerCount)
+    {
+        SSpindlePoolWorker* worker = (SSpindlePoolWorker*)aligned_malloc(sizeof(SSpindlePoolWorker), sizeof(SSpindlePoolWorker));
+        if (NULL == worker)
+            return __LINE__;
+
+        memset((void*)worker, 0, sizeof(SSpindlePoolWorker));
+
+        worker->threadHandle = spindleCreatePoolOSThread(worker);
+        if ((hwloc_thread_t)NULL == worker->threadHandle)
+        {
+            aligned_free((void*)worker);
+            return __LINE__;
+        }
+
+        poolWorkers[poolWorkerCount] = worker;
+        poolWorkerCount += 1;
+    }
+
+    return 0;
+}
+
+/// Frees the retained parallel region, if any, along with its thread assignment plan and all memory regions allocated for it.
+static void spindlePoolHelperReleasePlan(void)
+{
+    if (NULL != poolPlanRegion)
+    {
+        spindleDestroyRegion(poolPlanRegion);
+        free((void*)poolPlanTaskSpec);
+
+        poolPlanRegion = NULL;
+        poolPlanTaskSpec = NULL;
+        poolPlanTaskCount = 0;
+    }
+}
+
+// Every field of a task description except its starting function and argument must be compared below, so this fails to compile as a reminder whenever a field is added.
+_Static_assert(sizeof(SSpindleTaskConfig) == 80, "Compare any new field of SSpindleTaskConfig in spindlePoolHelperTaskSpecsMatch.");
+
+/// Determines if two task specifications would result in the same assignment of threads to cores and the same thread barrier configuration.
+/// Starting functions and arguments are not compared, since they do not affect either.
+/// @param [in] taskSpecA First task specification.
+/// @param [in] taskSpecB Second task specification.
+/// @return `true` if the task specifications produce the same thread assignment and thread barrier configuration, `false` otherwise.
+static bool spindlePoolHelperTaskSpecsMatch(const SSpindleTaskConfig* taskSpecA, const SSpindleTaskConfig* taskSpecB)
+{
+    return ((taskSpecA->numaNode == taskSpecB->numaNode)
+        && (taskSpecA->numThreads == taskSpecB->numThreads)
+        && (taskSpecA->smtPolicy == taskSpecB->smtPolicy)
+        && (taskSpecA->barrierAlgorithm == taskSpecB->barrierAlgorithm)
+        && (taskSpecA->arenaSize == taskSpecB->arenaSize)
+        && (taskSpecA->contextSlotCount == taskSpecB->contextSlotCount)
+        && (taskSpecA->reservedCoreCount == taskSpecB->reservedCoreCount)
+        && (taskSpecA->cachePolicy == taskSpecB->cachePolicy)
+        && (taskSpecA->placementPolicy == taskSpecB->placementPolicy)
+        && (taskSpecA->numaNodeMask == taskSpecB->numaNodeMask)
+        && (taskSpecA->coreKindPolicy == taskSpecB->coreKindPolicy)
+        && (taskSpecA->barrierWaitPolicy == taskSpecB->barrierWaitPolicy)
+        && (taskSpecA->barrierSpinIterations == taskSpecB->barrierSpinIterations));
+}
+
+/// Waits for the value at the specified address to differ from the specified value.
+/// Spins for a while, then blocks in the operating system, setting the specified flag while blocked so that the writer knows a wake-up is required.
+/// @param [in] address Address of the value to monitor.
+/// @param [in] value Value that, while present at the address, causes the calling thread to keep waiting.
+/// @param [in] sleepFlag Flag to set while blocked in the operating system.
+/// @param [in] spinLimit Number of spin-wait iterations to perform before blocking, or 0 to block right away.
+static void spindlePoolHelperWaitWhileEqual(volatile uint32_t* address, uint32_t value, volatile uint32_t* sleepFlag, uint32_t spinLimit)
+{
+    for (uint32_t i = 0; i < spinLimit; ++i)
+    {
+        if (value != *address)
+            return;
+
+        spin_pause();
+    }
+
+    while (value == *address)
+    {
+        // The fence ensures the writer either sees the flag or the re-check below sees the writer's update.
+        *sleepFlag = 1;
+        atomic_fence();
+
+        if (value == *address)
+            spindleWaitOnAddress(address, value);
+
+        *sleepFlag = 0;
+    }
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "pool.h" for documentation.
+
+bool spindlePoolAcquire(void)
+{
+    if (0 == atomic_load32_acquire(&poolEnabled))
+        return false;
+
+    if (!atomic_cas64(&poolBusy, (uint64_t)0, (uint64_t)1))
+        return false;
+
+    // The pool might have been disabled between the check above and claiming it.
+    if (0 == atomic_load32_acquire(&poolEnabled))
+    {
+        spindlePoolRelease();
+        return false;
+    }
+
+    return true;
+}
+
+// --------
+
+void spindlePoolRelease(void)
+{
+    atomic_store64_release(&poolBusy, (uint64_t)0);
+}
+
+// --------
+
+void spindlePoolRetainPlan(SSpindleTaskConfig* taskSpec, uint32_t taskCount, SSpindleRegion* region)
+{
+    SSpindleTaskConfig* planTaskSpec = NULL;
+
+    // Nothing to do if the region being retained is the one that was just reused.
+    if (region == poolPlanRegion)
+        return;
+
+    spindlePoolHelperReleasePlan();
+
+    planTaskSpec = (SSpindleTaskConfig*)malloc(sizeof(SSpindleTaskConfig) * taskCount);
+    if (NULL == planTaskSpec)
+    {
+        spindleDestroyRegion(region);
+        return;
+    }
+
+    memcpy((void*)planTaskSpec, (void*)taskSpec, sizeof(SSpindleTaskConfig) * taskCount);
+
+    poolPlanTaskSpec = planTaskSpec;
+    poolPlanTaskCount = taskCount;
+    poolPlanRegion = region;
+}
+
+// --------
+
+SSpindleRegion* spindlePoolReusePlan(SSpindleTaskConfig* taskSpec, uint32_t taskCount)
+{
+    if (NULL != poolPlanRegion && taskCount == poolPlanTaskCount)
+    {
+        bool planMatches = true;
+
+        for (uint32_t taskIndex = 0; taskIndex < taskCount && planMatches; ++taskIndex)
+            planMatches = spindlePoolHelperTaskSpecsMatch(&taskSpec[taskIndex], &poolPlanTaskSpec[taskIndex]);
+
+        if (planMatches)
+        {
+            SSpindleThreadInfo* const threadAssignments = poolPlanRegion->threadAssignments;
+
+            // Only the starting functions and arguments can differ, so refresh them from the new task specifications.
+            for (uint32_t threadIndex = 0; threadIndex < poolPlanRegion->threadCount; ++threadIndex)
+            {
+                threadAssignments[threadIndex].func = taskSpec[threadAssignments[threadIndex].taskSpecIndex].func;
+                threadAssignments[threadIndex].arg = taskSpec[threadAssignments[threadIndex].taskSpecIndex].arg;
+            }
+
+            return poolPlanRegion;
+        }
+    }
+
+    spindlePoolHelperReleasePlan();
+    return NULL;
+}
+
+// --------
+
+uint32_t spindlePoolRunThreads(SSpindleThreadInfo* threadSpec, uint32_t threadCount, bool useCurrentThread)
+{
+    const uint32_t firstPooledThread = (useCurrentThread ? 1 : 0);
+    const uint32_t numWorkersNeeded = threadCount - firstPooledThread;
+
+    // Make sure enough workers exist to run all the threads that the calling thread is not running itself.
+    if (numWorkersNeeded > poolWorkerCount)
+    {
+        const uint32_t growResult = spindlePoolHelperGrow(numWorkersNeeded);
+        if (0 != growResult)
+            return growResult;
+    }
+
+    // Wake up the required workers, one thread specification each.
+    poolActiveWorkerCount = numWorkersNeeded;
+
+    for (uint32_t i = 0; i < numWorkersNeeded; ++i)
+    {
+        threadSpec[firstPooledThread + i].threadHandle = poolWorkers[i]->threadHandle;
+        spindlePoolHelperDispatch(poolWorkers[i], &threadSpec[firstPooledThread + i]);
+    }
+
+    if (useCurrentThread)
+    {
+        threadSpec[0].threadHandle = spindleIdentifyCurrentOSThread();
+        spindleRunThreadSpec(&threadSpec[0]);
+    }
+
+    // Wait for all workers to report completion.
+    // A calling thread that took part in the parallel region occupies its own core, so it waits the way the region's barriers do: spinning until done under the spin policy, or spinning first and then blocking.
+    // Otherwise the calling thread is not affinitized and would take a core away from a worker, so it blocks right away.
+    if (useCurrentThread)
+    {
+        const uint32_t spinLimit = threadSpec[0].region->barrierSpinLimit;
+
+        for (uint32_t i = 0; (0 != poolActiveWorkerCount) && ((0 == spinLimit) || (i < spinLimit)); ++i)
+            spin_pause();
+    }
+
+    while (0 != poolActiveWorkerCount)
+    {
+        const uint32_t activeWorkerCount = poolActiveWorkerCount;
+
+        poolControllerIsSleeping = 1;
+        atomic_fence();
+
+        if (activeWorkerCount == poolActiveWorkerCount)
+            spindleWaitOnAddress(&poolActiveWorkerCount, activeWorkerCount);
+
+        poolControllerIsSleeping = 0;
+    }
+
+    return 0;
+}
+
+// --------
+
+void spindlePoolWorkerMain(SSpindlePoolWorker* worker)
+{
+    uint32_t dispatchCount = 0;
+    uint32_t spinLimit = 0;
+
+    while (true)
+    {
+        SSpindleThreadInfo* threadSpec = NULL;
+
+        // Park until the controlling thread dispatches work, spinning first only after a parallel region whose barriers do so.
+        spindlePoolHelperWaitWhileEqual(&worker->dispatchCount, dispatchCount, &worker->isSleeping, spinLimit);
+        dispatchCount = worker->dispatchCount;
+
+        // A missing thread specification is the signal to terminate.
+        threadSpec = worker->threadSpec;
+        if (NULL == threadSpec)
+            break;
+
+        // System calls to affinitize are only needed if the worker is moving to a different PU.
+        if (threadSpec->affinityObject != worker->affinityObject)
+        {
+            spindleAffinitizeCurrentOSThread(threadSpec->topology, threadSpec->affinityObject);
+            worker->affinityObject = threadSpec->affinityObject;
+        }
+
+        // Spinning while parked keeps back-to-back parallel regions from paying for an operating system wake-up, but without blocking it would occupy the core forever, so a region that never blocks at barriers gets the default limit.
+        // The region may be freed as soon as completion is reported, so its waiting policy is captured now.
+        spinLimit = threadSpec->region->barrierSpinLimit;
+        if (0 == spinLimit)
+            spinLimit = kSpindleBarrierDefaultSpinIterations;
+
+        spindleExecuteThreadSpec(threadSpec);
+
+        // Report completion. The last worker to finish wakes the controlling thread if it is blocked.
+        if (0 == atomic_add32(&poolActiveWorkerCount, -1) && 0 != poolControllerIsSleeping)
+            spindleWakeAddress(&poolActiveWorkerCount);
+    }
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+uint32_t spindleThreadPoolDisable(void)
+{
+    uint32_t result = 0;
+
+    if (false != spindleIsInParallelRegion())
+        return __LINE__;
+
+    if (0 == atomic_load32_acquire(&poolEnabled))
+        return 0;
+
+    // The pool cannot be torn down while another OS thread is using it to run a parallel region.
+    if (!atomic_cas64(&poolBusy, (uint64_t)0, (uint64_t)1))
+        return __LINE__;
+
+    // Instruct each worker to terminate and wait for it to do so.
+    for (uint32_t i = 0; i < poolWorkerCount; ++i)
+    {
+        spindlePoolHelperDispatch(poolWorkers[i], NULL);
+
+        if (0 != spindleJoinPoolOSThread(poolWorkers[i]))
+            result = __LINE__;
+
+        aligned_free((void*)poolWorkers[i]);
+    }
+
+    free((void*)poolWorkers);
+    poolWorkers = NULL;
+    poolWorkerCount = 0;
+
+    spindlePoolHelperReleasePlan();
+    atomic_store32_release(&poolEnabled, 0);
+
+    spindlePoolRelease();
+    return result;
+}
+
+// --------
+
+uint32_t spindleThreadPoolEnable(void)
+{
+    if (false != spindleIsInParallelRegion())
+        return __LINE__;
+
+    atomic_store32_release(&poolEnabled, 1);
+    return 0;
+}
+
+// --------
+
+bool spindleThreadPoolIsEnabled(void)
+{
+    return (0 != atomic_load32_acquire(&poolEnabled));
+}
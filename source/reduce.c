@@ -0,0 +1,537 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file reduce.c
+ *   Implementation of reductions, scans, and gathers across threads.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "align.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "reduce.h"
+#include "region.h"
+#include "types.h"
+
+#include <malloc.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// -------- TYPE DEFINITIONS ----------------------------------------------- //
+
+/// Enumerates the results a thread can request from a reduction or scan.
+typedef enum ESpindleReduceResult
+{
+    SpindleReduceResultTotal,                                               ///< Combination of all values.
+    SpindleReduceResultExclusiveScan,                                       ///< Combination of the values of all preceding threads.
+    SpindleReduceResultInclusiveScan                                        ///< Combination of the values of all preceding threads and the calling thread.
+} ESpindleReduceResult;
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Combines two values using the specified operation.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] isDouble `true` if the values hold the binary representations of double-precision values, `false` if they are 64-bit integers.
+/// @param [in] a First value, which is treated as the left operand.
+/// @param [in] b Second value, which is treated as the right operand.
+/// @return Combination of the two values.
+static uint64_t spindleHelperReduceCombine(ESpindleReduceOp op, bool isDouble, uint64_t a, uint64_t b)
+{
+    switch (op)
+    {
+    case SpindleReduceOpBitAnd:
+        return a & b;
+
+    case SpindleReduceOpBitOr:
+        return a | b;
+
+    case SpindleReduceOpBitXor:
+        return a ^ b;
+
+    default:
+        break;
+    }
+
+    if (isDouble)
+    {
+        double da, db;
+
+        memcpy((void*)&da, (const void*)&a, sizeof(da));
+        memcpy((void*)&db, (const void*)&b, sizeof(db));
+
+        switch (op)
+        {
+        case SpindleReduceOpSum:
+            da = da + db;
+            break;
+
+        case SpindleReduceOpMin:
+            da = (db < da ? db : da);
+            break;
+
+        case SpindleReduceOpMax:
+            da = (db > da ? db : da);
+            break;
+
+        default:
+            break;
+        }
+
+        memcpy((void*)&a, (const void*)&da, sizeof(a));
+        return a;
+    }
+
+    switch (op)
+    {
+    case SpindleReduceOpSum:
+        return a + b;
+
+    case SpindleReduceOpMin:
+        return ((int64_t)b < (int64_t)a ? b : a);
+
+    case SpindleReduceOpMax:
+        return ((int64_t)b > (int64_t)a ? b : a);
+
+    default:
+        return a;
+    }
+}
+
+// --------
+
+/// Retrieves the identity value of the specified operation, which is the result of an exclusive scan for the first thread.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] isDouble `true` for the binary representation of a double-precision identity value, `false` for a 64-bit integer identity value.
+/// @return Identity value.
+static uint64_t spindleHelperReduceIdentity(ESpindleReduceOp op, bool isDouble)
+{
+    double identity;
+    uint64_t identityBits;
+
+    switch (op)
+    {
+    case SpindleReduceOpBitAnd:
+        return ~((uint64_t)0);
+
+    case SpindleReduceOpMin:
+        if (!isDouble)
+            return (uint64_t)INT64_MAX;
+        identity = HUGE_VAL;
+        break;
+
+    case SpindleReduceOpMax:
+        if (!isDouble)
+            return (uint64_t)INT64_MIN;
+        identity = -HUGE_VAL;
+        break;
+
+    case SpindleReduceOpSum:
+        if (!isDouble)
+            return 0;
+        identity = 0.0;
+        break;
+
+    default:
+        return 0;
+    }
+
+    memcpy((void*)&identityBits, (const void*)&identity, sizeof(identityBits));
+    return identityBits;
+}
+
+// --------
+
+/// Arrives at the specified coordination region, as part of a barrier episode.
+/// The calling thread's contribution must already be in its slot, since arrival is a full memory barrier that makes it visible to whichever thread arrives last.
+/// @param [in] control Coordination region for the set of threads.
+/// @return `true` if the calling thread is the last to arrive and must release the others, `false` otherwise.
+static inline bool spindleHelperReduceArrive(SSpindleReduceControl* control)
+{
+    return (0 == atomic_add32(&control->counter, -1));
+}
+
+// --------
+
+/// Completes the current barrier episode at the specified coordination region, publishing all prior writes and releasing all other threads.
+/// Must be called only by the last thread to arrive.
+/// @param [in] control Coordination region for the set of threads.
+/// @param [in] flagValue Value of the flag observed before arriving.
+static void spindleHelperReduceRelease(SSpindleReduceControl* control, uint32_t flagValue)
+{
+    control->counter = control->threadCount;
+    atomic_store32_release(&control->flag, flagValue + 1);
+
+    if (0 != control->spinLimit)
+        spindleBarrierWakeFlag(&control->flag);
+}
+
+// --------
+
+/// Waits for the current barrier episode at the specified coordination region to complete, according to the current barrier waiting policy.
+/// @param [in] control Coordination region for the set of threads.
+/// @param [in] flagValue Value of the flag observed before arriving.
+static void spindleHelperReduceWait(SSpindleReduceControl* control, uint32_t flagValue)
+{
+    uint32_t currentFlagValue;
+
+    while (flagValue == (currentFlagValue = atomic_load32_acquire(&control->flag)))
+    {
+        if (0 != control->spinLimit)
+            spindleBarrierWaitFlag(&control->flag, currentFlagValue);
+        else
+            spindleBarrierSpinFlag(&control->flag, currentFlagValue);
+    }
+}
+
+// --------
+
+/// Performs a barrier among a set of threads, during which the last thread to arrive invokes the specified function before releasing the others.
+/// @param [in] control Coordination region for the set of threads.
+/// @param [in] action Function to invoke.
+/// @param [in] arg Argument to pass to the function.
+static void spindleHelperCollectiveBarrier(SSpindleReduceControl* control, TSpindleFunc action, void* arg)
+{
+    const uint32_t flagValue = atomic_load32_acquire(&control->flag);
+
+    if (spindleHelperReduceArrive(control))
+    {
+        action(arg);
+        spindleHelperReduceRelease(control, flagValue);
+    }
+    else
+    {
+        spindleHelperReduceWait(control, flagValue);
+    }
+}
+
+// --------
+
+/// Performs a gather among a set of threads.
+/// Each thread deposits its value into its own slot and then arrives at what is otherwise a centralized barrier.
+/// Once released, threads that requested the gathered values copy them out of all the slots in slot order.
+/// @param [in] control Coordination region for the set of threads.
+/// @param [in] threadIndex Index of the calling thread within the set of threads.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [out] values Array to fill with the values contributed by all threads, in slot order, or `NULL` if the calling thread does not need them.
+static void spindleHelperGather(SSpindleReduceControl* control, uint32_t threadIndex, uint64_t value, uint64_t* values)
+{
+    SSpindleReduceSlot* const slots = &spindleGetCurrentRegion()->reduceSlotBase[control->slotBase];
+    const uint32_t flagValue = atomic_load32_acquire(&control->flag);
+    const uint32_t parity = flagValue & 1;
+
+    slots[threadIndex].gatherValue[parity] = value;
+
+    if (spindleHelperReduceArrive(control))
+        spindleHelperReduceRelease(control, flagValue);
+    else
+        spindleHelperReduceWait(control, flagValue);
+
+    if (NULL != values)
+    {
+        const uint32_t threadCount = control->threadCount;
+
+        for (uint32_t slotIndex = 0; slotIndex < threadCount; ++slotIndex)
+            values[slotIndex] = slots[slotIndex].gatherValue[parity];
+    }
+}
+
+// --------
+
+/// Performs a reduction or scan among a set of threads.
+/// Each thread deposits its value into its own slot and then arrives at what is otherwise a centralized barrier.
+/// The last thread to arrive combines all the values in slot order, which makes the result independent of arrival order, and then releases the others.
+/// @param [in] control Coordination region for the set of threads.
+/// @param [in] threadIndex Index of the calling thread within the set of threads.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] isDouble `true` if the values hold the binary representations of double-precision values, `false` if they are 64-bit integers.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [in] resultType Result to return to the calling thread.
+/// @return Requested result.
+static uint64_t spindleHelperReduce(SSpindleReduceControl* control, uint32_t threadIndex, ESpindleReduceOp op, bool isDouble, uint64_t value, ESpindleReduceResult resultType)
+{
+    SSpindleReduceSlot* const slots = &spindleGetCurrentRegion()->reduceSlotBase[control->slotBase];
+    const uint32_t flagValue = atomic_load32_acquire(&control->flag);
+
+    slots[threadIndex].value = value;
+
+    if (spindleHelperReduceArrive(control))
+    {
+        const uint32_t threadCount = control->threadCount;
+        uint64_t accumulator = slots[0].value;
+
+        if (SpindleReduceResultTotal == resultType)
+        {
+            for (uint32_t slotIndex = 1; slotIndex < threadCount; ++slotIndex)
+                accumulator = spindleHelperReduceCombine(op, isDouble, accumulator, slots[slotIndex].value);
+        }
+        else
+        {
+            slots[0].exclusiveScan = spindleHelperReduceIdentity(op, isDouble);
+            slots[0].inclusiveScan = accumulator;
+
+            for (uint32_t slotIndex = 1; slotIndex < threadCount; ++slotIndex)
+            {
+                slots[slotIndex].exclusiveScan = accumulator;
+                accumulator = spindleHelperReduceCombine(op, isDouble, accumulator, slots[slotIndex].value);
+                slots[slotIndex].inclusiveScan = accumulator;
+            }
+        }
+
+        // Releasing the other threads publishes the result and all scan values.
+        control->result = accumulator;
+        spindleHelperReduceRelease(control, flagValue);
+    }
+    else
+    {
+        spindleHelperReduceWait(control, flagValue);
+    }
+
+    switch (resultType)
+    {
+    case SpindleReduceResultExclusiveScan:
+        return slots[threadIndex].exclusiveScan;
+
+    case SpindleReduceResultInclusiveScan:
+        return slots[threadIndex].inclusiveScan;
+
+    default:
+        return control->result;
+    }
+}
+
+// --------
+
+/// Performs a reduction or scan among all threads in the calling thread's task.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] isDouble `true` if the values hold the binary representations of double-precision values, `false` if they are 64-bit integers.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [in] resultType Result to return to the calling thread.
+/// @return Requested result.
+static inline uint64_t spindleHelperReduceLocal(ESpindleReduceOp op, bool isDouble, uint64_t value, ESpindleReduceResult resultType)
+{
+    return spindleHelperReduce(&spindleGetCurrentRegion()->reduceControlBase[spindleGetTaskID()], spindleGetLocalThreadID(), op, isDouble, value, resultType);
+}
+
+// --------
+
+/// Performs a reduction or scan among all threads.
+/// @param [in] op Operation to use for combining values.
+/// @param [in] isDouble `true` if the values hold the binary representations of double-precision values, `false` if they are 64-bit integers.
+/// @param [in] value Value contributed by the calling thread.
+/// @param [in] resultType Result to return to the calling thread.
+/// @return Requested result.
+static inline uint64_t spindleHelperReduceGlobal(ESpindleReduceOp op, bool isDouble, uint64_t value, ESpindleReduceResult resultType)
+{
+    return spindleHelperReduce(&spindleGetCurrentRegion()->reduceControlBase[spindleGetTaskCount()], spindleGetGlobalThreadID(), op, isDouble, value, resultType);
+}
+
+// --------
+
+/// Converts a double-precision value to its binary representation.
+/// @param [in] value Double-precision value.
+/// @return Binary representation.
+static inline uint64_t spindleHelperReduceDoubleToBits(double value)
+{
+    uint64_t bits;
+    memcpy((void*)&bits, (const void*)&value, sizeof(bits));
+    return bits;
+}
+
+// --------
+
+/// Converts the binary representation of a double-precision value back to the value itself.
+/// @param [in] bits Binary representation.
+/// @return Double-precision value.
+static inline double spindleHelperReduceBitsToDouble(uint64_t bits)
+{
+    double value;
+    memcpy((void*)&value, (const void*)&bits, sizeof(value));
+    return value;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "reduce.h" for documentation.
+
+void* spindleAllocateReduceBuffers(SSpindleRegion* region, SSpindleThreadInfo* threadAssignments, uint32_t threadCount, uint32_t taskCount)
+{
+    uint32_t nextSlotBase = 0;
+
+    if (NULL != region->reduceControlBase)
+        return region->reduceControlBase;
+
+    // One coordination region per task, plus one for global reductions.
+    region->reduceControlBase = (SSpindleReduceControl*)aligned_malloc(sizeof(SSpindleReduceControl) * (1 + taskCount), sizeof(SSpindleReduceControl));
+    if (NULL == region->reduceControlBase)
+        return NULL;
+
+    // Each thread gets one slot for local reductions and one for global reductions.
+    region->reduceSlotBase = (SSpindleReduceSlot*)aligned_malloc(sizeof(SSpindleReduceSlot) * 2 * threadCount, sizeof(SSpindleReduceSlot));
+    if (NULL == region->reduceSlotBase)
+    {
+        aligned_free((void*)region->reduceControlBase);
+        region->reduceControlBase = NULL;
+        return NULL;
+    }
+
+    memset((void*)region->reduceControlBase, 0, sizeof(SSpindleReduceControl) * (1 + taskCount));
+    region->reduceControlCount = 1 + taskCount;
+
+    // The first thread of each task identifies the number of threads for the whole task.
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        if (0 != threadAssignments[threadIndex].localThreadID)
+            continue;
+
+        region->reduceControlBase[threadAssignments[threadIndex].taskID].threadCount = threadAssignments[threadIndex].localThreadCount;
+        region->reduceControlBase[threadAssignments[threadIndex].taskID].slotBase = nextSlotBase;
+        nextSlotBase += threadAssignments[threadIndex].localThreadCount;
+    }
+
+    region->reduceControlBase[taskCount].threadCount = threadCount;
+    region->reduceControlBase[taskCount].slotBase = threadCount;
+
+    spindleInitializeReduceBuffers(region);
+    return region->reduceControlBase;
+}
+
+// --------
+
+void spindleCollectiveBarrierLocal(TSpindleFunc action, void* arg)
+{
+    spindleHelperCollectiveBarrier(&spindleGetCurrentRegion()->reduceControlBase[spindleGetTaskID()], action, arg);
+}
+
+// --------
+
+void spindleCollectiveBarrierGlobal(TSpindleFunc action, void* arg)
+{
+    spindleHelperCollectiveBarrier(&spindleGetCurrentRegion()->reduceControlBase[spindleGetTaskCount()], action, arg);
+}
+
+// --------
+
+void spindleFreeReduceBuffers(SSpindleRegion* region)
+{
+    if (NULL != region->reduceControlBase)
+    {
+        aligned_free((void*)region->reduceControlBase);
+        aligned_free((void*)region->reduceSlotBase);
+
+        region->reduceControlBase = NULL;
+        region->reduceSlotBase = NULL;
+        region->reduceControlCount = 0;
+    }
+}
+
+// --------
+
+void spindleInitializeReduceBuffers(SSpindleRegion* region)
+{
+    for (uint32_t controlIndex = 0; controlIndex < region->reduceControlCount; ++controlIndex)
+    {
+        region->reduceControlBase[controlIndex].counter = region->reduceControlBase[controlIndex].threadCount;
+        region->reduceControlBase[controlIndex].flag = 0;
+        region->reduceControlBase[controlIndex].flagSleepCount = 0;
+        region->reduceControlBase[controlIndex].spinLimit = region->barrierSpinLimit;
+    }
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+int64_t spindleReduceLocalInt(ESpindleReduceOp op, int64_t value)
+{
+    return (int64_t)spindleHelperReduceLocal(op, false, (uint64_t)value, SpindleReduceResultTotal);
+}
+
+// --------
+
+int64_t spindleReduceGlobalInt(ESpindleReduceOp op, int64_t value)
+{
+    return (int64_t)spindleHelperReduceGlobal(op, false, (uint64_t)value, SpindleReduceResultTotal);
+}
+
+// --------
+
+double spindleReduceLocalDouble(ESpindleReduceOp op, double value)
+{
+    return spindleHelperReduceBitsToDouble(spindleHelperReduceLocal(op, true, spindleHelperReduceDoubleToBits(value), SpindleReduceResultTotal));
+}
+
+// --------
+
+double spindleReduceGlobalDouble(ESpindleReduceOp op, double value)
+{
+    return spindleHelperReduceBitsToDouble(spindleHelperReduceGlobal(op, true, spindleHelperReduceDoubleToBits(value), SpindleReduceResultTotal));
+}
+
+// --------
+
+int64_t spindleScanLocalInt(ESpindleReduceOp op, int64_t value, bool inclusive)
+{
+    return (int64_t)spindleHelperReduceLocal(op, false, (uint64_t)value, (inclusive ? SpindleReduceResultInclusiveScan : SpindleReduceResultExclusiveScan));
+}
+
+// --------
+
+int64_t spindleScanGlobalInt(ESpindleReduceOp op, int64_t value, bool inclusive)
+{
+    return (int64_t)spindleHelperReduceGlobal(op, false, (uint64_t)value, (inclusive ? SpindleReduceResultInclusiveScan : SpindleReduceResultExclusiveScan));
+}
+
+// --------
+
+double spindleScanLocalDouble(ESpindleReduceOp op, double value, bool inclusive)
+{
+    return spindleHelperReduceBitsToDouble(spindleHelperReduceLocal(op, true, spindleHelperReduceDoubleToBits(value), (inclusive ? SpindleReduceResultInclusiveScan : SpindleReduceResultExclusiveScan)));
+}
+
+// --------
+
+double spindleScanGlobalDouble(ESpindleReduceOp op, double value, bool inclusive)
+{
+    return spindleHelperReduceBitsToDouble(spindleHelperReduceGlobal(op, true, spindleHelperReduceDoubleToBits(value), (inclusive ? SpindleReduceResultInclusiveScan : SpindleReduceResultExclusiveScan)));
+}
+
+// --------
+
+void spindleAllGatherLocal(uint64_t value, uint64_t* values)
+{
+    spindleHelperGather(&spindleGetCurrentRegion()->reduceControlBase[spindleGetTaskID()], spindleGetLocalThreadID(), value, values);
+}
+
+// --------
+
+void spindleAllGatherGlobal(uint64_t value, uint64_t* values)
+{
+    spindleHelperGather(&spindleGetCurrentRegion()->reduceControlBase[spindleGetTaskCount()], spindleGetGlobalThreadID(), value, values);
+}
+
+// --------
+
+void spindleGatherLocal(uint64_t value, uint64_t* values, uint32_t rootLocalThreadID)
+{
+    const uint32_t localThreadID = spindleGetLocalThreadID();
+    spindleHelperGather(&spindleGetCurrentRegion()->reduceControlBase[spindleGetTaskID()], localThreadID, value, (rootLocalThreadID == localThreadID ? values : NULL));
+}
+
+// --------
+
+void spindleGatherGlobal(uint64_t value, uint64_t* values, uint32_t rootGlobalThreadID)
+{
+    const uint32_t globalThreadID = spindleGetGlobalThreadID();
+    spindleHelperGather(&spindleGetCurrentRegion()->reduceControlBase[spindleGetTaskCount()], globalThreadID, value, (rootGlobalThreadID == globalThreadID ? values : NULL));
+}
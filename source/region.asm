@@ -0,0 +1,62 @@
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Spindle
+;   Multi-platform topology-aware thread control library.
+;   Distributes a set of synchronized tasks over cores in the system.
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Authored by Samuel Grossman
+; Department of Electrical Engineering, Stanford University
+; Copyright (c) 2016-2017
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; region.asm
+;   Implementation of internal parallel region lookup functionality.
+;   Also implements the external API functions that locate the calling thread's context block by way of its parallel region.
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+INCLUDE helpers.inc
+INCLUDE region.inc
+INCLUDE registers.inc
+
+
+EXTRN spindleRegionTable:QWORD
+
+
+_TEXT                                       SEGMENT
+
+
+; --------- FUNCTIONS ---------------------------------------------------------
+; See "region.h" for documentation.
+
+spindleGetCurrentRegion                     PROC PUBLIC
+    spindleAsmHelperGetRegion                       r_retval, e_retval, r11
+    ret
+spindleGetCurrentRegion                     ENDP
+
+
+; --------- FUNCTIONS ---------------------------------------------------------
+; See "spindle.h" for documentation.
+
+spindleGetContextBlock                      PROC PUBLIC
+    ; The context block of the calling thread is found in its parallel region, indexed by global thread ID.
+    ; Both come from the register that holds thread information, so returning from a nested parallel region restores the correct block automatically.
+    spindleAsmHelperGetRegion                       r_retval, e_retval, r11
+    spindleAsmHelperGetGlobalThreadID               r10d
+    mov                     rax,                    QWORD PTR [rax+kSpindleRegionContextThreadBlock]
+    mov                     rax,                    QWORD PTR [rax+8*r10]
+    ret
+spindleGetContextBlock                      ENDP
+
+; ---------
+
+spindleGetContextSlotCount                  PROC PUBLIC
+    spindleAsmHelperGetRegion                       r_retval, e_retval, r11
+    spindleAsmHelperGetGlobalThreadID               r10d
+    mov                     rax,                    QWORD PTR [rax+kSpindleRegionContextThreadSlotCount]
+    mov                     eax,                    DWORD PTR [rax+4*r10]
+    ret
+spindleGetContextSlotCount                  ENDP
+
+
+_TEXT                                       ENDS
+
+
+END
@@ -0,0 +1,142 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file region.c
+ *   Implementation of internal parallel region context functionality.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "align.h"
+#include "arena.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "barriergroup.h"
+#include "barrierstats.h"
+#include "context.h"
+#include "datashare.h"
+#include "loop.h"
+#include "osthread.h"
+#include "reduce.h"
+#include "region.h"
+#include "threadlocal.h"
+#include "trace.h"
+#include "types.h"
+#include "work.h"
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// -------- GLOBALS -------------------------------------------------------- //
+// See "region.h" for documentation.
+
+SSpindleRegion* spindleRegionTable[kSpindleRegionTableSize];
+
+
+// -------- LOCALS --------------------------------------------------------- //
+
+/// Specifies whether the calling OS thread is executing within a Spindle parallel region.
+/// Each OS thread has its own instance, so parallel regions spawned by different OS threads do not interfere with each other.
+static spindle_thread_local bool inParallelRegion = false;
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "region.h" for documentation.
+
+SSpindleRegion* spindleCreateRegion(void)
+{
+    SSpindleRegion* region = (SSpindleRegion*)aligned_malloc(sizeof(SSpindleRegion), sizeof(SSpindleBarrierData));
+    if (NULL == region)
+        return NULL;
+
+    memset((void*)region, 0, sizeof(SSpindleRegion));
+
+    // Claim the first unused entry in the region table, competing with any other OS threads doing the same.
+    for (uint32_t regionIndex = 0; regionIndex < kSpindleRegionTableSize; ++regionIndex)
+    {
+        if ((NULL == spindleRegionTable[regionIndex]) && atomic_cas64((uint64_t*)&spindleRegionTable[regionIndex], (uint64_t)0, (uint64_t)(uintptr_t)region))
+        {
+            region->index = regionIndex;
+            return region;
+        }
+    }
+
+    aligned_free((void*)region);
+    return NULL;
+}
+
+// --------
+
+void spindleDestroyRegion(SSpindleRegion* region)
+{
+    spindleFreeDataShareBuffers(region);
+    spindleFreeLocalThreadBarriers(region);
+    spindleFreeNodeThreadBarriers(region);
+    spindleFreeBarrierGroups(region);
+    spindleFreeReduceBuffers(region);
+    spindleFreeLoopShares(region);
+    spindleFreeWorkDeques(region);
+    spindleFreeArenas(region);
+    spindleFreeContextBlocks(region);
+    spindleFreeBarrierStats(region);
+    spindleFreeTraceBuffers(region);
+
+    free((void*)region->threadAssignments);
+
+    // All threads of the parallel region have terminated, so nothing can still be looking up its entry in the region table.
+    spindleRegionTable[region->index] = NULL;
+    aligned_free((void*)region);
+}
+
+// --------
+
+void spindleSignalRegionCompletion(SSpindleRegion* region)
+{
+    atomic_store32_release(&region->completionFlag, 1);
+    atomic_fence();
+
+    if (0 != region->completionWaiterIsSleeping)
+        spindleWakeAddress(&region->completionFlag);
+}
+
+// --------
+
+bool spindleWaitForRegionCompletion(SSpindleRegion* region, uint32_t timeoutMilliseconds)
+{
+    if ((0 != atomic_load32_acquire(&region->completionFlag)) || (0 == timeoutMilliseconds))
+        return (0 != atomic_load32_acquire(&region->completionFlag));
+
+    // Announce the intent to block before checking the flag again, so that the last thread to finish cannot miss the wake-up.
+    region->completionWaiterIsSleeping = 1;
+    atomic_fence();
+
+    spindleWaitOnAddressTimeout(&region->completionFlag, 0, timeoutMilliseconds);
+
+    region->completionWaiterIsSleeping = 0;
+    return (0 != atomic_load32_acquire(&region->completionFlag));
+}
+
+// --------
+
+void spindleSetInParallelRegion(bool value)
+{
+    inParallelRegion = value;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+bool spindleIsInParallelRegion(void)
+{
+    return inParallelRegion;
+}
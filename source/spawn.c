@@ -12,414 +12,401 @@
  *****************************************************************************/
 
 #include "../spindle.h"
+#include "arena.h"
 #include "barrier.h"
+#include "barriergroup.h"
+#include "barrierstats.h"
+#include "context.h"
 #include "datashare.h"
+#include "init.h"
+#include "loop.h"
 #include "osthread.h"
+#include "plan.h"
+#include "pool.h"
+#include "reduce.h"
+#include "region.h"
+#include "timestamp.h"
+#include "trace.h"
 #include "types.h"
+#include "work.h"
 
 #include <hwloc.h>
-#include <malloc.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <topo.h>
 
 
-// -------- LOCALS --------------------------------------------------------- //
-
-/// Specifies whether execution is taking place within a Spindle parallel region.
-/// Only one such region can exist at a time.
-static bool inParallelRegion = false;
-
-
 // -------- HELPERS -------------------------------------------------------- //
 
-/// Retrieves the `hwloc` processing unit object to which the specified thread should be affinitized.
-/// Parameters specify the `hwloc` system topology, the task definition, and the SMT policy, all of which are used to identify the processing unit.
-/// Performs minimal, if any, error-checking and assumes a correct assignment of physical cores to tasks.
-/// @param [in] topology System topology object, from `hwloc`.
-/// @param [in] startPhysCore Starting physical core, part of the task specification.
-/// @param [in] endPhysCore Ending physical core, part of the task specification.
-/// @param [in] threadIndex Zero-based index of the thread within the task (in other words, the thread's local ID).
-/// @param [in] smtPolicy SMT policy, part of the task specification.
-/// @return Object representing the `hwloc` processing unit to which the specified thread should be affinitized.
-static hwloc_obj_t spindleHelperGetThreadAffinityObject(hwloc_topology_t topology, uint32_t startPhysCore, uint32_t endPhysCore, uint32_t threadIndex, ESpindleSMTPolicy smtPolicy)
+/// Creates or reuses a parallel region for the specified task specifications and initializes all of its thread barriers and collective state, ready for threads to be started.
+/// On failure, nothing remains allocated, and if the thread pool was claimed, it remains claimed.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskCount Number of tasks specified, which must be nonzero.
+/// @param [in] usePool `true` if the calling thread has claimed the thread pool, in which case a retained parallel region may be reused.
+/// @param [in] allowedCpuset Set of logical cores to which thread assignment is restricted, or `NULL` to allow all logical cores. See #spindlePlanThreadAssignments.
+/// @param [out] outRegion Filled with the parallel region, ready to run.
+/// @return 0 on success, or nonzero in the event of an error.
+static uint32_t spindleHelperPrepareRegion(SSpindleTaskConfig* taskSpec, uint32_t taskCount, bool usePool, hwloc_const_cpuset_t allowedCpuset, SSpindleRegion** outRegion)
 {
-    const uint32_t numPhysCoresAvailable = endPhysCore - startPhysCore + 1;
-    hwloc_obj_t affinityObject = NULL;
+    SSpindleRegion* region = NULL;
+    SSpindleTaskConfig* expandedTaskSpec = NULL;
+    uint32_t* taskSpecIndex = NULL;
+    uint32_t expandedTaskCount = 0;
+    uint32_t threadResult = 0;
+    
+    hwloc_topology_t topology;
+    
+    // Each thread holds the task count in a 16-bit field of its thread information.
+    if (taskCount > kSpindleRegionMaxTaskCount)
+        return __LINE__;
+    
+    // Obtain the hardware topology object for the current system.
+    topology = topoGetSystemTopologyObject();
+    if (NULL == topology)
+        return __LINE__;
+    
+    // If the thread pool retained a region for identical task specifications, skip straight to initializing it.
+    if (usePool)
+        region = spindlePoolReusePlan(taskSpec, taskCount);
     
-    switch (smtPolicy)
+    if (NULL == region)
     {
-    case SpindleSMTPolicyDisableSMT:
-        // Each thread consumes a whole physical core, so verify that the index is within bounds.
-        if (threadIndex < numPhysCoresAvailable)
+        // Replace any task specification that requests one task per cache domain with the tasks it represents.
+        threadResult = spindlePlanExpandTaskSpecs(topology, taskSpec, taskCount, allowedCpuset, &expandedTaskSpec, &taskSpecIndex, &expandedTaskCount, NULL);
+        if (0 != threadResult)
+            return threadResult;
+        
+        if (expandedTaskCount > kSpindleRegionMaxTaskCount)
         {
-            // First, get the physical core at the specified index.
-            hwloc_obj_t physicalCoreObject = hwloc_get_obj_by_type(topology, HWLOC_OBJ_CORE, startPhysCore + threadIndex);
-            
-            // Next, get the first logical core of the corresponding physical core.
-            if (NULL != physicalCoreObject)
-                affinityObject = hwloc_get_obj_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU, 0);
+            spindlePlanFreeExpandedTaskSpecs(taskSpec, expandedTaskSpec, taskSpecIndex);
+            return __LINE__;
         }
-        break;
-
-    case SpindleSMTPolicyPreferPhysical:
-        if (1)
+        
+        region = spindleCreateRegion();
+        if (NULL == region)
         {
-            // Calculate physical and logical core indices.
-            // The current implementation assumes all physical cores per task have the same number of logical cores.
-            const uint32_t physicalCoreIndex = startPhysCore + (threadIndex % numPhysCoresAvailable);
-            const uint32_t logicalCoreIndex = threadIndex / numPhysCoresAvailable;
-
-            // Obtain the correct physical core.
-            hwloc_obj_t physicalCoreObject = hwloc_get_obj_by_type(topology, HWLOC_OBJ_CORE, physicalCoreIndex);
-
-            // Obtain the correct logical core as the affinity object.
-            if (NULL != physicalCoreObject)
-                affinityObject = hwloc_get_obj_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU, logicalCoreIndex);
+            spindlePlanFreeExpandedTaskSpecs(taskSpec, expandedTaskSpec, taskSpecIndex);
+            return __LINE__;
         }
-        break;
-
-    case SpindleSMTPolicyPreferLogical:
-        if (1)
+        
+        // Assign threads to cores.
+        threadResult = spindlePlanThreadAssignments(topology, expandedTaskSpec, taskSpecIndex, expandedTaskCount, allowedCpuset, &region->threadAssignments, &region->threadCount, NULL);
+        if (0 != threadResult)
         {
-            // First, get the physical core at the starting physical core index and, from this, obtain the number of logical cores per physical core.
-            // The current implementation assumes all physical cores per task have the same number of logical cores.
-            hwloc_obj_t physicalCoreObject = hwloc_get_obj_by_type(topology, HWLOC_OBJ_CORE, startPhysCore);
-            if (NULL == physicalCoreObject)
-                break;
-
-            const uint32_t logicalCoresPerPhysicalCore = hwloc_get_nbobjs_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU);
-
-            // Next, calculate physical and logical core indices.
-            const uint32_t physicalCoreIndex = startPhysCore + (threadIndex / logicalCoresPerPhysicalCore);
-            const uint32_t logicalCoreIndex = threadIndex % logicalCoresPerPhysicalCore;
-
-            // Obtain the correct physical core.
-            physicalCoreObject = hwloc_get_obj_by_type(topology, HWLOC_OBJ_CORE, physicalCoreIndex);
-
-            // Obtain the correct logical core as the affinity object.
-            if (NULL != physicalCoreObject)
-                affinityObject = hwloc_get_obj_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU, logicalCoreIndex);
+            spindlePlanFreeExpandedTaskSpecs(taskSpec, expandedTaskSpec, taskSpecIndex);
+            spindleDestroyRegion(region);
+            return threadResult;
         }
-        break;
-
-    default:
-        break;
+        
+        region->taskCount = expandedTaskCount;
+        
+        for (uint32_t threadIndex = 0; threadIndex < region->threadCount; ++threadIndex)
+            region->threadAssignments[threadIndex].region = region;
+        
+        // Allocate all thread barrier and data sharing memory regions.
+        if ((NULL == spindleAllocateDataShareBuffers(region, expandedTaskCount))
+            || (NULL == spindleAllocateLocalThreadBarriers(region, expandedTaskCount))
+            || (NULL == spindleAllocateNodeThreadBarriers(region, region->threadAssignments, region->threadCount, expandedTaskCount))
+            || (false == spindleAllocateBarrierGroups(region, expandedTaskSpec, expandedTaskCount, region->threadAssignments, region->threadCount))
+            || (NULL == spindleAllocateReduceBuffers(region, region->threadAssignments, region->threadCount, expandedTaskCount))
+            || (NULL == spindleAllocateLoopShares(region, region->threadAssignments, region->threadCount, expandedTaskCount))
+            || (NULL == spindleAllocateWorkDeques(region, region->threadCount, expandedTaskCount))
+            || (false == spindleAllocateArenas(region, expandedTaskSpec, region->threadAssignments, region->threadCount))
+            || (false == spindleAllocateContextBlocks(region, expandedTaskSpec, expandedTaskCount, region->threadAssignments, region->threadCount)))
+        {
+            spindlePlanFreeExpandedTaskSpecs(taskSpec, expandedTaskSpec, taskSpecIndex);
+            spindleDestroyRegion(region);
+            return __LINE__;
+        }
+        
+        // Capture the barrier waiting policy for this parallel region from its first task, which a reused region retains since its task specifications are identical.
+        region->barrierSpinLimit = spindleGetBarrierSpinLimit(expandedTaskSpec[0].barrierWaitPolicy, expandedTaskSpec[0].barrierSpinIterations);
+        
+        spindlePlanFreeExpandedTaskSpecs(taskSpec, expandedTaskSpec, taskSpecIndex);
     }
     
-    return affinityObject;
-}
-
-
-// -------- FUNCTIONS ------------------------------------------------------ //
-// See "spindle.h" for documentation.
-
-bool spindleIsInParallelRegion(void)
-{
-    return inParallelRegion;
-}
-
-// --------
-
-uint32_t spindleThreadsSpawn(SSpindleTaskSpec* taskSpec, uint32_t taskCount, bool useCurrentThread)
-{
-    SSpindleThreadInfo* threadAssignments = NULL;
-    uint32_t nextThreadAssignmentIndex = 0;
-    uint32_t threadResult = 0;
+    // Calibrate the timestamp counter the first time any parallel region is spawned, so that timed barriers can report nanoseconds without delay.
+    spindleInitializeTimestampCounter();
     
-    hwloc_topology_t topology;
-    hwloc_obj_t numaNodeObject = NULL;
-    hwloc_obj_t physicalCoreObject = NULL;
-
-    uint32_t* taskStartPhysCore;
-    uint32_t* taskEndPhysCore;
-    uint32_t* taskNumThreads;
-    
-    uint32_t currentNumaNode = 0;
-    uint32_t threadsLeftOnCurrentNumaNode = 0;
-    uint32_t coresLeftOnCurrentNumaNode = 0;
-    uint32_t numThreadsRequested = 0;
-    uint32_t numNumaNodes = 0;
-    uint32_t totalNumThreads = 0;
-    
-    // Verify that a Spindle parallel region does not already exist.
-    if (false != spindleIsInParallelRegion())
-        return __LINE__;
+    // Select how threads spin at barriers, based on the capabilities of the processor.
+    spindleInitializeBarrierSpinMethod();
     
-    // It is trivially a success case if the number of tasks is zero.
-    if (0 == taskCount)
-        return 0;
+    // Initialize all thread barrier and reduction memory regions, using the first thread of each task to identify the task's size.
+    spindleInitializeGlobalThreadBarrier(region, region->threadCount);
     
-    // Obtain the hardware topology object for the current system.
-    topology = topoGetSystemTopologyObject();
-    if (NULL == topology)
-        return __LINE__;
+    for (uint32_t threadIndex = 0; threadIndex < region->threadCount; ++threadIndex)
+    {
+        if (0 == region->threadAssignments[threadIndex].localThreadID)
+            spindleInitializeLocalThreadBarrier(region, region->threadAssignments[threadIndex].taskID, region->threadAssignments[threadIndex].localThreadCount);
+    }
     
-    // Figure out the highest possible NUMA node index, for error-checking purposes.
-    numNumaNodes = topoGetSystemNUMANodeCount();
-    if (1 > numNumaNodes)
-        return __LINE__;
+    spindleInitializeBarrierGroups(region);
+    spindleInitializeReduceBuffers(region);
+    spindleInitializeLoopShares(region);
+    spindleInitializeWorkDeques(region);
+    spindleInitializeBarrierStats(region);
+    spindleInitializeTraceBuffers(region);
     
-    // Initialize data structures to assign from the first NUMA node in the system.
-    numaNodeObject = topoGetNUMANodeObjectAtIndex(currentNumaNode);
-    if (NULL == numaNodeObject)
-        return __LINE__;
+    region->completionFlag = 0;
+    region->completionWaiterIsSleeping = 0;
+    region->abortFlag = 0;
     
-    threadsLeftOnCurrentNumaNode = hwloc_get_nbobjs_inside_cpuset_by_type(topology, numaNodeObject->cpuset, HWLOC_OBJ_PU);
-    coresLeftOnCurrentNumaNode = hwloc_get_nbobjs_inside_cpuset_by_type(topology, numaNodeObject->cpuset, HWLOC_OBJ_CORE);
+    *outRegion = region;
+    return 0;
+}
+
+/// Spawns threads for a nested parallel region on behalf of a thread that already belongs to a parallel region, and waits for them to terminate.
+/// All tasks must be placed on the calling thread's NUMA node. If the calling thread's task reserves cores, threads are assigned only to those cores, otherwise only to the physical cores of the calling thread's task, including all of their logical cores.
+/// The calling thread's information is restored once the nested parallel region finishes, so it continues as a member of its own parallel region.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskCount Number of tasks specified, which must be nonzero.
+/// @param [in] useCurrentThread `true` if the calling thread should be used as a worker in the nested parallel region, `false` otherwise.
+/// @return 0 once all spawned threads have terminated, or nonzero in the event of an error.
+static uint32_t spindleHelperSpawnNested(SSpindleTaskConfig* taskSpec, uint32_t taskCount, bool useCurrentThread)
+{
+    SSpindleRegion* const parentRegion = spindleGetCurrentRegion();
+    const uint32_t parentGlobalThreadID = spindleGetGlobalThreadID();
+    const SSpindleThreadInfo* const parentThreadInfo = &parentRegion->threadAssignments[parentGlobalThreadID];
     
-    physicalCoreObject = hwloc_get_obj_inside_cpuset_by_type(topology, numaNodeObject->cpuset, HWLOC_OBJ_CORE, 0);
-    if (NULL == physicalCoreObject)
-        return __LINE__;
+    SSpindleRegion* region = NULL;
+    hwloc_cpuset_t allowedCpuset = NULL;
+    uint64_t savedThreadInfo[4];
+    uint32_t threadResult = 0;
     
-    // Allocate memory for assignment arrays.
-    taskStartPhysCore = (uint32_t*)malloc(sizeof(uint32_t) * taskCount);
-    if (NULL == taskStartPhysCore)
-        return __LINE__;
-
-    taskEndPhysCore = (uint32_t*)malloc(sizeof(uint32_t) * taskCount);
-    if (NULL == taskEndPhysCore)
+    // Nested parallel regions are confined to the NUMA node of the task that spawns them.
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
     {
-        free((void*)taskStartPhysCore);
-        return __LINE__;
+        if (taskSpec[taskIndex].numaNode != parentThreadInfo->numaNode)
+            return __LINE__;
     }
-
-    taskNumThreads = (uint32_t*)malloc(sizeof(uint32_t) * taskCount);
-    if (NULL == taskNumThreads)
-    {
-        free((void*)taskStartPhysCore);
-        free((void*)taskEndPhysCore);
+    
+    allowedCpuset = hwloc_bitmap_alloc();
+    if (NULL == allowedCpuset)
         return __LINE__;
-    }
     
-    // Assign ranges of physical cores to tasks, based on the task specifications.
-    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    // If the calling thread's task reserved cores, build the set of logical cores they contain.
+    if (0 != parentThreadInfo->reservedCoreCount)
     {
-        // Verify the task specification's NUMA node.
-        if (taskSpec[taskIndex].numaNode < currentNumaNode || taskSpec[taskIndex].numaNode >= numNumaNodes)
+        for (uint32_t reservedCoreIndex = 0; reservedCoreIndex < parentThreadInfo->reservedCoreCount; ++reservedCoreIndex)
         {
-            free((void*)taskStartPhysCore);
-            free((void*)taskEndPhysCore);
-            free((void*)taskNumThreads);
-            return __LINE__;
-        }
-        
-        // Reinitialize to a different NUMA node if the specified NUMA node is different.
-        if (taskSpec[taskIndex].numaNode != currentNumaNode)
-        {
-            currentNumaNode = taskSpec[taskIndex].numaNode;
-            
-            numaNodeObject = topoGetNUMANodeObjectAtIndex(currentNumaNode);
-            if (NULL == numaNodeObject)
-            {
-                free((void*)taskStartPhysCore);
-                free((void*)taskEndPhysCore);
-                free((void*)taskNumThreads);
-                return __LINE__;
-            }
-            
-            threadsLeftOnCurrentNumaNode = hwloc_get_nbobjs_inside_cpuset_by_type(topology, numaNodeObject->cpuset, HWLOC_OBJ_PU);
-            coresLeftOnCurrentNumaNode = hwloc_get_nbobjs_inside_cpuset_by_type(topology, numaNodeObject->cpuset, HWLOC_OBJ_CORE);
-            
-            physicalCoreObject = hwloc_get_obj_inside_cpuset_by_type(topology, numaNodeObject->cpuset, HWLOC_OBJ_CORE, 0);
+            hwloc_obj_t physicalCoreObject = hwloc_get_obj_by_type(parentThreadInfo->topology, HWLOC_OBJ_CORE, parentThreadInfo->reservedStartPhysCore + reservedCoreIndex);
             if (NULL == physicalCoreObject)
             {
-                free((void*)taskStartPhysCore);
-                free((void*)taskEndPhysCore);
-                free((void*)taskNumThreads);
-                return __LINE__;
-            }
-        }
-        
-        // Figure out the requested number of threads, based on any special constants passed.
-        switch (taskSpec[taskIndex].numThreads)
-        {
-        case kSpindleTaskSpecThreadsSameAsPrevious:
-            // Use the same number of threads as was ultimately used for the previous task.
-            if (0 == taskIndex)
-            {
-                // Cannot assign same as previous number of threads if the current task is the first one specified.
-                free((void*)taskStartPhysCore);
-                free((void*)taskEndPhysCore);
-                free((void*)taskNumThreads);
+                hwloc_bitmap_free(allowedCpuset);
                 return __LINE__;
             }
             
-            numThreadsRequested = taskNumThreads[taskIndex - 1];
-            break;
-        
-        default:
-            // Use whatever number of threads as was specified directly in the input.
-            numThreadsRequested = taskSpec[taskIndex].numThreads;
-            break;
+            hwloc_bitmap_or(allowedCpuset, allowedCpuset, physicalCoreObject->cpuset);
         }
-        
-        // Find the ending physical core for the current task, based on the number of threads specified.
-        if (kSpindleTaskSpecAllAvailableThreads == numThreadsRequested)
+    }
+    else
+    {
+        // Otherwise, build the set of logical cores on the physical cores that the calling thread's task occupies, so that the nested parallel region does not overlap any other task.
+        for (uint32_t threadIndex = 0; threadIndex < parentRegion->threadCount; ++threadIndex)
         {
-            // Verify that at least one core remains available on the current NUMA node.
-            if (1 > coresLeftOnCurrentNumaNode)
-            {
-                free((void*)taskStartPhysCore);
-                free((void*)taskEndPhysCore);
-                free((void*)taskNumThreads);
-                return __LINE__;
-            }
-            
-            // Assign the starting physical core for the current task.
-            taskStartPhysCore[taskIndex] = physicalCoreObject->logical_index;
+            hwloc_obj_t physicalCoreObject = NULL;
             
-            // Initialize the counter for the number of threads assigned to the present task.
-            taskNumThreads[taskIndex] = 0;
+            if (parentRegion->threadAssignments[threadIndex].taskID != parentThreadInfo->taskID)
+                continue;
             
-            // Consume all the remaining physical cores on the present node.
-            while (NULL != physicalCoreObject)
-            {
-                // Update the end physical core assignment.
-                taskEndPhysCore[taskIndex] = physicalCoreObject->logical_index;
-
-                // Update the number of threads assigned to the present task.
-                if (SpindleSMTPolicyDisableSMT == taskSpec[taskIndex].smtPolicy)
-                    taskNumThreads[taskIndex] += 1;
-                else
-                    taskNumThreads[taskIndex] += hwloc_get_nbobjs_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU);
-
-                // Move to the next physical core.
-                physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, numaNodeObject->cpuset, HWLOC_OBJ_CORE, physicalCoreObject);
-            }
-
-            // Update the numbers of available cores and threads on the present NUMA node.
-            coresLeftOnCurrentNumaNode = 0;
-            threadsLeftOnCurrentNumaNode = 0;
-        }
-        else
-        {
-            uint32_t numThreadsAssignedForTask = 0;
-            
-            // Verify a sufficient number of cores and threads left on the current NUMA node.
-            if (threadsLeftOnCurrentNumaNode < numThreadsRequested || (SpindleSMTPolicyDisableSMT == taskSpec[taskIndex].smtPolicy && coresLeftOnCurrentNumaNode < numThreadsRequested))
+            physicalCoreObject = hwloc_get_ancestor_obj_by_type(parentThreadInfo->topology, HWLOC_OBJ_CORE, parentRegion->threadAssignments[threadIndex].affinityObject);
+            if (NULL == physicalCoreObject)
             {
-                free((void*)taskStartPhysCore);
-                free((void*)taskEndPhysCore);
-                free((void*)taskNumThreads);
+                hwloc_bitmap_free(allowedCpuset);
                 return __LINE__;
             }
             
-            // Assign the starting physical core for the current task.
-            taskStartPhysCore[taskIndex] = physicalCoreObject->logical_index;
-
-            // Specify the number of threads for the current task.
-            taskNumThreads[taskIndex] = numThreadsRequested;
-            
-            // Assign one physical core at a time to the present task, 
-            while (numThreadsAssignedForTask < numThreadsRequested)
-            {
-                // Calculate the number of threads consumed by the present physical core.
-                const uint32_t numThreadsConsumed = hwloc_get_nbobjs_inside_cpuset_by_type(topology, physicalCoreObject->cpuset, HWLOC_OBJ_PU);
-
-                // Check for errors: there needs to be a valid physical core object at this point.
-                if (NULL == physicalCoreObject)
-                {
-                    free((void*)taskStartPhysCore);
-                    free((void*)taskEndPhysCore);
-                    free((void*)taskNumThreads);
-                    return __LINE__;
-                }
-                
-                // Update the end physical core assignment.
-                taskEndPhysCore[taskIndex] = physicalCoreObject->logical_index;
-                
-                // Add to the total number of threads assigned to the present task.
-                if (SpindleSMTPolicyDisableSMT == taskSpec[taskIndex].smtPolicy)
-                    numThreadsAssignedForTask += 1;
-                else
-                    numThreadsAssignedForTask += numThreadsConsumed;
-
-                // Deduct from the number of available cores and threads on the present NUMA node.
-                coresLeftOnCurrentNumaNode -= 1;
-                threadsLeftOnCurrentNumaNode -= numThreadsConsumed;
-
-                // Move to the next physical core.
-                physicalCoreObject = hwloc_get_next_obj_inside_cpuset_by_type(topology, numaNodeObject->cpuset, HWLOC_OBJ_CORE, physicalCoreObject);
-            }
+            hwloc_bitmap_or(allowedCpuset, allowedCpuset, physicalCoreObject->cpuset);
         }
-
-        // Update the total number of threads created globally.
-        totalNumThreads += taskNumThreads[taskIndex];
     }
     
-    // Allocate memory for thread assignments.
-    threadAssignments = (SSpindleThreadInfo*)malloc(sizeof(SSpindleThreadInfo) * totalNumThreads);
-    if (NULL == threadAssignments)
+    // Nested parallel regions never use the thread pool, which may already be serving the parent parallel region.
+    threadResult = spindleHelperPrepareRegion(taskSpec, taskCount, false, allowedCpuset, &region);
+    hwloc_bitmap_free(allowedCpuset);
+    
+    if (0 != threadResult)
+        return threadResult;
+    
+    // Running a thread of the nested parallel region on the calling thread replaces its thread information, so keep a copy.
+    spindleSaveThreadInfo(savedThreadInfo);
+    spindleTraceRecord(kSpindleTracePhaseBegin, "Nested region");
+    
+    threadResult = spindleCreateThreads(region->threadAssignments, region->threadCount, useCurrentThread);
+    
+    // Resume as a member of the parent parallel region, on the logical core to which the calling thread was originally affinitized.
+    if (useCurrentThread)
+        spindleAffinitizeCurrentOSThread(parentThreadInfo->topology, parentThreadInfo->affinityObject);
+    
+    spindleRestoreThreadInfo(savedThreadInfo);
+    spindleSelectThreadTraceBuffer(parentRegion, parentGlobalThreadID);
+    spindleSetInParallelRegion(true);
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+    
+    spindleReportBarrierStats(region);
+    spindleWriteTrace(region);
+    spindleDestroyRegion(region);
+    return threadResult;
+}
+
+
+/// Spawns threads for a parallel region, either nested or not, and waits for them to terminate.
+/// @param [in] taskSpec Complete task descriptions, as an array.
+/// @param [in] taskCount Number of tasks specified, which must be nonzero.
+/// @param [in] useCurrentThread `true` if the calling thread should be used as a worker, `false` otherwise.
+/// @return 0 once all spawned threads have terminated, or nonzero in the event of an error.
+static uint32_t spindleHelperSpawn(SSpindleTaskConfig* taskSpec, uint32_t taskCount, bool useCurrentThread)
+{
+    SSpindleRegion* region = NULL;
+    bool usePool = false;
+    uint32_t threadResult = 0;
+    
+    // If the calling thread is already part of a Spindle parallel region, the new one is nested inside it.
+    if (false != spindleIsInParallelRegion())
+        return spindleHelperSpawnNested(taskSpec, taskCount, useCurrentThread);
+    
+    // The thread pool serves one parallel region at a time, so concurrent parallel regions that cannot claim it create their own threads.
+    usePool = spindlePoolAcquire();
+    
+    threadResult = spindleHelperPrepareRegion(taskSpec, taskCount, usePool, NULL, &region);
+    if (0 != threadResult)
     {
-        free((void*)taskStartPhysCore);
-        free((void*)taskEndPhysCore);
-        free((void*)taskNumThreads);
-        return __LINE__;
+        if (usePool)
+            spindlePoolRelease();
+        
+        return threadResult;
     }
     
-    // Create thread information for each task.
-    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    // Entering a Spindle parallel region.
+    spindleSetInParallelRegion(true);
+    
+    // Create the threads, or hand them to persistent workers, and wait for the result.
+    if (usePool)
+        threadResult = spindlePoolRunThreads(region->threadAssignments, region->threadCount, useCurrentThread);
+    else
+        threadResult = spindleCreateThreads(region->threadAssignments, region->threadCount, useCurrentThread);
+    
+    // Exiting a Spindle parallel region.
+    spindleSetInParallelRegion(false);
+    spindleReportBarrierStats(region);
+    spindleWriteTrace(region);
+    
+    // Keep the region around for the next one if the thread pool was used, otherwise free allocated memory and return.
+    if (usePool)
     {
-        for (uint32_t threadIndex = 0; threadIndex < taskNumThreads[taskIndex]; ++threadIndex)
-        {
-            threadAssignments[nextThreadAssignmentIndex].func = taskSpec[taskIndex].func;
-            threadAssignments[nextThreadAssignmentIndex].arg = taskSpec[taskIndex].arg;
-            threadAssignments[nextThreadAssignmentIndex].topology = topology;
-            threadAssignments[nextThreadAssignmentIndex].affinityObject = spindleHelperGetThreadAffinityObject(topology, taskStartPhysCore[taskIndex], taskEndPhysCore[taskIndex], threadIndex, taskSpec[taskIndex].smtPolicy);
-            threadAssignments[nextThreadAssignmentIndex].localThreadID = threadIndex;
-            threadAssignments[nextThreadAssignmentIndex].globalThreadID = nextThreadAssignmentIndex;
-            threadAssignments[nextThreadAssignmentIndex].taskID = taskIndex;
-            threadAssignments[nextThreadAssignmentIndex].localThreadCount = taskNumThreads[taskIndex];
-            threadAssignments[nextThreadAssignmentIndex].globalThreadCount = totalNumThreads;
-            threadAssignments[nextThreadAssignmentIndex].taskCount = taskCount;
-
-            nextThreadAssignmentIndex += 1;
-        }
+        spindlePoolRetainPlan(taskSpec, taskCount, region);
+        spindlePoolRelease();
+        return threadResult;
     }
     
-    // Allocate and initialize all thread barrier and data sharing memory regions.
-    spindleInitializeGlobalThreadBarrier(totalNumThreads);
+    spindleDestroyRegion(region);
+    return threadResult;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+uint32_t spindleThreadsSpawn(SSpindleTaskSpec* taskSpec, uint32_t taskCount, bool useCurrentThread)
+{
+    return spindleThreadsSpawnWithOptions(taskSpec, NULL, taskCount, useCurrentThread);
+}
+
+// --------
+
+uint32_t spindleThreadsSpawnWithOptions(SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, bool useCurrentThread)
+{
+    SSpindleTaskConfig* resolvedTaskSpec = NULL;
+    uint32_t threadResult = 0;
     
-    if (NULL == spindleAllocateDataShareBuffers(taskCount))
-    {
-        free((void*)taskStartPhysCore);
-        free((void*)taskEndPhysCore);
-        free((void*)taskNumThreads);
-        free((void*)threadAssignments);
+    // It is trivially a success case if the number of tasks is zero.
+    if (0 == taskCount)
+        return 0;
+    
+    threadResult = spindlePlanResolveTaskSpecs(taskSpec, taskOptions, taskCount, &resolvedTaskSpec, NULL);
+    if (0 != threadResult)
+        return threadResult;
+    
+    threadResult = spindleHelperSpawn(resolvedTaskSpec, taskCount, useCurrentThread);
+    
+    free((void*)resolvedTaskSpec);
+    return threadResult;
+}
+
+// --------
+
+uint32_t spindleThreadsSpawnAsync(SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, TSpindleJoinHandle* handle)
+{
+    SSpindleTaskConfig* resolvedTaskSpec = NULL;
+    SSpindleRegion* region = NULL;
+    uint32_t threadResult = 0;
+    
+    *handle = NULL;
+    
+    // Verify that the calling thread is not already part of a Spindle parallel region.
+    if (false != spindleIsInParallelRegion())
         return __LINE__;
-    }
     
-    if (NULL == spindleAllocateLocalThreadBarriers(taskCount))
+    // It is trivially a success case if the number of tasks is zero.
+    if (0 == taskCount)
+        return 0;
+    
+    threadResult = spindlePlanResolveTaskSpecs(taskSpec, taskOptions, taskCount, &resolvedTaskSpec, NULL);
+    if (0 != threadResult)
+        return threadResult;
+    
+    // The thread pool is bound to a single controlling thread that waits for its workers, so asynchronous parallel regions always create their own threads.
+    threadResult = spindleHelperPrepareRegion(resolvedTaskSpec, taskCount, false, NULL, &region);
+    free((void*)resolvedTaskSpec);
+    
+    if (0 != threadResult)
+        return threadResult;
+    
+    // The calling thread does not take part, so it does not enter the parallel region.
+    threadResult = spindleLaunchThreads(region->threadAssignments, region->threadCount);
+    if (0 != threadResult)
     {
-        spindleFreeDataShareBuffers();
-        free((void*)taskStartPhysCore);
-        free((void*)taskEndPhysCore);
-        free((void*)taskNumThreads);
-        free((void*)threadAssignments);
-        return __LINE__;
+        spindleDestroyRegion(region);
+        return threadResult;
     }
     
-    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
-        spindleInitializeLocalThreadBarrier(taskIndex, taskNumThreads[taskIndex]);
+    *handle = region;
+    return 0;
+}
+
+// --------
+
+bool spindleThreadsPoll(TSpindleJoinHandle handle)
+{
+    if (NULL == handle)
+        return true;
     
-    // Free buffers no longer needed.
-    free((void*)taskStartPhysCore);
-    free((void*)taskEndPhysCore);
-    free((void*)taskNumThreads);
+    return spindleWaitForRegionCompletion(handle, 0);
+}
+
+// --------
+
+bool spindleThreadsWaitTimeout(TSpindleJoinHandle handle, uint32_t timeoutMilliseconds)
+{
+    if (NULL == handle)
+        return true;
     
-    // Entering a Spindle parallel region.
-    inParallelRegion = true;
+    return spindleWaitForRegionCompletion(handle, timeoutMilliseconds);
+}
+
+// --------
+
+uint32_t spindleThreadsJoin(TSpindleJoinHandle handle)
+{
+    uint32_t threadResult = 0;
     
-    // Create the threads and wait for the result.
-    threadResult = spindleCreateThreads(threadAssignments, totalNumThreads, useCurrentThread);
+    if (NULL == handle)
+        return 0;
     
-    // Exiting a Spindle parallel region.
-    inParallelRegion = false;
+    threadResult = spindleJoinThreads(handle->threadAssignments, handle->threadCount);
     
-    // Free allocated memory and return.
-    spindleFreeDataShareBuffers();
-    spindleFreeLocalThreadBarriers();
-    free((void*)threadAssignments);
+    spindleReportBarrierStats(handle);
+    spindleWriteTrace(handle);
+    spindleDestroyRegion(handle);
     return threadResult;
 }
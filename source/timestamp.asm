@@ -0,0 +1,45 @@
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Spindle
+;   Multi-platform topology-aware thread control library.
+;   Distributes a set of synchronized tasks over cores in the system.
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; Authored by Samuel Grossman
+; Department of Electrical Engineering, Stanford University
+; Copyright (c) 2016-2017
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+; timestamp.asm
+;   Implementation of processor queries used to calibrate the timestamp
+;   counter.
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+INCLUDE registers.inc
+
+
+_TEXT                                       SEGMENT
+
+
+; --------- FUNCTIONS ---------------------------------------------------------
+; See "timestamp.h" for documentation.
+
+spindleTimestampQueryCPUID                  PROC PUBLIC
+    ; CPUID overwrites rbx, which must be preserved, as well as rdx, which may hold the output pointer.
+    push                    rbx
+    mov                     r10,                    r_param3
+    mov                     eax,                    e_param1
+    mov                     ecx,                    e_param2
+    cpuid
+    
+    ; Store the results in register order.
+    mov                     DWORD PTR [r10],        eax
+    mov                     DWORD PTR [r10+4],      ebx
+    mov                     DWORD PTR [r10+8],      ecx
+    mov                     DWORD PTR [r10+12],     edx
+    pop                     rbx
+    ret
+spindleTimestampQueryCPUID                  ENDP
+
+
+_TEXT                                       ENDS
+
+
+END
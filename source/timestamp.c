@@ -0,0 +1,184 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file timestamp.c
+ *   Implementation of timestamp counter calibration and conversion of
+ *   barrier wait times to nanoseconds.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "osthread.h"
+#include "timestamp.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SPINDLE_WINDOWS
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Calibration state indicating that no thread has started calibrating the timestamp counter.
+#define kSpindleTimestampStateUncalibrated      0ull
+
+/// Calibration state indicating that one thread is calibrating the timestamp counter and others must wait for it.
+#define kSpindleTimestampStateCalibrating       1ull
+
+/// Calibration state indicating that the results of calibration are available.
+#define kSpindleTimestampStateCalibrated        2ull
+
+
+// -------- LOCALS --------------------------------------------------------- //
+
+/// Calibration state of the timestamp counter, which allows exactly one thread to calibrate it and publishes the results to all others.
+/// Different OS threads may spawn parallel regions at the same time, so this is claimed atomically and read with acquire semantics.
+static uint64_t timestampCalibrationState = kSpindleTimestampStateUncalibrated;
+
+/// Specifies whether the timestamp counter is invariant, meaning it advances at a constant rate regardless of frequency scaling and sleep states.
+static bool timestampInvariant = false;
+
+/// Frequency of the timestamp counter, in ticks per second.
+static uint64_t timestampFrequency = 0;
+
+/// Number of nanoseconds per tick of the timestamp counter, used for conversions.
+static double timestampNanosecondsPerTick = 0.0;
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Determines the frequency of the timestamp counter as reported by the processor.
+/// Only recent processors report the crystal clock frequency along with the ratio of the timestamp counter to it.
+/// @return Frequency in ticks per second, or 0 if the processor does not report it.
+static uint64_t spindleHelperTimestampReportedFrequency(void)
+{
+    uint32_t registers[4];
+
+    spindleTimestampQueryCPUID(0, 0, registers);
+    if (registers[0] < 0x15)
+        return 0;
+
+    // Leaf 0x15 reports the ratio as ebx / eax and the crystal clock frequency in ecx, any of which may be 0 if not enumerated.
+    spindleTimestampQueryCPUID(0x15, 0, registers);
+    if ((0 == registers[0]) || (0 == registers[1]) || (0 == registers[2]))
+        return 0;
+
+    return ((uint64_t)registers[2] * (uint64_t)registers[1]) / (uint64_t)registers[0];
+}
+
+/// Measures the frequency of the timestamp counter by comparing it against the operating system's clock.
+/// Busy-waits for #kSpindleTimestampCalibrationNanoseconds.
+/// @return Frequency in ticks per second.
+static uint64_t spindleHelperTimestampMeasuredFrequency(void)
+{
+    const uint64_t startTime = spindleGetOSTimeNanoseconds();
+    const uint64_t startTimestamp = __rdtsc();
+    uint64_t endTime = startTime;
+    uint64_t endTimestamp = startTimestamp;
+
+    while ((endTime - startTime) < kSpindleTimestampCalibrationNanoseconds)
+        endTime = spindleGetOSTimeNanoseconds();
+
+    endTimestamp = __rdtsc();
+    return (uint64_t)(((double)(endTimestamp - startTimestamp) * 1000000000.0) / (double)(endTime - startTime));
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "timestamp.h" for documentation.
+
+void spindleInitializeTimestampCounter(void)
+{
+    uint32_t registers[4];
+    uint64_t frequency = 0;
+
+    if (kSpindleTimestampStateCalibrated == atomic_load64_acquire(&timestampCalibrationState))
+        return;
+
+    // Exactly one thread calibrates. Any other waits for the results, which takes no longer than the calibration itself.
+    if (!atomic_cas64(&timestampCalibrationState, kSpindleTimestampStateUncalibrated, kSpindleTimestampStateCalibrating))
+    {
+        while (kSpindleTimestampStateCalibrated != atomic_load64_acquire(&timestampCalibrationState))
+            spin_pause();
+
+        return;
+    }
+
+    // Extended leaf 0x80000001 reports support for rdtscp in edx bit 27, and extended leaf 0x80000007 reports an invariant timestamp counter in edx bit 8.
+    spindleTimestampQueryCPUID(0x80000000, 0, registers);
+
+    if (registers[0] >= 0x80000007)
+    {
+        spindleTimestampQueryCPUID(0x80000007, 0, registers);
+        timestampInvariant = (0 != (registers[3] & (1u << 8)));
+    }
+
+    spindleTimestampQueryCPUID(0x80000000, 0, registers);
+
+    if (registers[0] >= 0x80000001)
+    {
+        spindleTimestampQueryCPUID(0x80000001, 0, registers);
+        spindleBarrierUseRdtscp = ((registers[3] >> 27) & 1);
+    }
+
+    frequency = spindleHelperTimestampReportedFrequency();
+    if (0 == frequency)
+        frequency = spindleHelperTimestampMeasuredFrequency();
+
+    timestampFrequency = frequency;
+    timestampNanosecondsPerTick = 1000000000.0 / (double)frequency;
+
+    // Publish the results only once all of them are written.
+    atomic_store64_release(&timestampCalibrationState, kSpindleTimestampStateCalibrated);
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+uint64_t spindleGetTimestampFrequency(void)
+{
+    spindleInitializeTimestampCounter();
+    return timestampFrequency;
+}
+
+// --------
+
+bool spindleIsTimestampInvariant(void)
+{
+    spindleInitializeTimestampCounter();
+    return timestampInvariant;
+}
+
+// --------
+
+uint64_t spindleTimestampToNanoseconds(uint64_t ticks)
+{
+    spindleInitializeTimestampCounter();
+    return (uint64_t)((double)ticks * timestampNanosecondsPerTick);
+}
+
+// --------
+
+uint64_t spindleTimedBarrierLocalNanoseconds(void)
+{
+    return spindleTimestampToNanoseconds(spindleTimedBarrierLocal());
+}
+
+// --------
+
+uint64_t spindleTimedBarrierGlobalNanoseconds(void)
+{
+    return spindleTimestampToNanoseconds(spindleTimedBarrierGlobal());
+}
@@ -0,0 +1,395 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file trace.c
+ *   Implementation of event tracing and export to the Chrome trace event
+ *   format.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "memory.h"
+#include "region.h"
+#include "threadlocal.h"
+#include "trace.h"
+#include "types.h"
+
+#include <hwloc.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <topo.h>
+
+#ifdef SPINDLE_WINDOWS
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+
+// -------- LOCALS --------------------------------------------------------- //
+
+/// Trace file to which subsequently-spawned parallel regions append their events, or `NULL` if event tracing is disabled.
+static FILE* traceFile = NULL;
+
+/// Specifies whether any entry has been written to the trace file, which determines whether the next entry needs a separating comma.
+static bool traceFileHasEntries = false;
+
+/// Lock that serializes writes to the trace file by parallel regions that finish at the same time. Nonzero while held.
+static volatile uint64_t traceFileLock = 0;
+
+/// Number of events each thread's trace buffer holds in subsequently-spawned parallel regions.
+static uint32_t traceEventCapacity = 0;
+
+/// Number of parallel regions written to the trace file so far, used to give each one a distinct process identifier.
+static uint32_t traceRegionCount = 0;
+
+/// Timestamp, captured using the `rdtsc` instruction, at which event tracing was enabled. All times in the trace file are relative to it.
+static uint64_t traceStartTimestamp = 0;
+
+
+// -------- GLOBALS -------------------------------------------------------- //
+// See "trace.h" for documentation.
+
+spindle_thread_local SSpindleTraceBuffer* spindleTraceThreadBuffer = NULL;
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Acquires the lock that serializes writes to the trace file.
+static void spindleHelperTraceLock(void)
+{
+    while (!atomic_cas64(&traceFileLock, 0, 1))
+        _mm_pause();
+}
+
+/// Releases the lock that serializes writes to the trace file.
+static void spindleHelperTraceUnlock(void)
+{
+    atomic_fence();
+    traceFileLock = 0;
+}
+
+/// Writes a string to the trace file as a quoted JSON string, escaping characters as needed.
+/// @param [in] str String to write.
+static void spindleHelperTraceWriteString(const char* str)
+{
+    fputc('"', traceFile);
+
+    for (; '\0' != *str; ++str)
+    {
+        if (('"' == *str) || ('\\' == *str))
+            fprintf(traceFile, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            fprintf(traceFile, "\\u%04x", (unsigned int)(unsigned char)*str);
+        else
+            fputc(*str, traceFile);
+    }
+
+    fputc('"', traceFile);
+}
+
+/// Begins a new entry in the trace file, separating it from the previous entry if there is one.
+static void spindleHelperTraceBeginEntry(void)
+{
+    if (traceFileHasEntries)
+        fputs(",\n", traceFile);
+
+    traceFileHasEntries = true;
+}
+
+/// Writes a metadata entry that names a process or thread in the trace file.
+/// @param [in] metadataName Kind of metadata, such as `process_name` or `thread_name`.
+/// @param [in] processID Process identifier to which the metadata applies.
+/// @param [in] threadID Thread identifier to which the metadata applies.
+/// @param [in] name Name to assign.
+static void spindleHelperTraceWriteName(const char* metadataName, uint32_t processID, uint32_t threadID, const char* name)
+{
+    spindleHelperTraceBeginEntry();
+    fprintf(traceFile, "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", metadataName, processID, threadID);
+    spindleHelperTraceWriteString(name);
+    fputs("}}", traceFile);
+}
+
+/// Records an event of the specified phase, category, and name on the calling thread, if the calling thread is being traced.
+/// Used by the functions that are part of the external API.
+/// @param [in] phase Phase of the event, one of the `kSpindleTracePhase` constants.
+/// @param [in] category Category of the event, one of the `kSpindleTraceCategory` constants.
+/// @param [in] name Name of the event.
+static void spindleHelperTraceRecordIfEnabled(uint32_t phase, uint32_t category, const char* name)
+{
+#ifdef SPINDLE_ENABLE_TRACING
+    if (NULL != spindleTraceThreadBuffer)
+        spindleTraceRecordEvent(spindleTraceThreadBuffer, phase, category, name);
+#endif
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "trace.h" for documentation.
+
+void spindleFreeTraceBuffers(SSpindleRegion* region)
+{
+    if (NULL != region->traceBufferTable)
+    {
+        hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+        for (uint32_t threadIndex = 0; threadIndex < region->traceBufferCount; ++threadIndex)
+        {
+            if (NULL != region->traceBufferTable[threadIndex])
+                spindleFreeOSMemory(topology, (void*)region->traceBufferTable[threadIndex], region->traceBufferTable[threadIndex]->allocatedSize, SpindlePageSizeDefault);
+        }
+
+        free((void*)region->traceBufferTable);
+        region->traceBufferTable = NULL;
+        region->traceBufferCount = 0;
+        region->traceEventCapacity = 0;
+    }
+}
+
+// --------
+
+void spindleInitializeTraceBuffers(SSpindleRegion* region)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+    // A parallel region retained by the thread pool keeps its buffers only if their capacity still matches the configuration.
+    if ((NULL == traceFile) || (region->traceEventCapacity != traceEventCapacity))
+        spindleFreeTraceBuffers(region);
+
+    if (NULL == traceFile)
+        return;
+
+    if (NULL == region->traceBufferTable)
+    {
+        if (NULL == topology)
+            return;
+
+        region->traceBufferTable = (SSpindleTraceBuffer**)malloc(sizeof(SSpindleTraceBuffer*) * region->threadCount);
+        if (NULL == region->traceBufferTable)
+            return;
+
+        memset((void*)region->traceBufferTable, 0, sizeof(SSpindleTraceBuffer*) * region->threadCount);
+        region->traceBufferCount = region->threadCount;
+        region->traceEventCapacity = traceEventCapacity;
+
+        for (uint32_t threadIndex = 0; threadIndex < region->threadCount; ++threadIndex)
+        {
+            const size_t allocatedSize = sizeof(SSpindleTraceBuffer) + (sizeof(SSpindleTraceEvent) * traceEventCapacity);
+            hwloc_obj_t numaNodeObject = topoGetNUMANodeObjectAtIndex(region->threadAssignments[threadIndex].numaNode);
+            SSpindleTraceBuffer* buffer = NULL;
+
+            if (NULL != numaNodeObject)
+                buffer = (SSpindleTraceBuffer*)spindleAllocateOSMemory(topology, numaNodeObject, allocatedSize, SpindlePageSizeDefault);
+
+            if (NULL == buffer)
+            {
+                spindleFreeTraceBuffers(region);
+                return;
+            }
+
+            buffer->capacityMask = (uint64_t)traceEventCapacity - 1;
+            buffer->allocatedSize = allocatedSize;
+
+            region->traceBufferTable[region->threadAssignments[threadIndex].globalThreadID] = buffer;
+        }
+    }
+
+    for (uint32_t threadIndex = 0; threadIndex < region->traceBufferCount; ++threadIndex)
+        region->traceBufferTable[threadIndex]->writeCount = 0;
+}
+
+// --------
+
+void spindleSelectThreadTraceBuffer(SSpindleRegion* region, uint32_t globalThreadID)
+{
+#ifdef SPINDLE_ENABLE_TRACING
+    spindleTraceThreadBuffer = ((NULL == region) || (NULL == region->traceBufferTable) ? NULL : region->traceBufferTable[globalThreadID]);
+#endif
+}
+
+// --------
+
+void spindleTraceRecordEvent(SSpindleTraceBuffer* buffer, uint32_t phase, uint32_t category, const char* name)
+{
+    SSpindleTraceEvent* const event = &buffer->events[buffer->writeCount & buffer->capacityMask];
+
+    event->timestamp = __rdtsc();
+    event->name = name;
+    event->phase = phase;
+    event->category = category;
+
+    buffer->writeCount += 1;
+}
+
+// --------
+
+void spindleWriteTrace(SSpindleRegion* region)
+{
+    hwloc_topology_t topology = topoGetSystemTopologyObject();
+    const double microsecondsPerTick = 1000000.0 / (double)spindleGetTimestampFrequency();
+    uint32_t processID = 0;
+    char name[128];
+
+    if (NULL == region->traceBufferTable)
+        return;
+
+    spindleHelperTraceLock();
+
+    if (NULL == traceFile)
+    {
+        spindleHelperTraceUnlock();
+        return;
+    }
+
+    traceRegionCount += 1;
+    processID = traceRegionCount;
+
+    snprintf(name, sizeof(name), "Spindle region %u", processID);
+    spindleHelperTraceWriteName("process_name", processID, 0, name);
+
+    for (uint32_t threadIndex = 0; threadIndex < region->traceBufferCount; ++threadIndex)
+    {
+        const SSpindleThreadInfo* const threadInfo = &region->threadAssignments[threadIndex];
+        const SSpindleTraceBuffer* const buffer = region->traceBufferTable[threadInfo->globalThreadID];
+        const hwloc_obj_t coreObject = (NULL == topology ? NULL : hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_CORE, threadInfo->affinityObject));
+        const uint64_t firstEvent = (buffer->writeCount > (buffer->capacityMask + 1) ? buffer->writeCount - (buffer->capacityMask + 1) : 0);
+
+        // Tracks are named by task, NUMA node, and core, and sorted by global thread ID.
+        snprintf(name, sizeof(name), "Task %u / Node %u / Core %u / PU %u", threadInfo->taskID, threadInfo->numaNode, (NULL == coreObject ? 0 : coreObject->logical_index), threadInfo->affinityObject->logical_index);
+        spindleHelperTraceWriteName("thread_name", processID, threadInfo->globalThreadID, name);
+
+        spindleHelperTraceBeginEntry();
+        fprintf(traceFile, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"sort_index\":%u}}", processID, threadInfo->globalThreadID, threadInfo->globalThreadID);
+
+        for (uint64_t eventIndex = firstEvent; eventIndex < buffer->writeCount; ++eventIndex)
+        {
+            const SSpindleTraceEvent* const event = &buffer->events[eventIndex & buffer->capacityMask];
+            const double eventTime = (double)(event->timestamp - traceStartTimestamp) * microsecondsPerTick;
+
+            spindleHelperTraceBeginEntry();
+            fprintf(traceFile, "{\"ph\":\"%c\",\"cat\":\"%s\",\"ts\":%.3f,\"pid\":%u,\"tid\":%u", (char)event->phase, (kSpindleTraceCategoryUser == event->category ? "user" : "spindle"), eventTime, processID, threadInfo->globalThreadID);
+
+            if (NULL != event->name)
+            {
+                fputs(",\"name\":", traceFile);
+                spindleHelperTraceWriteString(event->name);
+            }
+
+            if (kSpindleTracePhaseInstant == event->phase)
+                fputs(",\"s\":\"t\"", traceFile);
+
+            fputc('}', traceFile);
+        }
+    }
+
+    fflush(traceFile);
+    spindleHelperTraceUnlock();
+}
+
+// --------
+
+void spindleTraceBarrierLocal(void)
+{
+    spindleTraceRecord(kSpindleTracePhaseBegin, "Local barrier");
+    spindleBarrierLocalUntraced();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+}
+
+// --------
+
+void spindleTraceBarrierGlobal(void)
+{
+    spindleTraceRecord(kSpindleTracePhaseBegin, "Global barrier");
+    spindleBarrierGlobalUntraced();
+    spindleTraceRecord(kSpindleTracePhaseEnd, NULL);
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+uint32_t spindleSetTrace(const char* filePath, uint32_t eventsPerThread)
+{
+    FILE* newTraceFile = NULL;
+    uint32_t newEventCapacity = 1;
+
+    if (false != spindleIsInParallelRegion())
+        return __LINE__;
+
+#ifndef SPINDLE_ENABLE_TRACING
+    if (NULL != filePath)
+        return __LINE__;
+#endif
+
+    if (NULL != filePath)
+    {
+        // Ring buffers are indexed by masking, so the capacity is rounded up to a power of two.
+        if (0 == eventsPerThread)
+            eventsPerThread = kSpindleTraceDefaultEventCapacity;
+
+        if (eventsPerThread > 0x80000000u)
+            return __LINE__;
+
+        while (newEventCapacity < eventsPerThread)
+            newEventCapacity <<= 1;
+
+        newTraceFile = fopen(filePath, "w");
+        if (NULL == newTraceFile)
+            return __LINE__;
+    }
+
+    spindleHelperTraceLock();
+
+    // Complete the previous trace file, if any, so that it is valid JSON.
+    if (NULL != traceFile)
+    {
+        fputs("\n]\n", traceFile);
+        fclose(traceFile);
+    }
+
+    traceFile = newTraceFile;
+    traceFileHasEntries = false;
+    traceEventCapacity = (NULL == newTraceFile ? 0 : newEventCapacity);
+    traceRegionCount = 0;
+
+    if (NULL != traceFile)
+    {
+        fputs("[\n", traceFile);
+        traceStartTimestamp = __rdtsc();
+    }
+
+    spindleHelperTraceUnlock();
+    return 0;
+}
+
+// --------
+
+void spindleTraceBegin(const char* name)
+{
+    spindleHelperTraceRecordIfEnabled(kSpindleTracePhaseBegin, kSpindleTraceCategoryUser, name);
+}
+
+// --------
+
+void spindleTraceEnd(void)
+{
+    spindleHelperTraceRecordIfEnabled(kSpindleTracePhaseEnd, kSpindleTraceCategoryUser, NULL);
+}
+
+// --------
+
+void spindleTraceInstant(const char* name)
+{
+    spindleHelperTraceRecordIfEnabled(kSpindleTracePhaseInstant, kSpindleTraceCategoryUser, name);
+}
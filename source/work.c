@@ -0,0 +1,526 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file work.c
+ *   Implementation of work-stealing scheduling of dynamically-spawned work items.
+ *****************************************************************************/
+
+#include "../spindle.h"
+#include "align.h"
+#include "atomic.h"
+#include "barrier.h"
+#include "reduce.h"
+#include "region.h"
+#include "types.h"
+#include "work.h"
+
+#include <hwloc.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <topo.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Number of preference tiers into which steal victims are grouped.
+/// In order, these are threads on the same physical core, threads in the same task, threads on the same NUMA node, and all other threads.
+#define kSpindleWorkVictimTierCount             4
+
+/// Highest preference tier that can contain threads in the same task as the thief.
+#define kSpindleWorkVictimTierLastLocal         1
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Determines how strongly a thread prefers to steal from another, based on their relative locations in the system.
+/// @param [in] thief Thread assignment of the thread looking for work.
+/// @param [in] victim Thread assignment of the thread that might be stolen from.
+/// @param [in] thiefCore Physical core object of the thread looking for work, or `NULL` if unknown.
+/// @param [in] victimCore Physical core object of the thread that might be stolen from, or `NULL` if unknown.
+/// @return Preference tier, where lower values are preferred.
+static uint32_t spindleHelperWorkVictimTier(const SSpindleThreadInfo* thief, const SSpindleThreadInfo* victim, hwloc_obj_t thiefCore, hwloc_obj_t victimCore)
+{
+    if ((NULL != thiefCore) && (thiefCore == victimCore))
+        return 0;
+
+    if (thief->taskID == victim->taskID)
+        return 1;
+
+    if (thief->numaNode == victim->numaNode)
+        return 2;
+
+    return 3;
+}
+
+// --------
+
+/// Computes the number of bytes occupied by a thread's work-stealing state, including both of its victim lists, which immediately follow it.
+/// @param [in] localThreadCount Number of threads in the owning thread's task.
+/// @param [in] threadCount Number of threads in the parallel region.
+/// @return Number of bytes to allocate.
+static inline size_t spindleHelperWorkDequeSize(uint32_t localThreadCount, uint32_t threadCount)
+{
+    return sizeof(SSpindleWorkDeque) + (sizeof(uint32_t) * ((size_t)(localThreadCount - 1) + (size_t)(threadCount - 1)));
+}
+
+// --------
+
+/// Builds the orders in which the specified thread attempts to steal from other threads, one for local runs and one for global runs.
+/// Within each preference tier, threads are ordered starting from the one whose global thread ID follows the thief's, so that thieves in the same tier do not all converge on the same victim.
+/// @param [in] topology System topology object from `hwloc`.
+/// @param [in] threadAssignments Thread assignments, as an array.
+/// @param [in] threadCount Number of threads assigned.
+/// @param [in] thiefIndex Index of the thief within the thread assignments.
+/// @param [in] deque Work-stealing state of the thief, whose victim lists are to be filled.
+static void spindleHelperWorkBuildVictimLists(hwloc_topology_t topology, const SSpindleThreadInfo* threadAssignments, uint32_t threadCount, uint32_t thiefIndex, SSpindleWorkDeque* deque)
+{
+    const SSpindleThreadInfo* const thief = &threadAssignments[thiefIndex];
+    hwloc_obj_t thiefCore = (NULL == thief->affinityObject) ? NULL : hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_CORE, thief->affinityObject);
+    uint32_t localVictimCount = 0;
+    uint32_t globalVictimCount = 0;
+
+    for (uint32_t tier = 0; tier < kSpindleWorkVictimTierCount; ++tier)
+    {
+        for (uint32_t offset = 1; offset < threadCount; ++offset)
+        {
+            const SSpindleThreadInfo* const victim = &threadAssignments[(thiefIndex + offset) % threadCount];
+            hwloc_obj_t victimCore = (NULL == victim->affinityObject) ? NULL : hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_CORE, victim->affinityObject);
+
+            if (tier != spindleHelperWorkVictimTier(thief, victim, thiefCore, victimCore))
+                continue;
+
+            deque->globalVictims[globalVictimCount] = victim->globalThreadID;
+            globalVictimCount += 1;
+
+            // Local runs steal only from the thief's own task, in the same order.
+            if ((tier <= kSpindleWorkVictimTierLastLocal) && (thief->taskID == victim->taskID))
+            {
+                deque->localVictims[localVictimCount] = victim->globalThreadID;
+                localVictimCount += 1;
+            }
+        }
+    }
+
+    deque->localVictimCount = localVictimCount;
+    deque->globalVictimCount = globalVictimCount;
+}
+
+// --------
+
+/// Retrieves the calling thread's work-stealing state, allocating it on the thread's NUMA node the first time the thread uses the work-stealing scheduler.
+/// Parallel regions that never use the scheduler therefore pay only for the table of pointers.
+/// @param [in] region Calling thread's parallel region.
+/// @return Calling thread's work-stealing state, or `NULL` if it could not be allocated.
+static SSpindleWorkDeque* spindleHelperWorkGetDeque(SSpindleRegion* region)
+{
+    const uint32_t globalThreadID = spindleGetGlobalThreadID();
+    const SSpindleThreadInfo* const threadInfo = &region->threadAssignments[globalThreadID];
+    hwloc_topology_t topology = NULL;
+    hwloc_obj_t numaNodeObject = NULL;
+    SSpindleWorkDeque* deque = region->workDequeTable[globalThreadID];
+
+    if (NULL != deque)
+        return deque;
+
+    topology = topoGetSystemTopologyObject();
+    numaNodeObject = topoGetNUMANodeObjectAtIndex(threadInfo->numaNode);
+    if ((NULL == topology) || (NULL == numaNodeObject))
+        return NULL;
+
+    deque = (SSpindleWorkDeque*)hwloc_alloc_membind(topology, spindleHelperWorkDequeSize(threadInfo->localThreadCount, region->workThreadCount), numaNodeObject->cpuset, HWLOC_MEMBIND_BIND, 0);
+    if (NULL == deque)
+        return NULL;
+
+    deque->top = 0;
+    deque->bottom = 0;
+    deque->currentFrame = NULL;
+    deque->dequeTable = region->workDequeTable;
+    deque->localVictims = (uint32_t*)&deque[1];
+    deque->globalVictims = &deque->localVictims[threadInfo->localThreadCount - 1];
+    deque->victims = deque->globalVictims;
+    deque->victimCount = 0;
+    spindleHelperWorkBuildVictimLists(topology, region->threadAssignments, region->workThreadCount, globalThreadID, deque);
+
+    // Thieves must not see the work-stealing state before it is initialized.
+    atomic_fence();
+    *(SSpindleWorkDeque* volatile*)&region->workDequeTable[globalThreadID] = deque;
+
+    return deque;
+}
+
+// --------
+
+/// Copies a work item out of a deque slot that other threads may be writing concurrently.
+/// The slot is read through a volatile pointer so that the compiler cannot move the reads ahead of the index loads that make the slot valid.
+/// @param [in] slot Deque slot from which to read.
+/// @param [out] item Work item to fill.
+static inline void spindleHelperWorkReadItem(const volatile SSpindleWorkItem* slot, SSpindleWorkItem* item)
+{
+    item->func = slot->func;
+    item->arg = slot->arg;
+    item->parent = slot->parent;
+}
+
+// --------
+
+/// Pushes a work item onto the bottom of the calling thread's own deque.
+/// @param [in] deque Calling thread's work-stealing state.
+/// @param [in] item Work item to push.
+/// @return `true` if the item was pushed, `false` if the deque is full.
+static bool spindleHelperWorkPush(SSpindleWorkDeque* deque, const SSpindleWorkItem* item)
+{
+    const uint64_t bottom = deque->bottom;
+
+    if ((bottom - atomic_load64(&deque->top)) >= kSpindleWorkDequeCapacity)
+        return false;
+
+    // Thieves must not see the new bottom index before the item itself.
+    deque->items[bottom % kSpindleWorkDequeCapacity] = *item;
+    atomic_store64_release(&deque->bottom, bottom + 1);
+
+    return true;
+}
+
+// --------
+
+/// Pops a work item from the bottom of the calling thread's own deque, competing with thieves only for the last remaining item.
+/// @param [in] deque Calling thread's work-stealing state.
+/// @param [out] item Work item to fill.
+/// @return `true` if an item was obtained, `false` if the deque is empty.
+static bool spindleHelperWorkPop(SSpindleWorkDeque* deque, SSpindleWorkItem* item)
+{
+    const uint64_t bottom = deque->bottom;
+    uint64_t top;
+    bool obtained = true;
+
+    if (0 == bottom)
+        return false;
+
+    // Claiming the item must become visible to thieves before checking whether any of them got there first.
+    *(volatile uint64_t*)&deque->bottom = bottom - 1;
+    atomic_fence();
+    top = atomic_load64(&deque->top);
+
+    if (top > (bottom - 1))
+    {
+        *(volatile uint64_t*)&deque->bottom = bottom;
+        return false;
+    }
+
+    spindleHelperWorkReadItem(&deque->items[(bottom - 1) % kSpindleWorkDequeCapacity], item);
+
+    if (top == (bottom - 1))
+    {
+        obtained = atomic_cas64(&deque->top, top, top + 1);
+        *(volatile uint64_t*)&deque->bottom = bottom;
+    }
+
+    return obtained;
+}
+
+// --------
+
+/// Attempts to steal a work item from the top of another thread's deque.
+/// @param [in] deque Victim's work-stealing state.
+/// @param [out] item Work item to fill.
+/// @return `true` if an item was obtained, `false` if the deque is empty or another thread took the item first.
+static bool spindleHelperWorkSteal(SSpindleWorkDeque* deque, SSpindleWorkItem* item)
+{
+    const uint64_t top = atomic_load64(&deque->top);
+    uint64_t bottom;
+
+    atomic_fence();
+    bottom = atomic_load64(&deque->bottom);
+
+    if (top >= bottom)
+        return false;
+
+    spindleHelperWorkReadItem(&deque->items[top % kSpindleWorkDequeCapacity], item);
+    return atomic_cas64(&deque->top, top, top + 1);
+}
+
+// --------
+
+/// Attempts to steal a work item from each eligible victim in order of preference, stopping at the first success.
+/// @param [in] deque Calling thread's work-stealing state.
+/// @param [out] item Work item to fill.
+/// @return `true` if an item was obtained, `false` otherwise.
+static bool spindleHelperWorkStealAny(SSpindleWorkDeque* deque, SSpindleWorkItem* item)
+{
+    for (uint32_t victimIndex = 0; victimIndex < deque->victimCount; ++victimIndex)
+    {
+        // Threads that have not yet used the work-stealing scheduler have no work-stealing state, and therefore nothing to steal.
+        SSpindleWorkDeque* const victimDeque = *(SSpindleWorkDeque* volatile*)&deque->dequeTable[deque->victims[victimIndex]];
+
+        if ((NULL != victimDeque) && spindleHelperWorkSteal(victimDeque, item))
+            return true;
+    }
+
+    return false;
+}
+
+// --------
+
+/// Obtains a work item to execute while waiting, preferring the calling thread's own most recently spawned work item and otherwise stealing one.
+/// @param [in] deque Calling thread's work-stealing state.
+/// @param [out] item Work item to fill.
+/// @return `true` if an item was obtained, `false` otherwise.
+static inline bool spindleHelperWorkFind(SSpindleWorkDeque* deque, SSpindleWorkItem* item)
+{
+    return (spindleHelperWorkPop(deque, item) || spindleHelperWorkStealAny(deque, item));
+}
+
+// --------
+
+/// Executes a work item, waits for all the work items it spawns to complete, and then notifies its parent.
+/// While waiting, the calling thread executes its own work items or steals others.
+/// @param [in] deque Calling thread's work-stealing state.
+/// @param [in] item Work item to execute.
+static void spindleHelperWorkExecute(SSpindleWorkDeque* deque, const SSpindleWorkItem* item)
+{
+    SSpindleWorkFrame* const previousFrame = deque->currentFrame;
+    SSpindleWorkFrame frame;
+    SSpindleWorkItem child;
+
+    frame.pending = 0;
+    deque->currentFrame = &frame;
+
+    item->func(item->arg);
+
+    while (0 != atomic_load64(&frame.pending))
+    {
+        if (spindleHelperWorkFind(deque, &child))
+            spindleHelperWorkExecute(deque, &child);
+        else
+            spin_pause();
+    }
+
+    deque->currentFrame = previousFrame;
+
+    if (NULL != item->parent)
+        atomic_fetch_add64(&item->parent->pending, (uint64_t)-1);
+}
+
+// --------
+
+/// Runs a root work item to completion using the specified set of threads, all of which must call this function.
+/// The first thread executes the root work item, and all other threads steal work until the root work item and all its descendants complete.
+/// If a thread's work-stealing state cannot be allocated, it takes no part in stealing, and if that thread is the first, the root work item and all its descendants run on it alone.
+/// @param [in] done Flag that indicates completion of the root work item, which must be 0 on entry.
+/// @param [in] isGlobal `true` if all threads participate in the run, `false` if only the threads of the calling thread's task do.
+/// @param [in] isFirstThread `true` for exactly one thread in the set, which executes the root work item.
+/// @param [in] func Function to call for the root work item.
+/// @param [in] arg Argument to pass to the root work item.
+static void spindleHelperWorkRun(SSpindleBarrierData* done, bool isGlobal, bool isFirstThread, TSpindleFunc func, void* arg)
+{
+    SSpindleWorkDeque* const deque = spindleHelperWorkGetDeque(spindleGetCurrentRegion());
+    SSpindleWorkItem item;
+
+    if (NULL == deque)
+    {
+        if (isFirstThread)
+        {
+            func(arg);
+            atomic_store32_release(&done->value, 1);
+        }
+        else
+        {
+            while (0 == atomic_load32_acquire(&done->value))
+                spin_pause();
+        }
+
+        return;
+    }
+
+    deque->victims = (isGlobal ? deque->globalVictims : deque->localVictims);
+    deque->victimCount = (isGlobal ? deque->globalVictimCount : deque->localVictimCount);
+
+    if (isFirstThread)
+    {
+        item.func = func;
+        item.arg = arg;
+        item.parent = NULL;
+
+        spindleHelperWorkExecute(deque, &item);
+        atomic_store32_release(&done->value, 1);
+    }
+    else
+    {
+        while (0 == atomic_load32_acquire(&done->value))
+        {
+            if (spindleHelperWorkStealAny(deque, &item))
+                spindleHelperWorkExecute(deque, &item);
+            else
+                spin_pause();
+        }
+    }
+}
+
+// --------
+
+/// Resets the completion flag of a run.
+/// Invoked by the last thread to reach the barrier at the end of a run, once no thread can still be reading the flag.
+/// @param [in] arg Completion flag to reset.
+static void spindleHelperWorkResetDone(void* arg)
+{
+    ((SSpindleBarrierData*)arg)->value = 0;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "work.h" for documentation.
+
+void* spindleAllocateWorkDeques(SSpindleRegion* region, uint32_t threadCount, uint32_t taskCount)
+{
+    if (NULL != region->workDequeTable)
+        return region->workDequeTable;
+
+    // Only the table is allocated here. Each thread allocates its own work-stealing state the first time it uses the work-stealing scheduler.
+    region->workDequeTable = (SSpindleWorkDeque**)malloc(sizeof(SSpindleWorkDeque*) * threadCount);
+    if (NULL == region->workDequeTable)
+        return NULL;
+
+    memset((void*)region->workDequeTable, 0, sizeof(SSpindleWorkDeque*) * threadCount);
+    region->workThreadCount = threadCount;
+    region->workTaskCount = taskCount;
+
+    // There is one completion flag per task plus one for global runs.
+    region->workDoneBase = (SSpindleBarrierData*)aligned_malloc(sizeof(SSpindleBarrierData) * (1 + taskCount), sizeof(SSpindleBarrierData));
+    if (NULL == region->workDoneBase)
+    {
+        spindleFreeWorkDeques(region);
+        return NULL;
+    }
+
+    spindleInitializeWorkDeques(region);
+    return region->workDequeTable;
+}
+
+// --------
+
+void spindleFreeWorkDeques(SSpindleRegion* region)
+{
+    if (NULL != region->workDequeTable)
+    {
+        hwloc_topology_t topology = topoGetSystemTopologyObject();
+
+        for (uint32_t threadIndex = 0; threadIndex < region->workThreadCount; ++threadIndex)
+        {
+            if (NULL != region->workDequeTable[threadIndex])
+                hwloc_free(topology, (void*)region->workDequeTable[threadIndex], spindleHelperWorkDequeSize(region->threadAssignments[threadIndex].localThreadCount, region->workThreadCount));
+        }
+
+        free((void*)region->workDequeTable);
+
+        if (NULL != region->workDoneBase)
+            aligned_free((void*)region->workDoneBase);
+
+        region->workDequeTable = NULL;
+        region->workDoneBase = NULL;
+        region->workThreadCount = 0;
+        region->workTaskCount = 0;
+    }
+}
+
+// --------
+
+void spindleInitializeWorkDeques(SSpindleRegion* region)
+{
+    for (uint32_t threadIndex = 0; threadIndex < region->workThreadCount; ++threadIndex)
+    {
+        if (NULL == region->workDequeTable[threadIndex])
+            continue;
+
+        region->workDequeTable[threadIndex]->top = 0;
+        region->workDequeTable[threadIndex]->bottom = 0;
+        region->workDequeTable[threadIndex]->currentFrame = NULL;
+        region->workDequeTable[threadIndex]->victimCount = 0;
+    }
+
+    for (uint32_t doneIndex = 0; doneIndex <= region->workTaskCount; ++doneIndex)
+        region->workDoneBase[doneIndex].value = 0;
+}
+
+
+// -------- FUNCTIONS ------------------------------------------------------ //
+// See "spindle.h" for documentation.
+
+void spindleWorkRunLocal(TSpindleFunc func, void* arg)
+{
+    SSpindleRegion* const region = spindleGetCurrentRegion();
+    SSpindleBarrierData* const done = &region->workDoneBase[spindleGetTaskID()];
+
+    spindleHelperWorkRun(done, false, (0 == spindleGetLocalThreadID()), func, arg);
+    spindleCollectiveBarrierLocal(&spindleHelperWorkResetDone, (void*)done);
+}
+
+// --------
+
+void spindleWorkRunGlobal(TSpindleFunc func, void* arg)
+{
+    SSpindleRegion* const region = spindleGetCurrentRegion();
+    SSpindleBarrierData* const done = &region->workDoneBase[spindleGetTaskCount()];
+
+    spindleHelperWorkRun(done, true, (0 == spindleGetGlobalThreadID()), func, arg);
+    spindleCollectiveBarrierGlobal(&spindleHelperWorkResetDone, (void*)done);
+}
+
+// --------
+
+void spindleWorkSpawn(TSpindleFunc func, void* arg)
+{
+    SSpindleWorkDeque* const deque = spindleHelperWorkGetDeque(spindleGetCurrentRegion());
+    SSpindleWorkItem item;
+
+    // Without work-stealing state, the work item can only be executed immediately.
+    if (NULL == deque)
+    {
+        func(arg);
+        return;
+    }
+
+    item.func = func;
+    item.arg = arg;
+    item.parent = deque->currentFrame;
+
+    // Outside of a run there is nobody to steal the work item, and if the deque is full there is nowhere to put it, so in both cases it is executed immediately.
+    if (NULL != item.parent)
+    {
+        atomic_fetch_add64(&item.parent->pending, 1);
+
+        if (spindleHelperWorkPush(deque, &item))
+            return;
+    }
+
+    spindleHelperWorkExecute(deque, &item);
+}
+
+// --------
+
+void spindleWorkSync(void)
+{
+    SSpindleWorkDeque* const deque = spindleGetCurrentRegion()->workDequeTable[spindleGetGlobalThreadID()];
+
+    SSpindleWorkItem item;
+
+    // A thread without work-stealing state has never spawned a work item, so there is nothing to wait for.
+    if ((NULL == deque) || (NULL == deque->currentFrame))
+        return;
+
+    while (0 != atomic_load64(&deque->currentFrame->pending))
+    {
+        if (spindleHelperWorkFind(deque, &item))
+            spindleHelperWorkExecute(deque, &item);
+        else
+            spin_pause();
+    }
+}
@@ -0,0 +1,482 @@
+/*****************************************************************************
+ * Spindle
+ *   Multi-platform topology-aware thread control library.
+ *   Distributes a set of synchronized tasks over cores in the system.
+ *****************************************************************************
+ * Authored by Samuel Grossman
+ * Department of Electrical Engineering, Stanford University
+ * Copyright (c) 2016-2017
+ *************************************************************************//**
+ * @file plan.c
+ *   Tests of thread placement, which plan parallel regions on topologies
+ *   loaded from the XML files in the topologies directory and check the
+ *   resulting assignment of threads to cores.
+ *   Built and run by `make test`.
+ *****************************************************************************/
+
+#include <spindle.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// -------- CONSTANTS ------------------------------------------------------ //
+
+/// Maximum number of task specifications used by any test case.
+#define kTestMaxTaskCount                       4
+
+/// Maximum length of the path of a topology file.
+#define kTestMaxPathLength                      4096
+
+
+// -------- LOCALS --------------------------------------------------------- //
+
+/// Directory that contains the topology files, as passed on the command line.
+static const char* testTopologyDir = NULL;
+
+/// Number of test cases run.
+static uint32_t testCaseCount = 0;
+
+/// Number of test cases that failed.
+static uint32_t testFailureCount = 0;
+
+
+// -------- HELPERS -------------------------------------------------------- //
+
+/// Loads a topology from the topology directory, reporting a failure if it cannot be loaded.
+/// @param [in] fileName Name of the XML file within the topology directory.
+/// @return Handle to the loaded topology, or `NULL` on failure.
+static TSpindleTopology testHelperLoadTopology(const char* fileName)
+{
+    TSpindleTopology topology = NULL;
+    char filePath[kTestMaxPathLength];
+
+    snprintf(filePath, sizeof(filePath), "%s/%s", testTopologyDir, fileName);
+
+    if (0 != spindleTopologyLoadXML(filePath, &topology))
+    {
+        printf("FAIL  load %s\n", filePath);
+        testFailureCount += 1;
+        return NULL;
+    }
+
+    return topology;
+}
+
+// --------
+
+/// Fills task specifications and their options with defaults: one thread on the first NUMA node, preferring physical cores.
+/// Functions are never called when planning, so none is set.
+/// @param [out] taskSpec Task specifications, as an array.
+/// @param [out] taskOptions Task options, as an array parallel to the task specifications.
+/// @param [in] taskCount Number of tasks.
+static void testHelperInitTasks(SSpindleTaskSpec* taskSpec, SSpindleTaskOptions* taskOptions, uint32_t taskCount)
+{
+    spindleTaskOptionsInit(taskOptions, taskCount);
+
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex)
+    {
+        taskSpec[taskIndex].func = NULL;
+        taskSpec[taskIndex].arg = NULL;
+        taskSpec[taskIndex].numaNode = 0;
+        taskSpec[taskIndex].numThreads = 1;
+        taskSpec[taskIndex].smtPolicy = SpindleSMTPolicyPreferPhysical;
+    }
+}
+
+// --------
+
+/// Plans the specified tasks and checks the task and logical core of every thread against expectations.
+/// Logical cores are identified by the logical indices that `hwloc` assigns, which for the topologies used here also identify the physical core and NUMA node.
+/// @param [in] caseName Name of the test case, for reporting.
+/// @param [in] topology Topology on which to plan.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskOptions Task options, as an array parallel to the task specifications.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] expectedThreadCount Number of threads expected.
+/// @param [in] expectedTaskID Task ID expected for each thread, indexed by global thread ID.
+/// @param [in] expectedLogicalCore Logical core expected for each thread, indexed by global thread ID.
+static void testHelperExpectPlan(const char* caseName, TSpindleTopology topology, SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, uint32_t expectedThreadCount, const uint32_t* expectedTaskID, const uint32_t* expectedLogicalCore)
+{
+    SSpindlePlan plan;
+    bool passed = true;
+
+    testCaseCount += 1;
+
+    if (0 != spindlePlanThreads(topology, taskSpec, taskOptions, taskCount, &plan))
+    {
+        printf("FAIL  %s: planning failed for task %u: %s\n", caseName, plan.errorTaskID, plan.errorMessage);
+        testFailureCount += 1;
+        spindlePlanFree(&plan);
+        return;
+    }
+
+    if (expectedThreadCount != plan.threadCount)
+    {
+        printf("FAIL  %s: expected %u threads, planned %u\n", caseName, expectedThreadCount, plan.threadCount);
+        passed = false;
+    }
+
+    for (uint32_t threadIndex = 0; (threadIndex < plan.threadCount) && (threadIndex < expectedThreadCount); ++threadIndex)
+    {
+        if ((expectedTaskID[threadIndex] != plan.threads[threadIndex].taskID) || (expectedLogicalCore[threadIndex] != plan.threads[threadIndex].logicalCore))
+        {
+            printf("FAIL  %s: expected thread %u as task %u on logical core %u, planned task %u on logical core %u\n", caseName, threadIndex, expectedTaskID[threadIndex], expectedLogicalCore[threadIndex], plan.threads[threadIndex].taskID, plan.threads[threadIndex].logicalCore);
+            passed = false;
+        }
+    }
+
+    if (passed)
+        printf("PASS  %s\n", caseName);
+    else
+        testFailureCount += 1;
+
+    spindlePlanFree(&plan);
+}
+
+// --------
+
+/// Plans the specified tasks and checks that planning fails, blaming the expected task specification.
+/// @param [in] caseName Name of the test case, for reporting.
+/// @param [in] topology Topology on which to plan.
+/// @param [in] taskSpec Task specifications, as an array.
+/// @param [in] taskOptions Task options, as an array parallel to the task specifications.
+/// @param [in] taskCount Number of tasks specified.
+/// @param [in] expectedErrorTaskID Index of the task specification expected to be blamed, or #kSpindlePlanNoTask.
+static void testHelperExpectPlanError(const char* caseName, TSpindleTopology topology, SSpindleTaskSpec* taskSpec, const SSpindleTaskOptions* taskOptions, uint32_t taskCount, uint32_t expectedErrorTaskID)
+{
+    SSpindlePlan plan;
+
+    testCaseCount += 1;
+
+    if (0 == spindlePlanThreads(topology, taskSpec, taskOptions, taskCount, &plan))
+    {
+        printf("FAIL  %s: planning succeeded unexpectedly\n", caseName);
+        testFailureCount += 1;
+    }
+    else if (expectedErrorTaskID != plan.errorTaskID)
+    {
+        printf("FAIL  %s: expected an error for task %u, got one for task %u: %s\n", caseName, expectedErrorTaskID, plan.errorTaskID, plan.errorMessage);
+        testFailureCount += 1;
+    }
+    else
+    {
+        printf("PASS  %s\n", caseName);
+    }
+
+    spindlePlanFree(&plan);
+}
+
+
+// -------- TEST CASES ----------------------------------------------------- //
+
+/// Tests alignment of tasks to cache domains.
+/// The topology has 2 NUMA nodes, each with 2 cache domains of 4 physical cores, each with 2 logical cores.
+static void testCacheDomains(void)
+{
+    TSpindleTopology topology = testHelperLoadTopology("cache-domains.xml");
+    SSpindleTaskSpec taskSpec[kTestMaxTaskCount];
+    SSpindleTaskOptions taskOptions[kTestMaxTaskCount];
+
+    if (NULL == topology)
+        return;
+
+    // Two tasks of 3 physical cores each: the second straddles both cache domains unless aligned.
+    testHelperInitTasks(taskSpec, taskOptions, 2);
+    taskSpec[0].numThreads = 3;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyDisableSMT;
+    taskSpec[1] = taskSpec[0];
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 1, 1, 1 };
+        const uint32_t expectedLogicalCore[] = { 0, 2, 4, 6, 8, 10 };
+        testHelperExpectPlan("cache domains ignored", topology, taskSpec, taskOptions, 2, 6, expectedTaskID, expectedLogicalCore);
+    }
+
+    taskOptions[0].cachePolicy = SpindleCachePolicyAlign;
+    taskOptions[1].cachePolicy = SpindleCachePolicyAlign;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 1, 1, 1 };
+        const uint32_t expectedLogicalCore[] = { 0, 2, 4, 8, 10, 12 };
+        testHelperExpectPlan("cache domains aligned", topology, taskSpec, taskOptions, 2, 6, expectedTaskID, expectedLogicalCore);
+    }
+
+    // One task per cache domain of the second NUMA node, each with 2 threads sharing a physical core.
+    testHelperInitTasks(taskSpec, taskOptions, 1);
+    taskSpec[0].numaNode = 1;
+    taskSpec[0].numThreads = 2;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyPreferLogical;
+    taskOptions[0].cachePolicy = SpindleCachePolicyTaskPerDomain;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 1, 1 };
+        const uint32_t expectedLogicalCore[] = { 16, 17, 24, 25 };
+        testHelperExpectPlan("one task per cache domain", topology, taskSpec, taskOptions, 1, 4, expectedTaskID, expectedLogicalCore);
+    }
+
+    spindleTopologyFree(topology);
+}
+
+// --------
+
+/// Tests scattering a task's threads over the physical cores available to it.
+static void testScatter(void)
+{
+    TSpindleTopology topology = testHelperLoadTopology("cache-domains.xml");
+    SSpindleTaskSpec taskSpec[kTestMaxTaskCount];
+    SSpindleTaskOptions taskOptions[kTestMaxTaskCount];
+
+    if (NULL == topology)
+        return;
+
+    // Four threads spread over the 8 physical cores of the first NUMA node, even though each would fit on half as many.
+    testHelperInitTasks(taskSpec, taskOptions, 1);
+    taskSpec[0].numThreads = 4;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyPreferLogical;
+    taskOptions[0].placementPolicy = SpindlePlacementPolicyScatter;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 0 };
+        const uint32_t expectedLogicalCore[] = { 0, 4, 8, 12 };
+        testHelperExpectPlan("scatter over a NUMA node", topology, taskSpec, taskOptions, 1, 4, expectedTaskID, expectedLogicalCore);
+    }
+
+    // Compact placement of the same task for comparison.
+    taskOptions[0].placementPolicy = SpindlePlacementPolicyCompact;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 0 };
+        const uint32_t expectedLogicalCore[] = { 0, 1, 2, 3 };
+        testHelperExpectPlan("compact on a NUMA node", topology, taskSpec, taskOptions, 1, 4, expectedTaskID, expectedLogicalCore);
+    }
+
+    // Scattering within each cache domain when one task is created per cache domain.
+    taskSpec[0].numThreads = 2;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyPreferPhysical;
+    taskOptions[0].placementPolicy = SpindlePlacementPolicyScatter;
+    taskOptions[0].cachePolicy = SpindleCachePolicyTaskPerDomain;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 1, 1 };
+        const uint32_t expectedLogicalCore[] = { 0, 4, 8, 12 };
+        testHelperExpectPlan("scatter within each cache domain", topology, taskSpec, taskOptions, 1, 4, expectedTaskID, expectedLogicalCore);
+    }
+
+    spindleTopologyFree(topology);
+}
+
+// --------
+
+/// Tests placement on a hybrid processor.
+/// The topology has 2 performance cores, each with 2 logical cores, followed by 4 efficiency cores, each with 1 logical core.
+static void testHybrid(void)
+{
+    TSpindleTopology topology = testHelperLoadTopology("hybrid.xml");
+    SSpindleTaskSpec taskSpec[kTestMaxTaskCount];
+    SSpindleTaskOptions taskOptions[kTestMaxTaskCount];
+
+    if (NULL == topology)
+        return;
+
+    // One task on all performance cores and one on all efficiency cores.
+    testHelperInitTasks(taskSpec, taskOptions, 2);
+    taskSpec[0].numThreads = kSpindleTaskSpecAllAvailableThreads;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyPreferLogical;
+    taskSpec[1] = taskSpec[0];
+    taskOptions[0].coreKindPolicy = SpindleCoreKindPolicyPerformance;
+    taskOptions[1].coreKindPolicy = SpindleCoreKindPolicyEfficiency;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 0, 1, 1, 1, 1 };
+        const uint32_t expectedLogicalCore[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+        testHelperExpectPlan("performance and efficiency tasks", topology, taskSpec, taskOptions, 2, 8, expectedTaskID, expectedLogicalCore);
+    }
+
+    // An efficiency task skips the performance cores that come first.
+    testHelperInitTasks(taskSpec, taskOptions, 1);
+    taskSpec[0].numThreads = 3;
+    taskOptions[0].coreKindPolicy = SpindleCoreKindPolicyEfficiency;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0 };
+        const uint32_t expectedLogicalCore[] = { 4, 5, 6 };
+        testHelperExpectPlan("efficiency task skips performance cores", topology, taskSpec, taskOptions, 1, 3, expectedTaskID, expectedLogicalCore);
+    }
+
+    // Preferring physical cores fills the single logical core of each efficiency core before the second logical cores of performance cores.
+    testHelperInitTasks(taskSpec, taskOptions, 1);
+    taskSpec[0].numThreads = 8;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        const uint32_t expectedLogicalCore[] = { 0, 2, 4, 5, 6, 7, 1, 3 };
+        testHelperExpectPlan("mixed core kinds preferring physical cores", topology, taskSpec, taskOptions, 1, 8, expectedTaskID, expectedLogicalCore);
+    }
+
+    // Only 4 logical cores are performance cores.
+    testHelperInitTasks(taskSpec, taskOptions, 1);
+    taskSpec[0].numThreads = 5;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyPreferLogical;
+    taskOptions[0].coreKindPolicy = SpindleCoreKindPolicyPerformance;
+    testHelperExpectPlanError("too many threads for performance cores", topology, taskSpec, taskOptions, 1, 0);
+
+    spindleTopologyFree(topology);
+}
+
+// --------
+
+/// Tests replication of a task specification across NUMA nodes.
+/// The topology has 4 NUMA nodes, each with 4 physical cores of 2 logical cores.
+static void testAllNUMANodes(void)
+{
+    TSpindleTopology topology = testHelperLoadTopology("four-nodes.xml");
+    SSpindleTaskSpec taskSpec[kTestMaxTaskCount];
+    SSpindleTaskOptions taskOptions[kTestMaxTaskCount];
+
+    if (NULL == topology)
+        return;
+
+    // One task of 2 threads on every NUMA node, each packed onto a single physical core.
+    testHelperInitTasks(taskSpec, taskOptions, 1);
+    taskSpec[0].numaNode = kSpindleTaskSpecAllNUMANodes;
+    taskSpec[0].numThreads = 2;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 1, 1, 2, 2, 3, 3 };
+        const uint32_t expectedLogicalCore[] = { 0, 1, 8, 9, 16, 17, 24, 25 };
+        testHelperExpectPlan("all NUMA nodes", topology, taskSpec, taskOptions, 1, 8, expectedTaskID, expectedLogicalCore);
+    }
+
+    // Only the second and fourth NUMA nodes.
+    taskOptions[0].numaNodeMask = 0xA;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 1, 1 };
+        const uint32_t expectedLogicalCore[] = { 8, 9, 24, 25 };
+        testHelperExpectPlan("NUMA node mask", topology, taskSpec, taskOptions, 1, 4, expectedTaskID, expectedLogicalCore);
+    }
+
+    // A mask that selects no NUMA node in the topology.
+    taskOptions[0].numaNodeMask = 0x30;
+    testHelperExpectPlanError("NUMA node mask outside the topology", topology, taskSpec, taskOptions, 1, 0);
+
+    // Replicated tasks interleave with others in order of NUMA node, keeping the order of the array within each NUMA node.
+    testHelperInitTasks(taskSpec, taskOptions, 3);
+    taskSpec[0].numaNode = 2;
+    taskSpec[1].numaNode = kSpindleTaskSpecAllNUMANodes;
+    taskSpec[2].numaNode = 0;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 1, 2, 3, 4, 5 };
+        const uint32_t expectedLogicalCore[] = { 0, 2, 8, 16, 18, 24 };
+        testHelperExpectPlan("replicated and single tasks mixed", topology, taskSpec, taskOptions, 3, 6, expectedTaskID, expectedLogicalCore);
+    }
+
+    // Errors identify the task specification as the caller wrote it, not the task created from it.
+    taskSpec[2].numaNode = 9;
+    testHelperExpectPlanError("invalid NUMA node after reordering", topology, taskSpec, taskOptions, 3, 2);
+
+    spindleTopologyFree(topology);
+}
+
+// --------
+
+/// Tests requests for the same number of threads as the previous task specification when tasks are reordered by NUMA node.
+/// The topology has 4 NUMA nodes, each with 4 physical cores of 2 logical cores.
+static void testSameAsPrevious(void)
+{
+    TSpindleTopology topology = testHelperLoadTopology("four-nodes.xml");
+    SSpindleTaskSpec taskSpec[kTestMaxTaskCount];
+    SSpindleTaskOptions taskOptions[kTestMaxTaskCount];
+
+    if (NULL == topology)
+        return;
+
+    // The previous task specification in the array is planned after the one that refers to it.
+    testHelperInitTasks(taskSpec, taskOptions, 2);
+    taskSpec[0].numaNode = 1;
+    taskSpec[0].numThreads = 4;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyPreferLogical;
+    taskSpec[1].numaNode = 0;
+    taskSpec[1].numThreads = kSpindleTaskSpecThreadsSameAsPrevious;
+    taskSpec[1].smtPolicy = SpindleSMTPolicyPreferLogical;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 0, 1, 1, 1, 1 };
+        const uint32_t expectedLogicalCore[] = { 0, 1, 2, 3, 8, 9, 10, 11 };
+        testHelperExpectPlan("same as previous on an earlier NUMA node", topology, taskSpec, taskOptions, 2, 8, expectedTaskID, expectedLogicalCore);
+    }
+
+    // The task planned just before the one that refers to the previous task specification was created from a different one.
+    testHelperInitTasks(taskSpec, taskOptions, 3);
+    taskSpec[0].numThreads = 4;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyPreferLogical;
+    taskSpec[1].numaNode = 1;
+    taskSpec[1].numThreads = 2;
+    taskSpec[1].smtPolicy = SpindleSMTPolicyPreferLogical;
+    taskSpec[2].numThreads = kSpindleTaskSpecThreadsSameAsPrevious;
+    taskSpec[2].smtPolicy = SpindleSMTPolicyPreferLogical;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 0, 1, 1, 2, 2 };
+        const uint32_t expectedLogicalCore[] = { 0, 1, 2, 3, 4, 5, 8, 9 };
+        testHelperExpectPlan("same as previous after reordering", topology, taskSpec, taskOptions, 3, 8, expectedTaskID, expectedLogicalCore);
+    }
+
+    // An automatically-determined number of threads is used once the previous task specification has been planned.
+    testHelperInitTasks(taskSpec, taskOptions, 3);
+    taskSpec[0].numaNode = 2;
+    taskSpec[0].smtPolicy = SpindleSMTPolicyDisableSMT;
+    taskSpec[1].numThreads = kSpindleTaskSpecAllAvailableThreads;
+    taskSpec[1].smtPolicy = SpindleSMTPolicyDisableSMT;
+    taskSpec[2].numaNode = 1;
+    taskSpec[2].numThreads = kSpindleTaskSpecThreadsSameAsPrevious;
+    taskSpec[2].smtPolicy = SpindleSMTPolicyDisableSMT;
+
+    {
+        const uint32_t expectedTaskID[] = { 0, 0, 0, 0, 1, 1, 1, 1, 2 };
+        const uint32_t expectedLogicalCore[] = { 0, 2, 4, 6, 8, 10, 12, 14, 16 };
+        testHelperExpectPlan("same as previous with all available threads", topology, taskSpec, taskOptions, 3, 9, expectedTaskID, expectedLogicalCore);
+    }
+
+    // An automatically-determined number of threads is not yet known if the previous task specification is planned later.
+    testHelperInitTasks(taskSpec, taskOptions, 2);
+    taskSpec[0].numaNode = 1;
+    taskSpec[0].numThreads = kSpindleTaskSpecAllAvailableThreads;
+    taskSpec[1].numThreads = kSpindleTaskSpecThreadsSameAsPrevious;
+    testHelperExpectPlanError("same as previous planned on a later NUMA node", topology, taskSpec, taskOptions, 2, 1);
+
+    // The first task specification has no previous one, even if it is not the first planned.
+    testHelperInitTasks(taskSpec, taskOptions, 2);
+    taskSpec[0].numaNode = 1;
+    taskSpec[0].numThreads = kSpindleTaskSpecThreadsSameAsPrevious;
+    testHelperExpectPlanError("same as previous for the first task", topology, taskSpec, taskOptions, 2, 0);
+
+    spindleTopologyFree(topology);
+}
+
+
+// -------- ENTRY POINT ---------------------------------------------------- //
+
+int main(int argc, char* argv[])
+{
+    if (2 != argc)
+    {
+        fprintf(stderr, "Usage: %s <topology directory>\n", argv[0]);
+        return 1;
+    }
+
+    testTopologyDir = argv[1];
+
+    testCacheDomains();
+    testScatter();
+    testHybrid();
+    testAllNUMANodes();
+    testSameAsPrevious();
+
+    printf("%u of %u test cases passed.\n", testCaseCount - testFailureCount, testCaseCount);
+    return ((0 == testFailureCount) ? 0 : 1);
+}